@@ -1,31 +1,84 @@
 #pragma once
 
 #include "mesh.h"
+#include <cstring>
 #include <filesystem>
+#include <optional>
+#include <vector>
 #include <framework/disable_all_warnings.h>
 DISABLE_WARNINGS_PUSH()
 #include <tinygltf/tiny_gltf.h>
 #include "mesh_io_gltf.h"
 DISABLE_WARNINGS_POP()
 
+//An occurrence of a mesh of a MeshScene
+struct MeshInstance {
+    unsigned int mesh; //Index of MeshScene::meshes
+    glm::mat4 transform; //From the space of the mesh to world space
+};
+
+//The unique meshes of a glTF scene and where they appear, see TinyGLTFLoader::loadScene
+struct MeshScene {
+    std::vector<Mesh> meshes;
+    std::vector<MeshInstance> instances;
+};
+
+//A node of the hierarchy that poses a MeshSkin, with the keyframes of the animation that moves it
+struct SkinNode {
+    int parent = -1; //Index of MeshSkin::nodes, always lower than the index of this node. -1 for a root.
+    glm::vec3 translation{0.0f};
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec3 scale{1.0f};
+    std::optional<glm::mat4> matrix; //Replaces translation, rotation and scale. glTF does not animate nodes with a matrix.
+    //Without keyframes if the property is not animated
+    TransformationChannel<glm::vec3> translationChannel;
+    TransformationChannel<glm::quat> rotationChannel;
+    TransformationChannel<glm::vec3> scaleChannel;
+
+    //The transform relative to the parent at a time of the animation
+    [[nodiscard]] glm::mat4 localTransform(float time) const;
+};
+
+/**
+ * The skin of a micro-mesh: the joints that move its base vertices and the node hierarchy and animation that move the
+ * joints, see TinyGLTFLoader::loadSkin. Linear blend skinning moves a vertex by the sum of the joint matrices of its
+ * joints, weighted by its weights.
+ */
+struct MeshSkin {
+    std::vector<SkinNode> nodes; //Every node of the file, parents before their children
+    std::vector<unsigned int> jointNodes; //Per joint, index of nodes
+    std::vector<glm::mat4> inverseBindMatrices; //Per joint, from the space of the mesh to the space of the joint in the bind pose
+    std::vector<glm::uvec4> joints; //Per base vertex of the mesh, the joints that move it
+    std::vector<glm::vec4> weights; //Per base vertex, how much each of its joints moves it. They sum to 1.
+    float duration = 0.0f; //Of the animation, 0 if the file does not have one
+
+    //Per joint, the transform from the bind pose to the pose at a time of the animation
+    [[nodiscard]] std::vector<glm::mat4> jointMatrices(float time) const;
+};
+
 class TinyGLTFLoader {
     tinygltf::Model umeshModel;
     SubdivisionMesh umesh;
 
     template <typename T>
-    std::vector<T> getAttributeData(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const std::string& attributeName) {
+    static std::vector<T> getAttributeData(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const std::string& attributeName) {
         return getBufferData<T>(model, primitive.attributes.at(attributeName));
     }
 
     template <typename T>
-    std::vector<T> getBufferData(const tinygltf::Model& model, const int index) const {
+    static std::vector<T> getBufferData(const tinygltf::Model& model, const int index) {
         const tinygltf::Accessor& accessor = model.accessors[index];
         const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
         const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
 
-        const auto* data = reinterpret_cast<const T*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
+        const unsigned char* data = &buffer.data[bufferView.byteOffset + accessor.byteOffset];
+        const int stride = accessor.ByteStride(bufferView);
+        if(stride <= 0 || static_cast<size_t>(stride) == sizeof(T)) return std::vector<T>(reinterpret_cast<const T*>(data), reinterpret_cast<const T*>(data) + accessor.count);
 
-        return std::vector<T>(data, data + accessor.count);
+        //Interleaved with other attributes
+        std::vector<T> elements(accessor.count);
+        for(size_t i = 0; i < elements.size(); i++) std::memcpy(&elements[i], data + i * stride, sizeof(T));
+        return elements;
     }
 
     /**
@@ -33,8 +86,46 @@ class TinyGLTFLoader {
     */
     [[nodiscard]] glm::vec3 getVertexDisplacementDir(glm::vec3 position) const;
 
+    //The indices of a primitive, whatever their component type, or 0, 1, 2, ... if it has none
+    static std::vector<unsigned int> getIndices(const tinygltf::Model& model, const tinygltf::Primitive& primitive);
+
+    /**
+    * Converts a triangle primitive without micro-mesh data to a Mesh with subdivision level 0: every triangle is its own
+    * only micro-triangle, without displacement.
+    */
+    static Mesh primitiveToMesh(const tinygltf::Model& model, const tinygltf::Primitive& primitive);
+
 public:
     TinyGLTFLoader(const std::filesystem::path& umeshFilePath , GLTFReadInfo& umeshReadInfo);
 
     Mesh toMesh();
+
+    /**
+    * Reads a micro-mesh (*.gltf file with a link to the *.bary file) and converts it to a Mesh.
+    */
+    static Mesh loadMesh(const std::filesystem::path& umeshFilePath);
+
+    /**
+    * Reads a glTF scene with any number of meshes, primitives and nodes. The nodes of the default scene are walked with
+    * their transforms, and every mesh is only converted once, however many nodes refer to it.
+    *
+    * micromesh-tools decodes one micro-mesh per file: the first primitive of the first mesh. Every other triangle
+    * primitive becomes a flat mesh with subdivision level 0 (see primitiveToMesh). To place more micro-meshes, a node can
+    * refer to another micro-mesh file with {"extras": {"umesh": "<path relative to this file>"}}.
+    *
+    * @param sceneFilePath the *.gltf or *.glb file
+    * @return the unique meshes and their instances
+    */
+    static MeshScene loadScene(const std::filesystem::path& sceneFilePath);
+
+    /**
+    * Reads the skin of the micro-mesh of a file (the first primitive of the first mesh, see loadMesh): the JOINTS_0 and
+    * WEIGHTS_0 of its base vertices, the skin of the node that places it (or the first skin of the file), every node with
+    * its transform, and the translations, rotations and scales of the first animation of the file. Vertices without any
+    * weight follow the first joint.
+    *
+    * @param umeshFilePath the *.gltf or *.glb file
+    * @throws std::runtime_error if the primitive has no joints and weights or the file has no skin
+    */
+    static MeshSkin loadSkin(const std::filesystem::path& umeshFilePath);
 };
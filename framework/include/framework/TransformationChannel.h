@@ -1,18 +1,41 @@
 #pragma once
 
 #include <framework/disable_all_warnings.h>
-#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 DISABLE_WARNINGS_PUSH()
 #include <glm/gtc/quaternion.hpp>
 #include <glm/fwd.hpp>
 DISABLE_WARNINGS_POP()
 
+//The interpolation modes of glTF animation samplers
+enum class InterpolationMode {
+    STEP,
+    LINEAR,
+    CUBICSPLINE
+};
+
+[[nodiscard]] inline InterpolationMode parseInterpolationMode(const std::string& name) {
+    if(name == "STEP") return InterpolationMode::STEP;
+    if(name == "LINEAR") return InterpolationMode::LINEAR;
+    if(name == "CUBICSPLINE") return InterpolationMode::CUBICSPLINE;
+
+    throw std::invalid_argument("Unknown interpolation mode: " + name);
+}
+
 template<typename T>
 T interpolate(const T& before, const T& after, float value);
 
+template<>
+inline float interpolate(const float& before, const float& after, const float value) {
+    return glm::mix(before, after, value); //Linear interpolation for scalars
+}
+
 template<>
 inline glm::vec3 interpolate(const glm::vec3& before, const glm::vec3& after, const float value) {
     return glm::mix(before, after, value); //Linear interpolation for vectors
@@ -23,58 +46,251 @@ inline glm::quat interpolate(const glm::quat& before, const glm::quat& after, co
     return glm::slerp(before, after, value); //Spherical linear interpolation for quats
 }
 
+//The tangent of keyframes that were added without one
+template<typename T>
+T zeroTangent() {
+    if constexpr(std::is_same_v<T, glm::quat>) return glm::quat(0.0f, 0.0f, 0.0f, 0.0f);
+    else return T(0.0f);
+}
+
+/**
+ * Cubic Hermite spline between two keyframes, as glTF defines CUBICSPLINE. Rotations are normalized afterwards.
+ *
+ * @param before the value at the first keyframe
+ * @param outTangent the out-tangent of the first keyframe
+ * @param inTangent the in-tangent of the second keyframe
+ * @param after the value at the second keyframe
+ * @param duration the time between the two keyframes, which scales the tangents
+ * @param value the time between the keyframes, from 0 to 1
+ */
+template<typename T>
+T interpolateCubic(const T& before, const T& outTangent, const T& inTangent, const T& after, const float duration, const float value) {
+    const float s2 = value * value;
+    const float s3 = s2 * value;
+
+    const T result = before * (2.0f * s3 - 3.0f * s2 + 1.0f) + outTangent * (duration * (s3 - 2.0f * s2 + value)) + after * (-2.0f * s3 + 3.0f * s2)
+        + inTangent * (duration * (s3 - s2));
+    if constexpr(std::is_same_v<T, glm::quat>) return glm::normalize(result);
+    else return result;
+}
+
+//Interpolates between keyframe `before` of flat keyframe arrays and the next one, see TransformationChannel
+template<typename T>
+T interpolateKeyframes(const InterpolationMode mode, const float* times, const T* values, const T* inTangents, const T* outTangents, const uint32_t before,
+                       const float animTime) {
+    const uint32_t after = before + 1;
+    if(animTime == times[before]) return values[before];
+
+    switch(mode) {
+        case InterpolationMode::STEP:
+            return values[before]; //Not really an interpolation style, just return transformation at `before`
+        case InterpolationMode::LINEAR:
+            return interpolate(values[before], values[after], (animTime - times[before]) / (times[after] - times[before]));
+        case InterpolationMode::CUBICSPLINE: {
+            const float duration = times[after] - times[before];
+            return interpolateCubic(values[before], outTangents[before], inTangents[after], values[after], duration, (animTime - times[before]) / duration);
+        }
+    }
+
+    throw std::runtime_error("There are only 3 interpolation modes, so code should never reach this.");
+}
+
+/**
+ * The keyframes of one animated property, sorted on time and stored as flat arrays: one of times, one of values and,
+ * for CUBICSPLINE, one of in-tangents and one of out-tangents. Times before the first or after the last keyframe are
+ * clamped to it.
+ *
+ * Finding the keyframes around a time is a binary search, unless a cursor is passed: a cursor remembers the keyframes of
+ * the previous lookup, and playing an animation forwards then only has to look at the next pair of keyframes.
+ */
 template<typename T>
 class TransformationChannel {
-    std::map<float, T> transformations;
-    std::string interpolationMode;
+public:
+    //Where the previous lookup of a channel was. Every thread that samples a channel keeps its own.
+    struct Cursor {
+        uint32_t keyframe = 0; //The keyframe before the time of the previous lookup
+    };
 
-    void getBeforeAndAfter(float time, std::pair<float, T>& before, std::pair<float, T>& after) {
-        auto lower = transformations.lower_bound(time);
-        auto upper = transformations.upper_bound(time);
+private:
+    std::vector<float> times;
+    std::vector<T> values;
+    std::vector<T> inTangents; //Same size as values, zero for keyframes that were added without tangents
+    std::vector<T> outTangents;
+    InterpolationMode interpolationMode = InterpolationMode::LINEAR;
+    Cursor cursor; //Of getTransformation
 
-        auto prev = std::prev(lower);
-        auto next = upper;
+    //Adds a keyframe, or replaces the one at the same time
+    void addKeyframe(const float time, const T& value, const T& inTangent, const T& outTangent) {
+        const auto position = std::ranges::lower_bound(times, time);
+        const auto index = position - times.begin();
 
-        before = *prev;
-        after = *next;
+        if(position != times.end() && *position == time) {
+            values[index] = value;
+            inTangents[index] = inTangent;
+            outTangents[index] = outTangent;
+            return;
+        }
+
+        times.insert(position, time);
+        values.insert(values.begin() + index, value);
+        inTangents.insert(inTangents.begin() + index, inTangent);
+        outTangents.insert(outTangents.begin() + index, outTangent);
     }
 
 public:
     TransformationChannel() = default;
 
-    void addTransformations(std::vector<float> time, std::vector<T> transformation) {
+    void addTransformations(const std::vector<float>& time, const std::vector<T>& transformation) {
         if(time.size() != transformation.size()) throw std::logic_error("Weird, the vectors have different size. This usually does not happen.");
 
-        for(int i = 0; i < time.size(); i++) {
-            transformations[time[i]] = transformation[i];
-        }
+        for(size_t i = 0; i < time.size(); i++) addKeyframe(time[i], transformation[i], zeroTangent<T>(), zeroTangent<T>());
+    }
+
+    /**
+     * Adds the keyframes of a CUBICSPLINE sampler.
+     *
+     * @param time the time of every keyframe
+     * @param tangentsAndValues per keyframe an in-tangent, a value and an out-tangent, in the order glTF stores them
+     */
+    void addCubicSplineTransformations(const std::vector<float>& time, const std::vector<T>& tangentsAndValues) {
+        if(3 * time.size() != tangentsAndValues.size()) throw std::logic_error("A cubic spline needs an in-tangent, a value and an out-tangent per keyframe.");
+
+        for(size_t i = 0; i < time.size(); i++) addKeyframe(time[i], tangentsAndValues[3 * i + 1], tangentsAndValues[3 * i], tangentsAndValues[3 * i + 2]);
+    }
+
+    void setInterpolationMode(const InterpolationMode mode) {
+        interpolationMode = mode;
     }
 
+    //STEP, LINEAR or CUBICSPLINE
     void setInterpolationMode(const std::string& im) {
-        interpolationMode = im;
+        interpolationMode = parseInterpolationMode(im);
     }
 
-    T getTransformation(float animTime) {
-        if(transformations.contains(animTime)) return transformations[animTime]; //Immediately return transformation if map contains it
+    [[nodiscard]] InterpolationMode getInterpolationMode() const {
+        return interpolationMode;
+    }
 
-        //Otherwise we need to interpolate between the two entries that is directly before and after the animation time
-        std::pair<float, T> before, after;
-        getBeforeAndAfter(animTime, before, after);
+    /**
+     * Finds the keyframe at or before a time, starting at the cursor: the same pair of keyframes and the next one are
+     * checked first, anything else is a binary search. The cursor is moved to the result.
+     *
+     * @return the keyframe at or before the time, clamped to the first and the second to last keyframe
+     */
+    [[nodiscard]] uint32_t findKeyframe(const float time, Cursor& c) const {
+        const auto last = static_cast<uint32_t>(times.size() - 1);
+        if(last == 0) return 0;
 
-        if(interpolationMode == "STEP") {
-            return transformations[before.first]; //Not really an interpolation style, just return transformation at `before`
-        } if(interpolationMode == "LINEAR") {
-            auto interpolatedTime = (animTime - before.first) / (after.first - before.first);
-            return interpolate(before.second, after.second, interpolatedTime);
-        } if(interpolationMode == "CUBICSPLINE") {
-            throw std::invalid_argument("Application does not support this animation type. Please add.");
-        }
+        uint32_t k = std::min(c.keyframe, last - 1);
+        if(times[k] <= time && time < times[k + 1]) return k;
+        if(k + 2 <= last && times[k + 1] <= time && time < times[k + 2]) return c.keyframe = k + 1;
+
+        const auto upper = std::upper_bound(times.begin(), times.end(), time);
+        k = static_cast<uint32_t>(std::clamp<std::ptrdiff_t>(upper - times.begin() - 1, 0, last - 1));
+        return c.keyframe = k;
+    }
 
-        throw std::runtime_error("There are only 3 interpolation modes, so code should never reach this.");
+    //Samples the channel at a time, see Cursor
+    [[nodiscard]] T sample(const float animTime, Cursor& c) const {
+        if(times.empty()) throw std::logic_error("The channel does not have any keyframes.");
+        if(animTime <= times.front()) return values.front();
+        if(animTime >= times.back()) return values.back();
+
+        return interpolateKeyframes(interpolationMode, times.data(), values.data(), inTangents.data(), outTangents.data(), findKeyframe(animTime, c), animTime);
+    }
+
+    //Samples the channel with a cursor of its own, so that playing it forwards is fast. Not thread-safe, see sample.
+    T getTransformation(const float animTime) {
+        return sample(animTime, cursor);
     }
 
     [[nodiscard]] float animationDuration() const {
-        return std::prev(transformations.end())->first;
+        return times.back();
+    }
+
+    [[nodiscard]] std::span<const float> keyframeTimes() const {
+        return times;
+    }
+
+    [[nodiscard]] std::span<const T> keyframeValues() const {
+        return values;
+    }
+
+    [[nodiscard]] std::span<const T> keyframeInTangents() const {
+        return inTangents;
+    }
+
+    [[nodiscard]] std::span<const T> keyframeOutTangents() const {
+        return outTangents;
     }
 };
 
+/**
+ * Many channels of the same type, such as the translations of every node of a scene, sampled at the same time in one
+ * pass. The keyframes of all channels are stored back to back in the same flat arrays, and every channel keeps a cursor,
+ * so playing them forwards reads the arrays from front to back.
+ */
+template<typename T>
+class TransformationChannels {
+    std::vector<float> times;
+    std::vector<T> values;
+    std::vector<T> inTangents;
+    std::vector<T> outTangents;
+    std::vector<uint32_t> firstKeyframes{0}; //The keyframes of channel i are firstKeyframes[i] until firstKeyframes[i + 1]
+    std::vector<InterpolationMode> modes;
+    std::vector<uint32_t> cursors; //Per channel, the keyframe before the previous time, relative to its first keyframe
+
+public:
+    //Copies the keyframes of a channel, which must have at least one, and returns its index
+    size_t addChannel(const TransformationChannel<T>& channel) {
+        if(channel.keyframeTimes().empty()) throw std::logic_error("The channel does not have any keyframes.");
+
+        times.insert(times.end(), channel.keyframeTimes().begin(), channel.keyframeTimes().end());
+        values.insert(values.end(), channel.keyframeValues().begin(), channel.keyframeValues().end());
+        inTangents.insert(inTangents.end(), channel.keyframeInTangents().begin(), channel.keyframeInTangents().end());
+        outTangents.insert(outTangents.end(), channel.keyframeOutTangents().begin(), channel.keyframeOutTangents().end());
+        firstKeyframes.push_back(static_cast<uint32_t>(times.size()));
+        modes.push_back(channel.getInterpolationMode());
+        cursors.push_back(0);
+
+        return modes.size() - 1;
+    }
+
+    [[nodiscard]] size_t channelCount() const {
+        return modes.size();
+    }
+
+    /**
+     * Samples every channel at the same time, see TransformationChannel::sample.
+     *
+     * @param animTime the time
+     * @param results the value of every channel, at least channelCount() of them
+     */
+    void sample(const float animTime, std::span<T> results) {
+        if(results.size() < modes.size()) throw std::logic_error("Not enough room for the values of every channel.");
+
+        for(size_t channel = 0; channel < modes.size(); channel++) {
+            const uint32_t first = firstKeyframes[channel];
+            const uint32_t last = firstKeyframes[channel + 1] - 1;
+
+            if(animTime <= times[first] || first == last) {
+                results[channel] = values[first];
+                continue;
+            }
+            if(animTime >= times[last]) {
+                results[channel] = values[last];
+                continue;
+            }
+
+            //The same pair of keyframes as before, the next one, or a binary search
+            uint32_t before = first + cursors[channel];
+            if(!(times[before] <= animTime && animTime < times[before + 1])) {
+                if(before + 2 <= last && times[before + 1] <= animTime && animTime < times[before + 2]) before++;
+                else before = static_cast<uint32_t>(std::upper_bound(times.begin() + first, times.begin() + last + 1, animTime) - times.begin() - 1);
+                cursors[channel] = before - first;
+            }
+
+            results[channel] = interpolateKeyframes(modes[channel], times.data(), values.data(), inTangents.data(), outTangents.data(), before, animTime);
+        }
+    }
+};
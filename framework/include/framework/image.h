@@ -14,9 +14,13 @@ DISABLE_WARNINGS_POP()
 struct Image {
 public:
     explicit Image(const std::filesystem::path& filePath);
+    //Creates a black image of the given size
+    Image(int width, int height, int channels);
 
 
-    void writeBitmapToFile(const std::filesystem::path& filePath);
+    //Both return false if the file could not be written
+    bool writeBitmapToFile(const std::filesystem::path& filePath);
+    bool writePNGToFile(const std::filesystem::path& filePath);
 
 public:
     int width, height, channels;
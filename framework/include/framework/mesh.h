@@ -3,6 +3,9 @@
 #include <framework/disable_all_warnings.h>
 #include <glm/gtc/quaternion.hpp>
 #include "TransformationChannel.h"
+#include <cstdint>
+#include <span>
+#include <unordered_map>
 #include <vector>
 #include "../../src/Triangle2D.h"
 #include "../../src/TriangleData.h"
@@ -26,6 +29,25 @@ struct Triangle {
 	[[nodiscard]] int subdivisionLevel() const;
 };
 
+//A micro-vertex whose displacement was changed with Mesh::setDisplacement
+struct DisplacementEdit {
+	unsigned int triangle; //Index of the triangles array of the Mesh struct
+	unsigned int microVertex; //Index of the uVertices array of that triangle
+	glm::vec3 previousDisplacement; //The displacement before the first edit since the last Mesh::clearDirty()
+};
+
+//Which micro-triangles make up each hierarchy triangle of a triangle, in the order of Mesh::triangleMinMaxDisplacements and Mesh::triangleDeltas.
+//Only depends on the undisplaced micro-vertices, so it stays valid when displacements are edited.
+struct TriangleHierarchy {
+	std::vector<glm::uvec3> corners; //Per hierarchy triangle, the micro-vertices at its corners
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> firstChildren; //The four children of a hierarchy triangle are next to each other. 0 for the deepest hierarchy triangles.
+	std::vector<unsigned int> faceOffsets; //The micro-triangles of deepest hierarchy triangle i are faces[faceOffsets[i]] until faces[faceOffsets[i + 1]], none for the others
+	std::vector<glm::uvec3> faces;
+	std::vector<unsigned int> vertexLeafOffsets; //The deepest hierarchy triangles that hold micro-vertex v are vertexLeaves[vertexLeafOffsets[v]] until vertexLeaves[vertexLeafOffsets[v + 1]]
+	std::vector<unsigned int> vertexLeaves;
+};
+
 struct Vertex {
 	glm::vec3 position;
 	glm::vec3 normal;
@@ -48,18 +70,69 @@ public:
 
 	//Compute hierarchical minimum and maximum displacements (except for the lowest subdivision level)
 	[[nodiscard]] std::vector<glm::vec2> minMaxDisplacements(std::vector<TriangleData>& tData) const;
+	//Same for a single triangle with a subdivision level above 0, appended to minMaxDisplacements
+	void triangleMinMaxDisplacements(const Triangle& t, std::vector<glm::vec2>& minMaxDisplacements) const;
 
 	//Compute delta for each hierarchical triangle in 2D. Delta represents a scalar by how much to expand the edges to include micro-vertices of future subdivision levels.
 	//So if we have a displaced triangle, and we project it onto the base triangle's plane, we compute 3 vertex positions that bounds all micro-vertices in that triangle (also that of
 	//future subdivision levels).
 	//We return a vector that contains deltas hierarchically, but do not store the lowest subdivision level. So if a triangle has subdivision level 2, a total of 5 deltas will be
 	//made for a single triangle. One delta for level 0, and four deltas for level 1.
-	[[nodiscard]] std::vector<float> triangleDeltas(const std::vector<int>& dOffsets) const;
+	[[nodiscard]] std::vector<float> triangleDeltas() const;
+	//Same for a single triangle with a subdivision level above 0, appended to deltas
+	void triangleDeltas(const Triangle& t, std::vector<float>& deltas) const;
 
 	//For each micro-vertex in each triangle, we compute the displacement scales.
 	//The displacement scale should be multiplied with the (interpolated) displacement direction to get the displacement vector
 	std::vector<float> computeDisplacementScales(std::vector<TriangleData>& tData) const;
 
+	//Same for a single micro-vertex of a triangle, -1 if it is not present
+	[[nodiscard]] float displacementScale(const Triangle& t, const uVertex& uv) const;
+
 	//Returns true if all triangles of the mesh have the same subdivision level. False if not
 	[[nodiscard]] bool hasUniformSubdivisionLevel() const;
+
+	//Sets the displacement of a micro-vertex and marks it dirty. Displacements are baked as scales of the interpolated direction (see computeDisplacementScales), so they should stay along it.
+	//Micro-vertices on an edge are stored by both triangles of that edge, set both to keep the surface closed.
+	void setDisplacement(unsigned int triangle, unsigned int microVertex, const glm::vec3& displacement);
+	//Every micro-vertex that was set since the last clearDirty(), once, in the order they were first set
+	[[nodiscard]] const std::vector<DisplacementEdit>& dirtyMicroVertices() const;
+	void clearDirty();
+
+	/**
+	 * Moves base vertices, for example to the pose of a skinned or keyframed frame, and with them the micro-vertices of the triangles around them: every micro-vertex keeps its
+	 * barycentric coordinates in its triangle and the scale of its displacement along the interpolated direction (see computeDisplacementScales), so the baked scales stay valid.
+	 * The triangles around each vertex are found the first time this is called, so triangles must not be added or removed afterwards.
+	 * Apply displacement edits (see setDisplacement) before moving vertices, their previous displacements are not moved.
+	 *
+	 * @param indices the vertices to move
+	 * @param moved their new position, normal and direction, in the same order
+	 * @return the triangles that use a moved vertex, once each and in increasing order
+	 */
+	std::vector<unsigned int> moveVertices(std::span<const unsigned int> indices, std::span<const Vertex> moved);
+
+	//Computes which micro-triangles make up each hierarchy triangle of a triangle with a subdivision level above 0
+	[[nodiscard]] TriangleHierarchy triangleHierarchy(const Triangle& t) const;
+
+	/**
+	 * Updates the min-max displacements and deltas of a triangle after some of its micro-vertices were edited, giving the same values as triangleMinMaxDisplacements and triangleDeltas.
+	 * Only the hierarchy triangles that hold an edited micro-vertex are updated. The min-max displacements of a hierarchy triangle are those of its four children, and its delta only
+	 * has to be recomputed from all of its micro-vertices if an edited one was the farthest outside and moved inwards, or is one of its corners.
+	 *
+	 * @param t the edited triangle
+	 * @param hierarchy the result of triangleHierarchy(t)
+	 * @param edits the edits of this triangle
+	 * @param minMaxDisplacements the min-max displacements of this triangle, updated in place
+	 * @param deltas the deltas of this triangle, updated in place
+	 * @return the number of hierarchy triangles that were updated
+	 */
+	size_t updateTriangleHierarchy(const Triangle& t, const TriangleHierarchy& hierarchy, std::span<const DisplacementEdit> edits,
+	                               std::span<glm::vec2> minMaxDisplacements, std::span<float> deltas) const;
+
+private:
+	std::vector<DisplacementEdit> dirty;
+	std::unordered_map<uint64_t, size_t> dirtyIndices; //Key (triangle << 32) | microVertex, value index of dirty
+	//Only filled by moveVertices: the triangles that use vertex v are vertexTriangles[vertexTriangleOffsets[v]] until vertexTriangles[vertexTriangleOffsets[v + 1]]
+	std::vector<unsigned int> vertexTriangleOffsets;
+	std::vector<unsigned int> vertexTriangles;
 };
@@ -1,24 +1,61 @@
 #include "TinyGLTFLoader.h"
 
 #include <framework/disable_all_warnings.h>
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <optional>
 #include <ranges>
 #include <unordered_set>
 DISABLE_WARNINGS_PUSH()
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 DISABLE_WARNINGS_POP()
 
-TinyGLTFLoader::TinyGLTFLoader(const std::filesystem::path& umeshFilePath, GLTFReadInfo& umeshReadInfo) {
+//Reads a *.gltf or *.glb file
+static void loadModel(const std::filesystem::path& filePath, tinygltf::Model& model) {
     std::string err, warn;
     tinygltf::TinyGLTF loader;
 
-    if(umeshFilePath.extension().string() == ".gltf") {
-        if(!loader.LoadASCIIFromFile(&umeshModel, &err, &warn, umeshFilePath.string())) throw std::runtime_error("Failed to load GLTF: " + err);
+    if(filePath.extension().string() == ".gltf") {
+        if(!loader.LoadASCIIFromFile(&model, &err, &warn, filePath.string())) throw std::runtime_error("Failed to load GLTF: " + err);
     } else {
-        if(!loader.LoadBinaryFromFile(&umeshModel, &err, &warn, umeshFilePath.string())) throw std::runtime_error("Failed to load GLB: " + err);
+        if(!loader.LoadBinaryFromFile(&model, &err, &warn, filePath.string())) throw std::runtime_error("Failed to load GLB: " + err);
     }
 
     if(!warn.empty()) std::cerr << "GLTF Warning: " << warn << std::endl;
+}
+
+//The transform of a node relative to its parent: its matrix, or its translation, rotation and scale
+static glm::mat4 localTransform(const tinygltf::Node& node) {
+    if(node.matrix.size() == 16) return glm::mat4(glm::make_mat4(node.matrix.data()));
+
+    glm::mat4 transform(1.0f);
+    if(node.translation.size() == 3) transform = glm::translate(transform, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
+    if(node.rotation.size() == 4) {
+        transform *= glm::mat4_cast(glm::quat(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]), static_cast<float>(node.rotation[1]),
+                                              static_cast<float>(node.rotation[2])));
+    }
+    if(node.scale.size() == 3) transform = glm::scale(transform, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+
+    return transform;
+}
+
+//Calls visit(node, transform) for a node and every node below it, with the transform from that node to world space
+template<typename Visit>
+static void visitNodes(const tinygltf::Model& model, const int nodeIndex, const glm::mat4& parentTransform, Visit&& visit, const size_t depth = 0) {
+    //A valid hierarchy is a forest, so it can not be deeper than the number of nodes
+    if(depth > model.nodes.size()) throw std::runtime_error("The node hierarchy of the GLTF file has a cycle");
+
+    const tinygltf::Node& node = model.nodes.at(nodeIndex);
+    const glm::mat4 transform = parentTransform * localTransform(node);
+
+    visit(node, transform);
+    for(const int child : node.children) visitNodes(model, child, transform, visit, depth + 1);
+}
+
+TinyGLTFLoader::TinyGLTFLoader(const std::filesystem::path& umeshFilePath, GLTFReadInfo& umeshReadInfo) {
+    loadModel(umeshFilePath, umeshModel);
 
     umesh = umeshReadInfo.get_subdivision_mesh();
 }
@@ -88,6 +125,299 @@ Mesh TinyGLTFLoader::toMesh() {
     return myMesh;
 }
 
+Mesh TinyGLTFLoader::loadMesh(const std::filesystem::path& umeshFilePath) {
+    //Use functions from micromesh-tools to read *.gltf and *.bary file
+    GLTFReadInfo read_micromesh;
+    if(!read_gltf(umeshFilePath.string(), read_micromesh)) std::cerr << "Error reading gltf file" << std::endl;
+    if(!read_micromesh.has_subdivision_mesh()) std::cerr << "gltf file does not contain micromesh data" << std::endl;
+
+    return TinyGLTFLoader(umeshFilePath, read_micromesh).toMesh();
+}
+
+MeshScene TinyGLTFLoader::loadScene(const std::filesystem::path& sceneFilePath) {
+    tinygltf::Model model;
+    loadModel(sceneFilePath, model);
+
+    //The micro-mesh of this file, if it has one. Only decoded if a node uses it.
+    const auto loadMicroMesh = [&]() -> std::optional<Mesh> {
+        GLTFReadInfo umeshReadInfo;
+        if(!read_gltf(sceneFilePath.string(), umeshReadInfo) || !umeshReadInfo.has_subdivision_mesh()) return std::nullopt;
+
+        return TinyGLTFLoader(sceneFilePath, umeshReadInfo).toMesh();
+    };
+
+    MeshScene scene;
+    std::map<std::string, unsigned int> meshIndices; //Per unique mesh: "<mesh>/<primitive>" for the primitives of this file, the path for other micro-mesh files
+    size_t skippedPrimitives = 0;
+
+    const auto addInstance = [&](const std::string& key, const glm::mat4& transform, const auto& load) {
+        auto iter = meshIndices.find(key);
+        if(iter == meshIndices.end()) {
+            iter = meshIndices.emplace(key, static_cast<unsigned int>(scene.meshes.size())).first;
+            scene.meshes.push_back(load());
+        }
+
+        scene.instances.push_back({iter->second, transform});
+    };
+
+    const auto addMesh = [&](const int meshIndex, const glm::mat4& transform) {
+        const std::vector<tinygltf::Primitive>& primitives = model.meshes.at(meshIndex).primitives;
+
+        for(size_t p = 0; p < primitives.size(); p++) {
+            const tinygltf::Primitive& primitive = primitives[p];
+            //A mode of -1 is the default, which is triangles
+            if((primitive.mode != TINYGLTF_MODE_TRIANGLES && primitive.mode != -1) || !primitive.attributes.contains("POSITION")) {
+                skippedPrimitives++;
+                continue;
+            }
+
+            addInstance(std::to_string(meshIndex) + '/' + std::to_string(p), transform, [&] {
+                if(meshIndex == 0 && p == 0) {
+                    if(std::optional<Mesh> microMesh = loadMicroMesh()) return std::move(*microMesh);
+                }
+                return primitiveToMesh(model, primitive);
+            });
+        }
+    };
+
+    const auto addNode = [&](const tinygltf::Node& node, const glm::mat4& transform) {
+        if(node.mesh >= 0) addMesh(node.mesh, transform);
+
+        if(node.extras.IsObject() && node.extras.Has("umesh") && node.extras.Get("umesh").IsString()) {
+            const std::filesystem::path umeshFilePath = std::filesystem::weakly_canonical(sceneFilePath.parent_path() / node.extras.Get("umesh").Get<std::string>());
+            addInstance(umeshFilePath.string(), transform, [&] { return loadMesh(umeshFilePath); });
+        }
+    };
+
+    if(model.scenes.empty()) {
+        //Without a scene, every mesh is placed once as it is
+        for(int meshIndex = 0; meshIndex < static_cast<int>(model.meshes.size()); meshIndex++) addMesh(meshIndex, glm::mat4(1.0f));
+    } else {
+        const tinygltf::Scene& gltfScene = model.scenes.at(model.defaultScene >= 0 ? model.defaultScene : 0);
+        for(const int node : gltfScene.nodes) visitNodes(model, node, glm::mat4(1.0f), addNode);
+    }
+
+    if(skippedPrimitives > 0) std::cerr << skippedPrimitives << " primitive(s) without triangles were skipped" << std::endl;
+
+    return scene;
+}
+
+glm::mat4 SkinNode::localTransform(const float time) const {
+    if(matrix) return *matrix;
+
+    //Poses are sampled at any time and from any thread, so every sample starts with a new cursor
+    TransformationChannel<glm::vec3>::Cursor translationCursor, scaleCursor;
+    TransformationChannel<glm::quat>::Cursor rotationCursor;
+    const glm::vec3 t = translationChannel.keyframeTimes().empty() ? translation : translationChannel.sample(time, translationCursor);
+    const glm::quat r = rotationChannel.keyframeTimes().empty() ? rotation : rotationChannel.sample(time, rotationCursor);
+    const glm::vec3 s = scaleChannel.keyframeTimes().empty() ? scale : scaleChannel.sample(time, scaleCursor);
+
+    return glm::scale(glm::translate(glm::mat4(1.0f), t) * glm::mat4_cast(r), s);
+}
+
+std::vector<glm::mat4> MeshSkin::jointMatrices(const float time) const {
+    //Parents come before their children, so their transform to world space is known when a child needs it
+    std::vector<glm::mat4> nodeTransforms(nodes.size());
+    for(size_t i = 0; i < nodes.size(); i++) {
+        const glm::mat4 local = nodes[i].localTransform(time);
+        nodeTransforms[i] = nodes[i].parent < 0 ? local : nodeTransforms[nodes[i].parent] * local;
+    }
+
+    std::vector<glm::mat4> matrices(jointNodes.size());
+    for(size_t joint = 0; joint < jointNodes.size(); joint++) matrices[joint] = nodeTransforms[jointNodes[joint]] * inverseBindMatrices[joint];
+
+    return matrices;
+}
+
+//Reads a JOINTS_0 or WEIGHTS_0 style attribute with 4 components of any of the types glTF allows, normalizing integer weights
+template<typename T>
+static std::vector<T> getVec4Attribute(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const std::string& attributeName, const bool normalized) {
+    const int index = primitive.attributes.at(attributeName);
+    const tinygltf::Accessor& accessor = model.accessors.at(index);
+    if(accessor.type != TINYGLTF_TYPE_VEC4) throw std::runtime_error(attributeName + " must have 4 components");
+
+    const auto convert = [&]<typename C>(const std::vector<glm::vec<4, C>>& data, const float scale) {
+        std::vector<T> result(data.size());
+        for(size_t i = 0; i < data.size(); i++) result[i] = normalized ? T(glm::vec4(data[i]) / scale) : T(data[i]);
+        return result;
+    };
+
+    const tinygltf::BufferView& bufferView = model.bufferViews.at(accessor.bufferView);
+    const unsigned char* data = &model.buffers.at(bufferView.buffer).data[bufferView.byteOffset + accessor.byteOffset];
+    const int stride = accessor.ByteStride(bufferView);
+    if(stride <= 0) throw std::runtime_error(attributeName + " has an invalid byte stride");
+
+    const auto read = [&]<typename C>(C) {
+        std::vector<glm::vec<4, C>> elements(accessor.count);
+        for(size_t i = 0; i < elements.size(); i++) std::memcpy(&elements[i], data + i * static_cast<size_t>(stride), sizeof(elements[i]));
+        return elements;
+    };
+
+    switch(accessor.componentType) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            return convert(read(uint8_t{}), 255.0f);
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            return convert(read(uint16_t{}), 65535.0f);
+        case TINYGLTF_COMPONENT_TYPE_FLOAT:
+            return convert(read(float{}), 1.0f);
+        default:
+            throw std::runtime_error(attributeName + " has an unsupported component type");
+    }
+}
+
+MeshSkin TinyGLTFLoader::loadSkin(const std::filesystem::path& umeshFilePath) {
+    tinygltf::Model model;
+    loadModel(umeshFilePath, model);
+
+    if(model.meshes.empty() || model.meshes[0].primitives.empty()) throw std::runtime_error("The GLTF file does not have a mesh");
+    const tinygltf::Primitive& primitive = model.meshes[0].primitives[0];
+    if(!primitive.attributes.contains("JOINTS_0") || !primitive.attributes.contains("WEIGHTS_0")) throw std::runtime_error("The mesh does not have JOINTS_0 and WEIGHTS_0");
+
+    //The skin of the node that places the mesh, or the first one
+    int skinIndex = model.skins.empty() ? -1 : 0;
+    for(const tinygltf::Node& node : model.nodes) {
+        if(node.mesh == 0 && node.skin >= 0) {
+            skinIndex = node.skin;
+            break;
+        }
+    }
+    if(skinIndex < 0) throw std::runtime_error("The GLTF file does not have a skin");
+    const tinygltf::Skin& gltfSkin = model.skins.at(skinIndex);
+
+    MeshSkin skin;
+
+    //Every node, depth first from the roots so that parents come first
+    std::vector<int> parents(model.nodes.size(), -1);
+    for(size_t i = 0; i < model.nodes.size(); i++) {
+        for(const int child : model.nodes[i].children) parents.at(child) = static_cast<int>(i);
+    }
+    std::vector<int> skinNodes(model.nodes.size(), -1); //Per node of the file, index of skin.nodes
+    const auto addNode = [&](const auto& self, const int nodeIndex) -> void {
+        if(skinNodes[nodeIndex] >= 0 || skin.nodes.size() >= model.nodes.size()) throw std::runtime_error("The node hierarchy of the GLTF file has a cycle");
+
+        const tinygltf::Node& node = model.nodes[nodeIndex];
+        SkinNode& skinNode = skin.nodes.emplace_back();
+        skinNode.parent = parents[nodeIndex] < 0 ? -1 : skinNodes[parents[nodeIndex]];
+        if(node.matrix.size() == 16) skinNode.matrix = glm::mat4(glm::make_mat4(node.matrix.data()));
+        if(node.translation.size() == 3) skinNode.translation = glm::vec3(node.translation[0], node.translation[1], node.translation[2]);
+        if(node.rotation.size() == 4) {
+            skinNode.rotation = glm::quat(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]), static_cast<float>(node.rotation[1]),
+                                          static_cast<float>(node.rotation[2]));
+        }
+        if(node.scale.size() == 3) skinNode.scale = glm::vec3(node.scale[0], node.scale[1], node.scale[2]);
+        skinNodes[nodeIndex] = static_cast<int>(skin.nodes.size() - 1);
+
+        for(const int child : node.children) self(self, child);
+    };
+    for(int i = 0; i < static_cast<int>(model.nodes.size()); i++) {
+        if(parents[i] < 0) addNode(addNode, i);
+    }
+    if(skin.nodes.size() != model.nodes.size()) throw std::runtime_error("The node hierarchy of the GLTF file has a cycle");
+
+    for(const int joint : gltfSkin.joints) skin.jointNodes.push_back(static_cast<unsigned int>(skinNodes.at(joint)));
+    skin.inverseBindMatrices = gltfSkin.inverseBindMatrices >= 0 ? getBufferData<glm::mat4>(model, gltfSkin.inverseBindMatrices)
+                                                                 : std::vector<glm::mat4>(skin.jointNodes.size(), glm::mat4(1.0f));
+    if(skin.inverseBindMatrices.size() != skin.jointNodes.size()) throw std::runtime_error("The skin needs an inverse bind matrix per joint");
+
+    skin.joints = getVec4Attribute<glm::uvec4>(model, primitive, "JOINTS_0", false);
+    skin.weights = getVec4Attribute<glm::vec4>(model, primitive, "WEIGHTS_0", true);
+    if(skin.joints.size() != skin.weights.size()) throw std::runtime_error("JOINTS_0 and WEIGHTS_0 have a different number of vertices");
+    for(size_t v = 0; v < skin.joints.size(); v++) {
+        const float sum = skin.weights[v].x + skin.weights[v].y + skin.weights[v].z + skin.weights[v].w;
+        if(sum > 0.0f) {
+            skin.weights[v] /= sum;
+        } else {
+            skin.joints[v] = glm::uvec4(0);
+            skin.weights[v] = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+        }
+        if(glm::any(glm::greaterThanEqual(skin.joints[v], glm::uvec4(static_cast<unsigned int>(skin.jointNodes.size()))))) {
+            throw std::runtime_error("A vertex refers to a joint the skin does not have");
+        }
+    }
+
+    //The translations, rotations and scales of the first animation. Morph target weights are not supported.
+    if(!model.animations.empty()) {
+        for(const tinygltf::AnimationChannel& channel : model.animations[0].channels) {
+            if(channel.target_node < 0) continue;
+
+            const tinygltf::AnimationSampler& sampler = model.animations[0].samplers.at(channel.sampler);
+            const std::vector<float> times = getBufferData<float>(model, sampler.input);
+            const bool cubic = sampler.interpolation == "CUBICSPLINE";
+            SkinNode& node = skin.nodes.at(skinNodes.at(channel.target_node));
+
+            const auto addKeyframes = [&]<typename T>(TransformationChannel<T>& target, const std::vector<T>& values) {
+                if(cubic) target.addCubicSplineTransformations(times, values);
+                else target.addTransformations(times, values);
+                target.setInterpolationMode(sampler.interpolation.empty() ? "LINEAR" : sampler.interpolation);
+            };
+
+            if(channel.target_path == "translation") {
+                addKeyframes(node.translationChannel, getBufferData<glm::vec3>(model, sampler.output));
+            } else if(channel.target_path == "scale") {
+                addKeyframes(node.scaleChannel, getBufferData<glm::vec3>(model, sampler.output));
+            } else if(channel.target_path == "rotation") {
+                if(model.accessors.at(sampler.output).componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) throw std::runtime_error("Only float rotations can be animated");
+
+                //glTF stores quaternions as x, y, z, w
+                std::vector<glm::quat> rotations;
+                for(const glm::vec4& q : getBufferData<glm::vec4>(model, sampler.output)) rotations.emplace_back(q.w, q.x, q.y, q.z);
+                addKeyframes(node.rotationChannel, rotations);
+            } else {
+                continue;
+            }
+
+            if(!times.empty()) skin.duration = std::max(skin.duration, times.back());
+        }
+    }
+
+    return skin;
+}
+
+std::vector<unsigned int> TinyGLTFLoader::getIndices(const tinygltf::Model& model, const tinygltf::Primitive& primitive) {
+    if(primitive.indices < 0) {
+        std::vector<unsigned int> indices(model.accessors.at(primitive.attributes.at("POSITION")).count);
+        for(size_t i = 0; i < indices.size(); i++) indices[i] = static_cast<unsigned int>(i);
+        return indices;
+    }
+
+    switch(model.accessors.at(primitive.indices).componentType) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+            const std::vector<unsigned char> indices = getBufferData<unsigned char>(model, primitive.indices);
+            return {indices.begin(), indices.end()};
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+            const std::vector<unsigned short> indices = getBufferData<unsigned short>(model, primitive.indices);
+            return {indices.begin(), indices.end()};
+        }
+        default:
+            return getBufferData<unsigned int>(model, primitive.indices);
+    }
+}
+
+Mesh TinyGLTFLoader::primitiveToMesh(const tinygltf::Model& model, const tinygltf::Primitive& primitive) {
+    Mesh mesh;
+
+    const auto positions = getAttributeData<glm::vec3>(model, primitive, "POSITION");
+    const auto normals = primitive.attributes.contains("NORMAL") ? getAttributeData<glm::vec3>(model, primitive, "NORMAL") : std::vector<glm::vec3>(positions.size());
+    for(size_t j = 0; j < positions.size(); j++) {
+        //The direction does not matter without displacement, but keeps the vertex sensible
+        mesh.vertices.push_back({positions[j], normals[j], normals[j]});
+    }
+
+    const std::vector<unsigned int> indicesFlat = getIndices(model, primitive);
+    for(size_t j = 0; j + 2 < indicesFlat.size(); j += 3) {
+        const glm::uvec3 t{indicesFlat[j], indicesFlat[j + 1], indicesFlat[j + 2]};
+
+        //The micro-vertices of subdivision level 0 are the corners in row-major order
+        std::vector<uVertex> uvs;
+        for(int corner = 0; corner < 3; corner++) uvs.push_back({positions[t[corner]], glm::vec3(0.0f), true});
+
+        mesh.triangles.push_back({t, std::move(uvs), {glm::uvec3(0, 1, 2)}});
+    }
+
+    return mesh;
+}
+
 glm::vec3 TinyGLTFLoader::getVertexDisplacementDir(const glm::vec3 position) const {
     for(const auto& f : umesh.faces) {
         for(int i = 0; i < 3; i++) {
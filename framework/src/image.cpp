@@ -14,9 +14,14 @@ DISABLE_WARNINGS_POP()
 
 
 // write image to a file
-void Image::writeBitmapToFile(const std::filesystem::path& filePath) {
+bool Image::writeBitmapToFile(const std::filesystem::path& filePath) {
     std::string filePathString = filePath.string();
-    stbi_write_bmp(filePathString.c_str(), width, height, channels, pixels.data());
+    return stbi_write_bmp(filePathString.c_str(), width, height, channels, pixels.data()) != 0;
+}
+
+bool Image::writePNGToFile(const std::filesystem::path& filePath) {
+    std::string filePathString = filePath.string();
+    return stbi_write_png(filePathString.c_str(), width, height, channels, pixels.data(), width * channels) != 0;
 }
 
 // Image constructor, create image from file
@@ -39,3 +44,6 @@ Image::Image(const std::filesystem::path& filePath)
 
 	stbi_image_free(stbPixels);
 }
+
+Image::Image(int width, int height, int channels): width(width), height(height), channels(channels), pixels(static_cast<size_t>(width) * height * channels, 0) {
+}
@@ -1,7 +1,9 @@
 #include "mesh.h"
 
+#include <algorithm>
 #include <functional>
 #include <ranges>
+#include <stdexcept>
 #include <unordered_map>
 #include <queue>
 #include <unordered_set>
@@ -116,76 +118,79 @@ int Triangle::subdivisionLevel() const {
     return std::ceil(std::log2(uFaces.size()) / 2.0);
 }
 
-std::vector<glm::vec2> Mesh::minMaxDisplacements(std::vector<TriangleData>& tData) const {
-    std::vector<glm::vec2> minMaxDisplacements;
-
+void Mesh::triangleMinMaxDisplacements(const Triangle& t, std::vector<glm::vec2>& minMaxDisplacements) const {
     struct TriangleElement {
         std::vector<glm::uvec3> uTriangles; //Each element is a micro triangle that is defined by 3 indices into the micro vertex array
         glm::vec3 v0, v1, v2; //Corner vertices
     };
 
-    for(const auto& [t, td] : std::views::zip(triangles, tData)) {
-        if(t.subdivisionLevel() == 0) continue; //If we have subdivision level 0, we do not need to store any min-max displacements.
+    //First we compute the normal of the triangle's plane
+    const auto v0 = vertices[t.baseVertexIndices.x];
+    const auto v1 = vertices[t.baseVertexIndices.y];
+    const auto v2 = vertices[t.baseVertexIndices.z];
 
-        td.minMaxOffset = minMaxDisplacements.size();
+    glm::vec3 e1 = v1.position - v0.position;
+    glm::vec3 e2 = v2.position - v0.position;
+    glm::vec3 N = glm::normalize(cross(e1, e2)); // plane normal
 
-        //First we compute the normal of the triangle's plane
-        const auto v0 = vertices[t.baseVertexIndices.x];
-        const auto v1 = vertices[t.baseVertexIndices.y];
-        const auto v2 = vertices[t.baseVertexIndices.z];
+    //Then we set up the queue
+    std::queue<TriangleElement> queue;
+    queue.emplace(t.uFaces, v0.position, v1.position, v2.position);
 
-        glm::vec3 e1 = v1.position - v0.position;
-        glm::vec3 e2 = v2.position - v0.position;
-        glm::vec3 N = glm::normalize(cross(e1, e2)); // plane normal
+    while(!queue.empty()) {
+        //Compute min and max displacement of this triangle
+        const auto currentTriangle = queue.front();
+        queue.pop();
+        float minDisplacement = 100000.0f, maxDisplacement = -100000.0f;
 
-        //Then we set up the queue
-        std::queue<TriangleElement> queue;
-        queue.emplace(t.uFaces, v0.position, v1.position, v2.position);
+        for(const auto& ut : currentTriangle.uTriangles) {
+            for(int i = 0; i < 3; i++) {
+                float height = glm::dot(t.uVertices[ut[i]].displacement, N);
 
-        while(!queue.empty()) {
-            //Compute min and max displacement of this triangle
-            const auto currentTriangle = queue.front();
-            queue.pop();
-            float minDisplacement = 100000.0f, maxDisplacement = -100000.0f;
+                maxDisplacement = std::max(maxDisplacement, height);
+                minDisplacement = std::min(minDisplacement, height);
+            }
+        }
 
-            for(const auto& ut : currentTriangle.uTriangles) {
-                for(int i = 0; i < 3; i++) {
-                    float height = glm::dot(t.uVertices[ut[i]].displacement, N);
+        minMaxDisplacements.emplace_back(minDisplacement, maxDisplacement);
 
-                    maxDisplacement = std::max(maxDisplacement, height);
-                    minDisplacement = std::min(minDisplacement, height);
-                }
-            }
+        if(currentTriangle.uTriangles.size() > 4) {
+            //Now we compute the next 4 triangles for processing
+            glm::vec3 v0v1 = (currentTriangle.v0 + currentTriangle.v1) / 2.0f;
+            glm::vec3 v0v2 = (currentTriangle.v0 + currentTriangle.v2) / 2.0f;
+            glm::vec3 v1v2 = (currentTriangle.v1 + currentTriangle.v2) / 2.0f;
+            TriangleElement t1{.v0 = currentTriangle.v0, .v1 = v0v1, .v2 = v0v2}; //Triangle near v0
+            TriangleElement t2{.v0 = v0v1, .v1 = currentTriangle.v1, .v2 = v1v2}; //Triangle near v1
+            TriangleElement t3{.v0 = v0v1, .v1 = v1v2, .v2 = v0v2}; //Center triangle
+            TriangleElement t4{.v0 = v0v2, .v1 = v1v2, .v2 = currentTriangle.v2}; //Triangle near v2
 
-            minMaxDisplacements.emplace_back(minDisplacement, maxDisplacement);
-
-            if(currentTriangle.uTriangles.size() > 4) {
-                //Now we compute the next 4 triangles for processing
-                glm::vec3 v0v1 = (currentTriangle.v0 + currentTriangle.v1) / 2.0f;
-                glm::vec3 v0v2 = (currentTriangle.v0 + currentTriangle.v2) / 2.0f;
-                glm::vec3 v1v2 = (currentTriangle.v1 + currentTriangle.v2) / 2.0f;
-                TriangleElement t1{.v0 = currentTriangle.v0, .v1 = v0v1, .v2 = v0v2}; //Triangle near v0
-                TriangleElement t2{.v0 = v0v1, .v1 = currentTriangle.v1, .v2 = v1v2}; //Triangle near v1
-                TriangleElement t3{.v0 = v0v1, .v1 = v1v2, .v2 = v0v2}; //Center triangle
-                TriangleElement t4{.v0 = v0v2, .v1 = v1v2, .v2 = currentTriangle.v2}; //Triangle near v2
-
-                for(const auto& ut : currentTriangle.uTriangles) {
-                    glm::vec3 midPoint = (1.0f/3.0f) * t.uVertices[ut[0]].position + (1.0f/3.0f) * t.uVertices[ut[1]].position + (1.0f/3.0f) * t.uVertices[ut[2]].position;
-                    glm::vec3 bc = Triangle::computeBaryCoords(currentTriangle.v0, currentTriangle.v1, currentTriangle.v2, midPoint);
-
-                    if(bc.x > 0.5) t1.uTriangles.push_back(ut);
-                    else if(bc.y > 0.5) t2.uTriangles.push_back(ut);
-                    else if(bc.z > 0.5) t4.uTriangles.push_back(ut);
-                    else t3.uTriangles.push_back(ut);
-                }
+            for(const auto& ut : currentTriangle.uTriangles) {
+                glm::vec3 midPoint = (1.0f/3.0f) * t.uVertices[ut[0]].position + (1.0f/3.0f) * t.uVertices[ut[1]].position + (1.0f/3.0f) * t.uVertices[ut[2]].position;
+                glm::vec3 bc = Triangle::computeBaryCoords(currentTriangle.v0, currentTriangle.v1, currentTriangle.v2, midPoint);
 
-                queue.emplace(t1);
-                queue.emplace(t2);
-                queue.emplace(t3);
-                queue.emplace(t4);
+                if(bc.x > 0.5) t1.uTriangles.push_back(ut);
+                else if(bc.y > 0.5) t2.uTriangles.push_back(ut);
+                else if(bc.z > 0.5) t4.uTriangles.push_back(ut);
+                else t3.uTriangles.push_back(ut);
             }
+
+            queue.emplace(t1);
+            queue.emplace(t2);
+            queue.emplace(t3);
+            queue.emplace(t4);
         }
     }
+}
+
+std::vector<glm::vec2> Mesh::minMaxDisplacements(std::vector<TriangleData>& tData) const {
+    std::vector<glm::vec2> minMaxDisplacements;
+
+    for(const auto& [t, td] : std::views::zip(triangles, tData)) {
+        if(t.subdivisionLevel() == 0) continue; //If we have subdivision level 0, we do not need to store any min-max displacements.
+
+        td.minMaxOffset = minMaxDisplacements.size();
+        triangleMinMaxDisplacements(t, minMaxDisplacements);
+    }
 
     /**
      * If all triangles have subdivision level 0, we do not need to store any min-max displacements.
@@ -271,26 +276,41 @@ float computeTriangleDelta(const Triangle2D& t, const std::unordered_set<glm::ve
     return maxDistance;
 }
 
-std::vector<float> Mesh::triangleDeltas(const std::vector<int>& dOffsets) const {
-    std::vector<float> boundTriangles;
+//Same as computeTriangleDelta for a single point
+static float pointDelta(const Triangle2D& t, const glm::vec2& p) {
+    const bool isCCW = t.isCCW();
+    const Edge2D edges[3]{ {t.v0, t.v1}, {t.v1, t.v2}, {t.v2, t.v0} };
+
+    float maxDistance = 0.0f;
+    for(const auto& e : edges) {
+        const float dist = distPointToEdge(p, e);
+        const bool isOutsideTriangle = isCCW ? e.isRight(p) : e.isLeft(p);
+        if(isOutsideTriangle && dist > maxDistance) maxDistance = dist;
+    }
+
+    return maxDistance;
+}
+
+void Mesh::triangleDeltas(const Triangle& t, std::vector<float>& deltas) const {
+    constexpr int dOffset = 0; //positions2D only holds the micro-vertices of this triangle
 
     std::vector<glm::vec3> positions2D;
-    for(const auto& triangle : triangles) {
-        //Compute plane positions of each micro vertex
-        const auto v0 = vertices[triangle.baseVertexIndices.x];
-        const auto v1 = vertices[triangle.baseVertexIndices.y];
-        const auto v2 = vertices[triangle.baseVertexIndices.z];
+    positions2D.reserve(t.uVertices.size());
 
-        glm::vec3 e1 = v1.position - v0.position;
-        glm::vec3 e2 = v2.position - v0.position;
-        glm::vec3 N = glm::normalize(cross(e1, e2)); // plane normal
+    //Compute plane positions of each micro vertex
+    const auto v0 = vertices[t.baseVertexIndices.x];
+    const auto v1 = vertices[t.baseVertexIndices.y];
+    const auto v2 = vertices[t.baseVertexIndices.z];
 
-        glm::vec3 T = normalize(e1);
-        glm::vec3 B = glm::normalize(cross(N, T));
+    glm::vec3 e1 = v1.position - v0.position;
+    glm::vec3 e2 = v2.position - v0.position;
+    glm::vec3 N = glm::normalize(cross(e1, e2)); // plane normal
 
-        TBNPlane::Plane plane(T, B, N, v0.position);
-        std::ranges::transform(triangle.uVertices, std::back_inserter(positions2D), [&](const uVertex& uv) { return plane.projectOnto(uv.position + uv.displacement); });
-    }
+    glm::vec3 T = normalize(e1);
+    glm::vec3 B = glm::normalize(cross(N, T));
+
+    TBNPlane::Plane plane(T, B, N, v0.position);
+    std::ranges::transform(t.uVertices, std::back_inserter(positions2D), [&](const uVertex& uv) { return plane.projectOnto(uv.position + uv.displacement); });
 
     struct TriangleElement {
         std::vector<glm::uvec3> uTriangles; //Each element is a micro triangle that is defined by 3 indices into the micro vertex array
@@ -298,80 +318,82 @@ std::vector<float> Mesh::triangleDeltas(const std::vector<int>& dOffsets) const
         Triangle2D t2D;
     };
 
-    for(const auto& [t, dOffset] : std::views::zip(triangles, dOffsets)) {
-        if(t.subdivisionLevel() == 0) continue; //If we have subdivision level 0, we do not need to store any delta values.
-
-        const auto nRows = numberOfVerticesOnEdge(t);
+    const auto nRows = numberOfVerticesOnEdge(t);
 
-        const auto v0 = vertices[t.baseVertexIndices.x];
-        const auto v1 = vertices[t.baseVertexIndices.y];
-        const auto v2 = vertices[t.baseVertexIndices.z];
+    const Vertex2D v02D(getPlanePosition(glm::vec2{0, 0}, dOffset, positions2D), {0, 0});
+    const Vertex2D v12D(getPlanePosition(glm::vec2{nRows - 1, 0}, dOffset, positions2D), {nRows - 1,0});
+    const Vertex2D v22D(getPlanePosition(glm::vec2{nRows - 1, nRows - 1}, dOffset, positions2D), {nRows - 1,nRows - 1});
+    Triangle2D tr2D(v02D, v12D, v22D);
 
-        const Vertex2D v02D(getPlanePosition(glm::vec2{0, 0}, dOffset, positions2D), {0, 0});
-        const Vertex2D v12D(getPlanePosition(glm::vec2{nRows - 1, 0}, dOffset, positions2D), {nRows - 1,0});
-        const Vertex2D v22D(getPlanePosition(glm::vec2{nRows - 1, nRows - 1}, dOffset, positions2D), {nRows - 1,nRows - 1});
-        Triangle2D tr2D(v02D, v12D, v22D);
+    //Set up the queue
+    std::queue<TriangleElement> queue;
+    queue.emplace(t.uFaces, v0.position, v1.position, v2.position, tr2D);
 
-        //Set up the queue
-        std::queue<TriangleElement> queue;
-        queue.emplace(t.uFaces, v0.position, v1.position, v2.position, tr2D);
+    while(!queue.empty()) {
+        const auto currentTriangle = queue.front();
+        queue.pop();
 
-        while(!queue.empty()) {
-            const auto currentTriangle = queue.front();
-            queue.pop();
+        //Compute bound triangle
+        std::unordered_set<glm::vec2> allPoints;
+        for(const auto& uf : currentTriangle.uTriangles) {
+            allPoints.insert(positions2D[dOffset + uf.x]);
+            allPoints.insert(positions2D[dOffset + uf.y]);
+            allPoints.insert(positions2D[dOffset + uf.z]);
+        }
+        const auto delta = computeTriangleDelta(currentTriangle.t2D, allPoints);
+        deltas.emplace_back(delta);
+
+        //Add next elements to queue
+        if(currentTriangle.uTriangles.size() > 4) {
+            //Now we divide all micro triangles into the 4 regions (after a bunch of data computation...)
+            glm::vec3 v0v1 = (currentTriangle.v0 + currentTriangle.v1) / 2.0f;
+            glm::vec3 v0v2 = (currentTriangle.v0 + currentTriangle.v2) / 2.0f;
+            glm::vec3 v1v2 = (currentTriangle.v1 + currentTriangle.v2) / 2.0f;
+
+            Edge2D e12D(currentTriangle.t2D.v0, currentTriangle.t2D.v1);
+            Edge2D e22D(currentTriangle.t2D.v1, currentTriangle.t2D.v2);
+            Edge2D e32D(currentTriangle.t2D.v2, currentTriangle.t2D.v0);
+
+            const auto e1Middle = e12D.middle();
+            const auto e2Middle = e22D.middle();
+            const auto e3Middle = e32D.middle();
+
+            Vertex2D v0v12D(getPlanePosition(e1Middle.coordinates, dOffset, positions2D), e1Middle.coordinates);
+            Vertex2D v1v22D(getPlanePosition(e2Middle.coordinates, dOffset, positions2D), e2Middle.coordinates);
+            Vertex2D v2v02D(getPlanePosition(e3Middle.coordinates, dOffset, positions2D), e3Middle.coordinates);
+
+            TriangleElement t1{.v0 = currentTriangle.v0, .v1 = v0v1, .v2 = v0v2, .t2D = {currentTriangle.t2D.v0, v0v12D, v2v02D}}; //Triangle near v0
+            TriangleElement t2{.v0 = v0v1, .v1 = currentTriangle.v1, .v2 = v1v2, .t2D = {v0v12D, currentTriangle.t2D.v1, v1v22D}}; //Triangle near v1
+            TriangleElement t3{.v0 = v0v1, .v1 = v1v2, .v2 = v0v2, .t2D = {v0v12D, v1v22D, v2v02D}}; //Center triangle
+            TriangleElement t4{.v0 = v0v2, .v1 = v1v2, .v2 = currentTriangle.v2, .t2D = {v2v02D, v1v22D, currentTriangle.t2D.v2}}; //Triangle near v2
+
+            //For each micro-triangle, we use the midpoint to identify in which of the 4 regions it belongs
+            for(const auto& ut : currentTriangle.uTriangles) {
+                glm::vec3 midPoint = (1.0f/3.0f) * t.uVertices[ut[0]].position + (1.0f/3.0f) * t.uVertices[ut[1]].position + (1.0f/3.0f) * t.uVertices[ut[2]].position;
+                glm::vec3 bc = Triangle::computeBaryCoords(currentTriangle.v0, currentTriangle.v1, currentTriangle.v2, midPoint);
 
-            //Compute bound triangle
-            std::unordered_set<glm::vec2> allPoints;
-            for(const auto& uf : currentTriangle.uTriangles) {
-                allPoints.insert(positions2D[dOffset + uf.x]);
-                allPoints.insert(positions2D[dOffset + uf.y]);
-                allPoints.insert(positions2D[dOffset + uf.z]);
+                if(bc.x > 0.5) t1.uTriangles.push_back(ut);
+                else if(bc.y > 0.5) t2.uTriangles.push_back(ut);
+                else if(bc.z > 0.5) t4.uTriangles.push_back(ut);
+                else t3.uTriangles.push_back(ut);
             }
-            const auto delta = computeTriangleDelta(currentTriangle.t2D, allPoints);
-            boundTriangles.emplace_back(delta);
-
-            //Add next elements to queue
-            if(currentTriangle.uTriangles.size() > 4) {
-                //Now we divide all micro triangles into the 4 regions (after a bunch of data computation...)
-                glm::vec3 v0v1 = (currentTriangle.v0 + currentTriangle.v1) / 2.0f;
-                glm::vec3 v0v2 = (currentTriangle.v0 + currentTriangle.v2) / 2.0f;
-                glm::vec3 v1v2 = (currentTriangle.v1 + currentTriangle.v2) / 2.0f;
-
-                Edge2D e12D(currentTriangle.t2D.v0, currentTriangle.t2D.v1);
-                Edge2D e22D(currentTriangle.t2D.v1, currentTriangle.t2D.v2);
-                Edge2D e32D(currentTriangle.t2D.v2, currentTriangle.t2D.v0);
-
-                const auto e1Middle = e12D.middle();
-                const auto e2Middle = e22D.middle();
-                const auto e3Middle = e32D.middle();
-
-                Vertex2D v0v12D(getPlanePosition(e1Middle.coordinates, dOffset, positions2D), e1Middle.coordinates);
-                Vertex2D v1v22D(getPlanePosition(e2Middle.coordinates, dOffset, positions2D), e2Middle.coordinates);
-                Vertex2D v2v02D(getPlanePosition(e3Middle.coordinates, dOffset, positions2D), e3Middle.coordinates);
-
-                TriangleElement t1{.v0 = currentTriangle.v0, .v1 = v0v1, .v2 = v0v2, .t2D = {currentTriangle.t2D.v0, v0v12D, v2v02D}}; //Triangle near v0
-                TriangleElement t2{.v0 = v0v1, .v1 = currentTriangle.v1, .v2 = v1v2, .t2D = {v0v12D, currentTriangle.t2D.v1, v1v22D}}; //Triangle near v1
-                TriangleElement t3{.v0 = v0v1, .v1 = v1v2, .v2 = v0v2, .t2D = {v0v12D, v1v22D, v2v02D}}; //Center triangle
-                TriangleElement t4{.v0 = v0v2, .v1 = v1v2, .v2 = currentTriangle.v2, .t2D = {v2v02D, v1v22D, currentTriangle.t2D.v2}}; //Triangle near v2
-
-                //For each micro-triangle, we use the midpoint to identify in which of the 4 regions it belongs
-                for(const auto& ut : currentTriangle.uTriangles) {
-                    glm::vec3 midPoint = (1.0f/3.0f) * t.uVertices[ut[0]].position + (1.0f/3.0f) * t.uVertices[ut[1]].position + (1.0f/3.0f) * t.uVertices[ut[2]].position;
-                    glm::vec3 bc = Triangle::computeBaryCoords(currentTriangle.v0, currentTriangle.v1, currentTriangle.v2, midPoint);
-
-                    if(bc.x > 0.5) t1.uTriangles.push_back(ut);
-                    else if(bc.y > 0.5) t2.uTriangles.push_back(ut);
-                    else if(bc.z > 0.5) t4.uTriangles.push_back(ut);
-                    else t3.uTriangles.push_back(ut);
-                }
 
-                queue.emplace(t1);
-                queue.emplace(t2);
-                queue.emplace(t3);
-                queue.emplace(t4);
-            }
+            queue.emplace(t1);
+            queue.emplace(t2);
+            queue.emplace(t3);
+            queue.emplace(t4);
         }
     }
+}
+
+std::vector<float> Mesh::triangleDeltas() const {
+    std::vector<float> boundTriangles;
+
+    for(const auto& t : triangles) {
+        if(t.subdivisionLevel() == 0) continue; //If we have subdivision level 0, we do not need to store any delta values.
+
+        triangleDeltas(t, boundTriangles);
+    }
 
     /**
      * If all triangles have subdivision level 0, we do not need to store any delta values.
@@ -387,10 +409,6 @@ std::vector<float> Mesh::computeDisplacementScales(std::vector<TriangleData>& tD
     std::vector<float> displacementScales;
 
     for(const auto& triangle : triangles) {
-        const auto v0 = vertices[triangle.baseVertexIndices.x];
-        const auto v1 = vertices[triangle.baseVertexIndices.y];
-        const auto v2 = vertices[triangle.baseVertexIndices.z];
-
         const auto subDivLvl = triangle.subdivisionLevel();
 
         tData.emplace_back(triangle.baseVertexIndices, numberOfVerticesOnEdge(triangle), subDivLvl, displacementScales.size());
@@ -400,25 +418,319 @@ std::vector<float> Mesh::computeDisplacementScales(std::vector<TriangleData>& tD
          * If a neighbouring triangle has a different (lower) subdivision level, then a micro-vertex doesn't always exist on the edge.
          * If that's the case, we place a dummy scale of -1.
          */
-        for(const auto& uv : triangle.uVertices) {
-            const glm::vec3 bc = Triangle::computeBaryCoords(v0.position, v1.position, v2.position, uv.position);
-            const auto interpolatedDir = bc.x * v0.direction + bc.y * v1.direction + bc.z * v2.direction;
-
-            if(uv.present) {
-                //Avoid dividing by 0
-                if(interpolatedDir.x != 0.0f) displacementScales.push_back(uv.displacement.x / interpolatedDir.x);
-                else if(interpolatedDir.y != 0.0f) displacementScales.push_back(uv.displacement.y / interpolatedDir.y);
-                else if(interpolatedDir.z != 0.0f) displacementScales.push_back(uv.displacement.z / interpolatedDir.z);
-                else displacementScales.push_back(0.0f); //No displacement
-            } else {
-                displacementScales.push_back(-1.0f); //Put dummy displacement scale of -1
-            }
-        }
+        for(const auto& uv : triangle.uVertices) displacementScales.push_back(displacementScale(triangle, uv));
     }
 
     return displacementScales;
 }
 
+//The scale of a displacement along an (interpolated) direction
+static float scaleAlong(const glm::vec3& displacement, const glm::vec3& direction) {
+    //Avoid dividing by 0
+    if(direction.x != 0.0f) return displacement.x / direction.x;
+    if(direction.y != 0.0f) return displacement.y / direction.y;
+    if(direction.z != 0.0f) return displacement.z / direction.z;
+    return 0.0f; //No displacement
+}
+
+float Mesh::displacementScale(const Triangle& t, const uVertex& uv) const {
+    if(!uv.present) return -1.0f; //Put dummy displacement scale of -1
+
+    const auto& v0 = vertices[t.baseVertexIndices.x];
+    const auto& v1 = vertices[t.baseVertexIndices.y];
+    const auto& v2 = vertices[t.baseVertexIndices.z];
+
+    const glm::vec3 bc = Triangle::computeBaryCoords(v0.position, v1.position, v2.position, uv.position);
+    const auto interpolatedDir = bc.x * v0.direction + bc.y * v1.direction + bc.z * v2.direction;
+
+    return scaleAlong(uv.displacement, interpolatedDir);
+}
+
 bool Mesh::hasUniformSubdivisionLevel() const {
     return std::ranges::adjacent_find(triangles, std::ranges::not_equal_to{}, [](const Triangle& t) { return t.subdivisionLevel(); }) == triangles.end();
 }
+
+void Mesh::setDisplacement(const unsigned int triangle, const unsigned int microVertex, const glm::vec3& displacement) {
+    uVertex& uv = triangles[triangle].uVertices[microVertex];
+
+    //Only the displacement from before the first edit is kept, that is what the baked data was computed from
+    const uint64_t key = (static_cast<uint64_t>(triangle) << 32) | microVertex;
+    if(dirtyIndices.try_emplace(key, dirty.size()).second) dirty.push_back({triangle, microVertex, uv.displacement});
+
+    uv.displacement = displacement;
+}
+
+std::vector<unsigned int> Mesh::moveVertices(const std::span<const unsigned int> indices, const std::span<const Vertex> moved) {
+    if(indices.size() != moved.size()) throw std::logic_error("Every moved vertex needs a new position.");
+
+    if(vertexTriangleOffsets.empty()) {
+        vertexTriangleOffsets.assign(vertices.size() + 1, 0);
+        for(const Triangle& t : triangles) {
+            for(int i = 0; i < 3; i++) vertexTriangleOffsets[t.baseVertexIndices[i] + 1]++;
+        }
+        for(size_t v = 0; v < vertices.size(); v++) vertexTriangleOffsets[v + 1] += vertexTriangleOffsets[v];
+
+        vertexTriangles.resize(vertexTriangleOffsets.back());
+        std::vector<unsigned int> filled(vertexTriangleOffsets.begin(), vertexTriangleOffsets.end() - 1);
+        for(unsigned int i = 0; i < triangles.size(); i++) {
+            for(int j = 0; j < 3; j++) vertexTriangles[filled[triangles[i].baseVertexIndices[j]]++] = i;
+        }
+    }
+
+    std::vector<unsigned int> movedTriangles;
+    for(const unsigned int v : indices) movedTriangles.insert(movedTriangles.end(), vertexTriangles.begin() + vertexTriangleOffsets[v], vertexTriangles.begin() + vertexTriangleOffsets[v + 1]);
+    std::ranges::sort(movedTriangles);
+    movedTriangles.erase(std::unique(movedTriangles.begin(), movedTriangles.end()), movedTriangles.end());
+
+    //Where every micro-vertex is in its triangle, before the vertices move. Micro-vertices that are not present are
+    //moved as well, since the AABBs include them.
+    struct Placement {
+        glm::vec3 bc;
+        float scale;
+    };
+    std::vector<Placement> placements;
+    for(const unsigned int i : movedTriangles) {
+        const Triangle& t = triangles[i];
+        const auto& v0 = vertices[t.baseVertexIndices.x];
+        const auto& v1 = vertices[t.baseVertexIndices.y];
+        const auto& v2 = vertices[t.baseVertexIndices.z];
+
+        for(const uVertex& uv : t.uVertices) {
+            const glm::vec3 bc = Triangle::computeBaryCoords(v0.position, v1.position, v2.position, uv.position);
+            placements.push_back({bc, scaleAlong(uv.displacement, bc.x * v0.direction + bc.y * v1.direction + bc.z * v2.direction)});
+        }
+    }
+
+    for(size_t i = 0; i < indices.size(); i++) vertices[indices[i]] = moved[i];
+
+    auto placement = placements.begin();
+    for(const unsigned int i : movedTriangles) {
+        Triangle& t = triangles[i];
+        const auto& v0 = vertices[t.baseVertexIndices.x];
+        const auto& v1 = vertices[t.baseVertexIndices.y];
+        const auto& v2 = vertices[t.baseVertexIndices.z];
+
+        for(uVertex& uv : t.uVertices) {
+            const glm::vec3& bc = placement->bc;
+            uv.position = bc.x * v0.position + bc.y * v1.position + bc.z * v2.position;
+            uv.displacement = placement->scale * (bc.x * v0.direction + bc.y * v1.direction + bc.z * v2.direction);
+            ++placement;
+        }
+    }
+
+    return movedTriangles;
+}
+
+const std::vector<DisplacementEdit>& Mesh::dirtyMicroVertices() const {
+    return dirty;
+}
+
+void Mesh::clearDirty() {
+    dirty.clear();
+    dirtyIndices.clear();
+}
+
+TriangleHierarchy Mesh::triangleHierarchy(const Triangle& t) const {
+    struct TriangleElement {
+        std::vector<glm::uvec3> uTriangles; //Each element is a micro triangle that is defined by 3 indices into the micro vertex array
+        glm::vec3 v0, v1, v2; //Corner vertices
+        glm::uvec2 c0, c1, c2; //Triangular grid coordinates of the corner vertices
+    };
+
+    const auto toIndex = [](const glm::uvec2& c) { return (c.x * (c.x + 1)) / 2 + c.y; };
+
+    const auto v0 = vertices[t.baseVertexIndices.x];
+    const auto v1 = vertices[t.baseVertexIndices.y];
+    const auto v2 = vertices[t.baseVertexIndices.z];
+    const unsigned int n = numberOfVerticesOnEdge(t) - 1;
+
+    TriangleHierarchy hierarchy;
+    std::vector<std::vector<unsigned int>> vertexLeaves(t.uVertices.size());
+
+    //The same subdivision as triangleMinMaxDisplacements and triangleDeltas, so the hierarchy triangles come in the same order
+    std::queue<TriangleElement> queue;
+    queue.emplace(t.uFaces, v0.position, v1.position, v2.position, glm::uvec2(0, 0), glm::uvec2(n, 0), glm::uvec2(n, n));
+
+    while(!queue.empty()) {
+        const auto currentTriangle = queue.front();
+        queue.pop();
+
+        const auto record = static_cast<unsigned int>(hierarchy.corners.size());
+        hierarchy.corners.emplace_back(toIndex(currentTriangle.c0), toIndex(currentTriangle.c1), toIndex(currentTriangle.c2));
+        hierarchy.faceOffsets.push_back(static_cast<unsigned int>(hierarchy.faces.size()));
+
+        if(currentTriangle.uTriangles.size() <= 4) {
+            for(const auto& ut : currentTriangle.uTriangles) {
+                hierarchy.faces.push_back(ut);
+                for(int i = 0; i < 3; i++) {
+                    if(vertexLeaves[ut[i]].empty() || vertexLeaves[ut[i]].back() != record) vertexLeaves[ut[i]].push_back(record);
+                }
+            }
+            continue;
+        }
+
+        glm::vec3 v0v1 = (currentTriangle.v0 + currentTriangle.v1) / 2.0f;
+        glm::vec3 v0v2 = (currentTriangle.v0 + currentTriangle.v2) / 2.0f;
+        glm::vec3 v1v2 = (currentTriangle.v1 + currentTriangle.v2) / 2.0f;
+        const glm::uvec2 c0c1 = (currentTriangle.c0 + currentTriangle.c1) / 2u;
+        const glm::uvec2 c1c2 = (currentTriangle.c1 + currentTriangle.c2) / 2u;
+        const glm::uvec2 c2c0 = (currentTriangle.c2 + currentTriangle.c0) / 2u;
+
+        TriangleElement t1{.v0 = currentTriangle.v0, .v1 = v0v1, .v2 = v0v2, .c0 = currentTriangle.c0, .c1 = c0c1, .c2 = c2c0}; //Triangle near v0
+        TriangleElement t2{.v0 = v0v1, .v1 = currentTriangle.v1, .v2 = v1v2, .c0 = c0c1, .c1 = currentTriangle.c1, .c2 = c1c2}; //Triangle near v1
+        TriangleElement t3{.v0 = v0v1, .v1 = v1v2, .v2 = v0v2, .c0 = c0c1, .c1 = c1c2, .c2 = c2c0}; //Center triangle
+        TriangleElement t4{.v0 = v0v2, .v1 = v1v2, .v2 = currentTriangle.v2, .c0 = c2c0, .c1 = c1c2, .c2 = currentTriangle.c2}; //Triangle near v2
+
+        for(const auto& ut : currentTriangle.uTriangles) {
+            glm::vec3 midPoint = (1.0f/3.0f) * t.uVertices[ut[0]].position + (1.0f/3.0f) * t.uVertices[ut[1]].position + (1.0f/3.0f) * t.uVertices[ut[2]].position;
+            glm::vec3 bc = Triangle::computeBaryCoords(currentTriangle.v0, currentTriangle.v1, currentTriangle.v2, midPoint);
+
+            if(bc.x > 0.5) t1.uTriangles.push_back(ut);
+            else if(bc.y > 0.5) t2.uTriangles.push_back(ut);
+            else if(bc.z > 0.5) t4.uTriangles.push_back(ut);
+            else t3.uTriangles.push_back(ut);
+        }
+
+        //The children of a hierarchy triangle are next to each other
+        hierarchy.firstChildren.resize(hierarchy.corners.size(), 0);
+        hierarchy.firstChildren.back() = static_cast<unsigned int>(hierarchy.corners.size() + queue.size());
+
+        queue.emplace(t1);
+        queue.emplace(t2);
+        queue.emplace(t3);
+        queue.emplace(t4);
+    }
+
+    hierarchy.faceOffsets.push_back(static_cast<unsigned int>(hierarchy.faces.size()));
+    hierarchy.firstChildren.resize(hierarchy.corners.size(), 0);
+
+    hierarchy.parents.resize(hierarchy.corners.size(), 0);
+    for(unsigned int i = 0; i < hierarchy.firstChildren.size(); i++) {
+        if(hierarchy.firstChildren[i] == 0) continue;
+        for(unsigned int child = 0; child < 4; child++) hierarchy.parents[hierarchy.firstChildren[i] + child] = i;
+    }
+
+    for(const auto& leaves : vertexLeaves) {
+        hierarchy.vertexLeafOffsets.push_back(static_cast<unsigned int>(hierarchy.vertexLeaves.size()));
+        hierarchy.vertexLeaves.insert(hierarchy.vertexLeaves.end(), leaves.begin(), leaves.end());
+    }
+    hierarchy.vertexLeafOffsets.push_back(static_cast<unsigned int>(hierarchy.vertexLeaves.size()));
+
+    return hierarchy;
+}
+
+size_t Mesh::updateTriangleHierarchy(const Triangle& t, const TriangleHierarchy& hierarchy, std::span<const DisplacementEdit> edits,
+                                     std::span<glm::vec2> minMaxDisplacements, std::span<float> deltas) const {
+    //The same plane as triangleMinMaxDisplacements and triangleDeltas
+    const auto v0 = vertices[t.baseVertexIndices.x];
+    const auto v1 = vertices[t.baseVertexIndices.y];
+    const auto v2 = vertices[t.baseVertexIndices.z];
+
+    glm::vec3 e1 = v1.position - v0.position;
+    glm::vec3 e2 = v2.position - v0.position;
+    glm::vec3 N = glm::normalize(cross(e1, e2)); // plane normal
+
+    glm::vec3 T = normalize(e1);
+    glm::vec3 B = glm::normalize(cross(N, T));
+
+    TBNPlane::Plane plane(T, B, N, v0.position);
+    const auto project = [&](const unsigned int microVertex, const glm::vec3& displacement) {
+        return glm::vec2(plane.projectOnto(t.uVertices[microVertex].position + displacement));
+    };
+
+    std::vector<unsigned int> editedVertices;
+    editedVertices.reserve(edits.size());
+    for(const auto& edit : edits) editedVertices.push_back(edit.microVertex);
+    std::ranges::sort(editedVertices);
+    const auto isEdited = [&](const unsigned int microVertex) { return std::ranges::binary_search(editedVertices, microVertex); };
+
+    //Every hierarchy triangle that holds an edited micro-vertex, with that edit: the ancestors of the deepest hierarchy triangles that hold it
+    std::vector<std::pair<unsigned int, unsigned int>> affected;
+    for(unsigned int edit = 0; edit < edits.size(); edit++) {
+        const unsigned int microVertex = edits[edit].microVertex;
+
+        for(unsigned int i = hierarchy.vertexLeafOffsets[microVertex]; i < hierarchy.vertexLeafOffsets[microVertex + 1]; i++) {
+            unsigned int record = hierarchy.vertexLeaves[i];
+            affected.emplace_back(record, edit);
+            while(record != 0) {
+                record = hierarchy.parents[record];
+                affected.emplace_back(record, edit);
+            }
+        }
+    }
+
+    //Children come after their parents, so going backwards updates them first
+    std::ranges::sort(affected, std::greater{});
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+    size_t updated = 0;
+    for(size_t begin = 0; begin < affected.size();) {
+        const unsigned int record = affected[begin].first;
+        size_t end = begin;
+        while(end < affected.size() && affected[end].first == record) end++;
+
+        //Min-max displacements
+        const unsigned int firstChild = hierarchy.firstChildren[record];
+        float minDisplacement = 100000.0f, maxDisplacement = -100000.0f;
+        if(firstChild == 0) {
+            for(unsigned int f = hierarchy.faceOffsets[record]; f < hierarchy.faceOffsets[record + 1]; f++) {
+                for(int i = 0; i < 3; i++) {
+                    float height = glm::dot(t.uVertices[hierarchy.faces[f][i]].displacement, N);
+
+                    maxDisplacement = std::max(maxDisplacement, height);
+                    minDisplacement = std::min(minDisplacement, height);
+                }
+            }
+        } else {
+            for(unsigned int child = firstChild; child < firstChild + 4; child++) {
+                minDisplacement = std::min(minDisplacement, minMaxDisplacements[child].x);
+                maxDisplacement = std::max(maxDisplacement, minMaxDisplacements[child].y);
+            }
+        }
+        minMaxDisplacements[record] = {minDisplacement, maxDisplacement};
+
+        //Delta. The corners are displaced micro-vertices as well, so the bound triangle changes when one of them is edited.
+        const glm::uvec3& corners = hierarchy.corners[record];
+        const Triangle2D t2D{{project(corners.x, t.uVertices[corners.x].displacement), {}}, {project(corners.y, t.uVertices[corners.y].displacement), {}},
+                             {project(corners.z, t.uVertices[corners.z].displacement), {}}};
+
+        const float oldDelta = deltas[record];
+        bool recompute = isEdited(corners.x) || isEdited(corners.y) || isEdited(corners.z);
+        bool wasFarthest = false;
+        float farthestEdited = 0.0f;
+        for(size_t i = begin; i < end && !recompute; i++) {
+            const DisplacementEdit& edit = edits[affected[i].second];
+            wasFarthest |= pointDelta(t2D, project(edit.microVertex, edit.previousDisplacement)) >= oldDelta;
+            farthestEdited = std::max(farthestEdited, pointDelta(t2D, project(edit.microVertex, t.uVertices[edit.microVertex].displacement)));
+        }
+        //If the farthest micro-vertex moved inwards, the next farthest one is not known
+        recompute |= wasFarthest && farthestEdited < oldDelta;
+
+        float newDelta = std::max(oldDelta, farthestEdited);
+        if(recompute) {
+            std::unordered_set<glm::vec2> allPoints;
+            std::vector<unsigned int> stack{record};
+            while(!stack.empty()) {
+                const unsigned int current = stack.back();
+                stack.pop_back();
+
+                if(hierarchy.firstChildren[current] != 0) {
+                    for(unsigned int child = 0; child < 4; child++) stack.push_back(hierarchy.firstChildren[current] + child);
+                    continue;
+                }
+
+                for(unsigned int f = hierarchy.faceOffsets[current]; f < hierarchy.faceOffsets[current + 1]; f++) {
+                    for(int i = 0; i < 3; i++) allPoints.insert(project(hierarchy.faces[f][i], t.uVertices[hierarchy.faces[f][i]].displacement));
+                }
+            }
+
+            newDelta = computeTriangleDelta(t2D, allPoints);
+        }
+        deltas[record] = newDelta;
+
+        updated++;
+        begin = end;
+    }
+
+    return updated;
+}
@@ -4,10 +4,9 @@
 #include <framework/disable_all_warnings.h>
 #include <framework/TinyGLTFLoader.h>
 
+#include "AABBBuilder.h"
 #include "CommandSender.h"
-#include "ComputeShader.h"
 #include "DefaultBuffer.h"
-#include "ReadbackBuffer.h"
 #include "UploadBuffer.h"
 
 DISABLE_WARNINGS_PUSH()
@@ -18,16 +17,11 @@ DISABLE_WARNINGS_POP()
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
 
-struct SimpleTriangle {
-    unsigned int uVerticesStart;
-    unsigned int uVerticesCount;
-};
-
-struct SimpleVertex {
-    glm::vec3 position;
-    glm::vec3 displacement;
-};
+static_assert(sizeof(AABB) == sizeof(D3D12_RAYTRACING_AABB), "AABBs are copied to the GPU as is");
+static_assert(offsetof(AABB, minPos) == offsetof(D3D12_RAYTRACING_AABB, MinX) && offsetof(AABB, maxPos) == offsetof(D3D12_RAYTRACING_AABB, MaxX), "AABBs are copied to the GPU as is");
 
 GPUMesh::GPUMesh(const Mesh& cpuMesh, const ComPtr<ID3D12Device5>& device, bool runTessellated): cpuMesh(cpuMesh) {
     if(runTessellated) {
@@ -60,47 +54,21 @@ GPUMesh::GPUMesh(const Mesh& cpuMesh, const ComPtr<ID3D12Device5>& device, bool
     }
 
 
-    //Prepare buffer data for use in compute shader
-    std::vector<SimpleTriangle> triangles;
-    std::vector<SimpleVertex> uVertices;
-    for(const auto& t : cpuMesh.triangles) {
-        SimpleTriangle st{};
-
-        st.uVerticesStart = uVertices.size();
-        st.uVerticesCount = t.uVertices.size();
-
-        triangles.push_back(st);
-        std::ranges::transform(t.uVertices, std::back_inserter(uVertices), [&](const uVertex& uv) { return SimpleVertex{uv.position, uv.displacement}; });
-    }
+    //The AABBs are computed on the CPU, which is faster than a round trip through a compute shader
+    const std::vector<AABB> cpuAABBs = AABBBuilder::build(cpuMesh);
+    AABBs.resize(cpuAABBs.size());
+    std::memcpy(AABBs.data(), cpuAABBs.data(), sizeof(D3D12_RAYTRACING_AABB) * AABBs.size());
 
     CommandSender cw(device, D3D12_COMMAND_LIST_TYPE_COMPUTE);
     cw.reset();
 
-    //Create buffers for on the GPU and upload data to those buffers
-    DefaultBuffer<SimpleVertex> microVertexBuffer(device, uVertices.size(), D3D12_RESOURCE_STATE_COPY_DEST);
-    microVertexBuffer.upload(uVertices, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-
-    DefaultBuffer<SimpleTriangle> triangleBuffer(device, triangles.size(), D3D12_RESOURCE_STATE_COPY_DEST);
-    triangleBuffer.upload(triangles, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-
-    DefaultBuffer<D3D12_RAYTRACING_AABB> outputBuffer(device, triangles.size(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-
-    //Execute, wait and reset for later use
-    cw.execute(device);
-    cw.reset();
-
-    //Create our compute shader and execute it (computing an AABB around each triangle)
-    ComputeShader cs(RESOURCE_ROOT L"shaders/createAABBs.hlsl", device, {{SRV, 2}, {UAV, 1}}, sizeof(D3D12_RAYTRACING_AABB) * triangles.size());
-    cs.createSRV<uVertex>(microVertexBuffer.getBuffer());
-    cs.createSRV<SimpleTriangle>(triangleBuffer.getBuffer());
-    cs.createUAV<D3D12_RAYTRACING_AABB>(outputBuffer.getBuffer());
-
-    AABBs = cs.execute<D3D12_RAYTRACING_AABB>(outputBuffer.getBuffer(), triangles.size());
+    DefaultBuffer<D3D12_RAYTRACING_AABB> aabbBuffer(device, AABBs.size(), D3D12_RESOURCE_STATE_COPY_DEST);
+    aabbBuffer.upload(AABBs, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
     //Create BLAS AND TLAS
     DefaultBuffer<void> scratchBufferBLAS;
     if(runTessellated) createTriangleBLAS(device, cw.getCommandList(), scratchBufferBLAS);
-    else createBLAS(device, cw.getCommandList(), triangles.size(), outputBuffer.getBuffer(), scratchBufferBLAS);
+    else createBLAS(device, cw.getCommandList(), AABBs.size(), aabbBuffer.getBuffer(), scratchBufferBLAS);
 
     DefaultBuffer<void> scratchBufferTLAS;
     UploadBuffer<D3D12_RAYTRACING_INSTANCE_DESC> instanceBuffer(device, 1);
@@ -141,14 +109,7 @@ GPUMesh& GPUMesh::operator=(GPUMesh&& other) noexcept {
 }
 
 GPUMesh GPUMesh::loadGLTFMeshGPU(const std::filesystem::path& umeshFilePath, const ComPtr<ID3D12Device5>& device, const bool runTessellated) {
-    //Use functions from micromesh-tools to read *.gltf and *.bary file
-    GLTFReadInfo read_micromesh;
-    if(!read_gltf(umeshFilePath.string(), read_micromesh)) std::cerr << "Error reading gltf file" << std::endl;
-    if(!read_micromesh.has_subdivision_mesh()) std::cerr << "gltf file does not contain micromesh data" << std::endl;
-
-    const Mesh m = TinyGLTFLoader(umeshFilePath, read_micromesh).toMesh();
-
-    return {m, device, runTessellated};
+    return {TinyGLTFLoader::loadMesh(umeshFilePath), device, runTessellated};
 }
 
 void GPUMesh::createBLAS(
@@ -13,5 +13,11 @@ namespace TBNPlane {
 
             return {glm::vec2(dot(movedP, T), dot(movedP, B)), dot(movedP, N)};
         }
+
+        //Unprojects a 2D point back to 3D
+        //h is the height to displace along the plane normal
+        [[nodiscard]] glm::vec3 unproject(const glm::vec2& p, const float h) const {
+            return origin + p.x * T + p.y * B + h * N;
+        }
     };
 }
\ No newline at end of file
@@ -10,17 +10,41 @@
 #include "UploadBuffer.h"
 DISABLE_WARNINGS_PUSH()
 #include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui/imgui.h>
 DISABLE_WARNINGS_POP()
 #include <shader.h>
 #include <framework/window.h>
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <ranges>
 #include <framework/trackball.h>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <utility>
 #include "TriangleData.h"
+#include "BakeCoordinator.h"
+#include "BakedMesh.h"
+#include "BatchRunner.h"
+#include "Benchmarks.h"
+#include "CameraPath.h"
+#include "CPURenderer.h"
+#include "CPUScene.h"
+#include "InstancedScene.h"
+#include "JobFile.h"
+#include "PagedBlocks.h"
+#include "RenderDaemon.h"
+#include "Skinning.h"
+#include "TileCoordinator.h"
 
 #ifdef _DEBUG
 #define DX12_ENABLE_DEBUG_LAYER
@@ -30,17 +54,13 @@ DISABLE_WARNINGS_POP()
 #pragma comment(lib, "dxguid.lib")
 #endif
 
-struct BaseVertex {
-    glm::vec3 position;
-    glm::vec3 direction;
-};
-
 class Application {
 public:
-    explicit Application(const std::filesystem::path& umeshPath, const bool tessellated):
+    explicit Application(const std::filesystem::path& umeshPath, const bool tessellated, const std::filesystem::path& recordFile = {}):
         window("Micro Meshes", glm::ivec2(1024, 1024), &gpuState),
         projectionMatrix(glm::perspective(glm::radians(80.0f), window.getAspectRatio(), 0.1f, 1000.0f)),
-        runTessellated(tessellated)
+        runTessellated(tessellated),
+        recordPath(recordFile)
     {
         createDevice();
 
@@ -124,40 +144,27 @@ public:
             rtShader.createAccStrucSRV(mesh.getTLASBuffer());
 
 
-            std::vector<BaseVertex> baseVertices;
-            baseVertices.reserve(mesh.cpuMesh.vertices.size());
-            std::ranges::transform(mesh.cpuMesh.vertices, std::back_inserter(baseVertices), [](const Vertex& v) { return BaseVertex{v.position, v.direction}; });
+            //Same data as the CPU ray tracer uses
+            const BakedMesh baked = BakedMesh::bake(mesh.cpuMesh);
 
-            vertexBuffer = DefaultBuffer<BaseVertex>(device, baseVertices.size(), D3D12_RESOURCE_STATE_COPY_DEST);
-            vertexBuffer.upload(baseVertices, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            vertexBuffer = DefaultBuffer<BaseVertex>(device, baked.vertices.size(), D3D12_RESOURCE_STATE_COPY_DEST);
+            vertexBuffer.upload(baked.vertices, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
             rtShader.createSRV<BaseVertex>(vertexBuffer.getBuffer());
 
-            const auto cpuMesh = mesh.cpuMesh;
-
-            std::vector<TriangleData> tData;
-            tData.reserve(cpuMesh.triangles.size());
-            const auto displacementScales = cpuMesh.computeDisplacementScales(tData);
-
-            const auto minMaxDisplacements = cpuMesh.minMaxDisplacements(tData);
-
-            triangleData = DefaultBuffer<TriangleData>(device, tData.size(), D3D12_RESOURCE_STATE_COPY_DEST);
-            triangleData.upload(tData, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            triangleData = DefaultBuffer<TriangleData>(device, baked.triangleData.size(), D3D12_RESOURCE_STATE_COPY_DEST);
+            triangleData.upload(baked.triangleData, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
             rtShader.createSRV<TriangleData>(triangleData.getBuffer());
 
-            displacementScalesBuffer = DefaultBuffer<float>(device, displacementScales.size(), D3D12_RESOURCE_STATE_COPY_DEST);
-            displacementScalesBuffer.upload(displacementScales, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            displacementScalesBuffer = DefaultBuffer<float>(device, baked.displacementScales.size(), D3D12_RESOURCE_STATE_COPY_DEST);
+            displacementScalesBuffer.upload(baked.displacementScales, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
             rtShader.createSRV<float>(displacementScalesBuffer.getBuffer());
 
-            minMaxDisplacementBuffer = DefaultBuffer<glm::vec2>(device, minMaxDisplacements.size(), D3D12_RESOURCE_STATE_COPY_DEST);
-            minMaxDisplacementBuffer.upload(minMaxDisplacements, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            minMaxDisplacementBuffer = DefaultBuffer<glm::vec2>(device, baked.minMaxDisplacements.size(), D3D12_RESOURCE_STATE_COPY_DEST);
+            minMaxDisplacementBuffer.upload(baked.minMaxDisplacements, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
             rtShader.createSRV<glm::vec2>(minMaxDisplacementBuffer.getBuffer());
 
-            std::vector<int> allOffsets;
-            std::ranges::transform(tData, std::back_inserter(allOffsets), [&](const TriangleData& td) { return td.displacementOffset; });
-            const auto deltas = cpuMesh.triangleDeltas(allOffsets);
-
-            deltaBuffer = DefaultBuffer<float>(device, deltas.size(), D3D12_RESOURCE_STATE_COPY_DEST);
-            deltaBuffer.upload(deltas, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            deltaBuffer = DefaultBuffer<float>(device, baked.deltas.size(), D3D12_RESOURCE_STATE_COPY_DEST);
+            deltaBuffer.upload(baked.deltas, cw.getCommandList(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
             rtShader.createSRV<float>(deltaBuffer.getBuffer());
 
 
@@ -195,6 +202,15 @@ public:
             cw.execute(device);
             cw.reset();
         }
+
+        //Press K to add the current camera as a keyframe to the recorded camera path
+        if(!recordPath.empty()) {
+            recordedPath.resolution = dimensions;
+
+            window.registerKeyCallback([this](const int key, int, const int action, int) {
+                if(key == GLFW_KEY_K && action == GLFW_PRESS) recordKeyframe();
+            });
+        }
     }
 
     void update() {
@@ -239,6 +255,11 @@ public:
 
             swapChain->Present(1, 0);
         }
+
+        if(!recordPath.empty() && !recordedPath.getKeyframes().empty()) {
+            recordedPath.save(recordPath);
+            std::cout << "Saved " << recordedPath.getKeyframes().size() << " keyframes to " << recordPath << std::endl;
+        }
     }
 
     ~Application() {
@@ -271,6 +292,21 @@ private:
 
     bool runTessellated;
 
+    std::filesystem::path recordPath;
+    CameraPath recordedPath;
+    std::chrono::steady_clock::time_point recordStart;
+
+    //Keyframes are timed by when they were recorded, so the replay follows the pace of the user
+    void recordKeyframe() {
+        const auto now = std::chrono::steady_clock::now();
+        if(recordedPath.getKeyframes().empty()) recordStart = now;
+
+        const float time = std::chrono::duration<float>(now - recordStart).count();
+        recordedPath.addKeyframe({time, trackball->lookAt(), trackball->rotationEulerAngles(), trackball->distanceFromLookAt()});
+
+        std::cout << "Recorded keyframe " << recordedPath.getKeyframes().size() << " at " << time << "s" << std::endl;
+    }
+
     void createDevice() {
 #ifdef DX12_ENABLE_DEBUG_LAYER
         ID3D12Debug1* pdx12Debug = nullptr;
@@ -330,6 +366,664 @@ private:
     }
 };
 
+//Settings of the CPU renderer that the headless modes share
+struct RendererOptions {
+    //Passed to the renderer, see apply
+    bool packets = false;
+    float lodPixels = 0.0f;
+
+    //Passed to the scene rather than the renderer, see createScene
+    CPUScene::TraversalMode traversal = CPUScene::TraversalMode::AUTOMATIC;
+    bool splitAABBs = false;
+    int tessellationLevel = 0;
+    bool lazyBake = false;
+    VertexOrder vertexOrder = VertexOrder::ROW_MAJOR;
+    bool quantizedHierarchy = false; //Only for eagerly baked meshes in memory
+
+    std::filesystem::path pagedFile; //If set, the mesh is baked into this file and traced through a cache of pageCacheBytes, see PagedBlocks
+    size_t pageCacheBytes = size_t(256) << 20;
+    float flatTolerance = -1.0f; //If not negative, flat subtrees of the hierarchy are collapsed with this tolerance, see BakedMesh::collapseFlatSubtrees
+    bool instancing = false; //Load the file as a glTF scene of instanced meshes, see TinyGLTFLoader::loadScene and InstancedScene
+    bool skinned = false; //Pose the mesh with the skin and animation of its file every frame, see SkinnedAnimation. Only for meshes that CPUScene::applyMotion supports.
+    std::vector<std::string> bakeWorkers; //If set, eagerly baked meshes in memory are baked in shards on these daemons, see BakeCoordinator
+    std::filesystem::path meshFile; //The file of the mesh as the bake workers load it
+    std::filesystem::path shardDirectory; //Where the bake workers write their shards
+
+    void apply(CPURenderer& renderer) const {
+        renderer.setPacketTraversal(packets);
+        renderer.setLevelOfDetail(lodPixels);
+    }
+
+    [[nodiscard]] CPUScene createScene(const Mesh& mesh) const {
+        if(!pagedFile.empty()) {
+            PagedBlocks::bake(mesh, pagedFile, vertexOrder);
+            return CPUScene(PagedBlocks::open(pagedFile, pageCacheBytes), traversal, splitAABBs, tessellationLevel);
+        }
+        if(lazyBake) return CPUScene::bakeLazily(std::make_shared<const Mesh>(mesh), traversal, splitAABBs, tessellationLevel, vertexOrder);
+
+        BakedMesh baked = bake(mesh);
+        if(flatTolerance >= 0.0f) baked.collapseFlatSubtrees(flatTolerance);
+        if(quantizedHierarchy) baked.quantizeHierarchy();
+        return CPUScene(std::move(baked), traversal, splitAABBs, tessellationLevel);
+    }
+
+    //The same baked mesh on the bake workers as in this process
+    [[nodiscard]] BakedMesh bake(const Mesh& mesh) const {
+        if(bakeWorkers.empty()) return BakedMesh::bake(mesh, vertexOrder);
+
+        DistributedBakeStats stats;
+        BakedMesh baked = BakeCoordinator(bakeWorkers, {}).bake(mesh, meshFile, shardDirectory, vertexOrder, stats);
+        std::cout << "# distributed bake: " << stats.shards << " shards on " << bakeWorkers.size() - stats.failedWorkers.size() << " of " << bakeWorkers.size() << " workers in "
+            << stats.seconds << "s, " << static_cast<double>(stats.shardBytes) / (1024.0 * 1024.0) << " MiB of shards merged in " << stats.mergeSeconds << "s" << std::endl;
+        for(const std::string& error : stats.failedWorkers) std::cerr << "Bake worker failed: " << error << std::endl;
+
+        return baked;
+    }
+
+    //The scene in a file, or its micro-mesh as the only instance without instancing
+    [[nodiscard]] MeshScene loadMeshes(const std::filesystem::path& umeshPath) const {
+        if(instancing) return TinyGLTFLoader::loadScene(umeshPath);
+
+        MeshScene meshScene;
+        meshScene.meshes.push_back(TinyGLTFLoader::loadMesh(umeshPath));
+        meshScene.instances.push_back({0, glm::mat4(1.0f)});
+        return meshScene;
+    }
+
+    //Without instancing a CPUScene of the only mesh, otherwise an InstancedScene in which every unique mesh is baked once
+    [[nodiscard]] std::unique_ptr<RayTracedScene> createScene(const MeshScene& meshScene) const {
+        if(!instancing) return std::make_unique<CPUScene>(createScene(meshScene.meshes.front()));
+
+        std::vector<CPUScene> scenes;
+        for(const Mesh& mesh : meshScene.meshes) scenes.push_back(createScene(mesh));
+
+        std::vector<InstancedScene::Instance> instances;
+        for(const MeshInstance& instance : meshScene.instances) instances.push_back({instance.mesh, instance.transform});
+        return std::make_unique<InstancedScene>(std::move(scenes), std::move(instances));
+    }
+};
+
+//Memory of the baked meshes and BVHs of a scene
+static size_t sceneSizeInBytes(const RayTracedScene& scene) {
+    if(const auto* instanced = dynamic_cast<const InstancedScene*>(&scene)) return instanced->meshSizeInBytes() + instanced->instanceSizeInBytes();
+
+    const auto& single = static_cast<const CPUScene&>(scene);
+    return single.getMesh().sizeInBytes() + single.getBVH().sizeInBytes();
+}
+
+//Prints one line of statistics in CSV format, normalized per ray where that makes sense
+static void printFrameStats(const std::string& label, const float time, const FrameStats& fs) {
+    const auto& ts = fs.traversal;
+    const double rays = std::max<double>(1.0, static_cast<double>(ts.rays));
+
+    std::cout << label << ',' << time << ',' << fs.seconds * 1000.0 << ',' << ts.rays << ',' << fs.raysPerSecond() / 1e6 << ','
+        << ts.hits / rays << ',' << ts.bvhNodesVisited / rays << ',' << ts.intersectionCalls / rays << ','
+        << ts.hierarchyNodesVisited / rays << ',' << ts.boundingTriangleTests / rays << ',' << ts.microTriangleTests / rays << std::endl;
+}
+
+//Renders every frame of a camera path on the CPU, without creating a window or touching the GPU, and reports the statistics of every frame
+static int replayCameraPath(const std::filesystem::path& umeshPath, const std::filesystem::path& cameraPathFile, const unsigned int threadCount, const RendererOptions& options) {
+    CameraPath path;
+    try {
+        path = CameraPath::load(cameraPathFile);
+    } catch(const std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+
+    const auto loadStart = std::chrono::steady_clock::now();
+    const MeshScene meshScene = options.loadMeshes(umeshPath);
+    const auto bakeStart = std::chrono::steady_clock::now();
+    const std::unique_ptr<RayTracedScene> scene = options.createScene(meshScene);
+    const auto bakeEnd = std::chrono::steady_clock::now();
+
+    size_t baseTriangles = 0;
+    for(const Mesh& mesh : meshScene.meshes) baseTriangles += mesh.triangles.size();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "# mesh: " << umeshPath.string() << ", " << baseTriangles << " base triangles";
+    if(options.instancing) std::cout << " in " << meshScene.meshes.size() << " unique meshes, " << meshScene.instances.size() << " instances";
+    std::cout << std::endl;
+    std::cout << "# load: " << std::chrono::duration<double>(bakeStart - loadStart).count() << "s, bake + BVH: " << std::chrono::duration<double>(bakeEnd - bakeStart).count() << "s, "
+        << sceneSizeInBytes(*scene) / (1024.0 * 1024.0) << " MiB" << std::endl;
+    CPURenderer renderer(*scene, threadCount);
+    options.apply(renderer);
+    std::cout << "# " << path.frameCount() << " frames at " << path.resolution.x << "x" << path.resolution.y << ", " << renderer.getThreadCount() << " threads" << std::endl;
+    std::cout << "frame,time,ms,rays,mrays_per_s,hit_rate,bvh_nodes_per_ray,intersection_calls_per_ray,hierarchy_nodes_per_ray,bounding_tests_per_ray,micro_triangle_tests_per_ray" << std::endl;
+
+    const glm::mat4 projection = path.projectionMatrix();
+    std::vector<glm::vec3> pixels;
+
+    FrameStats total;
+    for(int frame = 0; frame < path.frameCount(); frame++) {
+        const float time = path.frameTime(frame);
+        const glm::mat4 invViewProj = glm::inverse(projection * CameraPath::viewMatrix(path.sample(time)));
+
+        const FrameStats fs = renderer.render(invViewProj, path.resolution, pixels);
+        printFrameStats(std::to_string(frame), time, fs);
+
+        total.seconds += fs.seconds;
+        total.traversal += fs.traversal;
+    }
+
+    printFrameStats("total", path.endTime(), total);
+
+    return 0;
+}
+
+//Inserts the frame number before the extension, so out.png becomes out_0007.png
+static std::filesystem::path numberedFilePath(const std::filesystem::path& filePath, const int frame) {
+    std::ostringstream name;
+    name << filePath.stem().string() << '_' << std::setw(4) << std::setfill('0') << frame << filePath.extension().string();
+
+    return filePath.parent_path() / name.str();
+}
+
+//Parses a comma-separated list of daemon addresses, see Socket
+static std::vector<std::string> parseAddresses(const std::string& text) {
+    std::vector<std::string> addresses;
+    std::stringstream list(text);
+    for(std::string address; std::getline(list, address, ',');) {
+        if(!address.empty()) addresses.push_back(address);
+    }
+
+    return addresses;
+}
+
+//Parses a resolution such as 1920x1080, returns (0, 0) if it is not valid
+static glm::uvec2 parseResolution(const std::string& text) {
+    unsigned int width = 0, height = 0;
+    char separator = 0;
+    std::istringstream stream(text);
+    if(!(stream >> width >> separator >> height) || separator != 'x') return {0, 0};
+
+    return {width, height};
+}
+
+/**
+ * Creates the cameras of an offline render. Without a camera path, the camera looks at the center of the mesh from far
+ * enough away to see all of it, orbiting around it in `turntableFrames` frames. Throws if the camera path can not be loaded.
+ *
+ * @param path set to the loaded camera path, or a default one that has the resolution and field of view of the cameras
+ * @return one camera per frame
+ */
+static std::vector<CameraKeyframe> offlineCameras(const RayTracedScene& scene, const std::filesystem::path& cameraPathFile, const glm::uvec2& resolution,
+                                                  const int turntableFrames, CameraPath& path) {
+    std::vector<CameraKeyframe> cameras;
+    if(!cameraPathFile.empty()) path = CameraPath::load(cameraPathFile);
+    if(resolution.x > 0 && resolution.y > 0) path.resolution = resolution;
+
+    if(!cameraPathFile.empty()) {
+        for(int frame = 0; frame < path.frameCount(); frame++) cameras.push_back(path.sample(path.frameTime(frame)));
+        return cameras;
+    }
+
+    //Fit the bounding sphere of the mesh in the narrowest field of view
+    const AABB bounds = scene.bounds();
+    const int frames = std::max(1, turntableFrames);
+    for(int frame = 0; frame < frames; frame++) {
+        const float angle = glm::two_pi<float>() * static_cast<float>(frame) / static_cast<float>(frames);
+        cameras.push_back(path.frameBounds(bounds, angle, static_cast<float>(frame) / path.framesPerSecond));
+    }
+
+    return cameras;
+}
+
+//Poses a micro-mesh with the skin and the first animation of its file, and moves the scene along with it
+class SkinnedAnimation {
+    MeshSkin skin;
+    Skinning::RestPose rest;
+    Skinning::VertexArrays posed;
+    unsigned int threadCount;
+
+public:
+    SkinnedAnimation(const std::filesystem::path& umeshPath, const Mesh& mesh, const unsigned int threadCount): skin(TinyGLTFLoader::loadSkin(umeshPath)), threadCount(threadCount) {
+        if(skin.joints.size() != mesh.vertices.size()) throw std::runtime_error("The skin does not have joints for every base vertex of the micro-mesh");
+
+        rest = Skinning::RestPose(mesh.vertices, skin.joints, skin.weights);
+    }
+
+    /**
+     * Skins the base vertices at a time of the animation, moves the mesh to them and updates the scene.
+     *
+     * @return the time it took to skin the vertices and the time it took to move the mesh and update the scene, in seconds
+     */
+    std::pair<double, double> pose(const float time, Mesh& mesh, CPUScene& scene) {
+        const auto start = std::chrono::steady_clock::now();
+        Skinning::skin(rest, skin.jointMatrices(time), posed, threadCount);
+        const auto skinned = std::chrono::steady_clock::now();
+        scene.applyMotion(mesh, Skinning::moveVertices(mesh, posed), threadCount);
+        const auto end = std::chrono::steady_clock::now();
+
+        return {std::chrono::duration<double>(skinned - start).count(), std::chrono::duration<double>(end - skinned).count()};
+    }
+};
+
+/**
+ * Renders images on the CPU without creating a window or touching the GPU.
+ *
+ * @param umeshPath the micro-mesh to render
+ * @param outputFile the image to write. If there is more than one frame, the frame number is appended to its name.
+ * @param cameraPathFile a camera path to render every frame of, or an empty path to frame the whole mesh
+ * @param resolution the resolution of the images, or (0, 0) for the default of the camera path
+ * @param turntableFrames the number of frames of a full orbit around the mesh, ignored with a camera path
+ * @param threadCount the number of threads to render with, 0 uses every hardware thread
+ * @param options whether to trace the rays in packets and the level of detail, and whether to animate the mesh
+ */
+static int renderImages(const std::filesystem::path& umeshPath, const std::filesystem::path& outputFile, const std::filesystem::path& cameraPathFile,
+                        const glm::uvec2& resolution, const int turntableFrames, const unsigned int threadCount, const RendererOptions& options) {
+    MeshScene meshScene = options.loadMeshes(umeshPath);
+    const auto bakeStart = std::chrono::steady_clock::now();
+    const std::unique_ptr<RayTracedScene> scene = options.createScene(meshScene);
+    const auto bakeEnd = std::chrono::steady_clock::now();
+
+    std::optional<SkinnedAnimation> animation;
+    if(options.skinned) animation.emplace(umeshPath, meshScene.meshes.front(), threadCount);
+
+    CameraPath path;
+    std::vector<CameraKeyframe> cameras;
+    try {
+        cameras = offlineCameras(*scene, cameraPathFile, resolution, turntableFrames, path);
+    } catch(const std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+
+    CPURenderer renderer(*scene, threadCount);
+    options.apply(renderer);
+    const glm::mat4 projection = path.projectionMatrix();
+    std::vector<glm::vec3> pixels;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Bake + BVH: " << std::chrono::duration<double>(bakeEnd - bakeStart).count() << "s, rendering " << cameras.size() << " frame(s) at "
+        << path.resolution.x << "x" << path.resolution.y << " on " << renderer.getThreadCount() << " threads" << std::endl;
+
+    FrameStats total;
+    for(size_t frame = 0; frame < cameras.size(); frame++) {
+        //The animation plays at the time of the camera, so it is in sync with a camera path
+        std::pair<double, double> poseSeconds;
+        if(animation) poseSeconds = animation->pose(cameras[frame].time, meshScene.meshes.front(), static_cast<CPUScene&>(*scene));
+
+        const FrameStats fs = renderer.render(glm::inverse(projection * CameraPath::viewMatrix(cameras[frame])), path.resolution, pixels);
+
+        const std::filesystem::path filePath = cameras.size() == 1 ? outputFile : numberedFilePath(outputFile, static_cast<int>(frame));
+        try {
+            CPURenderer::writeImage(pixels, path.resolution, filePath);
+        } catch(const std::runtime_error& e) {
+            std::cerr << e.what();
+            return 1;
+        }
+        std::cout << filePath.string() << ": " << fs.seconds * 1000.0 << "ms, " << fs.raysPerSecond() / 1e6 << " Mrays/s";
+        if(animation) std::cout << ", skinning " << poseSeconds.first * 1000.0 << "ms, scene update " << poseSeconds.second * 1000.0 << "ms";
+        std::cout << std::endl;
+
+        total.seconds += fs.seconds;
+        total.traversal += fs.traversal;
+    }
+
+    std::cout << "Total: " << total.seconds << "s, " << total.raysPerSecond() / 1e6 << " Mrays/s" << std::endl;
+
+    return 0;
+}
+
+/**
+ * Renders the same images as renderImages on render daemons instead of this process, see TileCoordinator.
+ *
+ * @param umeshPath the micro-mesh, which the workers must be able to read at its absolute path
+ * @param workers the addresses of the daemons
+ * @param tileSize the size of the tiles that the frames are split into
+ */
+static int renderDistributed(const std::filesystem::path& umeshPath, const std::filesystem::path& outputFile, const std::filesystem::path& cameraPathFile,
+                             const glm::uvec2& resolution, const int turntableFrames, const std::vector<std::string>& workers, const unsigned int tileSize,
+                             const RendererOptions& options) {
+    CameraPath path;
+    try {
+        if(!cameraPathFile.empty()) path = CameraPath::load(cameraPathFile);
+    } catch(const std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+    if(resolution.x > 0 && resolution.y > 0) path.resolution = resolution;
+
+    //Without a camera path the workers frame the mesh, so this process does not have to load it
+    std::vector<TileCoordinator::Frame> frames;
+    TileCoordinator::Frame frame{std::filesystem::absolute(umeshPath), path.resolution, path.fovy, std::nullopt, 0.0f, options.packets, options.lodPixels};
+    if(!cameraPathFile.empty()) {
+        for(int i = 0; i < path.frameCount(); i++) {
+            frame.camera = path.sample(path.frameTime(i));
+            frames.push_back(frame);
+        }
+    } else {
+        const int count = std::max(1, turntableFrames);
+        for(int i = 0; i < count; i++) {
+            frame.angle = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(count);
+            frames.push_back(frame);
+        }
+    }
+
+    TileCoordinator coordinator(workers, {tileSize});
+    std::vector<uint8_t> rgb;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Rendering " << frames.size() << " frame(s) at " << path.resolution.x << "x" << path.resolution.y << " on " << workers.size() << " worker(s)" << std::endl;
+
+    DistributedFrameStats total;
+    for(size_t i = 0; i < frames.size(); i++) {
+        DistributedFrameStats fs;
+        try {
+            fs = coordinator.render(frames[i], rgb);
+        } catch(const std::runtime_error& e) {
+            //None of the workers could be reached, or all of them failed
+            std::cerr << e.what();
+            return 1;
+        }
+
+        const std::filesystem::path filePath = frames.size() == 1 ? outputFile : numberedFilePath(outputFile, static_cast<int>(i));
+        try {
+            CPURenderer::writeImage(rgb, path.resolution, filePath);
+        } catch(const std::runtime_error& e) {
+            std::cerr << e.what();
+            return 1;
+        }
+        std::cout << filePath.string() << ": " << fs.seconds * 1000.0 << "ms, " << fs.raysPerSecond() / 1e6 << " Mrays/s, " << fs.tiles << " tiles, "
+            << fs.reissuedTiles << " reissued, " << fs.discardedTiles << " discarded, tiles per worker:";
+        for(const size_t tiles : fs.tilesPerWorker) std::cout << ' ' << tiles;
+        std::cout << std::endl;
+        for(const std::string& failure : fs.failedWorkers) std::cerr << "Worker failed: " << failure << std::endl;
+
+        total.seconds += fs.seconds;
+        total.rays += fs.rays;
+    }
+
+    std::cout << "Total: " << total.seconds << "s, " << total.raysPerSecond() / 1e6 << " Mrays/s" << std::endl;
+
+    return 0;
+}
+
+/**
+ * Measures how the CPU renderer scales with the number of threads, for both static bands and work stealing. Renders
+ * the first frame of the offline cameras with 1 up to `maxThreadCount` threads and prints the best of a few runs as CSV.
+ *
+ * @param maxThreadCount the highest number of threads to measure, 0 uses every hardware thread
+ * @param options whether to trace the rays in packets and the level of detail
+ */
+static int measureScaling(const std::filesystem::path& umeshPath, const std::filesystem::path& cameraPathFile, const glm::uvec2& resolution, const unsigned int maxThreadCount,
+                          const RendererOptions& options) {
+    constexpr int RUNS = 3;
+
+    const std::unique_ptr<RayTracedScene> scene = options.createScene(options.loadMeshes(umeshPath));
+    CameraPath path;
+    CameraKeyframe camera{};
+    try {
+        camera = offlineCameras(*scene, cameraPathFile, resolution, 1, path).front();
+    } catch(const std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+    const glm::mat4 invViewProj = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(camera));
+    const unsigned int threads = maxThreadCount > 0 ? maxThreadCount : std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "# mesh: " << umeshPath.string() << ", " << path.resolution.x << "x" << path.resolution.y << ", best of " << RUNS << " runs" << std::endl;
+    std::cout << "threads,schedule,ms,mrays_per_s,speedup,efficiency,stolen_tiles" << std::endl;
+
+    std::vector<glm::vec3> pixels;
+    for(const auto schedule : {CPURenderer::Schedule::STATIC_BANDS, CPURenderer::Schedule::WORK_STEALING}) {
+        double singleThreadSeconds = 0.0;
+
+        for(unsigned int threadCount = 1; threadCount <= threads; threadCount++) {
+            CPURenderer renderer(*scene, threadCount, schedule);
+            options.apply(renderer);
+
+            FrameStats best;
+            for(int run = 0; run < RUNS; run++) {
+                const FrameStats fs = renderer.render(invViewProj, path.resolution, pixels);
+                if(run == 0 || fs.seconds < best.seconds) best = fs;
+            }
+            if(threadCount == 1) singleThreadSeconds = best.seconds;
+
+            const double speedup = singleThreadSeconds / best.seconds;
+            std::cout << threadCount << ',' << (schedule == CPURenderer::Schedule::STATIC_BANDS ? "bands" : "stealing") << ',' << best.seconds * 1000.0 << ','
+                << best.raysPerSecond() / 1e6 << ',' << speedup << ',' << speedup / threadCount << ',' << best.stolenTiles << std::endl;
+        }
+    }
+
+    return 0;
+}
+
+//The micro-mesh, the cameras and the settings that a benchmark of a micro-mesh runs with
+struct BenchmarkInput {
+    std::filesystem::path umeshPath;
+    std::shared_ptr<const Mesh> mesh; //Null once it is baked into the scene
+    std::optional<CPUScene> scene; //The baked mesh, for MeshBenchmark::Setup::BAKED
+    std::vector<CameraKeyframe> cameras;
+    CameraPath path;
+    unsigned int threadCount = 0;
+    float lodPixels = 0.0f;
+};
+
+//A benchmark of a micro-mesh and the flag that runs it, see Benchmarks
+struct MeshBenchmark {
+    enum class Setup {
+        MESH, //Only the loaded mesh
+        CAMERAS, //The loaded mesh and the cameras, the benchmark bakes the mesh itself
+        BAKED //The baked scene and the cameras
+    };
+
+    const char* flag;
+    Setup setup;
+    int (*run)(BenchmarkInput& input);
+};
+
+static const MeshBenchmark MESH_BENCHMARKS[] = {
+    {"--packet-bench", MeshBenchmark::Setup::BAKED, [](BenchmarkInput& in) { return Benchmarks::packetTraversal(*in.scene, in.cameras, in.path, in.threadCount); }},
+    {"--lod-bench", MeshBenchmark::Setup::BAKED,
+     [](BenchmarkInput& in) { return Benchmarks::levelOfDetail(*in.scene, in.cameras, in.path, in.threadCount, in.lodPixels > 0.0f ? in.lodPixels : 1.0f); }},
+    {"--grid-bench", MeshBenchmark::Setup::BAKED, [](BenchmarkInput& in) { return Benchmarks::gridTraversal(*in.scene, in.cameras, in.path, in.threadCount); }},
+    {"--split-bench", MeshBenchmark::Setup::BAKED,
+     [](BenchmarkInput& in) { return Benchmarks::aabbSplitting(in.scene->getMesh(), in.cameras, in.path, in.threadCount); }},
+    {"--aabb-bench", MeshBenchmark::Setup::MESH, [](BenchmarkInput& in) { return Benchmarks::aabbBuild(*in.mesh, in.threadCount); }},
+    {"--hybrid-bench", MeshBenchmark::Setup::BAKED,
+     [](BenchmarkInput& in) { return Benchmarks::hybridTessellation(in.scene->getMesh(), in.cameras, in.path, in.threadCount); }},
+    {"--lazy-bench", MeshBenchmark::Setup::CAMERAS, [](BenchmarkInput& in) { return Benchmarks::lazyBake(in.mesh, in.cameras, in.path, in.threadCount); }},
+    {"--edit-bench", MeshBenchmark::Setup::CAMERAS, [](BenchmarkInput& in) { return Benchmarks::incrementalBake(*in.mesh, in.cameras, in.path, in.threadCount); }},
+    {"--paged-bench", MeshBenchmark::Setup::CAMERAS,
+     [](BenchmarkInput& in) { return Benchmarks::pagedBlocks(*in.mesh, in.cameras, in.path, in.threadCount, std::filesystem::path(in.umeshPath) += ".pages"); }},
+    {"--order-bench", MeshBenchmark::Setup::CAMERAS, [](BenchmarkInput& in) { return Benchmarks::vertexOrder(*in.mesh, in.cameras, in.path, in.threadCount); }},
+    {"--quantize-bench", MeshBenchmark::Setup::CAMERAS, [](BenchmarkInput& in) { return Benchmarks::quantizedHierarchy(*in.mesh, in.cameras, in.path, in.threadCount); }},
+    {"--sparse-bench", MeshBenchmark::Setup::CAMERAS, [](BenchmarkInput& in) { return Benchmarks::sparseHierarchy(*in.mesh, in.cameras, in.path, in.threadCount); }},
+    {"--instance-bench", MeshBenchmark::Setup::CAMERAS, [](BenchmarkInput& in) { return Benchmarks::instancing(*in.mesh, in.cameras, in.path, in.threadCount); }},
+    {"--refit-bench", MeshBenchmark::Setup::CAMERAS, [](BenchmarkInput& in) { return Benchmarks::bvhRefit(*in.mesh, in.cameras, in.path, in.threadCount); }},
+    {"--shard-bench", MeshBenchmark::Setup::MESH,
+     [](BenchmarkInput& in) { return Benchmarks::shardedBake(*in.mesh, in.threadCount, std::filesystem::path(in.umeshPath) += ".shards"); }},
+    {"--query-bench", MeshBenchmark::Setup::BAKED, [](BenchmarkInput& in) { return Benchmarks::rayQuery(in.scene->getMesh(), in.cameras, in.path, in.threadCount); }},
+};
+
+//The benchmark of a micro-mesh that a flag runs, null if the flag is not one
+static const MeshBenchmark* findMeshBenchmark(const std::string& flag) {
+    for(const MeshBenchmark& benchmark : MESH_BENCHMARKS) {
+        if(flag == benchmark.flag) return &benchmark;
+    }
+    return nullptr;
+}
+
+/**
+ * Loads the micro-mesh, bakes it and places the offline cameras as far as the benchmark needs, and runs it.
+ *
+ * @param lodPixels the level of detail of --lod-bench
+ */
+static int runMeshBenchmark(const MeshBenchmark& benchmark, const std::filesystem::path& umeshPath, const std::filesystem::path& cameraPathFile,
+                            const glm::uvec2& resolution, const int turntableFrames, const unsigned int threadCount, const float lodPixels) {
+    BenchmarkInput input;
+    input.umeshPath = umeshPath;
+    input.mesh = std::make_shared<const Mesh>(TinyGLTFLoader::loadMesh(umeshPath));
+    input.threadCount = threadCount;
+    input.lodPixels = lodPixels;
+
+    try {
+        if(benchmark.setup == MeshBenchmark::Setup::BAKED) {
+            input.scene.emplace(BakedMesh::bake(*input.mesh));
+            input.mesh.reset();
+            input.cameras = offlineCameras(*input.scene, cameraPathFile, resolution, turntableFrames, input.path);
+        } else if(benchmark.setup == MeshBenchmark::Setup::CAMERAS) {
+            //Only used to place the cameras, the benchmark bakes the mesh itself. The copies of --instance-bench fit in the bounds of the mesh.
+            const CPUScene scene = CPUScene::bakeLazily(input.mesh);
+            input.cameras = offlineCameras(scene, cameraPathFile, resolution, turntableFrames, input.path);
+        }
+    } catch(const std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+
+    return benchmark.run(input);
+}
+
+/**
+ * Runs a resident render daemon until a client asks it to shut down, see RenderDaemon.
+ *
+ * @param address a Unix domain socket or a TCP "host:port" to listen on
+ * @param argc, argv the arguments after --daemon <address>: --threads <n>, --cache <MB>, --packets, --lod <pixels>, --scene,
+ * --paged-cache <directory>, --page-cache <MB>, --output-dir <directory> and --allow-remote
+ */
+static int runDaemon(const std::string& address, const int argc, char* argv[]) {
+    RenderDaemon::Options daemonOptions;
+    daemonOptions.address = address;
+    RendererOptions options;
+    std::filesystem::path pagedDirectory;
+    for(int i = 0; i < argc; i++) {
+        const std::string arg(argv[i]);
+
+        if(arg == "--threads" && i + 1 < argc) daemonOptions.threadCount = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+        else if(arg == "--cache" && i + 1 < argc) daemonOptions.cacheBytes = static_cast<size_t>(std::max(1, std::atoi(argv[++i]))) << 20;
+        else if(arg == "--packets") daemonOptions.packets = true;
+        else if(arg == "--lod" && i + 1 < argc) daemonOptions.lodPixels = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        else if(arg == "--scene") options.instancing = true;
+        else if(arg == "--paged-cache" && i + 1 < argc) pagedDirectory = argv[++i];
+        else if(arg == "--page-cache" && i + 1 < argc) options.pageCacheBytes = static_cast<size_t>(std::max(1, std::atoi(argv[++i]))) << 20;
+        else if(arg == "--output-dir" && i + 1 < argc) daemonOptions.outputDirectory = argv[++i];
+        else if(arg == "--allow-remote") daemonOptions.allowRemote = true;
+        else {
+            std::cerr << "Unknown argument: " << arg;
+            return 1;
+        }
+    }
+
+    if(options.instancing && !pagedDirectory.empty()) {
+        std::cerr << "--paged-cache is ignored together with --scene" << std::endl;
+        pagedDirectory.clear();
+    }
+
+    const auto loader = [options, pagedDirectory](const std::filesystem::path& umeshPath, const std::uint64_t hash) {
+        if(pagedDirectory.empty()) {
+            std::unique_ptr<RayTracedScene> scene = options.createScene(options.loadMeshes(umeshPath));
+            const size_t bytes = sceneSizeInBytes(*scene);
+            return SceneCache::Loaded{std::move(scene), bytes};
+        }
+
+        //Daemons that share the directory, on this machine or on others, bake a mesh once and memory-map the same file.
+        //It is written under a name of its own and renamed, so nobody opens a file that is only partly written.
+        std::ostringstream name;
+        name << std::hex << std::setw(16) << std::setfill('0') << hash << ".pages";
+        const std::filesystem::path pagedFile = pagedDirectory / name.str();
+        if(!std::filesystem::exists(pagedFile)) {
+            std::filesystem::create_directories(pagedDirectory);
+            std::filesystem::path partialFile = pagedFile;
+            partialFile += "." + std::to_string(std::random_device{}()) + ".partial";
+            PagedBlocks::bake(TinyGLTFLoader::loadMesh(umeshPath), partialFile, options.vertexOrder);
+            std::error_code error;
+            std::filesystem::rename(partialFile, pagedFile, error);
+            if(error) {
+                //Another daemon renamed its copy first, and may have it mapped already
+                std::filesystem::remove(partialFile, error);
+                if(!std::filesystem::exists(pagedFile)) throw std::runtime_error("Could not write " + pagedFile.string());
+            }
+        }
+
+        auto scene = std::make_unique<CPUScene>(PagedBlocks::open(pagedFile, options.pageCacheBytes), options.traversal, options.splitAABBs, options.tessellationLevel);
+        const size_t bytes = sceneSizeInBytes(*scene) + options.pageCacheBytes;
+        return SceneCache::Loaded{std::move(scene), bytes};
+    };
+
+    RenderDaemon daemon(loader, daemonOptions, [](const std::filesystem::path& umeshPath) { return TinyGLTFLoader::loadMesh(umeshPath); });
+    try {
+        daemon.run();
+    } catch(const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Runs the jobs of a job file on the CPU, see JobFile and BatchRunner, and reports the statistics of every frame.
+ *
+ * @param jobFilePath the TOML job file
+ * @param argc, argv the arguments after --jobs <file>: --threads <n>, which overrides the threads of the job file
+ */
+static int runJobs(const std::filesystem::path& jobFilePath, const int argc, char* argv[]) {
+    unsigned int threadCount = 0;
+    for(int i = 0; i < argc; i++) {
+        const std::string arg(argv[i]);
+
+        if(arg == "--threads" && i + 1 < argc) threadCount = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+        else {
+            std::cerr << "Unknown argument: " << arg;
+            return 1;
+        }
+    }
+
+    JobFile jobFile;
+    try {
+        jobFile = JobFile::load(jobFilePath);
+    } catch(const std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+
+    BatchRunner runner(std::move(jobFile), [](const std::filesystem::path& umeshPath) { return TinyGLTFLoader::loadMesh(umeshPath); }, threadCount);
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "# " << jobFilePath.string() << ": " << runner.jobCount() << " jobs, " << runner.getJobFile().meshes.size() << " meshes, "
+        << runner.getJobFile().scenes.size() << " scenes" << std::endl;
+    std::cout << "frame,time,ms,rays,mrays_per_s,hit_rate,bvh_nodes_per_ray,intersection_calls_per_ray,hierarchy_nodes_per_ray,bounding_tests_per_ray,micro_triangle_tests_per_ray" << std::endl;
+
+    const auto start = std::chrono::steady_clock::now();
+    for(size_t job = 0; job < runner.jobCount(); job++) {
+        BatchRunner::JobResult result;
+        try {
+            result = runner.run(job);
+        } catch(const std::exception& e) {
+            //A job that fails, for example because its images can not be written, stops the batch
+            std::cerr << "Job " << job << " failed: " << e.what();
+            return 1;
+        }
+
+        std::cout << "# " << result.name << ": ";
+        if(result.bakedMeshes > 0) std::cout << "loaded " << result.bakedMeshes << " mesh(es) in " << result.loadSeconds << "s, ";
+        if(result.bakeSeconds > 0.0) std::cout << "bake + BVH " << result.bakeSeconds << "s, ";
+        else std::cout << "reused the scene, ";
+        std::cout << result.frames.size() << " frame(s) at " << result.resolution.x << "x" << result.resolution.y << ", " << result.samples << " sample(s) per pixel, "
+            << result.threadCount << " threads" << std::endl;
+        for(size_t frame = 0; frame < result.frames.size(); frame++) {
+            printFrameStats(result.name + "/" + std::to_string(frame), result.frames[frame].time, result.frames[frame].stats);
+        }
+        printFrameStats(result.name + "/total", result.frames.empty() ? 0.0f : result.frames.back().time, result.total);
+    }
+    std::cout << "# all jobs: " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s" << std::endl;
+
+    return 0;
+}
+
+//Parses hierarchy, grid or auto, returns false if the text is none of them
+static bool parseTraversalMode(const std::string& text, CPUScene::TraversalMode& mode) {
+    if(text == "hierarchy") mode = CPUScene::TraversalMode::HIERARCHY;
+    else if(text == "grid") mode = CPUScene::TraversalMode::GRID;
+    else if(text == "auto") mode = CPUScene::TraversalMode::AUTOMATIC;
+    else return false;
+
+    return true;
+}
+
 int main(const int argc, char* argv[]) {
     //The first argument is the path to the .exe file
     if(argc == 1) {
@@ -337,6 +1031,25 @@ int main(const int argc, char* argv[]) {
         return 1;
     }
 
+    //Benchmarks that do not need a micro-mesh
+    if(std::string(argv[1]) == "--kernel-bench") return Benchmarks::edgeKernels();
+    if(std::string(argv[1]) == "--channel-bench") return Benchmarks::transformationChannels();
+    if(std::string(argv[1]) == "--skinning-bench") return Benchmarks::skinning(0);
+    if(std::string(argv[1]) == "--jobs") {
+        if(argc < 3) {
+            std::cerr << "Did not specify the job file.";
+            return 1;
+        }
+        return runJobs(argv[2], argc - 3, argv + 3);
+    }
+    if(std::string(argv[1]) == "--daemon") {
+        if(argc < 3) {
+            std::cerr << "Did not specify the address of the daemon.";
+            return 1;
+        }
+        return runDaemon(argv[2], argc - 3, argv + 3);
+    }
+
     //Introducing scope to destroy the Application object before we check for live objects
     {
         const std::filesystem::path umeshPath(argv[1]);
@@ -346,9 +1059,115 @@ int main(const int argc, char* argv[]) {
         }
 
         bool tessellated = false;
-        if(argc == 3 && std::string(argv[2]) == "-T") tessellated = true;
+        std::filesystem::path replayFile, recordFile, renderFile, cameraFile;
+        glm::uvec2 resolution{0, 0};
+        int turntableFrames = 1;
+        unsigned int threadCount = 0;
+        bool scaling = false;
+        RendererOptions options;
+        const MeshBenchmark* meshBenchmark = nullptr;
+        std::vector<std::string> workers;
+        unsigned int remoteTileSize = TileCoordinator::Options{}.tileSize;
+        for(int i = 2; i < argc; i++) {
+            const std::string arg(argv[i]);
+
+            if(arg == "-T") tessellated = true;
+            else if(const MeshBenchmark* benchmark = findMeshBenchmark(arg)) meshBenchmark = benchmark;
+            else if(arg == "--replay" && i + 1 < argc) replayFile = argv[++i];
+            else if(arg == "--record" && i + 1 < argc) recordFile = argv[++i];
+            else if(arg == "--render" && i + 1 < argc) renderFile = argv[++i];
+            else if(arg == "--camera" && i + 1 < argc) cameraFile = argv[++i];
+            else if(arg == "--scaling") scaling = true;
+            else if(arg == "--packets") options.packets = true;
+            else if(arg == "--lod" && i + 1 < argc) options.lodPixels = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+            else if(arg == "--split-aabbs") options.splitAABBs = true;
+            else if(arg == "--hybrid" && i + 1 < argc) options.tessellationLevel = std::max(0, std::atoi(argv[++i]));
+            else if(arg == "--lazy") options.lazyBake = true;
+            else if(arg == "--paged" && i + 1 < argc) options.pagedFile = argv[++i];
+            else if(arg == "--page-cache" && i + 1 < argc) options.pageCacheBytes = static_cast<size_t>(std::max(1, std::atoi(argv[++i]))) << 20;
+            else if(arg == "--bird-curve") options.vertexOrder = VertexOrder::BIRD_CURVE;
+            else if(arg == "--quantize") options.quantizedHierarchy = true;
+            else if(arg == "--sparse" && i + 1 < argc) options.flatTolerance = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+            else if(arg == "--scene") options.instancing = true;
+            else if(arg == "--skin") options.skinned = true;
+            else if(arg == "--workers" && i + 1 < argc) workers = parseAddresses(argv[++i]);
+            else if(arg == "--bake-workers" && i + 1 < argc) options.bakeWorkers = parseAddresses(argv[++i]);
+            else if(arg == "--shard-dir" && i + 1 < argc) options.shardDirectory = argv[++i];
+            else if(arg == "--remote-tile" && i + 1 < argc) remoteTileSize = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+            else if(arg == "--traversal" && i + 1 < argc) {
+                if(!parseTraversalMode(argv[++i], options.traversal)) {
+                    std::cerr << "Invalid traversal: " << argv[i];
+                    return 1;
+                }
+            }
+            else if(arg == "--resolution" && i + 1 < argc) {
+                resolution = parseResolution(argv[++i]);
+                if(resolution.x == 0 || resolution.y == 0) {
+                    std::cerr << "Invalid resolution: " << argv[i];
+                    return 1;
+                }
+            }
+            else if(arg == "--turntable" && i + 1 < argc) turntableFrames = std::max(1, std::atoi(argv[++i]));
+            else if(arg == "--threads" && i + 1 < argc) threadCount = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+            else {
+                std::cerr << "Unknown argument: " << arg;
+                return 1;
+            }
+        }
+
+        if(options.instancing && !options.pagedFile.empty()) {
+            std::cerr << "--paged is ignored together with --scene" << std::endl;
+            options.pagedFile.clear();
+        }
+        if(options.quantizedHierarchy && (options.lazyBake || !options.pagedFile.empty())) {
+            std::cerr << "--quantize is ignored for lazily baked and paged meshes" << std::endl;
+            options.quantizedHierarchy = false;
+        }
+        if(options.flatTolerance >= 0.0f && (options.lazyBake || !options.pagedFile.empty())) {
+            std::cerr << "--sparse is ignored for lazily baked and paged meshes" << std::endl;
+            options.flatTolerance = -1.0f;
+        }
+        if(options.flatTolerance >= 0.0f && options.quantizedHierarchy) {
+            std::cerr << "--quantize is ignored together with --sparse" << std::endl;
+            options.quantizedHierarchy = false;
+        }
+        if(!options.bakeWorkers.empty() && (options.instancing || options.lazyBake || !options.pagedFile.empty())) {
+            std::cerr << "--bake-workers is ignored together with --scene, --lazy and --paged" << std::endl;
+            options.bakeWorkers.clear();
+        }
+        if(!options.bakeWorkers.empty()) {
+            //The workers load the mesh themselves and write their shards next to it, unless told otherwise
+            options.meshFile = std::filesystem::absolute(umeshPath);
+            if(options.shardDirectory.empty()) options.shardDirectory = options.meshFile.parent_path() / (options.meshFile.filename().string() + ".shards");
+            options.shardDirectory = std::filesystem::absolute(options.shardDirectory);
+        }
+        if(options.skinned && (options.instancing || !options.pagedFile.empty() || options.quantizedHierarchy || options.flatTolerance >= 0.0f)) {
+            std::cerr << "--skin is ignored together with --scene, --paged, --quantize and --sparse" << std::endl;
+            options.skinned = false;
+        }
+
+        //Headless; the CPU ray tracer only supports the micro-mesh path
+        if(!replayFile.empty()) {
+            if(tessellated) std::cerr << "-T is ignored when replaying a camera path" << std::endl;
+            if(options.skinned) std::cerr << "--skin is ignored when replaying a camera path" << std::endl;
+            return replayCameraPath(umeshPath, replayFile, threadCount, options);
+        }
+        if(scaling) {
+            if(options.skinned) std::cerr << "--skin is ignored when measuring scaling" << std::endl;
+            return measureScaling(umeshPath, cameraFile, resolution, threadCount, options);
+        }
+        if(meshBenchmark) return runMeshBenchmark(*meshBenchmark, umeshPath, cameraFile, resolution, turntableFrames, threadCount, options.lodPixels);
+        if(!renderFile.empty() && !workers.empty()) {
+            if(options.skinned) std::cerr << "--skin is ignored when rendering on workers" << std::endl;
+            return renderDistributed(umeshPath, renderFile, cameraFile, resolution, turntableFrames, workers, remoteTileSize, options);
+        }
+        if(!renderFile.empty()) {
+            if(tessellated) std::cerr << "-T is ignored when rendering offline" << std::endl;
+            return renderImages(umeshPath, renderFile, cameraFile, resolution, turntableFrames, threadCount, options);
+        }
 
-        Application app(umeshPath, tessellated);
+        if(options.instancing) std::cerr << "--scene is ignored by the GPU path, which renders the micro-mesh of the file" << std::endl;
+        Application app(umeshPath, tessellated, recordFile);
         app.update();
     }
 
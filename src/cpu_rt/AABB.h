@@ -0,0 +1,62 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <limits>
+
+//Axis-aligned bounding box. The memory layout is the same as D3D12_RAYTRACING_AABB, so an array of these can be uploaded
+//to the GPU as is.
+struct AABB {
+    glm::vec3 minPos{std::numeric_limits<float>::max()};
+    glm::vec3 maxPos{-std::numeric_limits<float>::max()};
+
+    void extend(const glm::vec3& p) {
+        minPos = glm::min(minPos, p);
+        maxPos = glm::max(maxPos, p);
+    }
+
+    void extend(const AABB& other) {
+        minPos = glm::min(minPos, other.minPos);
+        maxPos = glm::max(maxPos, other.maxPos);
+    }
+
+    [[nodiscard]] bool isEmpty() const {
+        return minPos.x > maxPos.x || minPos.y > maxPos.y || minPos.z > maxPos.z;
+    }
+
+    [[nodiscard]] glm::vec3 centroid() const {
+        return (minPos + maxPos) * 0.5f;
+    }
+
+    [[nodiscard]] float surfaceArea() const {
+        if(isEmpty()) return 0.0f;
+
+        const glm::vec3 d = maxPos - minPos;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    //Slab test.
+    // @param origin: the ray origin
+    // @param invDir: 1 / ray direction (per component)
+    // @param tMin, tMax: the ray interval
+    // @param tEntry: the ray parameter where the ray enters the box (only written when the box is hit)
+    // @return true if the ray overlaps the box somewhere in [tMin, tMax]
+    [[nodiscard]] bool intersect(const glm::vec3& origin, const glm::vec3& invDir, const float tMin, const float tMax, float& tEntry) const {
+        const glm::vec3 t0 = (minPos - origin) * invDir;
+        const glm::vec3 t1 = (maxPos - origin) * invDir;
+
+        const glm::vec3 tSmall = glm::min(t0, t1);
+        const glm::vec3 tBig = glm::max(t0, t1);
+
+        const float tNear = std::max(std::max(tSmall.x, tSmall.y), std::max(tSmall.z, tMin));
+        const float tFar = std::min(std::min(tBig.x, tBig.y), std::min(tBig.z, tMax));
+
+        if(tNear > tFar) return false;
+
+        tEntry = tNear;
+        return true;
+    }
+};
@@ -0,0 +1,110 @@
+#include "AABBBuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <thread>
+
+#include "EdgeKernels.h"
+
+#if defined(EDGE_KERNELS_SSE)
+#include <immintrin.h>
+#endif
+
+//An AABB around all displaced micro-vertices of a triangle, including the ones that are not present
+static AABB triangleAABBScalar(const Triangle& triangle) {
+    AABB aabb;
+    for(const uVertex& uv : triangle.uVertices) aabb.extend(uv.position + uv.displacement);
+
+    return aabb;
+}
+
+#if defined(EDGE_KERNELS_SSE)
+/*
+ * One micro-vertex per iteration, x, y and z in one register. The position is loaded from its x and the displacement
+ * from the position's z, so that both loads stay within the uVertex and the unused lane never holds the padding after
+ * present. _mm_min_ps(p, aabb) returns p only if p < aabb, just like glm::min(aabb, p).
+ */
+static AABB triangleAABBSSE(const Triangle& triangle) {
+    static_assert(offsetof(uVertex, displacement) == offsetof(uVertex, position) + sizeof(glm::vec3), "The displacement is loaded through the position");
+
+    __m128 minPos = _mm_set1_ps(std::numeric_limits<float>::max());
+    __m128 maxPos = _mm_set1_ps(-std::numeric_limits<float>::max());
+
+    for(const uVertex& uv : triangle.uVertices) {
+        const __m128 position = _mm_loadu_ps(&uv.position.x); //px, py, pz, dx
+        const __m128 shifted = _mm_loadu_ps(&uv.position.z); //pz, dx, dy, dz
+        const __m128 displacement = _mm_shuffle_ps(shifted, shifted, _MM_SHUFFLE(3, 3, 2, 1));
+        const __m128 displaced = _mm_add_ps(position, displacement);
+
+        minPos = _mm_min_ps(displaced, minPos);
+        maxPos = _mm_max_ps(displaced, maxPos);
+    }
+
+    alignas(16) float minValues[4], maxValues[4];
+    _mm_store_ps(minValues, minPos);
+    _mm_store_ps(maxValues, maxPos);
+
+    AABB aabb;
+    aabb.minPos = glm::vec3(minValues[0], minValues[1], minValues[2]);
+    aabb.maxPos = glm::vec3(maxValues[0], maxValues[1], maxValues[2]);
+    return aabb;
+}
+#endif
+
+static AABB triangleAABB(const Triangle& triangle) {
+#if defined(EDGE_KERNELS_SSE)
+    return triangleAABBSSE(triangle);
+#else
+    return triangleAABBScalar(triangle);
+#endif
+}
+
+namespace AABBBuilder {
+    std::vector<AABB> buildScalar(const Mesh& mesh) {
+        std::vector<AABB> AABBs;
+        AABBs.reserve(mesh.triangles.size());
+        for(const Triangle& t : mesh.triangles) AABBs.push_back(triangleAABBScalar(t));
+
+        return AABBs;
+    }
+
+    std::vector<AABB> build(const Mesh& mesh, const unsigned int threadCount) {
+        std::vector<AABB> AABBs(mesh.triangles.size());
+
+        const size_t chunks = (mesh.triangles.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        const unsigned int requested = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+        const unsigned int threads = static_cast<unsigned int>(std::clamp<size_t>(requested, 1, std::max<size_t>(1, chunks)));
+
+        //Every thread writes its own chunks, so the output needs no synchronization
+        std::atomic<size_t> nextChunk{0};
+        const auto work = [&] {
+            for(size_t chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+                const size_t end = std::min(mesh.triangles.size(), (chunk + 1) * CHUNK_SIZE);
+                for(size_t i = chunk * CHUNK_SIZE; i < end; i++) AABBs[i] = triangleAABB(mesh.triangles[i]);
+            }
+        };
+
+        //The calling thread works as well
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for(unsigned int thread = 0; thread + 1 < threads; thread++) workers.emplace_back(work);
+        work();
+        for(std::thread& worker : workers) worker.join();
+
+        return AABBs;
+    }
+
+    AABB build(const Triangle& triangle) {
+        return triangleAABB(triangle);
+    }
+
+    const char* instructionSet() {
+#if defined(EDGE_KERNELS_SSE)
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <framework/mesh.h>
+#include <vector>
+
+#include "AABB.h"
+
+/*
+ * Computes the AABB of every base triangle around all of its displaced micro-vertices, on the CPU. This replaces the
+ * createAABBs compute pass, which needed an upload, a dispatch and a blocking readback while loading a mesh.
+ *
+ * Taking the minimum and maximum is exact and the micro-vertices are visited in the same order, so every
+ * implementation gives bit-identical results to the scalar one. The result has the layout of D3D12_RAYTRACING_AABB.
+ */
+namespace AABBBuilder {
+    //Base triangles per work item. Triangles differ a lot in subdivision level, so the threads take chunks until none are left.
+    static constexpr unsigned int CHUNK_SIZE = 1024;
+
+    //Single-threaded reference, position + displacement per micro-vertex with glm
+    [[nodiscard]] std::vector<AABB> buildScalar(const Mesh& mesh);
+
+    /**
+     * Computes the AABBs in parallel, with the widest implementation the build supports.
+     *
+     * @param mesh the mesh
+     * @param threadCount the number of threads, including the calling thread. 0 uses every hardware thread.
+     */
+    [[nodiscard]] std::vector<AABB> build(const Mesh& mesh, unsigned int threadCount = 0);
+
+    //The AABB of a single triangle, the same as build(...) gives for it
+    [[nodiscard]] AABB build(const Triangle& triangle);
+
+    //Name of the instruction set build(...) uses
+    [[nodiscard]] const char* instructionSet();
+}
@@ -0,0 +1,93 @@
+#include "AABBSplitter.h"
+
+#include <algorithm>
+
+//Cost of traversing the extra BVH nodes of a split, and of every hierarchy level a procedural intersection call descends.
+//A call that starts at a deeper hierarchy triangle has fewer levels left to descend, which is what makes a split pay.
+static constexpr float SPLIT_TRAVERSAL_COST = 1.0f;
+static constexpr float SPLIT_LEVEL_COST = 2.0f;
+
+//Surface area heuristic cost of the best way to bound a hierarchy triangle: with its own AABB, or with the best AABBs
+//of its four children. Computed bottom-up, so that a split that only pays off further down is still found.
+static float bestCost(const std::vector<std::vector<AABB>>& levelBounds, const int subDivisionLevel, const int level, const unsigned int localIndex, std::vector<std::vector<unsigned char>>& split) {
+    const auto l = static_cast<size_t>(level);
+    const float area = levelBounds[l][localIndex].surfaceArea();
+    const float leafCost = SPLIT_LEVEL_COST * static_cast<float>(subDivisionLevel - level) * area;
+    if(l + 1 == levelBounds.size()) return leafCost;
+
+    float splitCost = SPLIT_TRAVERSAL_COST * area;
+    for(unsigned int child = 0; child < 4; child++) splitCost += bestCost(levelBounds, subDivisionLevel, level + 1, 4 * localIndex + child, split);
+
+    split[l][localIndex] = splitCost < leafCost;
+    return std::min(leafCost, splitCost);
+}
+
+//Adds the AABB of a hierarchy triangle, or those of its descendants if it is split
+static void addNode(const std::vector<std::vector<AABB>>& levelBounds, const std::vector<std::vector<unsigned char>>& split, const MicroMeshNode& node, SplitAABBs& result) {
+    const auto level = static_cast<size_t>(node.level);
+    if(level + 1 < levelBounds.size() && split[level][node.localIndex]) {
+        for(unsigned int child = 0; child < 4; child++) addNode(levelBounds, split, {node.primitiveIndex, node.level + 1, 4 * node.localIndex + child}, result);
+        return;
+    }
+
+    result.AABBs.push_back(levelBounds[level][node.localIndex]);
+    result.nodes.push_back(node);
+}
+
+//The bounds of the hierarchy triangles of every level down to deepestLevel: those of the deepest level from the
+//micro-triangles, those of the levels above the union of their children
+static std::vector<std::vector<AABB>> boundsPerLevel(const BakedMesh& mesh, const unsigned int primitiveIndex, const int deepestLevel) {
+    std::vector<std::vector<AABB>> levelBounds(static_cast<size_t>(deepestLevel) + 1);
+    levelBounds.back() = microMeshNodeBounds(mesh, primitiveIndex, deepestLevel);
+    for(size_t level = levelBounds.size() - 1; level-- > 0;) {
+        levelBounds[level].resize(levelBounds[level + 1].size() / 4);
+        for(size_t node = 0; node < levelBounds[level + 1].size(); node++) levelBounds[level][node / 4].extend(levelBounds[level + 1][node]);
+    }
+
+    return levelBounds;
+}
+
+SplitAABBs splitAABBs(const BakedMesh& mesh, const int maxLevel) {
+    SplitAABBs split;
+    split.AABBs.reserve(mesh.AABBs.size());
+    split.nodes.reserve(mesh.AABBs.size());
+
+    for(unsigned int i = 0; i < mesh.triangleData.size(); i++) {
+        //Triangles that are flat enough for grid marching stay whole, the grid is marched over the whole base triangle
+        const int deepestLevel = std::min(maxLevel, mesh.triangleData[i].subDivisionLevel - 1);
+        if(deepestLevel <= 0 || prefersGridTraversal(mesh, i)) {
+            split.AABBs.push_back(mesh.AABBs[i]);
+            split.nodes.push_back({i, 0, 0});
+            continue;
+        }
+
+        std::vector<std::vector<AABB>> levelBounds = boundsPerLevel(mesh, i, deepestLevel);
+
+        //Keep the AABB of AABBBuilder for base triangles that are not split, the GPU uses the same one
+        levelBounds[0][0] = mesh.AABBs[i];
+
+        std::vector<std::vector<unsigned char>> splitNodes(levelBounds.size());
+        for(size_t level = 0; level < levelBounds.size(); level++) splitNodes[level].resize(levelBounds[level].size(), 0);
+        bestCost(levelBounds, mesh.triangleData[i].subDivisionLevel, 0, 0, splitNodes);
+
+        const size_t before = split.AABBs.size();
+        addNode(levelBounds, splitNodes, {i, 0, 0}, split);
+        split.splitTriangles += split.AABBs.size() - before > 1;
+    }
+
+    return split;
+}
+
+void refitSplitAABBs(const BakedMesh& mesh, const std::span<const MicroMeshNode> nodes, const std::span<AABB> AABBs) {
+    if(nodes.empty()) return;
+
+    const unsigned int primitiveIndex = nodes.front().primitiveIndex;
+    if(nodes.size() == 1 && nodes.front().level == 0) {
+        AABBs.front() = mesh.AABBs[primitiveIndex];
+        return;
+    }
+
+    const int deepestLevel = std::ranges::max(nodes, {}, &MicroMeshNode::level).level;
+    const std::vector<std::vector<AABB>> levelBounds = boundsPerLevel(mesh, primitiveIndex, deepestLevel);
+    for(size_t i = 0; i < nodes.size(); i++) AABBs[i] = levelBounds[static_cast<size_t>(nodes[i].level)][nodes[i].localIndex];
+}
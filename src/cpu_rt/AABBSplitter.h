@@ -0,0 +1,44 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "AABB.h"
+#include "BakedMesh.h"
+#include "MicroMeshTraversal.h"
+
+//The primitives of the CPU BVH when base triangles may be split: one AABB per base triangle or per hierarchy triangle
+struct SplitAABBs {
+    std::vector<AABB> AABBs;
+    std::vector<MicroMeshNode> nodes; //What every AABB bounds
+    size_t splitTriangles = 0; //The number of base triangles that were split into more than one AABB
+};
+
+static constexpr int DEFAULT_MAX_SPLIT_LEVEL = 3;
+
+/**
+ * Replaces the single AABB of long, thin or strongly displaced base triangles by several tighter ones: one per
+ * hierarchy triangle, tagged with its path (see MicroMeshNode), so that the traversal can start at that hierarchy triangle.
+ *
+ * A hierarchy triangle is only split into its four children if the surface area heuristic says that it pays: if
+ * SPLIT_TRAVERSAL_COST * area plus the cost of the children is lower than the cost of intersecting it, which is
+ * SPLIT_LEVEL_COST * area per hierarchy level left below it, where area is the surface area of the AABB. The cheapest
+ * cut through the hierarchy is found bottom-up. Midpoint subdivision keeps the shape of a triangle, so the AABBs of its
+ * children add up to about its own AABB for flat triangles, and to more when the displacements are strong: a split
+ * pays when the levels it saves outweigh that, which favours deep hierarchies over shallow ones. Base triangles for
+ * which prefersGridTraversal is true are never split, since their micro-grid is marched as a whole.
+ *
+ * @param mesh the baked mesh
+ * @param maxLevel the deepest hierarchy level to split to. Base triangles are split at most down to one level above
+ * their micro-triangles.
+ */
+[[nodiscard]] SplitAABBs splitAABBs(const BakedMesh& mesh, int maxLevel = DEFAULT_MAX_SPLIT_LEVEL);
+
+/**
+ * Recomputes the AABBs that splitAABBs chose for a base triangle after its displacements changed, keeping the choice.
+ *
+ * @param mesh the baked mesh
+ * @param nodes the hierarchy triangles that splitAABBs returned for one base triangle
+ * @param AABBs their AABBs, updated in place
+ */
+void refitSplitAABBs(const BakedMesh& mesh, std::span<const MicroMeshNode> nodes, std::span<AABB> AABBs);
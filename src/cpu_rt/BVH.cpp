@@ -0,0 +1,192 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <numeric>
+
+static constexpr int BIN_COUNT = 16;
+static constexpr unsigned int MAX_LEAF_SIZE = 8;
+
+BVH::BVH(const std::vector<AABB>& primitiveBounds) {
+    if(primitiveBounds.empty()) return;
+
+    const auto primitiveCount = static_cast<unsigned int>(primitiveBounds.size());
+
+    primitiveIndices.resize(primitiveCount);
+    std::iota(primitiveIndices.begin(), primitiveIndices.end(), 0u);
+
+    std::vector<glm::vec3> centroids;
+    centroids.reserve(primitiveCount);
+    std::ranges::transform(primitiveBounds, std::back_inserter(centroids), [](const AABB& b) { return b.centroid(); });
+
+    nodes.reserve(2 * primitiveCount - 1); //A binary tree with n leaves has at most 2n - 1 nodes. Reserving makes sure that node references stay valid.
+    nodes.push_back({{}, 0, primitiveCount});
+
+    updateBounds(0, primitiveBounds);
+    subdivide(0, primitiveBounds, centroids, 0);
+
+    for(const Node& node : nodes) weightedArea += nodeCost(node) * static_cast<double>(node.bounds.surfaceArea());
+    builtCost = sahCost();
+}
+
+void BVH::updateBounds(const unsigned int nodeIndex, const std::vector<AABB>& primitiveBounds) {
+    Node& node = nodes[nodeIndex];
+
+    node.bounds = {};
+    for(unsigned int i = 0; i < node.count; i++) node.bounds.extend(primitiveBounds[primitiveIndices[node.leftFirst + i]]);
+}
+
+void BVH::subdivide(const unsigned int nodeIndex, const std::vector<AABB>& primitiveBounds, const std::vector<glm::vec3>& centroids, const int depth) {
+    Node& node = nodes[nodeIndex];
+    if(node.count <= 1 || depth >= MAX_DEPTH) return;
+
+    const auto first = primitiveIndices.begin() + node.leftFirst;
+    const auto last = first + node.count;
+
+    AABB centroidBounds;
+    std::for_each(first, last, [&](const unsigned int p) { centroidBounds.extend(centroids[p]); });
+
+    //Find the cheapest split over all 3 axes with the binned surface area heuristic
+    int bestAxis = -1, bestSplit = 0;
+    float bestCost = std::numeric_limits<float>::max();
+
+    for(int axis = 0; axis < 3; axis++) {
+        const float boundsMin = centroidBounds.minPos[axis];
+        const float extent = centroidBounds.maxPos[axis] - boundsMin;
+        if(extent <= 0.0f) continue;
+
+        struct Bin {
+            AABB bounds;
+            unsigned int count = 0;
+        } bins[BIN_COUNT];
+
+        const float scale = BIN_COUNT / extent;
+        std::for_each(first, last, [&](const unsigned int p) {
+            const int b = std::min(BIN_COUNT - 1, static_cast<int>((centroids[p][axis] - boundsMin) * scale));
+            bins[b].count++;
+            bins[b].bounds.extend(primitiveBounds[p]);
+        });
+
+        //Sweep from the left and from the right to get the area and count on both sides of each split plane
+        float leftArea[BIN_COUNT - 1], rightArea[BIN_COUNT - 1];
+        unsigned int leftCount[BIN_COUNT - 1], rightCount[BIN_COUNT - 1];
+        AABB leftBox, rightBox;
+        unsigned int leftSum = 0, rightSum = 0;
+
+        for(int i = 0; i < BIN_COUNT - 1; i++) {
+            leftSum += bins[i].count;
+            leftBox.extend(bins[i].bounds);
+            leftCount[i] = leftSum;
+            leftArea[i] = leftBox.surfaceArea();
+
+            rightSum += bins[BIN_COUNT - 1 - i].count;
+            rightBox.extend(bins[BIN_COUNT - 1 - i].bounds);
+            rightCount[BIN_COUNT - 2 - i] = rightSum;
+            rightArea[BIN_COUNT - 2 - i] = rightBox.surfaceArea();
+        }
+
+        for(int i = 0; i < BIN_COUNT - 1; i++) {
+            if(leftCount[i] == 0 || rightCount[i] == 0) continue;
+
+            const float cost = static_cast<float>(leftCount[i]) * leftArea[i] + static_cast<float>(rightCount[i]) * rightArea[i];
+            if(cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    if(bestAxis == -1) return; //All centroids are at the same position, so we can not split
+
+    const float parentArea = node.bounds.surfaceArea();
+    const float splitCost = TRAVERSAL_COST + INTERSECTION_COST * (parentArea > 0.0f ? bestCost / parentArea : 0.0f);
+    const float leafCost = INTERSECTION_COST * static_cast<float>(node.count);
+    if(splitCost >= leafCost && node.count <= MAX_LEAF_SIZE) return;
+
+    //Partition the primitives on both sides of the split plane
+    const float boundsMin = centroidBounds.minPos[bestAxis];
+    const float scale = BIN_COUNT / (centroidBounds.maxPos[bestAxis] - boundsMin);
+    const auto middle = std::partition(first, last, [&](const unsigned int p) {
+        return std::min(BIN_COUNT - 1, static_cast<int>((centroids[p][bestAxis] - boundsMin) * scale)) <= bestSplit;
+    });
+
+    const auto leftCount = static_cast<unsigned int>(middle - first);
+    if(leftCount == 0 || leftCount == node.count) return;
+
+    const auto leftChild = static_cast<unsigned int>(nodes.size());
+    nodes.push_back({{}, node.leftFirst, leftCount});
+    nodes.push_back({{}, node.leftFirst + leftCount, node.count - leftCount});
+
+    node.leftFirst = leftChild;
+    node.count = 0;
+
+    updateBounds(leftChild, primitiveBounds);
+    updateBounds(leftChild + 1, primitiveBounds);
+
+    subdivide(leftChild, primitiveBounds, centroids, depth + 1);
+    subdivide(leftChild + 1, primitiveBounds, centroids, depth + 1);
+}
+
+void BVH::findParents() {
+    parents.assign(nodes.size(), 0);
+    primitiveLeaves.assign(primitiveIndices.size(), 0);
+
+    for(unsigned int i = 0; i < nodes.size(); i++) {
+        const Node& node = nodes[i];
+        if(node.isLeaf()) {
+            for(unsigned int j = 0; j < node.count; j++) primitiveLeaves[primitiveIndices[node.leftFirst + j]] = i;
+        } else {
+            parents[node.leftFirst] = parents[node.leftFirst + 1] = i;
+        }
+    }
+}
+
+std::vector<unsigned int> BVH::markRefitNodes(const std::span<const unsigned int> primitives) {
+    if(!pendingChildren) {
+        pendingChildren = std::make_unique<std::atomic<unsigned int>[]>(nodes.size());
+        refitMarks.assign(nodes.size(), 0);
+    }
+
+    //Marks are refit numbers, so they never have to be cleared
+    const unsigned int mark = ++refitCount;
+    std::vector<unsigned int> leaves;
+    for(const unsigned int primitive : primitives) {
+        unsigned int nodeIndex = primitiveLeaves[primitive];
+        if(refitMarks[nodeIndex] == mark) continue;
+        leaves.push_back(nodeIndex);
+
+        //Up to the first node that was marked already, which only gets another pending child
+        for(;;) {
+            refitMarks[nodeIndex] = mark;
+            if(nodeIndex == 0) break;
+
+            nodeIndex = parents[nodeIndex];
+            pendingChildren[nodeIndex].fetch_add(1, std::memory_order_relaxed);
+            if(refitMarks[nodeIndex] == mark) break;
+        }
+    }
+
+    return leaves;
+}
+
+float BVH::sahCost() const {
+    if(nodes.empty()) return 0.0f;
+
+    const float rootArea = nodes.front().bounds.surfaceArea();
+    return rootArea > 0.0f ? static_cast<float>(weightedArea / static_cast<double>(rootArea)) : 0.0f;
+}
+
+float BVH::builtSahCost() const {
+    return builtCost;
+}
+
+const std::vector<BVH::Node>& BVH::getNodes() const {
+    return nodes;
+}
+
+size_t BVH::sizeInBytes() const {
+    return nodes.size() * sizeof(Node) + (primitiveIndices.size() + parents.size() + primitiveLeaves.size() + refitMarks.size()) * sizeof(unsigned int)
+        + (pendingChildren ? nodes.size() * sizeof(std::atomic<unsigned int>) : 0);
+}
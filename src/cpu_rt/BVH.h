@@ -0,0 +1,337 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "AABB.h"
+#include "RayDesc.h"
+
+/**
+ * Bounding volume hierarchy over a set of AABBs, built with the binned surface area heuristic.
+ *
+ * This is the CPU counterpart of the bottom-level acceleration structure that GPUMesh builds from the per-triangle
+ * AABBs. What a primitive is, is up to the caller: traversal calls back for every primitive whose AABB the ray hits.
+ */
+class BVH {
+public:
+    struct Node {
+        AABB bounds;
+        unsigned int leftFirst; //Index of the left child (the right child is at leftFirst + 1), or the first primitive if this is a leaf
+        unsigned int count; //Number of primitives. 0 for inner nodes.
+
+        [[nodiscard]] bool isLeaf() const { return count > 0; }
+    };
+
+    BVH() = default;
+    explicit BVH(const std::vector<AABB>& primitiveBounds);
+
+    /**
+     * Traverses the BVH front to back.
+     *
+     * @param ray the ray
+     * @param tMax the current maximum ray parameter. It is read again after every primitive, so the callback can shrink
+     * it when it finds a closer hit.
+     * @param intersectPrimitive called with the primitive index for every primitive whose AABB is hit
+     * @param stats counters that are updated during the traversal
+     */
+    template<typename IntersectPrimitive>
+    void traverse(const RayDesc& ray, const float& tMax, IntersectPrimitive&& intersectPrimitive, TraversalStats& stats) const {
+        if(nodes.empty()) return;
+
+        const glm::vec3 invDir = 1.0f / ray.direction;
+
+        struct Entry {
+            unsigned int node;
+            float tEntry;
+        };
+
+        Entry stack[MAX_DEPTH + 1];
+        int stackTop = 0;
+
+        float rootEntry;
+        if(!nodes[0].bounds.intersect(ray.origin, invDir, ray.tMin, tMax, rootEntry)) return;
+        stack[stackTop++] = {0, rootEntry};
+
+        while(stackTop > 0) {
+            const Entry current = stack[--stackTop];
+            if(current.tEntry > tMax) continue; //A closer hit has been found since this node was pushed
+
+            const Node& node = nodes[current.node];
+            stats.bvhNodesVisited++;
+
+            if(node.isLeaf()) {
+                for(unsigned int i = 0; i < node.count; i++) intersectPrimitive(primitiveIndices[node.leftFirst + i]);
+                continue;
+            }
+
+            float tLeft, tRight;
+            const bool hitLeft = nodes[node.leftFirst].bounds.intersect(ray.origin, invDir, ray.tMin, tMax, tLeft);
+            const bool hitRight = nodes[node.leftFirst + 1].bounds.intersect(ray.origin, invDir, ray.tMin, tMax, tRight);
+
+            //Push the far child first, so that the near child is popped first
+            if(hitLeft && hitRight) {
+                if(tLeft <= tRight) {
+                    stack[stackTop++] = {node.leftFirst + 1, tRight};
+                    stack[stackTop++] = {node.leftFirst, tLeft};
+                } else {
+                    stack[stackTop++] = {node.leftFirst, tLeft};
+                    stack[stackTop++] = {node.leftFirst + 1, tRight};
+                }
+            } else if(hitLeft) {
+                stack[stackTop++] = {node.leftFirst, tLeft};
+            } else if(hitRight) {
+                stack[stackTop++] = {node.leftFirst + 1, tRight};
+            }
+        }
+    }
+
+    /**
+     * Traverses the BVH with a packet of rays. A node is visited when at least one ray hits it, and is traversed with
+     * just the rays that hit it. The near child is determined by the earliest entry of any ray.
+     *
+     * @param packet the rays
+     * @param hits the current closest hit of every ray. hits[i].t is the maximum ray parameter of ray i, which is read again for every node.
+     * @param intersectPrimitive called with the primitive index and the mask of the rays that hit its AABB
+     * @param stats counters that are updated during the traversal
+     */
+    template<typename IntersectPrimitive>
+    void traversePacket(const RayPacket& packet, const HitInfo (&hits)[RAY_PACKET_SIZE], IntersectPrimitive&& intersectPrimitive, TraversalStats& stats) const {
+        if(nodes.empty() || !packet.activeMask) return;
+
+        glm::vec3 invDirs[RAY_PACKET_SIZE];
+        for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) invDirs[lane] = 1.0f / packet.rays[lane].direction;
+
+        //Returns the rays of laneMask that hit the box, and the earliest entry of these rays
+        const auto intersectLanes = [&](const AABB& bounds, const unsigned int laneMask, float& tEntry) {
+            unsigned int hitLanes = 0;
+            tEntry = std::numeric_limits<float>::max();
+
+            for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+                float t;
+                if((laneMask & (1u << lane)) && bounds.intersect(packet.rays[lane].origin, invDirs[lane], packet.rays[lane].tMin, hits[lane].t, t)) {
+                    hitLanes |= 1u << lane;
+                    tEntry = std::min(tEntry, t);
+                }
+            }
+
+            return hitLanes;
+        };
+
+        struct Entry {
+            unsigned int node;
+            unsigned int laneMask;
+            float tEntry;
+        };
+
+        Entry stack[MAX_DEPTH + 1];
+        int stackTop = 0;
+
+        float rootEntry;
+        const unsigned int rootLanes = intersectLanes(nodes[0].bounds, packet.activeMask, rootEntry);
+        if(!rootLanes) return;
+        stack[stackTop++] = {0, rootLanes, rootEntry};
+
+        while(stackTop > 0) {
+            const Entry current = stack[--stackTop];
+
+            //A closer hit has been found for all rays since this node was pushed
+            float tMax = 0.0f;
+            for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+                if(current.laneMask & (1u << lane)) tMax = std::max(tMax, hits[lane].t);
+            }
+            if(current.tEntry > tMax) continue;
+
+            const Node& node = nodes[current.node];
+            stats.bvhNodesVisited++;
+
+            if(node.isLeaf()) {
+                for(unsigned int i = 0; i < node.count; i++) intersectPrimitive(primitiveIndices[node.leftFirst + i], current.laneMask);
+                continue;
+            }
+
+            float tLeft, tRight;
+            const unsigned int leftLanes = intersectLanes(nodes[node.leftFirst].bounds, current.laneMask, tLeft);
+            const unsigned int rightLanes = intersectLanes(nodes[node.leftFirst + 1].bounds, current.laneMask, tRight);
+
+            //Push the far child first, so that the near child is popped first
+            if(leftLanes && rightLanes) {
+                if(tLeft <= tRight) {
+                    stack[stackTop++] = {node.leftFirst + 1, rightLanes, tRight};
+                    stack[stackTop++] = {node.leftFirst, leftLanes, tLeft};
+                } else {
+                    stack[stackTop++] = {node.leftFirst, leftLanes, tLeft};
+                    stack[stackTop++] = {node.leftFirst + 1, rightLanes, tRight};
+                }
+            } else if(leftLanes) {
+                stack[stackTop++] = {node.leftFirst, leftLanes, tLeft};
+            } else if(rightLanes) {
+                stack[stackTop++] = {node.leftFirst + 1, rightLanes, tRight};
+            }
+        }
+    }
+
+    /**
+     * Updates the bounds of the nodes above some primitives after their AABBs changed, without changing the tree. Going
+     * up stops at the first node whose bounds stay the same. The first call finds the parent of every node and the leaf
+     * of every primitive.
+     *
+     * @param primitives the primitives whose AABBs changed
+     * @param primitiveBounds returns the (new) AABB of a primitive
+     * @return the number of nodes whose bounds changed
+     */
+    template<typename PrimitiveBounds>
+    size_t refit(std::span<const unsigned int> primitives, PrimitiveBounds&& primitiveBounds) {
+        if(nodes.empty()) return 0;
+        if(parents.empty()) findParents();
+
+        size_t refitted = 0;
+        for(const unsigned int primitive : primitives) {
+            for(unsigned int nodeIndex = primitiveLeaves[primitive];; nodeIndex = parents[nodeIndex]) {
+                Node& node = nodes[nodeIndex];
+
+                AABB bounds;
+                if(node.isLeaf()) {
+                    for(unsigned int i = 0; i < node.count; i++) bounds.extend(primitiveBounds(primitiveIndices[node.leftFirst + i]));
+                } else {
+                    bounds.extend(nodes[node.leftFirst].bounds);
+                    bounds.extend(nodes[node.leftFirst + 1].bounds);
+                }
+
+                //The nodes above were computed from these bounds already
+                if(bounds.minPos == node.bounds.minPos && bounds.maxPos == node.bounds.maxPos) break;
+
+                weightedArea += nodeCost(node) * (static_cast<double>(bounds.surfaceArea()) - static_cast<double>(node.bounds.surfaceArea()));
+                node.bounds = bounds;
+                refitted++;
+                if(nodeIndex == 0) break;
+            }
+        }
+
+        return refitted;
+    }
+
+    /**
+     * Same as refit, but bottom-up over several threads, for when many primitives moved at once (such as every base
+     * triangle of a skinned mesh). The threads take the leaves above the primitives in chunks and refit them. Going up,
+     * the thread that finishes the last of the refit children of a node refits it, so every node is refit once and only
+     * after its children. Unlike refit, going up does not stop at nodes whose bounds stay the same.
+     *
+     * @param primitives the primitives whose AABBs changed
+     * @param primitiveBounds returns the (new) AABB of a primitive, called from several threads at once
+     * @param threadCount the number of threads, including the calling thread. 0 uses every hardware thread.
+     * @return the number of nodes whose bounds changed
+     */
+    template<typename PrimitiveBounds>
+    size_t refit(std::span<const unsigned int> primitives, PrimitiveBounds&& primitiveBounds, const unsigned int threadCount) {
+        if(nodes.empty()) return 0;
+        if(parents.empty()) findParents();
+
+        const std::vector<unsigned int> leaves = markRefitNodes(primitives);
+
+        const size_t chunks = (leaves.size() + REFIT_CHUNK_SIZE - 1) / REFIT_CHUNK_SIZE;
+        const unsigned int requested = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+        const auto threads = static_cast<unsigned int>(std::clamp<size_t>(requested, 1, std::max<size_t>(1, chunks)));
+
+        struct Result {
+            size_t refitted = 0;
+            double weightedArea = 0.0;
+        };
+        std::vector<Result> results(threads);
+
+        std::atomic<size_t> nextChunk{0};
+        const auto work = [&](Result& result) {
+            const auto update = [&](Node& node, const AABB& bounds) {
+                if(bounds.minPos == node.bounds.minPos && bounds.maxPos == node.bounds.maxPos) return;
+
+                result.weightedArea += nodeCost(node) * (static_cast<double>(bounds.surfaceArea()) - static_cast<double>(node.bounds.surfaceArea()));
+                node.bounds = bounds;
+                result.refitted++;
+            };
+
+            for(size_t chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+                const size_t end = std::min(leaves.size(), (chunk + 1) * REFIT_CHUNK_SIZE);
+                for(size_t i = chunk * REFIT_CHUNK_SIZE; i < end; i++) {
+                    Node& leaf = nodes[leaves[i]];
+                    AABB bounds;
+                    for(unsigned int j = 0; j < leaf.count; j++) bounds.extend(primitiveBounds(primitiveIndices[leaf.leftFirst + j]));
+                    update(leaf, bounds);
+
+                    //The last child to arrive refits its parent, the acquire-release makes the bounds of the other children visible
+                    for(unsigned int nodeIndex = leaves[i]; nodeIndex != 0;) {
+                        nodeIndex = parents[nodeIndex];
+                        if(pendingChildren[nodeIndex].fetch_sub(1, std::memory_order_acq_rel) != 1) break;
+
+                        Node& node = nodes[nodeIndex];
+                        bounds = nodes[node.leftFirst].bounds;
+                        bounds.extend(nodes[node.leftFirst + 1].bounds);
+                        update(node, bounds);
+                    }
+                }
+            }
+        };
+
+        //The calling thread works as well
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for(unsigned int thread = 1; thread < threads; thread++) workers.emplace_back(work, std::ref(results[thread]));
+        work(results[0]);
+        for(std::thread& worker : workers) worker.join();
+
+        size_t refitted = 0;
+        for(const Result& result : results) {
+            refitted += result.refitted;
+            weightedArea += result.weightedArea;
+        }
+
+        return refitted;
+    }
+
+    /**
+     * The cost of tracing a ray that hits the root by the surface area heuristic: the sum over all nodes of the chance
+     * that the ray hits them (their surface area relative to that of the root) times the cost of visiting them. Refitting
+     * keeps the tree, so when the primitives move a lot their nodes overlap more and more, and this grows.
+     */
+    [[nodiscard]] float sahCost() const;
+    //sahCost() right after the tree was built
+    [[nodiscard]] float builtSahCost() const;
+
+    [[nodiscard]] const std::vector<Node>& getNodes() const;
+    [[nodiscard]] size_t sizeInBytes() const;
+
+private:
+    static constexpr int MAX_DEPTH = 64;
+    static constexpr size_t REFIT_CHUNK_SIZE = 64; //Leaves per work item of the parallel refit
+    static constexpr float TRAVERSAL_COST = 1.0f;
+    static constexpr float INTERSECTION_COST = 4.0f; //Intersecting a micro-mesh triangle is a lot more expensive than testing a box
+
+    std::vector<Node> nodes;
+    std::vector<unsigned int> primitiveIndices;
+    //The sum of the surface area of every node times its cost, see sahCost
+    double weightedArea = 0.0;
+    float builtCost = 0.0f;
+    //Only filled by the first refit
+    std::vector<unsigned int> parents;
+    std::vector<unsigned int> primitiveLeaves;
+    //Only for the parallel refit: per node, the number of its children that still have to be refit (0 between refits),
+    //and the last refit that marked it
+    std::unique_ptr<std::atomic<unsigned int>[]> pendingChildren;
+    std::vector<unsigned int> refitMarks;
+    unsigned int refitCount = 0;
+
+    //In double, like the weighted area it adds to
+    [[nodiscard]] static double nodeCost(const Node& node) {
+        return static_cast<double>(node.isLeaf() ? INTERSECTION_COST * static_cast<float>(node.count) : TRAVERSAL_COST);
+    }
+
+    void findParents();
+    //Marks every node above the primitives and counts its marked children in pendingChildren. Returns the marked leaves.
+    std::vector<unsigned int> markRefitNodes(std::span<const unsigned int> primitives);
+    void updateBounds(unsigned int nodeIndex, const std::vector<AABB>& primitiveBounds);
+    void subdivide(unsigned int nodeIndex, const std::vector<AABB>& primitiveBounds, const std::vector<glm::vec3>& centroids, int depth);
+};
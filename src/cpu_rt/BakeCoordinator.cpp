@@ -0,0 +1,150 @@
+#include "BakeCoordinator.h"
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <json.hpp>
+DISABLE_WARNINGS_POP()
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "ShardedBake.h"
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+BakeCoordinator::BakeCoordinator(std::vector<std::string> workerAddresses, const Options bakeOptions): workers(std::move(workerAddresses)), options(bakeOptions) {
+    if(workers.empty()) throw std::invalid_argument("A coordinator needs at least one worker");
+}
+
+const std::vector<std::string>& BakeCoordinator::getWorkers() const {
+    return workers;
+}
+
+BakedMesh BakeCoordinator::bake(const Mesh& mesh, const std::filesystem::path& file, const std::filesystem::path& directory, const VertexOrder order, DistributedBakeStats& stats) {
+    const auto start = Clock::now();
+    const std::vector<ShardedBake::Range> ranges = ShardedBake::split(mesh, {0, static_cast<unsigned int>(mesh.triangles.size())},
+                                                                      static_cast<unsigned int>(workers.size()) * std::max(1u, options.shardsPerWorker));
+    std::filesystem::create_directories(directory);
+
+    stats = {};
+    stats.shards = ranges.size();
+    stats.shardsPerWorker.resize(workers.size());
+
+    std::vector<Socket> connections(workers.size());
+    for(size_t worker = 0; worker < workers.size(); worker++) {
+        try {
+            connections[worker] = Socket::connect(workers[worker]);
+        } catch(const std::runtime_error& e) {
+            stats.failedWorkers.push_back(e.what());
+        }
+    }
+
+    //Coordinators that share the directory must not write over each other's shards
+    const std::string tag = std::to_string(std::random_device{}());
+
+    std::deque<size_t> pending; //Shards that no worker has
+    for(size_t shard = 0; shard < ranges.size(); shard++) pending.push_back(shard);
+    size_t remaining = ranges.size();
+    std::vector<std::filesystem::path> shardFiles(ranges.size());
+
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    const auto work = [&](const size_t worker) {
+        Socket& connection = connections[worker];
+
+        std::unique_lock lock(mutex);
+        while(true) {
+            //A worker without a shard waits while others have theirs out, their shards come back here if they fail
+            changed.wait(lock, [&] { return remaining == 0 || !pending.empty(); });
+            if(remaining == 0) return;
+
+            const size_t shard = pending.front();
+            pending.pop_front();
+            lock.unlock();
+
+            const ShardedBake::Range& range = ranges[shard];
+            const std::filesystem::path output = directory / (tag + "-" + std::to_string(shard) + "-" + std::to_string(worker) + ".shard");
+            const json request = {{"type", "bake"}, {"id", shard}, {"mesh", file.string()}, {"first", range.firstTriangle}, {"count", range.triangleCount},
+                                  {"order", order == VertexOrder::BIRD_CURVE ? "bird-curve" : "row-major"}, {"output", output.string()}};
+
+            std::string line, error;
+            size_t bytes = 0;
+            if(connection.sendAll(request.dump() + '\n') && connection.readLine(line)) {
+                try {
+                    const json response = json::parse(line);
+                    if(!response.value("ok", false)) throw std::runtime_error(response.value("error", std::string("unknown error")));
+                    if(response.at("meshTriangles").get<size_t>() != mesh.triangles.size()) throw std::runtime_error("loaded another mesh from " + file.string());
+                    bytes = response.value("bytes", size_t(0));
+                } catch(const std::exception& e) {
+                    error = e.what();
+                }
+            } else {
+                error = "the connection broke";
+            }
+
+            lock.lock();
+            if(!error.empty()) {
+                stats.failedWorkers.push_back(workers[worker] + ": " + error);
+                pending.push_front(shard);
+                connection = Socket();
+                changed.notify_all();
+                return;
+            }
+
+            shardFiles[shard] = output;
+            remaining--;
+            stats.shardBytes += bytes;
+            stats.shardsPerWorker[worker]++;
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(size_t worker = 0; worker < workers.size(); worker++) {
+        if(connections[worker].valid()) threads.emplace_back(work, worker);
+    }
+    if(threads.empty()) throw std::runtime_error("None of the workers can be reached");
+    for(std::thread& thread : threads) thread.join();
+
+    const auto removeShards = [&] {
+        if(options.keepShards) return;
+
+        std::error_code error;
+        for(const std::filesystem::path& shardFile : shardFiles) {
+            if(!shardFile.empty()) std::filesystem::remove(shardFile, error);
+        }
+    };
+
+    if(remaining > 0) {
+        removeShards();
+        std::string errors;
+        for(const std::string& error : stats.failedWorkers) errors += "\n" + error;
+        throw std::runtime_error("Every worker failed before the mesh was baked:" + errors);
+    }
+
+    const auto merge = Clock::now();
+    stats.seconds = std::chrono::duration<double>(merge - start).count();
+
+    std::vector<ShardedBake::Shard> shards;
+    shards.reserve(shardFiles.size());
+    try {
+        for(const std::filesystem::path& shardFile : shardFiles) shards.push_back(ShardedBake::read(shardFile));
+    } catch(...) {
+        removeShards();
+        throw;
+    }
+    removeShards();
+
+    BakedMesh baked = ShardedBake::merge(std::move(shards));
+    stats.mergeSeconds = std::chrono::duration<double>(Clock::now() - merge).count();
+
+    return baked;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <framework/mesh.h>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "BakedMesh.h"
+#include "Socket.h"
+
+//What happened while a BakeCoordinator baked a mesh
+struct DistributedBakeStats {
+    double seconds = 0.0; //Until every shard was baked
+    double mergeSeconds = 0.0; //Reading and merging the shards
+    size_t shards = 0;
+    size_t shardBytes = 0; //Of all shard files
+    std::vector<size_t> shardsPerWorker;
+    std::vector<std::string> failedWorkers; //Workers whose connection broke or whose bake failed, their shards went to the others
+};
+
+/**
+ * Bakes a mesh on several RenderDaemon processes, on this machine or on others: the base triangles are split into shards
+ * (see ShardedBake), which the workers take one at a time as bake requests. Every worker bakes its shard with its own
+ * threads and writes it into a directory that all of them share with the coordinator, which reads the shards back and
+ * merges them into the same BakedMesh as a bake in one process.
+ *
+ * Workers that are faster take more shards. A worker whose connection breaks or whose bake fails is dropped and its
+ * shard goes to the others. Unlike the tiles of TileCoordinator, shards are not copied to idle workers, since a copy
+ * would bake a large part of the mesh a second time.
+ */
+class BakeCoordinator {
+public:
+    struct Options {
+        unsigned int shardsPerWorker = 4; //Smaller shards balance the load better, larger ones load the mesh fewer times
+        bool keepShards = false; //Leave the shard files in the directory rather than removing them after the merge
+    };
+
+    /**
+     * @param workerAddresses the addresses of the daemons, see Socket. Connected to when a mesh is baked.
+     * @param bakeOptions how the mesh is split
+     */
+    BakeCoordinator(std::vector<std::string> workerAddresses, Options bakeOptions);
+
+    /**
+     * Bakes a mesh on all workers that can be reached. Throws if none can, or if every worker failed before every shard
+     * was baked.
+     *
+     * @param mesh the mesh, only to split it into shards of about the same size
+     * @param file the file of the mesh as the workers see it, so an absolute path on a file system they share
+     * @param directory where the workers write their shards, as both they and this process see it
+     * @param order the order of the displacement scales
+     * @param stats what happened
+     * @return the same baked mesh as BakedMesh::bake
+     */
+    [[nodiscard]] BakedMesh bake(const Mesh& mesh, const std::filesystem::path& file, const std::filesystem::path& directory, VertexOrder order, DistributedBakeStats& stats);
+
+    [[nodiscard]] const std::vector<std::string>& getWorkers() const;
+
+private:
+    std::vector<std::string> workers;
+    Options options;
+};
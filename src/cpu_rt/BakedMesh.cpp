@@ -0,0 +1,550 @@
+#include "BakedMesh.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "AABBBuilder.h"
+#include "PagedBlocks.h"
+
+//The displacement vector of a micro-vertex with a given scale
+static glm::vec3 displacement(const BakedMesh& baked, const TriangleData& td, const glm::uvec2& coords, const float scale) {
+    const glm::vec3 directions[3] = {baked.vertices[td.vIndices.x].direction, baked.vertices[td.vIndices.y].direction, baked.vertices[td.vIndices.z].direction};
+    const unsigned int segments = static_cast<unsigned int>(td.nRows - 1);
+
+    const glm::vec3 bc = glm::vec3(segments - coords.x, coords.x - coords.y, coords.y) / static_cast<float>(segments);
+    return scale * (bc.x * directions[0] + bc.y * directions[1] + bc.z * directions[2]);
+}
+
+//How far the displacement of a micro-vertex moves it along the plane of its base triangle
+static float tangentialDisplacement(const BakedMesh& baked, const TriangleData& td, const glm::vec3& N, const glm::uvec2& coords, const float scale) {
+    const glm::vec3 d = displacement(baked, td, coords, scale);
+    return glm::length(d - glm::dot(d, N) * N);
+}
+
+//The longest tangential displacement of a present micro-vertex of a base triangle
+static float tangentialDisplacement(const BakedMesh& baked, const TriangleData& td) {
+    const glm::vec3& N = baked.plane(td).N;
+    const unsigned int segments = static_cast<unsigned int>(td.nRows - 1);
+
+    float maxLength = 0.0f;
+    for(unsigned int x = 0; x <= segments; x++) {
+        for(unsigned int y = 0; y <= x; y++) {
+            const float scale = baked.displacementScale(td, {x, y});
+            if(scale == -1.0f) continue;
+
+            maxLength = std::max(maxLength, tangentialDisplacement(baked, td, N, {x, y}, scale));
+        }
+    }
+
+    return maxLength;
+}
+
+//A hierarchy triangle by the grid coordinates of its corners, in the same order as the traversal subdivides them
+using HierarchyCorners = std::array<glm::uvec2, 3>;
+
+//The 4 children of a hierarchy triangle, in the order of their records (see subdivide(...) in MicroMeshTraversal.cpp)
+static std::array<HierarchyCorners, 4> childCorners(const HierarchyCorners& t) {
+    const glm::uvec2 m0 = (t[0] + t[1]) / 2u;
+    const glm::uvec2 m1 = (t[1] + t[2]) / 2u;
+    const glm::uvec2 m2 = (t[2] + t[0]) / 2u;
+
+    return {{{t[0], m0, m2}, {m0, t[1], m1}, {m0, m1, m2}, {m2, m1, t[2]}}};
+}
+
+//Checks if the displacements of all micro-vertices of a hierarchy triangle with `size` micro-triangles along an edge
+//are at most maxDistance away from interpolating those of its corners, so that the triangle through the displaced
+//corners can stand in for its micro-triangles. Around missing micro-vertices the micro-triangles do not follow the
+//regular grid, so hierarchy triangles with missing micro-vertices are never flat.
+static bool isFlat(const BakedMesh& baked, const TriangleData& td, const HierarchyCorners& t, const int size, const float maxDistance) {
+    glm::vec3 corners[3];
+    for(size_t i = 0; i < 3; i++) {
+        const float scale = baked.displacementScale(td, t[i]);
+        if(scale == -1.0f) return false;
+
+        corners[i] = displacement(baked, td, t[i], scale);
+    }
+
+    const glm::ivec2 origin(t[0]);
+    const glm::ivec2 step1 = (glm::ivec2(t[1]) - origin) / size;
+    const glm::ivec2 step2 = (glm::ivec2(t[2]) - origin) / size;
+    for(int i = 0; i <= size; i++) {
+        for(int j = 0; i + j <= size; j++) {
+            const glm::uvec2 coords(origin + i * step1 + j * step2);
+            const float scale = baked.displacementScale(td, coords);
+            if(scale == -1.0f) return false;
+
+            const glm::vec3 bc = glm::vec3(size - i - j, i, j) / static_cast<float>(size);
+            const glm::vec3 flat = bc.x * corners[0] + bc.y * corners[1] + bc.z * corners[2];
+            if(glm::length(displacement(baked, td, coords, scale) - flat) > maxDistance) return false;
+        }
+    }
+
+    return true;
+}
+
+//The triangular grid coordinates of the micro-vertex at an index of Triangle::uVertices, the inverse of BakedMesh::displacementScale's index
+static glm::uvec2 gridCoordinates(const unsigned int index) {
+    auto x = static_cast<unsigned int>((std::sqrt(8.0 * index + 1.0) - 1.0) / 2.0);
+    while((x * (x + 1)) / 2 > index) x--;
+    while(((x + 1) * (x + 2)) / 2 <= index) x++;
+
+    return {x, index - (x * (x + 1)) / 2};
+}
+
+BakedMesh BakedMesh::bakeWithoutHierarchy(const Mesh& mesh, const VertexOrder order) {
+    BakedMesh baked;
+
+    baked.vertices.reserve(mesh.vertices.size());
+    std::ranges::transform(mesh.vertices, std::back_inserter(baked.vertices), [](const Vertex& v) { return BaseVertex{v.position, v.direction}; });
+
+    baked.triangleData.reserve(mesh.triangles.size());
+    baked.displacementScales = mesh.computeDisplacementScales(baked.triangleData);
+    if(order == VertexOrder::BIRD_CURVE) {
+        //Mesh gives the scales in the order of Triangle::uVertices, which is row-major
+        std::vector<float> reordered(baked.displacementScales.size());
+        for(const TriangleData& td : baked.triangleData) {
+            const std::vector<std::uint32_t>& curve = VertexOrdering::birdCurve(td.subDivisionLevel);
+            const auto offset = static_cast<size_t>(td.displacementOffset);
+            for(size_t i = 0; i < curve.size(); i++) reordered[offset + curve[i]] = baked.displacementScales[offset + i];
+        }
+
+        baked.displacementScales = std::move(reordered);
+        baked.vertexOrder = order;
+    }
+
+    //An AABB around all displaced micro-vertices of a triangle, the same ones GPUMesh builds the BLAS from
+    baked.AABBs = AABBBuilder::build(mesh);
+
+    //How far displacements move micro-vertices sideways, which bounds how far micro-triangles stray from their grid cell
+    baked.tangentialDisplacements.reserve(baked.triangleData.size());
+    for(const TriangleData& td : baked.triangleData) baked.tangentialDisplacements.push_back(tangentialDisplacement(baked, td));
+
+    baked.uniformSubdivisionLevel = mesh.hasUniformSubdivisionLevel();
+    for(const TriangleData& td : baked.triangleData) baked.maxSubdivisionLevel = std::max(baked.maxSubdivisionLevel, td.subDivisionLevel);
+
+    return baked;
+}
+
+BakedMesh BakedMesh::bake(const Mesh& mesh, const VertexOrder order) {
+    BakedMesh baked = bakeWithoutHierarchy(mesh, order);
+    baked.minMaxDisplacements = mesh.minMaxDisplacements(baked.triangleData);
+    baked.deltas = mesh.triangleDeltas();
+
+    return baked;
+}
+
+BakedMesh BakedMesh::bakeLazily(const Mesh& mesh, const VertexOrder order) {
+    BakedMesh baked = bakeWithoutHierarchy(mesh, order);
+
+    //Same layout as Mesh::minMaxDisplacements: every hierarchy triangle above the micro-triangles, level by level
+    size_t records = 0;
+    for(TriangleData& td : baked.triangleData) {
+        if(td.subDivisionLevel == 0) continue;
+
+        td.minMaxOffset = static_cast<int>(records);
+        records += hierarchyRecordCount(td);
+    }
+
+    //One dummy value if there are no records, like Mesh::minMaxDisplacements and Mesh::triangleDeltas
+    baked.minMaxDisplacements.resize(std::max<size_t>(1, records), glm::vec2(0.0f));
+    baked.deltas.resize(std::max<size_t>(1, records), 0.0f);
+
+    //The root min-max displacements are as cheap as the AABBs, and the traversal heuristics need them before any ray is traced.
+    //Same as the first record of Mesh::minMaxDisplacements: the heights of the micro-vertices of all micro-triangles.
+    for(size_t i = 0; i < mesh.triangles.size(); i++) {
+        const TriangleData& td = baked.triangleData[i];
+        if(td.subDivisionLevel == 0) continue;
+
+        const glm::vec3 N = baked.plane(td).N;
+        float minDisplacement = 100000.0f, maxDisplacement = -100000.0f;
+        for(const glm::uvec3& face : mesh.triangles[i].uFaces) {
+            for(int j = 0; j < 3; j++) {
+                const float height = glm::dot(mesh.triangles[i].uVertices[face[j]].displacement, N);
+
+                maxDisplacement = std::max(maxDisplacement, height);
+                minDisplacement = std::min(minDisplacement, height);
+            }
+        }
+
+        baked.minMaxDisplacements[static_cast<size_t>(td.minMaxOffset)] = {minDisplacement, maxDisplacement};
+    }
+
+    return baked;
+}
+
+BakedMesh BakedMesh::bakeRange(const Mesh& mesh, const unsigned int firstTriangle, const unsigned int triangleCount, const VertexOrder order) {
+    if(static_cast<size_t>(firstTriangle) + triangleCount > mesh.triangles.size()) throw std::out_of_range("The base triangles to bake are not within the mesh");
+    const std::span<const Triangle> triangles(mesh.triangles.data() + firstTriangle, triangleCount);
+
+    BakedMesh baked;
+    baked.vertexOrder = order;
+    baked.vertices.reserve(mesh.vertices.size());
+    std::ranges::transform(mesh.vertices, std::back_inserter(baked.vertices), [](const Vertex& v) { return BaseVertex{v.position, v.direction}; });
+
+    //The same passes as bake, one base triangle at a time, see Mesh::computeDisplacementScales and Mesh::minMaxDisplacements
+    baked.triangleData.reserve(triangles.size());
+    baked.AABBs.reserve(triangles.size());
+    for(const Triangle& t : triangles) {
+        TriangleData td{t.baseVertexIndices, mesh.numberOfVerticesOnEdge(t), t.subdivisionLevel(), static_cast<int>(baked.displacementScales.size()), 0};
+
+        const size_t begin = baked.displacementScales.size();
+        for(const uVertex& uv : t.uVertices) baked.displacementScales.push_back(mesh.displacementScale(t, uv));
+        if(order == VertexOrder::BIRD_CURVE) {
+            const std::vector<std::uint32_t>& curve = VertexOrdering::birdCurve(td.subDivisionLevel);
+            std::vector<float> reordered(curve.size());
+            for(size_t i = 0; i < curve.size(); i++) reordered[curve[i]] = baked.displacementScales[begin + i];
+            std::ranges::copy(reordered, baked.displacementScales.begin() + static_cast<std::ptrdiff_t>(begin));
+        }
+
+        if(td.subDivisionLevel > 0) {
+            td.minMaxOffset = static_cast<int>(baked.minMaxDisplacements.size());
+            mesh.triangleMinMaxDisplacements(t, baked.minMaxDisplacements);
+            mesh.triangleDeltas(t, baked.deltas);
+        }
+
+        baked.triangleData.push_back(td);
+        baked.AABBs.push_back(AABBBuilder::build(t));
+        baked.maxSubdivisionLevel = std::max(baked.maxSubdivisionLevel, td.subDivisionLevel);
+        baked.uniformSubdivisionLevel &= td.subDivisionLevel == baked.triangleData.front().subDivisionLevel;
+    }
+
+    //One dummy value if there are no records, like Mesh::minMaxDisplacements and Mesh::triangleDeltas
+    if(baked.minMaxDisplacements.empty()) baked.minMaxDisplacements.emplace_back(0.0f);
+    if(baked.deltas.empty()) baked.deltas.push_back(0.0f);
+
+    baked.tangentialDisplacements.reserve(triangles.size());
+    for(const TriangleData& td : baked.triangleData) baked.tangentialDisplacements.push_back(tangentialDisplacement(baked, td));
+
+    return baked;
+}
+
+BakedMeshUpdate BakedMesh::applyEdits(const Mesh& mesh, const std::span<const DisplacementEdit> edits, TriangleHierarchies& hierarchies) {
+    if(pages) throw std::runtime_error("Paged meshes can not be edited, their blocks are read-only");
+    if(hasQuantizedHierarchy()) throw std::runtime_error("Meshes with a quantized hierarchy can not be edited");
+    if(hasSparseHierarchy()) throw std::runtime_error("Meshes with a sparse hierarchy can not be edited");
+
+    BakedMeshUpdate update;
+
+    std::vector<DisplacementEdit> sorted(edits.begin(), edits.end());
+    std::ranges::stable_sort(sorted, {}, &DisplacementEdit::triangle);
+
+    for(auto begin = sorted.begin(); begin != sorted.end();) {
+        const unsigned int i = begin->triangle;
+        const auto end = std::find_if(begin, sorted.end(), [&](const DisplacementEdit& edit) { return edit.triangle != i; });
+        const std::span<const DisplacementEdit> triangleEdits(begin, end);
+
+        const Triangle& t = mesh.triangles[i];
+        const TriangleData& td = triangleData[i];
+        const glm::vec3 N = plane(td).N;
+
+        //The tangential displacement and the AABB are maxima (and minima) over all micro-vertices. They only have to be
+        //recomputed from all of them if an edited micro-vertex reached them before and may have moved inwards.
+        float& tangential = tangentialDisplacements[i];
+        AABB& aabb = AABBs[i];
+        bool tangentialWasReached = false, boundsWereReached = false;
+        float farthestTangential = 0.0f;
+        AABB editedBounds;
+
+        for(const DisplacementEdit& edit : triangleEdits) {
+            const uVertex& uv = t.uVertices[edit.microVertex];
+            const glm::uvec2 coords = gridCoordinates(edit.microVertex);
+
+            float& scale = displacementScales[scaleIndex(td, coords)];
+            if(scale != -1.0f) tangentialWasReached |= tangentialDisplacement(*this, td, N, coords, scale) >= tangential;
+            scale = mesh.displacementScale(t, uv);
+            if(scale != -1.0f) farthestTangential = std::max(farthestTangential, tangentialDisplacement(*this, td, N, coords, scale));
+
+            const glm::vec3 previous = uv.position + edit.previousDisplacement;
+            boundsWereReached |= glm::any(glm::equal(previous, aabb.minPos)) || glm::any(glm::equal(previous, aabb.maxPos));
+            editedBounds.extend(uv.position + uv.displacement);
+        }
+
+        if(tangentialWasReached && farthestTangential < tangential) tangential = tangentialDisplacement(*this, td);
+        else tangential = std::max(tangential, farthestTangential);
+
+        if(boundsWereReached) aabb = AABBBuilder::build(t);
+        else aabb.extend(editedBounds);
+
+        if(td.subDivisionLevel > 0) {
+            const size_t count = hierarchyRecordCount(td);
+            const std::span<glm::vec2> triangleMinMax(minMaxDisplacements.data() + td.minMaxOffset, count);
+            const std::span<float> triangleDeltas(deltas.data() + td.minMaxOffset, count);
+
+            const auto [entry, inserted] = hierarchies.try_emplace(i);
+            if(inserted) entry->second = mesh.triangleHierarchy(t);
+
+            if(entry->second.corners.size() == count) {
+                update.updatedRecords += mesh.updateTriangleHierarchy(t, entry->second, triangleEdits, triangleMinMax, triangleDeltas);
+            } else {
+                //Not a complete hierarchy, so the records are recomputed like bake does
+                std::vector<glm::vec2> recomputedMinMax;
+                std::vector<float> recomputedDeltas;
+                mesh.triangleMinMaxDisplacements(t, recomputedMinMax);
+                mesh.triangleDeltas(t, recomputedDeltas);
+
+                std::copy_n(recomputedMinMax.begin(), std::min(count, recomputedMinMax.size()), triangleMinMax.begin());
+                std::copy_n(recomputedDeltas.begin(), std::min(count, recomputedDeltas.size()), triangleDeltas.begin());
+                update.updatedRecords += count;
+            }
+        }
+
+        update.triangles.push_back(i);
+        begin = end;
+    }
+
+    return update;
+}
+
+BakedMeshUpdate BakedMesh::applyMotion(const Mesh& mesh, const std::span<const unsigned int> triangles, const unsigned int threadCount) {
+    if(pages) throw std::runtime_error("Paged meshes can not be moved, their blocks are read-only");
+    if(hasQuantizedHierarchy()) throw std::runtime_error("Meshes with a quantized hierarchy can not be moved");
+    if(hasSparseHierarchy()) throw std::runtime_error("Meshes with a sparse hierarchy can not be moved");
+
+    BakedMeshUpdate update;
+    update.triangles.assign(triangles.begin(), triangles.end());
+
+    for(const unsigned int i : triangles) {
+        for(int j = 0; j < 3; j++) {
+            const Vertex& v = mesh.vertices[triangleData[i].vIndices[j]];
+            vertices[triangleData[i].vIndices[j]] = {v.position, v.direction};
+        }
+
+        if(triangleData[i].subDivisionLevel > 0) update.updatedRecords += hierarchyRecordCount(triangleData[i]);
+    }
+
+    //Every triangle writes only its own data, so the threads need no synchronization
+    constexpr size_t CHUNK_SIZE = 64;
+    const size_t chunks = (triangles.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const unsigned int requested = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+    const auto threads = static_cast<unsigned int>(std::clamp<size_t>(requested, 1, std::max<size_t>(1, chunks)));
+
+    std::atomic<size_t> nextChunk{0};
+    const auto work = [&] {
+        std::vector<glm::vec2> recomputedMinMax;
+        std::vector<float> recomputedDeltas;
+
+        for(size_t chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+            const size_t end = std::min(triangles.size(), (chunk + 1) * CHUNK_SIZE);
+            for(size_t k = chunk * CHUNK_SIZE; k < end; k++) {
+                const unsigned int i = triangles[k];
+                const Triangle& t = mesh.triangles[i];
+                const TriangleData& td = triangleData[i];
+
+                AABBs[i] = AABBBuilder::build(t);
+                tangentialDisplacements[i] = tangentialDisplacement(*this, td);
+                if(td.subDivisionLevel == 0) continue;
+
+                //The heights and deltas are measured in the plane of the moved triangle, so all of them change
+                recomputedMinMax.clear();
+                recomputedDeltas.clear();
+                mesh.triangleMinMaxDisplacements(t, recomputedMinMax);
+                mesh.triangleDeltas(t, recomputedDeltas);
+
+                const size_t count = hierarchyRecordCount(td);
+                std::copy_n(recomputedMinMax.begin(), std::min(count, recomputedMinMax.size()), minMaxDisplacements.begin() + td.minMaxOffset);
+                std::copy_n(recomputedDeltas.begin(), std::min(count, recomputedDeltas.size()), deltas.begin() + td.minMaxOffset);
+            }
+        }
+    };
+
+    //The calling thread works as well
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for(unsigned int thread = 0; thread + 1 < threads; thread++) workers.emplace_back(work);
+    work();
+    for(std::thread& worker : workers) worker.join();
+
+    return update;
+}
+
+void BakedMesh::quantizeHierarchy() {
+    if(pages) throw std::runtime_error("The hierarchy of a paged mesh can not be quantized");
+    if(hasSparseHierarchy()) throw std::runtime_error("A sparse hierarchy can not be quantized");
+    if(hasQuantizedHierarchy()) return;
+
+    quantizedBounds.assign(minMaxDisplacements.size(), {0, 255, 255, 0});
+    hierarchyRanges.assign(triangleData.size(), {glm::vec2(0.0f), 0.0f});
+
+    //The decoded bounds of the current triangle, which its children are relative to
+    std::vector<glm::vec2> decoded;
+    for(size_t i = 0; i < triangleData.size(); i++) {
+        const TriangleData& td = triangleData[i];
+        const size_t count = hierarchyRecordCount(td);
+        if(count == 0) continue;
+
+        const glm::vec2* exactMinMax = minMaxDisplacements.data() + td.minMaxOffset;
+        const float* exactDeltas = deltas.data() + td.minMaxOffset;
+        QuantizedBounds* records = quantizedBounds.data() + td.minMaxOffset;
+
+        HierarchyRange& range = hierarchyRanges[i];
+        range.rootMinMax = exactMinMax[0];
+        range.maxDelta = *std::max_element(exactDeltas, exactDeltas + count);
+
+        //Rounded up, then moved up further if float rounding still decodes below the exact delta
+        for(size_t r = 0; r < count; r++) {
+            const float fraction = range.maxDelta > 0.0f ? exactDeltas[r] / range.maxDelta : 0.0f;
+            auto q = static_cast<std::uint8_t>(std::clamp(std::ceil(fraction * 255.0f), 0.0f, 255.0f));
+            while(q < 255 && dequantize(0.0f, range.maxDelta, q) < exactDeltas[r]) q++;
+            records[r].delta = q;
+        }
+
+        //Top-down, so that every child is encoded relative to what the traversal decodes for its parent
+        decoded.assign(count, glm::vec2(0.0f));
+        decoded[0] = range.rootMinMax;
+        for(int level = 0; level + 1 < td.subDivisionLevel; level++) {
+            const size_t levelBegin = ((size_t(1) << (2 * level)) - 1) / 3;
+            const size_t childBegin = ((size_t(1) << (2 * (level + 1))) - 1) / 3;
+
+            for(size_t local = 0; local < (size_t(1) << (2 * level)); local++) {
+                const glm::vec2& parent = decoded[levelBegin + local];
+                const float extent = parent.y - parent.x;
+
+                for(size_t c = 0; c < 4; c++) {
+                    const size_t child = childBegin + 4 * local + c;
+                    const glm::vec2& exact = exactMinMax[child];
+                    const float minFraction = extent > 0.0f ? (exact.x - parent.x) / extent : 0.0f;
+                    const float maxFraction = extent > 0.0f ? (exact.y - parent.x) / extent : 1.0f;
+
+                    auto qMin = static_cast<std::uint8_t>(std::clamp(std::floor(minFraction * 255.0f), 0.0f, 255.0f));
+                    auto qMax = static_cast<std::uint8_t>(std::clamp(std::ceil(maxFraction * 255.0f), 0.0f, 255.0f));
+                    while(qMin > 0 && dequantize(parent.x, parent.y, qMin) > exact.x) qMin--;
+                    while(qMax < 255 && dequantize(parent.x, parent.y, qMax) < exact.y) qMax++;
+
+                    records[child].min = qMin;
+                    records[child].max = qMax;
+                    decoded[child] = dequantizeMinMax(parent, records[child]);
+                }
+            }
+        }
+    }
+
+    minMaxDisplacements = {};
+    deltas = {};
+}
+
+size_t BakedMesh::collapseFlatSubtrees(const float tolerance) {
+    //Displacements that only differ by float rounding still count as flat at a tolerance of 0
+    constexpr float MIN_TOLERANCE = 1e-5f;
+
+    if(pages) throw std::runtime_error("The hierarchy of a paged mesh can not be made sparse");
+    if(hasQuantizedHierarchy()) throw std::runtime_error("A quantized hierarchy can not be made sparse");
+    if(hasSparseHierarchy()) return 0;
+
+    std::vector<glm::vec2> sparseMinMax;
+    std::vector<float> sparseDeltas;
+    interiorOffsets.reserve(triangleData.size());
+
+    //The hierarchy triangles of a level that are kept, by their local index and corners
+    std::vector<std::pair<unsigned int, HierarchyCorners>> level, nextLevel;
+    size_t flatLeaves = 0;
+    for(TriangleData& td : triangleData) {
+        const auto denseOffset = static_cast<size_t>(td.minMaxOffset);
+        td.minMaxOffset = static_cast<int>(sparseMinMax.size());
+        interiorOffsets.push_back(static_cast<std::uint32_t>(interiorWords.size()));
+        if(td.subDivisionLevel == 0) continue;
+
+        const glm::vec3& p0 = vertices[td.vIndices.x].position;
+        const glm::vec3& p1 = vertices[td.vIndices.y].position;
+        const glm::vec3& p2 = vertices[td.vIndices.z].position;
+        const float longestEdge = std::max({glm::length(p1 - p0), glm::length(p2 - p1), glm::length(p0 - p2)});
+        const float maxDistance = std::max(tolerance, MIN_TOLERANCE) * longestEdge;
+
+        //Level by level, so that the children of the k-th hierarchy triangle with children are the records 1 + 4k to 4 + 4k
+        const unsigned int segments = static_cast<unsigned int>(td.nRows - 1);
+        level.assign(1, {0u, HierarchyCorners{glm::uvec2(0, 0), glm::uvec2(segments, 0), glm::uvec2(segments, segments)}});
+        size_t record = 0, interior = 0;
+        for(int l = 0; l < td.subDivisionLevel; l++) {
+            nextLevel.clear();
+
+            for(const auto& [localIndex, corners] : level) {
+                const size_t dense = denseOffset + ((size_t(1) << (2 * l)) - 1) / 3 + localIndex;
+                sparseMinMax.push_back(minMaxDisplacements[dense]);
+                sparseDeltas.push_back(deltas[dense]);
+
+                if(record % 64 == 0) interiorWords.push_back({0, static_cast<std::uint32_t>(interior)});
+                if(isFlat(*this, td, corners, 1 << (td.subDivisionLevel - l), maxDistance)) {
+                    flatLeaves++;
+                } else {
+                    interiorWords.back().bits |= std::uint64_t(1) << (record % 64);
+                    interior++;
+
+                    const std::array<HierarchyCorners, 4> children = childCorners(corners);
+                    for(unsigned int c = 0; c < 4; c++) nextLevel.emplace_back(4 * localIndex + c, children[c]);
+                }
+                record++;
+            }
+
+            std::swap(level, nextLevel);
+        }
+    }
+
+    //One dummy value if there are no records, like bake
+    if(sparseMinMax.empty()) {
+        sparseMinMax.emplace_back(0.0f);
+        sparseDeltas.push_back(0.0f);
+    }
+    minMaxDisplacements = std::move(sparseMinMax);
+    deltas = std::move(sparseDeltas);
+
+    return flatLeaves;
+}
+
+size_t BakedMesh::hierarchyRecordCount(const TriangleData& td) {
+    return td.subDivisionLevel == 0 ? 0 : ((size_t(1) << (2 * td.subDivisionLevel)) - 1) / 3;
+}
+
+TBNPlane::Plane BakedMesh::plane(const TriangleData& td) const {
+    const glm::vec3& p0 = vertices[td.vIndices.x].position;
+    const glm::vec3& p1 = vertices[td.vIndices.y].position;
+    const glm::vec3& p2 = vertices[td.vIndices.z].position;
+
+    const glm::vec3 N = glm::normalize(glm::cross(p1 - p0, p2 - p0));
+    const glm::vec3 T = glm::normalize(p1 - p0);
+    const glm::vec3 B = glm::normalize(glm::cross(N, T));
+
+    return {T, B, N, p0};
+}
+
+glm::vec3 BakedMesh::microVertexPosition(const TriangleData& td, const glm::uvec2& coords) const {
+    const BaseVertex& v0 = vertices[td.vIndices.x];
+    const BaseVertex& v1 = vertices[td.vIndices.y];
+    const BaseVertex& v2 = vertices[td.vIndices.z];
+
+    //Row x of the grid goes from v0 (x = 0) to the edge v1-v2 (x = nRows - 1), column y goes from the v0-v1 edge towards v2
+    const float segments = static_cast<float>(td.nRows - 1);
+    const glm::vec2 c(coords);
+    const glm::vec3 bc = glm::vec3(segments - c.x, c.x - c.y, c.y) / segments;
+
+    const glm::vec3 position = bc.x * v0.position + bc.y * v1.position + bc.z * v2.position;
+    const glm::vec3 direction = bc.x * v0.direction + bc.y * v1.direction + bc.z * v2.direction;
+
+    return position + displacementScale(td, coords) * direction;
+}
+
+TriangleBlock BakedMesh::pagedBlock(const unsigned int primitiveIndex) const {
+    std::shared_ptr<const std::vector<float>> data = pages->load(primitiveIndex);
+    const PagedBlocks::Layout layout = PagedBlocks::layout(triangleData[primitiveIndex]);
+
+    const float* begin = data->data();
+    return {begin, order(triangleData[primitiveIndex]), reinterpret_cast<const glm::vec2*>(begin + layout.minMaxOffset), begin + layout.deltaOffset, nullptr, nullptr, nullptr, std::move(data)};
+}
+
+size_t BakedMesh::sizeInBytes() const {
+    return vertices.size() * sizeof(BaseVertex)
+        + triangleData.size() * sizeof(TriangleData)
+        + displacementScales.size() * sizeof(float)
+        + minMaxDisplacements.size() * sizeof(glm::vec2)
+        + deltas.size() * sizeof(float)
+        + AABBs.size() * sizeof(AABB)
+        + tangentialDisplacements.size() * sizeof(float)
+        + quantizedBounds.size() * sizeof(QuantizedBounds)
+        + hierarchyRanges.size() * sizeof(HierarchyRange)
+        + interiorWords.size() * sizeof(InteriorWord)
+        + interiorOffsets.size() * sizeof(std::uint32_t);
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <framework/mesh.h>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "AABB.h"
+#include "VertexOrder.h"
+#include "../Plane.h"
+#include "../TriangleData.h"
+
+struct BaseVertex {
+    glm::vec3 position;
+    glm::vec3 direction;
+};
+
+//What BakedMesh::applyEdits or BakedMesh::applyMotion changed
+struct BakedMeshUpdate {
+    std::vector<unsigned int> triangles; //The edited or moved base triangles, in increasing order
+    size_t updatedRecords = 0; //The number of hierarchy records (min-max displacements and deltas) that were updated
+};
+
+class PagedBlocks;
+
+/**
+ * A hierarchy record (min-max displacements and delta) in 4 bytes instead of 12, see BakedMesh::quantizeHierarchy. The
+ * min-max displacements are 255ths of the range of the parent hierarchy triangle, the delta 255ths of the largest delta
+ * of the base triangle (a child can need a larger delta than its parent). All are rounded outwards, so the decoded
+ * bounds always contain the exact ones.
+ */
+struct QuantizedBounds {
+    std::uint8_t min;
+    std::uint8_t max;
+    std::uint8_t delta;
+    std::uint8_t padding;
+};
+
+//Per base triangle, what its quantized records are relative to
+struct HierarchyRange {
+    glm::vec2 rootMinMax; //The exact min-max displacements of the base triangle, the parent range of its children
+    float maxDelta; //The largest delta of any of its hierarchy triangles
+};
+
+//Decodes a fraction of a range, 255 gives exactly the end of the range
+[[nodiscard]] inline float dequantize(const float begin, const float end, const std::uint8_t q) {
+    if(q == 255) return end;
+
+    return begin + static_cast<float>(q) * ((end - begin) * (1.0f / 255.0f));
+}
+
+//The min-max displacements of a hierarchy triangle from the (decoded) min-max displacements of its parent
+[[nodiscard]] inline glm::vec2 dequantizeMinMax(const glm::vec2& parent, const QuantizedBounds& q) {
+    return {dequantize(parent.x, parent.y, q.min), dequantize(parent.x, parent.y, q.max)};
+}
+
+/**
+ * 64 records of a sparse hierarchy, see BakedMesh::collapseFlatSubtrees. The records of a base triangle are stored level
+ * by level like a full hierarchy, but without the descendants of flat leaves. The children of the k-th record with
+ * children (counting from the root) are therefore the records 1 + 4k to 4 + 4k, and k is the rank of its bit.
+ */
+struct InteriorWord {
+    std::uint64_t bits; //One bit per record: set if the hierarchy triangle has children, clear if it is a flat leaf
+    std::uint32_t rank; //The number of set bits in the words of the base triangle before this one
+};
+
+//Whether the hierarchy triangle of a record of a sparse hierarchy has children
+[[nodiscard]] inline bool hasChildren(const InteriorWord* words, const int record) {
+    return (words[record / 64].bits >> (record % 64)) & 1u;
+}
+
+//The record of the first child of a hierarchy triangle of a sparse hierarchy that has children
+[[nodiscard]] inline int firstChildRecord(const InteriorWord* words, const int record) {
+    const InteriorWord& word = words[record / 64];
+    const std::uint64_t before = word.bits & ((std::uint64_t(1) << (record % 64)) - 1);
+
+    return 1 + 4 * (static_cast<int>(word.rank) + std::popcount(before));
+}
+
+/**
+ * The data of one base triangle that the traversal reads per micro-vertex or hierarchy triangle, with its offsets
+ * (TriangleData::displacementOffset and minMaxOffset) already applied. The pointers stay valid as long as the block is held.
+ */
+struct TriangleBlock {
+    const float* displacementScales;
+    const std::uint32_t* vertexOrder; //Where the scale of each micro-vertex is, by its row-major index. nullptr if the scales are in row-major order.
+    const glm::vec2* minMaxDisplacements;
+    const float* deltas;
+    const QuantizedBounds* quantizedBounds; //Instead of minMaxDisplacements and deltas if the hierarchy is quantized, nullptr otherwise
+    const HierarchyRange* range; //Only if the hierarchy is quantized
+    const InteriorWord* interior; //Which records have children if the hierarchy is sparse, nullptr otherwise
+    std::shared_ptr<const void> pin; //Keeps a paged block alive while the cache evicts it, empty when the mesh is in memory
+};
+
+//The hierarchies of the base triangles that were edited before, by base triangle, see Mesh::triangleHierarchy
+using TriangleHierarchies = std::unordered_map<unsigned int, TriangleHierarchy>;
+
+/**
+ * All data the micro-mesh intersection needs, baked from a Mesh.
+ *
+ * This is exactly the data that is uploaded to the GPU for intersection.hlsl (vertices, triangle data, displacement
+ * scales, min-max displacements and deltas), plus one AABB and one tangential displacement per base triangle. Keeping
+ * it in one place lets the CPU traversal use the same buffers as the GPU without touching D3D12.
+ */
+struct BakedMesh {
+    std::vector<BaseVertex> vertices;
+    std::vector<TriangleData> triangleData;
+    std::vector<float> displacementScales;
+    std::vector<glm::vec2> minMaxDisplacements;
+    std::vector<float> deltas;
+    std::vector<AABB> AABBs;
+    std::vector<float> tangentialDisplacements; //Per base triangle, the longest displacement of a micro-vertex along the triangle's plane
+    //Only after quantizeHierarchy, which empties minMaxDisplacements and deltas: the hierarchy records at the same offsets, and per base triangle their ranges
+    std::vector<QuantizedBounds> quantizedBounds;
+    std::vector<HierarchyRange> hierarchyRanges;
+    //Only after collapseFlatSubtrees, which leaves out the records below flat leaves: which records have children, and
+    //per base triangle where its words start
+    std::vector<InteriorWord> interiorWords;
+    std::vector<std::uint32_t> interiorOffsets;
+    bool uniformSubdivisionLevel = true;
+    int maxSubdivisionLevel = 0;
+    VertexOrder vertexOrder = VertexOrder::ROW_MAJOR; //Of the displacement scales of every base triangle, the GPU only reads row-major order
+    //Set for meshes opened with PagedBlocks::open. displacementScales, minMaxDisplacements and deltas are then empty:
+    //their blocks are read from a file on demand, see block(...)
+    std::shared_ptr<PagedBlocks> pages;
+
+    static BakedMesh bake(const Mesh& mesh, VertexOrder order = VertexOrder::ROW_MAJOR);
+    //Same as bake, but only allocates the min-max displacements and deltas (the hierarchy records) and sets their offsets.
+    //They are computed per base triangle later, see LazyHierarchy.
+    static BakedMesh bakeLazily(const Mesh& mesh, VertexOrder order = VertexOrder::ROW_MAJOR);
+    //Everything but the hierarchy records (min-max displacements and deltas), which are left empty, see PagedBlocks::bake
+    static BakedMesh bakeWithoutHierarchy(const Mesh& mesh, VertexOrder order = VertexOrder::ROW_MAJOR);
+    //Same as bake, but only the base triangles from firstTriangle on, as if they were the whole mesh: their offsets start
+    //at 0 and the arrays only hold them. The vertices are all base vertices. See ShardedBake.
+    static BakedMesh bakeRange(const Mesh& mesh, unsigned int firstTriangle, unsigned int triangleCount, VertexOrder order = VertexOrder::ROW_MAJOR);
+
+    /**
+     * Updates the baked data after displacements of micro-vertices were edited, giving the same data as baking the
+     * edited mesh again. Only the displacement scales of the edited micro-vertices, the hierarchy records that hold them
+     * (see Mesh::updateTriangleHierarchy), and the AABBs and tangential displacements of their base triangles change.
+     *
+     * @param mesh the edited mesh, which this was baked from
+     * @param edits the edits since then, see Mesh::dirtyMicroVertices
+     * @param hierarchies the hierarchies of the base triangles, computed when a base triangle is edited for the first time
+     */
+    BakedMeshUpdate applyEdits(const Mesh& mesh, std::span<const DisplacementEdit> edits, TriangleHierarchies& hierarchies);
+
+    /**
+     * Updates the baked data after base vertices moved (see Mesh::moveVertices), giving the same data as baking the
+     * moved mesh again up to float rounding. The displacement scales do not change, but the vertices, AABBs, tangential
+     * displacements and hierarchy records of the triangles around the moved vertices are recomputed, in parallel.
+     *
+     * @param mesh the moved mesh, which this was baked from
+     * @param triangles the triangles that use a moved vertex, as returned by Mesh::moveVertices
+     * @param threadCount the number of threads, including the calling thread. 0 uses every hardware thread.
+     */
+    BakedMeshUpdate applyMotion(const Mesh& mesh, std::span<const unsigned int> triangles, unsigned int threadCount = 0);
+
+    /**
+     * Replaces the min-max displacements and deltas by 8-bit fractions, see QuantizedBounds, for the CPU traversal
+     * only. The traversal decodes the bounds of every hierarchy triangle from those of its parent, so it culls a little
+     * less but finds the same hits. Meshes with a quantized hierarchy can not be edited or paged.
+     */
+    void quantizeHierarchy();
+    [[nodiscard]] bool hasQuantizedHierarchy() const {
+        return !hierarchyRanges.empty();
+    }
+
+    /**
+     * Makes the hierarchy sparse, for the CPU traversal only: hierarchy triangles whose micro-vertices all lie within
+     * a tolerance of the triangle through their displaced corners become flat leaves. The records of their descendants
+     * are left out, and the traversal intersects the triangle through the corners instead of descending further, like
+     * it does for level of detail. Only for meshes that were baked with bake, and not together with quantizeHierarchy.
+     * Meshes with a sparse hierarchy can not be edited or paged.
+     *
+     * @param tolerance how far a micro-vertex may be from the flat triangle, as a fraction of the longest edge of its
+     * base triangle. At 0 only exactly flat subtrees (up to float rounding) are collapsed, such as those with a constant
+     * displacement.
+     * @return the number of flat leaves
+     */
+    size_t collapseFlatSubtrees(float tolerance);
+    [[nodiscard]] bool hasSparseHierarchy() const {
+        return !interiorOffsets.empty();
+    }
+
+    //The number of min-max displacements (and deltas) of a base triangle: one per hierarchy triangle above its micro-triangles
+    [[nodiscard]] static size_t hierarchyRecordCount(const TriangleData& td);
+
+    //Same as getDisplacementScale(...) in intersection.hlsl. Only for meshes in memory, the traversal goes through block(...)
+    // @param td: the triangle
+    // @param coords: triangular grid coordinates of the micro-vertex
+    // @return the scale by how much to displace the micro-vertex along its (interpolated) direction. -1 if the micro-vertex is not present
+    [[nodiscard]] float displacementScale(const TriangleData& td, const glm::uvec2& coords) const {
+        return displacementScales[scaleIndex(td, coords)];
+    }
+
+    //Where the displacement scale of a micro-vertex is in displacementScales
+    [[nodiscard]] size_t scaleIndex(const TriangleData& td, const glm::uvec2& coords) const {
+        const unsigned int index = (coords.x * (coords.x + 1)) / 2 + coords.y;
+        if(vertexOrder == VertexOrder::BIRD_CURVE) return static_cast<size_t>(td.displacementOffset) + VertexOrdering::birdCurve(td.subDivisionLevel)[index];
+
+        return static_cast<size_t>(td.displacementOffset) + index;
+    }
+
+    //The displacement scales, min-max displacements and deltas of a base triangle, from memory or from the pages
+    [[nodiscard]] TriangleBlock block(unsigned int primitiveIndex) const {
+        if(pages) return pagedBlock(primitiveIndex);
+
+        const TriangleData& td = triangleData[primitiveIndex];
+        if(hasQuantizedHierarchy()) {
+            return {displacementScales.data() + td.displacementOffset, order(td), nullptr, nullptr, quantizedBounds.data() + td.minMaxOffset, &hierarchyRanges[primitiveIndex], nullptr, nullptr};
+        }
+
+        const InteriorWord* interior = hasSparseHierarchy() ? interiorWords.data() + interiorOffsets[primitiveIndex] : nullptr;
+        return {displacementScales.data() + td.displacementOffset, order(td), minMaxDisplacements.data() + td.minMaxOffset, deltas.data() + td.minMaxOffset, nullptr, nullptr, interior, nullptr};
+    }
+
+    //Creates the plane of a base triangle, in the same way as the intersection shader does
+    [[nodiscard]] TBNPlane::Plane plane(const TriangleData& td) const;
+
+    //Computes the displaced 3D position of a micro-vertex
+    // @param td: the triangle
+    // @param coords: triangular grid coordinates of the micro-vertex
+    [[nodiscard]] glm::vec3 microVertexPosition(const TriangleData& td, const glm::uvec2& coords) const;
+
+    [[nodiscard]] size_t sizeInBytes() const;
+
+private:
+    [[nodiscard]] TriangleBlock pagedBlock(unsigned int primitiveIndex) const;
+
+    [[nodiscard]] const std::uint32_t* order(const TriangleData& td) const {
+        return vertexOrder == VertexOrder::BIRD_CURVE ? VertexOrdering::birdCurve(td.subDivisionLevel).data() : nullptr;
+    }
+};
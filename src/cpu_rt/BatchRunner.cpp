@@ -0,0 +1,215 @@
+#include "BatchRunner.h"
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/gtc/constants.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "CameraPath.h"
+#include "ShardedBake.h"
+
+using Clock = std::chrono::steady_clock;
+
+BatchRunner::BatchRunner(JobFile jobFile, MeshLoader meshLoader, const unsigned int threadCount):
+    jobFile(std::move(jobFile)), meshLoader(std::move(meshLoader)), threadCount(threadCount > 0 ? threadCount : this->jobFile.threadCount) {
+    if(!this->meshLoader) throw std::invalid_argument("A batch runner needs a mesh loader");
+
+    const size_t meshCount = this->jobFile.meshes.size();
+    const size_t sceneCount = this->jobFile.scenes.size();
+    bakedMeshes.resize(meshCount);
+    meshScenes.resize(meshCount);
+    scenes.resize(sceneCount);
+    lastBake.assign(meshCount, 0);
+    lastMeshJob.assign(meshCount, 0);
+    lastSceneJob.assign(sceneCount, 0);
+
+    //A mesh or scene is built by the first job that renders it, which needs the baked meshes until then
+    std::vector<bool> meshRendered(meshCount, false), sceneRendered(sceneCount, false);
+    for(size_t job = 0; job < this->jobFile.jobs.size(); job++) {
+        const JobFile::Job& entry = this->jobFile.jobs[job];
+        if(entry.mesh) {
+            if(!meshRendered[*entry.mesh]) lastBake[*entry.mesh] = job;
+            meshRendered[*entry.mesh] = true;
+            lastMeshJob[*entry.mesh] = job;
+        } else {
+            if(!sceneRendered[*entry.scene]) {
+                for(const JobFile::SceneEntry::Instance& instance : this->jobFile.scenes[*entry.scene].instances) lastBake[instance.mesh] = job;
+            }
+            sceneRendered[*entry.scene] = true;
+            lastSceneJob[*entry.scene] = job;
+        }
+    }
+}
+
+const JobFile& BatchRunner::getJobFile() const {
+    return jobFile;
+}
+
+size_t BatchRunner::jobCount() const {
+    return jobFile.jobs.size();
+}
+
+BakedMesh BatchRunner::takeBakedMesh(const unsigned int mesh, const size_t job, JobResult& result) {
+    if(!bakedMeshes[mesh]) {
+        const JobFile::MeshEntry& entry = jobFile.meshes[mesh];
+        const auto loadStart = Clock::now();
+        const Mesh loaded = meshLoader(entry.file);
+        const auto bakeStart = Clock::now();
+        bakedMeshes[mesh] = ShardedBake::bake(loaded, entry.order, threadCount);
+        result.loadSeconds += std::chrono::duration<double>(bakeStart - loadStart).count();
+        result.bakedMeshes++;
+    }
+
+    if(lastBake[mesh] > job) return *bakedMeshes[mesh];
+
+    BakedMesh baked = std::move(*bakedMeshes[mesh]);
+    bakedMeshes[mesh].reset();
+    return baked;
+}
+
+RayTracedScene& BatchRunner::sceneOf(const size_t job, JobResult& result) {
+    const JobFile::Job& entry = jobFile.jobs[job];
+    const auto start = Clock::now();
+
+    if(entry.mesh) {
+        std::unique_ptr<CPUScene>& scene = meshScenes[*entry.mesh];
+        if(!scene) {
+            scene = std::make_unique<CPUScene>(takeBakedMesh(*entry.mesh, job, result));
+            result.bakeSeconds = std::chrono::duration<double>(Clock::now() - start).count() - result.loadSeconds;
+        }
+        return *scene;
+    }
+
+    std::unique_ptr<InstancedScene>& scene = scenes[*entry.scene];
+    if(!scene) {
+        //Every mesh of the scene once, in the order the instances first use them
+        const JobFile::SceneEntry& sceneEntry = jobFile.scenes[*entry.scene];
+        std::vector<unsigned int> localIndex(jobFile.meshes.size(), ~0u);
+        std::vector<CPUScene> meshes;
+        std::vector<InstancedScene::Instance> instances;
+        for(const JobFile::SceneEntry::Instance& instance : sceneEntry.instances) {
+            if(localIndex[instance.mesh] == ~0u) {
+                localIndex[instance.mesh] = static_cast<unsigned int>(meshes.size());
+                meshes.emplace_back(takeBakedMesh(instance.mesh, job, result));
+            }
+            instances.push_back({localIndex[instance.mesh], instance.transform});
+        }
+
+        scene = std::make_unique<InstancedScene>(std::move(meshes), std::move(instances));
+        result.bakeSeconds = std::chrono::duration<double>(Clock::now() - start).count() - result.loadSeconds;
+    }
+    return *scene;
+}
+
+FrameStats BatchRunner::renderSupersampled(const CPURenderer& renderer, const glm::mat4& invViewProj, const glm::uvec2& resolution, const unsigned int samples,
+                                           std::vector<glm::vec3>& pixels) {
+    const auto grid = static_cast<unsigned int>(std::lround(std::sqrt(static_cast<double>(samples))));
+    if(grid * grid != samples || samples == 0) throw std::invalid_argument("The number of samples per pixel must be a square number");
+    if(grid == 1) return renderer.render(invViewProj, resolution, pixels);
+
+    const auto start = Clock::now();
+    const glm::uvec2 fineResolution = resolution * grid;
+    pixels.assign(static_cast<size_t>(resolution.x) * resolution.y, glm::vec3(0.0f));
+
+    FrameStats frameStats;
+    std::vector<glm::vec3> strip;
+    const float weight = 1.0f / static_cast<float>(samples);
+    for(unsigned int yBegin = 0; yBegin < resolution.y; yBegin += STRIP_ROWS) {
+        const unsigned int yEnd = std::min(yBegin + STRIP_ROWS, resolution.y);
+        const FrameStats stripStats = renderer.render(invViewProj, fineResolution, {{0, yBegin * grid}, {fineResolution.x, yEnd * grid}}, strip);
+        frameStats.traversal += stripStats.traversal;
+        frameStats.stolenTiles += stripStats.stolenTiles;
+
+        for(unsigned int y = yBegin; y < yEnd; y++) {
+            for(unsigned int x = 0; x < resolution.x; x++) {
+                glm::vec3 sum(0.0f);
+                for(unsigned int sy = 0; sy < grid; sy++) {
+                    const size_t row = static_cast<size_t>((y - yBegin) * grid + sy) * fineResolution.x;
+                    for(unsigned int sx = 0; sx < grid; sx++) sum += strip[row + x * grid + sx];
+                }
+                pixels[static_cast<size_t>(y) * resolution.x + x] = sum * weight;
+            }
+        }
+    }
+    frameStats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    return frameStats;
+}
+
+BatchRunner::JobResult BatchRunner::run(const size_t job) {
+    if(job >= jobFile.jobs.size()) throw std::out_of_range("There is no job " + std::to_string(job));
+    const JobFile::Job& entry = jobFile.jobs[job];
+    const RenderSettings settings = entry.settings.orDefaults(jobFile.defaults);
+
+    JobResult result;
+    result.name = entry.name;
+    RayTracedScene& scene = sceneOf(job, result);
+
+    const CPUScene::TraversalMode traversal = settings.traversal.value_or(CPUScene::TraversalMode::AUTOMATIC);
+    if(entry.mesh && meshScenes[*entry.mesh]->getTraversalMode() != traversal) meshScenes[*entry.mesh]->setTraversalMode(traversal);
+    if(entry.scene && scenes[*entry.scene]->getScenes().front().getTraversalMode() != traversal) scenes[*entry.scene]->setTraversalMode(traversal);
+
+    //The resolution and field of view of the job win over those of its camera path, which win over the defaults of the file
+    CameraPath path;
+    if(!entry.cameraPath.empty()) path = CameraPath::load(entry.cameraPath);
+    const RenderSettings& view = entry.cameraPath.empty() ? settings : entry.settings;
+    if(view.resolution) path.resolution = *view.resolution;
+    if(view.fovy) path.fovy = *view.fovy;
+
+    std::vector<CameraKeyframe> cameras;
+    if(!entry.cameraPath.empty()) {
+        for(int frame = 0; frame < path.frameCount(); frame++) cameras.push_back(path.sample(path.frameTime(frame)));
+    } else if(!entry.cameras.empty()) {
+        cameras = entry.cameras;
+        for(size_t frame = 0; frame < cameras.size(); frame++) cameras[frame].time = static_cast<float>(frame) / path.framesPerSecond;
+    } else {
+        const AABB bounds = scene.bounds();
+        for(int frame = 0; frame < entry.turntableFrames; frame++) {
+            const float angle = glm::two_pi<float>() * static_cast<float>(frame) / static_cast<float>(entry.turntableFrames);
+            cameras.push_back(path.frameBounds(bounds, angle, static_cast<float>(frame) / path.framesPerSecond));
+        }
+    }
+
+    CPURenderer renderer(scene, threadCount);
+    renderer.setPacketTraversal(settings.packets.value_or(false));
+    renderer.setLevelOfDetail(settings.lodPixels.value_or(0.0f));
+    result.resolution = path.resolution;
+    result.samples = settings.samples.value_or(1);
+    result.threadCount = renderer.getThreadCount();
+
+    if(!entry.output.empty() && entry.output.has_parent_path()) std::filesystem::create_directories(entry.output.parent_path());
+
+    const glm::mat4 projection = path.projectionMatrix();
+    std::vector<glm::vec3> pixels;
+    for(size_t frame = 0; frame < cameras.size(); frame++) {
+        FrameResult& frameResult = result.frames.emplace_back();
+        frameResult.time = cameras[frame].time;
+        frameResult.stats = renderSupersampled(renderer, glm::inverse(projection * CameraPath::viewMatrix(cameras[frame])), path.resolution, result.samples, pixels);
+
+        if(!entry.output.empty()) {
+            //Inserts the frame number before the extension, so out.png becomes out_0007.png, like --render does
+            frameResult.image = entry.output;
+            if(cameras.size() > 1) {
+                std::string number = std::to_string(frame);
+                number.insert(0, number.size() < 4 ? 4 - number.size() : 0, '0');
+                frameResult.image.replace_filename(entry.output.stem().string() + '_' + number + entry.output.extension().string());
+            }
+            CPURenderer::writeImage(pixels, path.resolution, frameResult.image);
+        }
+
+        result.total.seconds += frameResult.stats.seconds;
+        result.total.traversal += frameResult.stats.traversal;
+        result.total.stolenTiles += frameResult.stats.stolenTiles;
+    }
+
+    //Release what no later job renders
+    if(entry.mesh && lastMeshJob[*entry.mesh] <= job) meshScenes[*entry.mesh].reset();
+    if(entry.scene && lastSceneJob[*entry.scene] <= job) scenes[*entry.scene].reset();
+
+    return result;
+}
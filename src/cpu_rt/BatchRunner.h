@@ -0,0 +1,104 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <framework/mesh.h>
+
+#include "BakedMesh.h"
+#include "CPURenderer.h"
+#include "InstancedScene.h"
+#include "JobFile.h"
+
+/**
+ * Runs the jobs of a JobFile on the CPU renderer, in one process that parses the file once.
+ *
+ * Every mesh is loaded and baked once, the first time a job needs it, and every mesh or scene of instanced meshes is
+ * built once and rendered by all jobs that name it: a job that renders the same scene with another traversal mode only
+ * changes the traversal of its base triangles (see CPUScene::setTraversalMode), and one that changes the camera,
+ * resolution, samples, packets or level of detail only changes the renderer. A scene is released after the last job
+ * that renders it, and a baked mesh once every scene that needs it was built, so the memory of the batch does not grow
+ * with the number of jobs. Since an InstancedScene owns its meshes, a mesh that is rendered on its own and in scenes
+ * is copied for every one of them, but baked once.
+ *
+ * More than one sample per pixel renders the frame at a resolution that is sqrt(samples) times higher in both axes,
+ * which puts the rays on a regular grid in every pixel, and averages them. The frame is rendered in strips, so the
+ * samples of a whole frame are never in memory at once. The level of detail then follows the footprint of a sample.
+ */
+class BatchRunner {
+public:
+    using MeshLoader = std::function<Mesh(const std::filesystem::path& file)>;
+
+    //Output rows of a frame with more than one sample per pixel that are rendered at once
+    static constexpr unsigned int STRIP_ROWS = 64;
+
+    struct FrameResult {
+        float time; //Of the camera, in seconds
+        std::filesystem::path image; //Empty if the job has no output
+        FrameStats stats;
+    };
+
+    struct JobResult {
+        std::string name;
+        double loadSeconds = 0.0; //Loading the meshes that no job loaded before, 0 if they were all reused
+        double bakeSeconds = 0.0; //Baking them and building the scene, 0 if it was reused
+        size_t bakedMeshes = 0; //Meshes that this job baked
+        glm::uvec2 resolution{0, 0};
+        unsigned int samples = 1;
+        unsigned int threadCount = 0;
+        std::vector<FrameResult> frames;
+        FrameStats total;
+    };
+
+    /**
+     * @param jobFile the jobs
+     * @param meshLoader loads the micro-mesh of a file, for example TinyGLTFLoader::loadMesh
+     * @param threadCount the number of threads to bake and render with, overrides that of the job file if not 0
+     */
+    BatchRunner(JobFile jobFile, MeshLoader meshLoader, unsigned int threadCount = 0);
+
+    [[nodiscard]] const JobFile& getJobFile() const;
+    [[nodiscard]] size_t jobCount() const;
+
+    /**
+     * Runs a job: builds its scene unless an earlier job did, renders its frames and writes them to its output. The
+     * jobs are meant to run in the order of the file; a job that runs after the scene of an earlier one was released
+     * builds it again.
+     */
+    JobResult run(size_t job);
+
+    /**
+     * Renders a frame with `samples` rays per pixel on a regular grid, see BatchRunner.
+     *
+     * @param samples a square number
+     * @param pixels the averaged colors, row by row starting at the top
+     */
+    static FrameStats renderSupersampled(const CPURenderer& renderer, const glm::mat4& invViewProj, const glm::uvec2& resolution, unsigned int samples,
+                                         std::vector<glm::vec3>& pixels);
+
+private:
+    JobFile jobFile;
+    MeshLoader meshLoader;
+    unsigned int threadCount;
+
+    std::vector<std::optional<BakedMesh>> bakedMeshes; //Per mesh of the file, until every scene that needs it was built
+    std::vector<std::unique_ptr<CPUScene>> meshScenes; //Per mesh of the file, while jobs render it on its own
+    std::vector<std::unique_ptr<InstancedScene>> scenes; //Per scene of the file, while jobs render it
+    std::vector<size_t> lastBake; //Per mesh, the first job of the last scene that needs the baked mesh
+    std::vector<size_t> lastMeshJob; //Per mesh, the last job that renders it on its own
+    std::vector<size_t> lastSceneJob; //Per scene, the last job that renders it
+
+    //The baked mesh, moved out of the cache if no later scene needs it. Loads and bakes it if no job did before.
+    BakedMesh takeBakedMesh(unsigned int mesh, size_t job, JobResult& result);
+    //The scene of a job, built if it is not there
+    RayTracedScene& sceneOf(size_t job, JobResult& result);
+};
@@ -0,0 +1,1527 @@
+#include "Benchmarks.h"
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/gtc/matrix_transform.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <framework/TransformationChannel.h>
+
+#include "AABBBuilder.h"
+#include "CPURenderer.h"
+#include "EdgeKernels.h"
+#include "InstancedScene.h"
+#include "MicroMeshTraversal.h"
+#include "PagedBlocks.h"
+#include "RayQuery.h"
+#include "Shading.h"
+#include "ShardedBake.h"
+#include "Skinning.h"
+#include "VertexOrder.h"
+
+//The grid triangles of a level below a grid triangle, see VertexOrdering::GridTriangle
+static void collectGridTriangles(const VertexOrdering::GridTriangle& t, const int levels, std::vector<VertexOrdering::GridTriangle>& triangles) {
+    if(levels == 0) {
+        triangles.push_back(t);
+        return;
+    }
+
+    for(const VertexOrdering::GridTriangle& child : t.children()) collectGridTriangles(child, levels - 1, triangles);
+}
+
+//The number of distinct cache lines that hold the displacement scales of the micro-vertices of a grid triangle,
+//if the scales of its base triangle start on a cache line
+static size_t cacheLines(const VertexOrdering::GridTriangle& t, const std::vector<std::uint32_t>* order, std::vector<size_t>& lines) {
+    constexpr size_t CACHE_LINE = 64;
+
+    lines.clear();
+    for(unsigned int dx = 0; dx <= t.size; dx++) {
+        const unsigned int firstY = t.upright ? 0 : dx;
+        const unsigned int lastY = t.upright ? dx : t.size;
+        for(unsigned int dy = firstY; dy <= lastY; dy++) {
+            const unsigned int x = t.corner.x + dx, y = t.corner.y + dy;
+            const unsigned int index = (x * (x + 1)) / 2 + y;
+            lines.push_back((order ? (*order)[index] : index) * sizeof(float) / CACHE_LINE);
+        }
+    }
+
+    std::ranges::sort(lines);
+    return static_cast<size_t>(std::ranges::unique(lines).begin() - lines.begin());
+}
+
+/**
+ * Transforms of copies of a mesh on a grid of copiesPerSide x copiesPerSide, scaled down to fit the bounds of the mesh
+ * together. The grid spans the two axes along which the bounds are largest.
+ */
+static std::vector<glm::mat4> gridTransforms(const AABB& bounds, const int copiesPerSide) {
+    const glm::vec3 extent = bounds.maxPos - bounds.minPos;
+    const int flatAxis = extent.x <= extent.y && extent.x <= extent.z ? 0 : (extent.y <= extent.z ? 1 : 2);
+    const float scale = 1.0f / static_cast<float>(copiesPerSide);
+
+    std::vector<glm::mat4> transforms;
+    for(int i = 0; i < copiesPerSide; i++) {
+        for(int j = 0; j < copiesPerSide; j++) {
+            glm::vec3 cell = bounds.centroid();
+            const int firstAxis = (flatAxis + 1) % 3, secondAxis = (flatAxis + 2) % 3;
+            cell[firstAxis] = bounds.minPos[firstAxis] + (static_cast<float>(i) + 0.5f) * extent[firstAxis] * scale;
+            cell[secondAxis] = bounds.minPos[secondAxis] + (static_cast<float>(j) + 0.5f) * extent[secondAxis] * scale;
+
+            transforms.push_back(glm::translate(glm::mat4(1.0f), cell) * glm::scale(glm::mat4(1.0f), glm::vec3(scale)) * glm::translate(glm::mat4(1.0f), -bounds.centroid()));
+        }
+    }
+
+    return transforms;
+}
+
+//One mesh with a transformed copy of a mesh per transform, which is what instancing saves
+static Mesh flattenCopies(const Mesh& mesh, const std::vector<glm::mat4>& transforms) {
+    Mesh flat;
+    for(const glm::mat4& transform : transforms) {
+        const glm::mat3 linear(transform);
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+        const auto firstVertex = static_cast<unsigned int>(flat.vertices.size());
+
+        for(const Vertex& v : mesh.vertices) flat.vertices.push_back({glm::vec3(transform * glm::vec4(v.position, 1.0f)), glm::normalize(normalMatrix * v.normal), linear * v.direction});
+        for(Triangle t : mesh.triangles) {
+            t.baseVertexIndices += firstVertex;
+            for(uVertex& uv : t.uVertices) {
+                uv.position = glm::vec3(transform * glm::vec4(uv.position, 1.0f));
+                uv.displacement = linear * uv.displacement;
+            }
+            flat.triangles.push_back(std::move(t));
+        }
+    }
+
+    return flat;
+}
+
+/**
+ * The vertices of a mesh twisted around the longest axis of its bounds and pulled along it, like a skinned limb: every
+ * vertex is rotated by an angle that grows along the axis, and its direction and normal with it, then moved along the
+ * axis by a fraction of the extent. weights scales both per vertex.
+ */
+static std::vector<Vertex> twistVertices(const std::vector<Vertex>& rest, const std::vector<unsigned int>& indices, const std::vector<float>& weights, const AABB& bounds,
+                                         const float maxAngle, const float pull) {
+    const glm::vec3 extent = bounds.maxPos - bounds.minPos;
+    const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    glm::vec3 axisDirection(0.0f);
+    axisDirection[axis] = 1.0f;
+
+    std::vector<Vertex> twisted;
+    twisted.reserve(indices.size());
+    for(size_t i = 0; i < indices.size(); i++) {
+        const Vertex& v = rest[indices[i]];
+        const float along = extent[axis] > 0.0f ? (v.position[axis] - bounds.minPos[axis]) / extent[axis] : 0.0f;
+        const glm::mat3 rotation(glm::rotate(glm::mat4(1.0f), maxAngle * weights[i] * along, axisDirection));
+
+        const glm::vec3 position = bounds.centroid() + rotation * (v.position - bounds.centroid()) + pull * weights[i] * extent[axis] * axisDirection;
+        twisted.push_back({position, rotation * v.normal, rotation * v.direction});
+    }
+
+    return twisted;
+}
+
+//How TransformationChannel used to sample: keyframes in a map, found with a lookup and a pair of binary searches, and the
+//interpolation mode compared as a string every time. Kept to measure against.
+struct MapChannel {
+    std::map<float, glm::vec3> transformations;
+    std::string interpolationMode;
+
+    glm::vec3 getTransformation(const float animTime) {
+        if(transformations.contains(animTime)) return transformations[animTime];
+
+        const auto before = *std::prev(transformations.lower_bound(animTime));
+        const auto after = *transformations.upper_bound(animTime);
+        if(interpolationMode == "STEP") return before.second;
+        if(interpolationMode == "LINEAR") return interpolate(before.second, after.second, (animTime - before.first) / (after.first - before.first));
+
+        throw std::invalid_argument("Unsupported interpolation mode " + interpolationMode);
+    }
+};
+
+//Results of benchmarked code are written here, so that the compiler can not optimize the code away
+static volatile float sink;
+
+//Bitwise comparison, so that differences in the sign of zero or in NaNs are caught as well
+static bool sameBits(const float a, const float b) {
+    return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+//Rays of a query, stored as RayArrays wants them
+struct QueryRays {
+    std::vector<float> originX, originY, originZ, directionX, directionY, directionZ, tMin, tMax;
+
+    void push(const RayDesc& ray) {
+        originX.push_back(ray.origin.x);
+        originY.push_back(ray.origin.y);
+        originZ.push_back(ray.origin.z);
+        directionX.push_back(ray.direction.x);
+        directionY.push_back(ray.direction.y);
+        directionZ.push_back(ray.direction.z);
+        tMin.push_back(ray.tMin);
+        tMax.push_back(ray.tMax);
+    }
+
+    [[nodiscard]] size_t size() const {
+        return originX.size();
+    }
+
+    [[nodiscard]] RayArrays arrays() const {
+        return {size(), originX.data(), originY.data(), originZ.data(), directionX.data(), directionY.data(), directionZ.data(), tMin.data(), tMax.data()};
+    }
+};
+
+//Hits of a query, stored as HitArrays wants them
+struct QueryHits {
+    std::vector<float> t, u, v;
+    std::vector<uint32_t> baseTriangle, microTriangle;
+
+    explicit QueryHits(const size_t count): t(count), u(count), v(count), baseTriangle(count), microTriangle(count) {}
+
+    [[nodiscard]] HitArrays arrays() {
+        return {t.data(), baseTriangle.data(), microTriangle.data(), u.data(), v.data(), nullptr};
+    }
+};
+
+namespace Benchmarks {
+    int edgeKernels() {
+        constexpr size_t CASES = size_t(1) << 16;
+        constexpr int REPETITIONS = 64;
+
+        struct Case {
+            EdgeKernels::ChildTriangles triangles;
+            float deltas[EdgeKernels::CHILDREN];
+            glm::vec2 origin, direction;
+        };
+
+        //Subdivided triangles like the traversal produces, plus rays that start both inside and outside of them
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> delta(0.0f, 0.1f);
+        std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+        std::vector<Case> cases(CASES);
+        for(Case& c : cases) {
+            const glm::vec2 v0(position(rng), position(rng)), v1(position(rng), position(rng)), v2(position(rng), position(rng));
+            const glm::vec2 uv0 = 0.5f * (v0 + v1), uv1 = 0.5f * (v1 + v2), uv2 = 0.5f * (v2 + v0);
+            const glm::vec2 children[4][3] = {{v0, uv0, uv2}, {uv0, v1, uv1}, {uv2, uv1, v2}, {uv0, uv1, uv2}};
+
+            for(int child = 0; child < EdgeKernels::CHILDREN; child++) {
+                for(int vertex = 0; vertex < 3; vertex++) c.triangles.set(child, vertex, children[child][vertex]);
+                c.deltas[child] = delta(rng);
+            }
+
+            c.origin = 2.0f * glm::vec2(position(rng), position(rng));
+            const float a = angle(rng);
+            c.direction = glm::vec2(std::cos(a), std::sin(a));
+        }
+
+        using Intersect = EdgeKernels::ChildHits (*)(const EdgeKernels::ChildTriangles&, const glm::vec2&, const glm::vec2&, unsigned int);
+        using Expand = void (*)(EdgeKernels::ChildTriangles&, const float (&)[EdgeKernels::CHILDREN]);
+
+        std::vector<std::pair<std::string, Intersect>> intersectKernels{{"scalar", &EdgeKernels::intersectChildrenScalar}};
+        std::vector<std::pair<std::string, Expand>> expandKernels{{"scalar", &EdgeKernels::expandChildrenScalar}};
+#if defined(EDGE_KERNELS_SSE)
+        intersectKernels.emplace_back("SSE2", &EdgeKernels::intersectChildrenSSE);
+        expandKernels.emplace_back("SSE2", &EdgeKernels::expandChildrenSSE);
+#endif
+#if defined(EDGE_KERNELS_AVX2)
+        intersectKernels.emplace_back("AVX2", &EdgeKernels::intersectChildrenAVX2);
+#endif
+#if defined(EDGE_KERNELS_NEON)
+        intersectKernels.emplace_back("NEON", &EdgeKernels::intersectChildrenNEON);
+        expandKernels.emplace_back("NEON", &EdgeKernels::expandChildrenNEON);
+#endif
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "# " << CASES << " random cases, the traversal uses " << EdgeKernels::instructionSet() << std::endl;
+        std::cout << "kernel,implementation,ns_per_call,speedup" << std::endl;
+
+        //The intersection is timed on expanded triangles, like the traversal tests them
+        std::vector<EdgeKernels::ChildTriangles> expandedTriangles(CASES);
+        for(size_t i = 0; i < CASES; i++) {
+            expandedTriangles[i] = cases[i].triangles;
+            EdgeKernels::expandChildrenScalar(expandedTriangles[i], cases[i].deltas);
+        }
+
+        double scalarNs = 0.0;
+        for(const auto& [name, expand] : expandKernels) {
+            float checksum = 0.0f;
+            const auto start = std::chrono::steady_clock::now();
+            for(int r = 0; r < REPETITIONS; r++) {
+                for(const Case& c : cases) {
+                    EdgeKernels::ChildTriangles expanded = c.triangles;
+                    expand(expanded, c.deltas);
+                    checksum += expanded.x[0][r % EdgeKernels::CHILDREN];
+                }
+            }
+            const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (static_cast<double>(CASES) * REPETITIONS);
+            if(name == "scalar") scalarNs = ns;
+
+            std::cout << "expand," << name << ',' << ns << ',' << scalarNs / ns << std::endl;
+            sink = checksum;
+        }
+
+        for(const auto& [name, intersect] : intersectKernels) {
+            unsigned int hitCount = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for(int r = 0; r < REPETITIONS; r++) {
+                for(size_t i = 0; i < CASES; i++) hitCount += intersect(expandedTriangles[i], cases[i].origin, cases[i].direction, 0xF).mask;
+            }
+            const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (static_cast<double>(CASES) * REPETITIONS);
+            if(name == "scalar") scalarNs = ns;
+
+            std::cout << "intersect," << name << ',' << ns << ',' << scalarNs / ns << std::endl;
+            sink = static_cast<float>(hitCount);
+        }
+
+        return 0;
+    }
+
+    int transformationChannels() {
+        constexpr size_t CHANNELS = 4096;
+        constexpr size_t KEYFRAMES = 32;
+        constexpr size_t FRAMES = 600;
+        constexpr float DURATION = 10.0f;
+
+        //Keyframes at random times, with the first and last at the start and end, so every frame lies between two of them
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<MapChannel> mapChannels(CHANNELS);
+        std::vector<TransformationChannel<glm::vec3>> channels(CHANNELS);
+        for(size_t c = 0; c < CHANNELS; c++) {
+            std::vector<float> times{0.0f, DURATION};
+            for(size_t k = 2; k < KEYFRAMES; k++) times.push_back(DURATION * unit(rng));
+            std::vector<glm::vec3> values(KEYFRAMES);
+            for(glm::vec3& v : values) v = {unit(rng), unit(rng), unit(rng)};
+
+            const std::string mode = c % 4 == 0 ? "STEP" : "LINEAR";
+            for(size_t k = 0; k < KEYFRAMES; k++) mapChannels[c].transformations[times[k]] = values[k];
+            mapChannels[c].interpolationMode = mode;
+            channels[c].addTransformations(times, values);
+            channels[c].setInterpolationMode(mode);
+        }
+
+        TransformationChannels<glm::vec3> batch;
+        for(const auto& channel : channels) batch.addChannel(channel);
+
+        std::vector<float> frameTimes(FRAMES);
+        for(size_t f = 0; f < FRAMES; f++) frameTimes[f] = DURATION * static_cast<float>(f) / static_cast<float>(FRAMES);
+
+        //The same keyframes and formulas, so every implementation must give bit-identical results to the map
+        std::vector<glm::vec3> reference(CHANNELS * FRAMES);
+        const auto start = std::chrono::steady_clock::now();
+        for(size_t f = 0; f < FRAMES; f++) {
+            for(size_t c = 0; c < CHANNELS; c++) reference[f * CHANNELS + c] = mapChannels[c].getTransformation(frameTimes[f]);
+        }
+        const double mapNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (static_cast<double>(CHANNELS) * FRAMES);
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "# " << CHANNELS << " channels of " << KEYFRAMES << " keyframes, played forwards in " << FRAMES << " frames" << std::endl;
+        std::cout << "implementation,mismatches,ns_per_sample,speedup" << std::endl;
+        std::cout << "map," << 0 << ',' << mapNs << ',' << 1.0 << std::endl;
+
+        bool allAgree = true;
+        const auto measure = [&](const std::string& name, const auto& sampleFrame) {
+            std::vector<glm::vec3> results(CHANNELS);
+            int mismatches = 0;
+
+            double seconds = 0.0;
+            for(size_t f = 0; f < FRAMES; f++) {
+                const auto frameStart = std::chrono::steady_clock::now();
+                sampleFrame(frameTimes[f], results);
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+
+                for(size_t c = 0; c < CHANNELS; c++) {
+                    const glm::vec3& expected = reference[f * CHANNELS + c];
+                    mismatches += !sameBits(results[c].x, expected.x) || !sameBits(results[c].y, expected.y) || !sameBits(results[c].z, expected.z);
+                }
+            }
+
+            const double ns = seconds * 1e9 / (static_cast<double>(CHANNELS) * FRAMES);
+            allAgree &= mismatches == 0;
+            std::cout << name << ',' << mismatches << ',' << ns << ',' << mapNs / ns << std::endl;
+            sink = results.front().x;
+        };
+
+        measure("binary_search", [&](const float time, std::vector<glm::vec3>& results) {
+            for(size_t c = 0; c < CHANNELS; c++) {
+                TransformationChannel<glm::vec3>::Cursor fresh;
+                results[c] = channels[c].sample(time, fresh);
+            }
+        });
+        measure("cursor", [&](const float time, std::vector<glm::vec3>& results) {
+            for(size_t c = 0; c < CHANNELS; c++) results[c] = channels[c].getTransformation(time);
+        });
+        measure("batch", [&](const float time, std::vector<glm::vec3>& results) {
+            batch.sample(time, results);
+        });
+
+        //A Hermite spline through the values and derivatives of a cubic polynomial is that polynomial
+        const auto polynomial = [](const float t) { return glm::vec3(t * t * t - 4.0f * t * t + t, 0.5f * t * t - 2.0f, -t * t * t + 3.0f * t); };
+        const auto derivative = [](const float t) { return glm::vec3(3.0f * t * t - 8.0f * t + 1.0f, t, -3.0f * t * t + 3.0f); };
+        TransformationChannel<glm::vec3> spline;
+        std::vector<float> splineTimes;
+        std::vector<glm::vec3> tangentsAndValues;
+        for(size_t k = 0; k < KEYFRAMES; k++) {
+            const float t = 4.0f * static_cast<float>(k) / static_cast<float>(KEYFRAMES - 1);
+            splineTimes.push_back(t);
+            tangentsAndValues.insert(tangentsAndValues.end(), {derivative(t), polynomial(t), derivative(t)});
+        }
+        spline.addCubicSplineTransformations(splineTimes, tangentsAndValues);
+        spline.setInterpolationMode(InterpolationMode::CUBICSPLINE);
+
+        float maxError = 0.0f;
+        for(size_t f = 0; f < FRAMES; f++) {
+            const float t = 4.0f * static_cast<float>(f) / static_cast<float>(FRAMES);
+            const glm::vec3 expected = polynomial(t);
+            maxError = std::max(maxError, glm::length(spline.getTransformation(t) - expected) / std::max(1.0f, glm::length(expected)));
+        }
+        const bool splineAgrees = maxError < 1e-4f;
+        std::cout << "# cubic spline: relative error " << std::scientific << maxError << (splineAgrees ? "" : " (too large)") << std::endl;
+
+        return allAgree && splineAgrees ? 0 : 1;
+    }
+
+    int skinning(const unsigned int threadCount) {
+        constexpr size_t VERTICES = size_t(1) << 20;
+        constexpr int JOINTS = 64;
+        constexpr int FRAMES = 16;
+        constexpr float SEGMENT = 1.0f / JOINTS;
+
+        //A tube along y around a chain of joints. Every vertex follows the 4 joints around its height, like a limb.
+        std::vector<Vertex> vertices(VERTICES);
+        std::vector<glm::uvec4> joints(VERTICES);
+        std::vector<glm::vec4> weights(VERTICES);
+        for(size_t v = 0; v < VERTICES; v++) {
+            const float height = (static_cast<float>(v) + 0.5f) / VERTICES;
+            const float angle = 2.39996323f * static_cast<float>(v); //Golden angle, spreads the vertices around the tube
+            const glm::vec3 radial(std::cos(angle), 0.0f, std::sin(angle));
+            vertices[v] = {glm::vec3(0.0f, height, 0.0f) + 0.05f * radial, radial, 0.01f * glm::normalize(radial + glm::vec3(0.0f, 0.2f, 0.0f))};
+
+            const float segment = height / SEGMENT;
+            const int nearest = static_cast<int>(segment);
+            glm::vec4 w;
+            for(int influence = 0; influence < Skinning::INFLUENCES; influence++) {
+                const int joint = std::clamp(nearest - 1 + influence, 0, JOINTS - 1);
+                joints[v][influence] = static_cast<unsigned int>(joint);
+                w[influence] = std::max(0.0f, 2.0f - std::abs(segment - (static_cast<float>(joint) + 0.5f)));
+            }
+            weights[v] = w / (w.x + w.y + w.z + w.w);
+        }
+        const Skinning::RestPose rest(vertices, joints, weights);
+
+        //Every joint bends the chain above it a little, differently in every frame
+        const auto jointMatrices = [&](const int frame) {
+            std::vector<glm::mat4> matrices(JOINTS);
+            glm::mat4 world(1.0f);
+            for(int joint = 0; joint < JOINTS; joint++) {
+                const float bend = 0.05f * std::sin(0.4f * static_cast<float>(frame) + 0.2f * static_cast<float>(joint));
+                world = glm::rotate(world * glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, joint == 0 ? 0.0f : SEGMENT, 0.0f)), bend, glm::vec3(0.0f, 0.0f, 1.0f));
+                const glm::mat4 inverseBind = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -SEGMENT * static_cast<float>(joint), 0.0f));
+                matrices[static_cast<size_t>(joint)] = world * inverseBind;
+            }
+
+            return matrices;
+        };
+
+        std::vector<std::pair<std::string, Skinning::Kernel>> kernels{{"scalar", &Skinning::skinScalar}};
+#if defined(EDGE_KERNELS_SSE)
+        kernels.emplace_back("SSE2", &Skinning::skinSSE);
+#endif
+#if defined(EDGE_KERNELS_AVX2)
+        kernels.emplace_back("AVX2", &Skinning::skinAVX2);
+#endif
+#if defined(EDGE_KERNELS_NEON)
+        kernels.emplace_back("NEON", &Skinning::skinNEON);
+#endif
+
+        const unsigned int threads = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<unsigned int> threadCounts{1};
+        if(threads > 1) threadCounts.push_back(threads);
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << VERTICES << " vertices, " << JOINTS << " joints, " << Skinning::INFLUENCES << " joints per vertex, " << FRAMES
+            << " frames, the scene uses " << Skinning::instructionSet() << std::endl;
+        std::cout << "implementation,threads,ms_per_frame,vertices_per_s_millions,speedup" << std::endl;
+
+        double scalarSeconds = 0.0;
+        for(const auto& [name, kernel] : kernels) {
+            for(const unsigned int count : threadCounts) {
+                Skinning::VertexArrays posed;
+                double seconds = 0.0;
+                for(int frame = 0; frame < FRAMES; frame++) {
+                    const std::vector<glm::mat4> matrices = jointMatrices(frame);
+                    const auto start = std::chrono::steady_clock::now();
+                    Skinning::skin(kernel, rest, matrices, posed, count);
+                    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                }
+                seconds /= FRAMES;
+                if(name == "scalar" && count == 1) scalarSeconds = seconds;
+
+                std::cout << name << ',' << count << ',' << seconds * 1000.0 << ',' << VERTICES / seconds / 1e6 << ',' << scalarSeconds / seconds << std::endl;
+            }
+        }
+
+        return 0;
+    }
+
+    int packetTraversal(const CPUScene& scene, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount) {
+        constexpr int RUNS = 3;
+
+        CPURenderer renderer(scene, threadCount);
+        const glm::mat4 projection = path.projectionMatrix();
+
+        //Best of a few runs, to reduce the noise of other processes
+        const auto bestOf = [&](const glm::mat4& invViewProj, std::vector<glm::vec3>& pixels) {
+            FrameStats best;
+            for(int run = 0; run < RUNS; run++) {
+                const FrameStats fs = renderer.render(invViewProj, path.resolution, pixels);
+                if(run == 0 || fs.seconds < best.seconds) best = fs;
+            }
+
+            return best;
+        };
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << path.resolution.x << "x" << path.resolution.y << ", " << renderer.getThreadCount() << " threads, packets of "
+            << CPURenderer::PACKET_WIDTH << "x" << CPURenderer::PACKET_HEIGHT << " rays, best of " << RUNS << " runs" << std::endl;
+        std::cout << "view,single_mrays_per_s,packet_mrays_per_s,speedup,single_hierarchy_nodes_per_ray,packet_hierarchy_nodes_per_ray,different_pixels" << std::endl;
+
+        std::vector<glm::vec3> singlePixels, packetPixels;
+        double singleSeconds = 0.0, packetSeconds = 0.0;
+        uint64_t rays = 0;
+
+        for(size_t view = 0; view < cameras.size(); view++) {
+            const glm::mat4 invViewProj = glm::inverse(projection * CameraPath::viewMatrix(cameras[view]));
+
+            renderer.setPacketTraversal(false);
+            const FrameStats single = bestOf(invViewProj, singlePixels);
+            renderer.setPacketTraversal(true);
+            const FrameStats packet = bestOf(invViewProj, packetPixels);
+
+            //Rays that hit several micro-triangles of a base triangle can report another one in a packet
+            size_t differentPixels = 0;
+            for(size_t i = 0; i < singlePixels.size(); i++) differentPixels += singlePixels[i] != packetPixels[i];
+
+            const double raysPerFrame = std::max<double>(1.0, static_cast<double>(single.traversal.rays));
+            std::cout << view << ',' << single.raysPerSecond() / 1e6 << ',' << packet.raysPerSecond() / 1e6 << ',' << single.seconds / packet.seconds << ','
+                << static_cast<double>(single.traversal.hierarchyNodesVisited) / raysPerFrame << ',' << static_cast<double>(packet.traversal.hierarchyNodesVisited) / raysPerFrame << ','
+                << differentPixels << std::endl;
+
+            singleSeconds += single.seconds;
+            packetSeconds += packet.seconds;
+            rays += single.traversal.rays;
+        }
+
+        std::cout << "total," << static_cast<double>(rays) / singleSeconds / 1e6 << ',' << static_cast<double>(rays) / packetSeconds / 1e6 << ',' << singleSeconds / packetSeconds << ",,,"
+            << std::endl;
+
+        return 0;
+    }
+
+    int levelOfDetail(const CPUScene& scene, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount, const float lodPixels) {
+        constexpr int RUNS = 3;
+        constexpr float DISTANCE_SCALES[] = {1.0f, 4.0f, 16.0f};
+
+        CPURenderer renderer(scene, threadCount);
+        const glm::mat4 projection = path.projectionMatrix();
+
+        const auto bestOf = [&](const glm::mat4& invViewProj, std::vector<glm::vec3>& pixels) {
+            FrameStats best;
+            for(int run = 0; run < RUNS; run++) {
+                const FrameStats fs = renderer.render(invViewProj, path.resolution, pixels);
+                if(run == 0 || fs.seconds < best.seconds) best = fs;
+            }
+
+            return best;
+        };
+
+        std::cout << std::fixed << std::setprecision(4);
+        std::cout << "# " << path.resolution.x << "x" << path.resolution.y << ", " << renderer.getThreadCount() << " threads, level of detail of " << lodPixels
+            << " pixels, best of " << RUNS << " runs" << std::endl;
+        std::cout << "view,distance_scale,full_mrays_per_s,lod_mrays_per_s,speedup,lod_terminations_per_ray,rmse,max_error,pixels_over_1_255" << std::endl;
+
+        std::vector<glm::vec3> fullPixels, lodPixelValues;
+        for(size_t view = 0; view < cameras.size(); view++) {
+            for(const float scale : DISTANCE_SCALES) {
+                CameraKeyframe camera = cameras[view];
+                camera.distance *= scale;
+                const glm::mat4 invViewProj = glm::inverse(projection * CameraPath::viewMatrix(camera));
+
+                renderer.setLevelOfDetail(0.0f);
+                const FrameStats full = bestOf(invViewProj, fullPixels);
+                renderer.setLevelOfDetail(lodPixels);
+                const FrameStats lod = bestOf(invViewProj, lodPixelValues);
+
+                //Errors in color channels, where 1/255 is the smallest difference that an 8-bit image can show
+                double squaredError = 0.0;
+                float maxError = 0.0f;
+                size_t visiblePixels = 0;
+                for(size_t i = 0; i < fullPixels.size(); i++) {
+                    const glm::vec3 difference = glm::abs(glm::clamp(fullPixels[i], 0.0f, 1.0f) - glm::clamp(lodPixelValues[i], 0.0f, 1.0f));
+                    const float pixelError = std::max(difference.x, std::max(difference.y, difference.z));
+                    squaredError += static_cast<double>(glm::dot(difference, difference)) / 3.0;
+                    maxError = std::max(maxError, pixelError);
+                    visiblePixels += pixelError > 1.0f / 255.0f;
+                }
+
+                const double pixelCount = std::max<double>(1.0, static_cast<double>(fullPixels.size()));
+                const double raysPerFrame = std::max<double>(1.0, static_cast<double>(lod.traversal.rays));
+                std::cout << view << ',' << scale << ',' << full.raysPerSecond() / 1e6 << ',' << lod.raysPerSecond() / 1e6 << ',' << full.seconds / lod.seconds << ','
+                    << static_cast<double>(lod.traversal.lodTerminations) / raysPerFrame << ',' << std::sqrt(squaredError / pixelCount) << ',' << maxError << ','
+                    << static_cast<double>(visiblePixels) / pixelCount << std::endl;
+            }
+        }
+
+        return 0;
+    }
+
+    int gridTraversal(CPUScene& scene, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount) {
+        constexpr int RUNS = 3;
+        using Mode = CPUScene::TraversalMode;
+        constexpr std::pair<Mode, const char*> MODES[] = {{Mode::HIERARCHY, "hierarchy"}, {Mode::GRID, "grid"}, {Mode::AUTOMATIC, "automatic"}};
+
+        const BakedMesh& mesh = scene.getMesh();
+        const Mode originalMode = scene.getTraversalMode();
+
+        std::cout << "level,triangles,grid_supported,grid_preferred" << std::endl;
+        for(int level = 0; level <= mesh.maxSubdivisionLevel; level++) {
+            size_t triangles = 0, supported = 0, preferred = 0;
+            for(unsigned int i = 0; i < mesh.triangleData.size(); i++) {
+                if(mesh.triangleData[i].subDivisionLevel != level) continue;
+
+                triangles++;
+                supported += supportsGridTraversal(mesh, i);
+                preferred += prefersGridTraversal(mesh, i);
+            }
+            if(triangles > 0) std::cout << level << ',' << triangles << ',' << supported << ',' << preferred << std::endl;
+        }
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << path.resolution.x << "x" << path.resolution.y << ", best of " << RUNS << " runs" << std::endl;
+        std::cout << "view,mode,grid_triangles,mrays_per_s,speedup,hierarchy_nodes_per_ray,grid_cells_per_ray,micro_triangle_tests_per_ray,different_pixels" << std::endl;
+
+        std::vector<glm::vec3> hierarchyPixels, pixels;
+        for(size_t view = 0; view < cameras.size(); view++) {
+            const glm::mat4 invViewProj = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(cameras[view]));
+            double hierarchySeconds = 0.0;
+
+            for(const auto& [mode, name] : MODES) {
+                scene.setTraversalMode(mode);
+                CPURenderer renderer(scene, threadCount);
+
+                FrameStats best;
+                for(int run = 0; run < RUNS; run++) {
+                    const FrameStats fs = renderer.render(invViewProj, path.resolution, pixels);
+                    if(run == 0 || fs.seconds < best.seconds) best = fs;
+                }
+
+                if(mode == Mode::HIERARCHY) {
+                    hierarchySeconds = best.seconds;
+                    hierarchyPixels = pixels;
+                }
+
+                //The micro-triangles are the same, but their vertices are computed differently, so hits can differ in the last bits
+                size_t differentPixels = 0;
+                for(size_t i = 0; i < pixels.size(); i++) differentPixels += glm::any(glm::greaterThan(glm::abs(pixels[i] - hierarchyPixels[i]), glm::vec3(1.0f / 255.0f)));
+
+                const double rays = std::max<double>(1.0, static_cast<double>(best.traversal.rays));
+                std::cout << view << ',' << name << ',' << scene.gridTriangleCount() << ',' << best.raysPerSecond() / 1e6 << ',' << hierarchySeconds / best.seconds << ','
+                    << static_cast<double>(best.traversal.hierarchyNodesVisited) / rays << ',' << static_cast<double>(best.traversal.gridCellsVisited) / rays << ','
+                    << static_cast<double>(best.traversal.microTriangleTests) / rays << ',' << differentPixels << std::endl;
+            }
+        }
+
+        scene.setTraversalMode(originalMode);
+
+        return 0;
+    }
+
+    int aabbSplitting(const BakedMesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount) {
+        constexpr int RUNS = 3;
+
+        const auto buildStart = std::chrono::steady_clock::now();
+        const CPUScene wholeScene(mesh);
+        const auto buildMiddle = std::chrono::steady_clock::now();
+        const CPUScene splitScene(mesh, CPUScene::TraversalMode::AUTOMATIC, true);
+        const auto buildEnd = std::chrono::steady_clock::now();
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# whole: " << wholeScene.primitiveCount() << " AABBs, " << std::chrono::duration<double, std::milli>(buildMiddle - buildStart).count() << "ms; split: "
+            << splitScene.primitiveCount() << " AABBs (" << splitScene.splitTriangleCount() << " of " << mesh.triangleData.size() << " base triangles split), "
+            << std::chrono::duration<double, std::milli>(buildEnd - buildMiddle).count() << "ms" << std::endl;
+        std::cout << "# " << path.resolution.x << "x" << path.resolution.y << ", best of " << RUNS << " runs" << std::endl;
+        std::cout << "view,whole_intersection_calls_per_ray,split_intersection_calls_per_ray,calls_removed,whole_bvh_nodes_per_ray,split_bvh_nodes_per_ray,"
+            "whole_mrays_per_s,split_mrays_per_s,speedup,different_pixels" << std::endl;
+
+        const auto bestOf = [&](const CPUScene& scene, const glm::mat4& invViewProj, std::vector<glm::vec3>& pixels) {
+            CPURenderer renderer(scene, threadCount);
+            FrameStats best;
+            for(int run = 0; run < RUNS; run++) {
+                const FrameStats fs = renderer.render(invViewProj, path.resolution, pixels);
+                if(run == 0 || fs.seconds < best.seconds) best = fs;
+            }
+
+            return best;
+        };
+
+        std::vector<glm::vec3> wholePixels, splitPixels;
+        TraversalStats wholeTotal, splitTotal;
+        for(size_t view = 0; view < cameras.size(); view++) {
+            const glm::mat4 invViewProj = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(cameras[view]));
+            const FrameStats whole = bestOf(wholeScene, invViewProj, wholePixels);
+            const FrameStats split = bestOf(splitScene, invViewProj, splitPixels);
+
+            //Hierarchy triangles start their traversal from tighter bounds, so hits can differ in the last bits
+            size_t differentPixels = 0;
+            for(size_t i = 0; i < wholePixels.size(); i++) differentPixels += glm::any(glm::greaterThan(glm::abs(wholePixels[i] - splitPixels[i]), glm::vec3(1.0f / 255.0f)));
+
+            const double rays = std::max<double>(1.0, static_cast<double>(whole.traversal.rays));
+            const double removed = 1.0 - static_cast<double>(split.traversal.intersectionCalls) / std::max<double>(1.0, static_cast<double>(whole.traversal.intersectionCalls));
+            std::cout << view << ',' << static_cast<double>(whole.traversal.intersectionCalls) / rays << ',' << static_cast<double>(split.traversal.intersectionCalls) / rays << ','
+                << removed << ',' << static_cast<double>(whole.traversal.bvhNodesVisited) / rays << ',' << static_cast<double>(split.traversal.bvhNodesVisited) / rays << ','
+                << whole.raysPerSecond() / 1e6 << ',' << split.raysPerSecond() / 1e6 << ',' << whole.seconds / split.seconds << ',' << differentPixels << std::endl;
+
+            wholeTotal += whole.traversal;
+            splitTotal += split.traversal;
+        }
+
+        const double rays = std::max<double>(1.0, static_cast<double>(wholeTotal.rays));
+        std::cout << "total," << static_cast<double>(wholeTotal.intersectionCalls) / rays << ',' << static_cast<double>(splitTotal.intersectionCalls) / rays << ','
+            << 1.0 - static_cast<double>(splitTotal.intersectionCalls) / std::max<double>(1.0, static_cast<double>(wholeTotal.intersectionCalls)) << ','
+            << static_cast<double>(wholeTotal.bvhNodesVisited) / rays << ',' << static_cast<double>(splitTotal.bvhNodesVisited) / rays << ",,,," << std::endl;
+
+        return 0;
+    }
+
+    int hybridTessellation(const BakedMesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount) {
+        constexpr int RUNS = 3;
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << mesh.triangleData.size() << " base triangles, baked mesh " << static_cast<double>(mesh.sizeInBytes()) / 1e6 << "MB, " << cameras.size() << " views at "
+            << path.resolution.x << "x" << path.resolution.y << ", best of " << RUNS << " runs" << std::endl;
+        std::cout << "tessellation_level,tessellated_triangles,micro_triangles,build_ms,acceleration_mb,total_mb,memory_ratio,mrays_per_s,speedup,"
+            "intersection_calls_per_ray,micro_triangle_tests_per_ray,different_pixels" << std::endl;
+
+        std::vector<std::vector<glm::vec3>> proceduralPixels(cameras.size());
+        double proceduralSeconds = 0.0, proceduralBytes = 0.0;
+        double bestSpeedup = 0.0;
+        int fastestLevel = 0, memoryCrossover = -1;
+
+        //Level 0 is fully procedural, the last level tessellates every base triangle
+        for(int level = 0; level <= mesh.maxSubdivisionLevel + 1; level++) {
+            const auto buildStart = std::chrono::steady_clock::now();
+            const CPUScene scene(mesh, CPUScene::TraversalMode::AUTOMATIC, false, level);
+            const double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+
+            CPURenderer renderer(scene, threadCount);
+            double seconds = 0.0;
+            TraversalStats traversal;
+            size_t differentPixels = 0;
+            for(size_t view = 0; view < cameras.size(); view++) {
+                const glm::mat4 invViewProj = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(cameras[view]));
+
+                std::vector<glm::vec3> pixels;
+                FrameStats best;
+                for(int run = 0; run < RUNS; run++) {
+                    const FrameStats fs = renderer.render(invViewProj, path.resolution, pixels);
+                    if(run == 0 || fs.seconds < best.seconds) best = fs;
+                }
+                seconds += best.seconds;
+                traversal += best.traversal;
+
+                if(level == 0) proceduralPixels[view] = pixels;
+                for(size_t i = 0; i < pixels.size(); i++) differentPixels += glm::any(glm::greaterThan(glm::abs(pixels[i] - proceduralPixels[view][i]), glm::vec3(1.0f / 255.0f)));
+            }
+
+            const double accelerationBytes = static_cast<double>(scene.accelerationSizeInBytes());
+            const double totalBytes = accelerationBytes + static_cast<double>(mesh.sizeInBytes());
+            if(level == 0) {
+                proceduralSeconds = seconds;
+                proceduralBytes = totalBytes;
+            }
+
+            const double speedup = proceduralSeconds / seconds;
+            if(speedup > bestSpeedup) {
+                bestSpeedup = speedup;
+                fastestLevel = level;
+            }
+            if(memoryCrossover < 0 && accelerationBytes > static_cast<double>(mesh.sizeInBytes())) memoryCrossover = level;
+
+            const double rays = std::max<double>(1.0, static_cast<double>(traversal.rays));
+            std::cout << level << ',' << scene.tessellatedTriangleCount() << ',' << scene.microTriangleCount() << ',' << buildSeconds * 1000.0 << ','
+                << accelerationBytes / 1e6 << ',' << totalBytes / 1e6 << ',' << totalBytes / proceduralBytes << ',' << rays / seconds / 1e6 << ',' << speedup << ','
+                << static_cast<double>(traversal.intersectionCalls) / rays << ',' << static_cast<double>(traversal.microTriangleTests) / rays << ',' << differentPixels << std::endl;
+        }
+
+        //Where tessellating more stops paying off in throughput, and where the explicit micro-triangles outweigh the compressed micro-mesh
+        std::cout << "# throughput crossover: tessellating below level " << fastestLevel << " is fastest (" << bestSpeedup << "x)" << std::endl;
+        if(memoryCrossover >= 0) std::cout << "# memory crossover: from level " << memoryCrossover << " the acceleration structure is larger than the baked mesh" << std::endl;
+        else std::cout << "# memory crossover: none, the acceleration structure stays smaller than the baked mesh" << std::endl;
+
+        return 0;
+    }
+
+    int aabbBuild(const Mesh& mesh, const unsigned int threadCount) {
+        constexpr int RUNS = 5;
+        constexpr size_t MIN_MICRO_VERTICES = size_t(1) << 22;
+
+        //Small meshes are repeated, so that the timings are not dominated by starting threads
+        const auto countMicroVertices = [](const Mesh& m) {
+            size_t count = 0;
+            for(const Triangle& t : m.triangles) count += t.uVertices.size();
+            return count;
+        };
+
+        const size_t meshMicroVertices = countMicroVertices(mesh);
+        const size_t copies = meshMicroVertices == 0 ? 1 : std::max<size_t>(1, (MIN_MICRO_VERTICES + meshMicroVertices - 1) / meshMicroVertices);
+        Mesh repeated;
+        repeated.triangles.reserve(mesh.triangles.size() * copies);
+        for(size_t copy = 0; copy < copies; copy++) repeated.triangles.insert(repeated.triangles.end(), mesh.triangles.begin(), mesh.triangles.end());
+
+        size_t microTriangles = 0;
+        for(const Triangle& t : repeated.triangles) microTriangles += t.uFaces.size();
+        const size_t microVertices = meshMicroVertices * copies;
+        const unsigned int threads = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+
+        const auto bestOf = [&](const auto& build, std::vector<AABB>& AABBs) {
+            double best = 0.0;
+            for(int run = 0; run < RUNS; run++) {
+                const auto start = std::chrono::steady_clock::now();
+                AABBs = build();
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if(run == 0 || seconds < best) best = seconds;
+            }
+
+            return best;
+        };
+
+        std::vector<AABB> AABBs;
+        const double scalarSeconds = bestOf([&] { return AABBBuilder::buildScalar(repeated); }, AABBs);
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << repeated.triangles.size() << " base triangles (" << copies << " copies of the mesh), " << microVertices << " micro-vertices, "
+            << microTriangles << " micro-triangles, best of " << RUNS << " runs" << std::endl;
+        std::cout << "implementation,threads,ms,micro_vertices_per_s_millions,speedup" << std::endl;
+        std::cout << "scalar,1," << scalarSeconds * 1000.0 << ',' << static_cast<double>(microVertices) / scalarSeconds / 1e6 << ",1.000" << std::endl;
+
+        std::vector<unsigned int> threadCounts{1};
+        if(threads > 1) threadCounts.push_back(threads);
+        for(const unsigned int count : threadCounts) {
+            const double seconds = bestOf([&] { return AABBBuilder::build(repeated, count); }, AABBs);
+            std::cout << AABBBuilder::instructionSet() << ',' << count << ',' << seconds * 1000.0 << ',' << static_cast<double>(microVertices) / seconds / 1e6 << ','
+                << scalarSeconds / seconds << std::endl;
+        }
+
+        return 0;
+    }
+
+    int lazyBake(const std::shared_ptr<const Mesh>& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount) {
+        if(cameras.empty()) return 0;
+        const glm::mat4 firstView = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(cameras.front()));
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << mesh->triangles.size() << " base triangles, first of " << cameras.size() << " views at " << path.resolution.x << "x"
+            << path.resolution.y << std::endl;
+        std::cout << "bake,bake_ms,first_frame_ms,first_image_ms,triangles_built,built_fraction,different_pixels" << std::endl;
+
+        //Eager: every record before the first ray
+        auto start = std::chrono::steady_clock::now();
+        const CPUScene eagerScene(BakedMesh::bake(*mesh));
+        const double eagerBakeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<glm::vec3> eagerPixels;
+        const FrameStats eagerFrame = CPURenderer(eagerScene, threadCount).render(firstView, path.resolution, eagerPixels);
+        std::cout << "eager," << eagerBakeSeconds * 1000.0 << ',' << eagerFrame.seconds * 1000.0 << ',' << (eagerBakeSeconds + eagerFrame.seconds) * 1000.0
+            << ',' << mesh->triangles.size() << ",1.000,0" << std::endl;
+
+        //Lazy: only the triangles the first frame reaches
+        start = std::chrono::steady_clock::now();
+        const CPUScene lazyScene = CPUScene::bakeLazily(mesh);
+        const double lazyBakeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<glm::vec3> lazyPixels;
+        const FrameStats lazyFrame = CPURenderer(lazyScene, threadCount).render(firstView, path.resolution, lazyPixels);
+        const size_t built = lazyScene.getLazyHierarchy()->builtCount();
+
+        //The records are the same, so the images must be identical
+        size_t differentPixels = 0;
+        for(size_t i = 0; i < lazyPixels.size(); i++) differentPixels += lazyPixels[i] != eagerPixels[i];
+
+        std::cout << "lazy," << lazyBakeSeconds * 1000.0 << ',' << lazyFrame.seconds * 1000.0 << ',' << (lazyBakeSeconds + lazyFrame.seconds) * 1000.0
+            << ',' << built << ',' << static_cast<double>(built) / static_cast<double>(std::max<size_t>(1, mesh->triangles.size())) << ','
+            << differentPixels << std::endl;
+
+        return differentPixels == 0 ? 0 : 1;
+    }
+
+    int incrementalBake(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount) {
+        if(mesh.triangles.empty() || cameras.empty()) return 0;
+        const glm::mat4 firstView = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(cameras.front()));
+
+        Mesh edited = mesh;
+        CPUScene scene(BakedMesh::bake(edited));
+
+        //Edits of growing size: base triangles times micro-vertices per base triangle. Each brush is a run of neighbouring micro-vertices.
+        const std::pair<size_t, size_t> rounds[] = {{1, 1}, {1, 16}, {16, 16}, {std::max<size_t>(1, mesh.triangles.size() / 100), 4}};
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << mesh.triangles.size() << " base triangles, first of " << cameras.size() << " views at " << path.resolution.x << "x" << path.resolution.y << std::endl;
+        std::cout << "edited_micro_vertices,edited_triangles,updated_records,refit_nodes,incremental_ms,rebake_ms,speedup,mismatches,different_pixels" << std::endl;
+
+        std::mt19937 rng(1);
+        bool allAgree = true;
+        for(const auto& [triangleCount, verticesPerTriangle] : rounds) {
+            std::uniform_int_distribution<size_t> pickTriangle(0, mesh.triangles.size() - 1);
+            std::uniform_real_distribution<float> factor(0.5f, 1.5f);
+
+            for(size_t i = 0; i < triangleCount; i++) {
+                const auto triangle = static_cast<unsigned int>(pickTriangle(rng));
+                const Triangle& t = edited.triangles[triangle];
+                const Vertex& v0 = edited.vertices[t.baseVertexIndices.x];
+                const Vertex& v1 = edited.vertices[t.baseVertexIndices.y];
+                const Vertex& v2 = edited.vertices[t.baseVertexIndices.z];
+                const float size = glm::length(v1.position - v0.position);
+
+                //Displacements are baked as scales of the interpolated direction, so they are edited along it
+                const size_t count = std::min(verticesPerTriangle, t.uVertices.size());
+                const size_t first = std::uniform_int_distribution<size_t>(0, t.uVertices.size() - count)(rng);
+                for(size_t v = first; v < first + count; v++) {
+                    const glm::vec3 bc = Triangle::computeBaryCoords(v0.position, v1.position, v2.position, t.uVertices[v].position);
+                    const glm::vec3 direction = bc.x * v0.direction + bc.y * v1.direction + bc.z * v2.direction;
+                    const float scale = t.uVertices[v].present ? edited.displacementScale(t, t.uVertices[v]) : 0.0f;
+
+                    const float newScale = factor(rng) * scale + 0.02f * size * (factor(rng) - 1.0f);
+                    edited.setDisplacement(triangle, static_cast<unsigned int>(v), newScale * direction);
+                }
+            }
+
+            const size_t editedVertices = edited.dirtyMicroVertices().size();
+            auto start = std::chrono::steady_clock::now();
+            const CPUScene::EditStats stats = scene.applyEdits(edited);
+            const double incrementalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            edited.clearDirty();
+
+            start = std::chrono::steady_clock::now();
+            const CPUScene rebaked(BakedMesh::bake(edited));
+            const double rebakeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            //The baked data must be the same as that of a full bake
+            const BakedMesh& a = scene.getMesh();
+            const BakedMesh& b = rebaked.getMesh();
+            size_t mismatches = 0;
+            for(size_t i = 0; i < a.displacementScales.size(); i++) mismatches += a.displacementScales[i] != b.displacementScales[i];
+            for(size_t i = 0; i < a.minMaxDisplacements.size(); i++) mismatches += a.minMaxDisplacements[i] != b.minMaxDisplacements[i];
+            for(size_t i = 0; i < a.deltas.size(); i++) mismatches += a.deltas[i] != b.deltas[i];
+            for(size_t i = 0; i < a.AABBs.size(); i++) mismatches += a.AABBs[i].minPos != b.AABBs[i].minPos || a.AABBs[i].maxPos != b.AABBs[i].maxPos;
+            for(size_t i = 0; i < a.tangentialDisplacements.size(); i++) mismatches += a.tangentialDisplacements[i] != b.tangentialDisplacements[i];
+
+            //The refit BVH has another tree than the rebuilt one, but must find the same hits
+            std::vector<glm::vec3> refitPixels, rebuiltPixels;
+            CPURenderer(scene, threadCount).render(firstView, path.resolution, refitPixels);
+            CPURenderer(rebaked, threadCount).render(firstView, path.resolution, rebuiltPixels);
+            size_t differentPixels = 0;
+            for(size_t i = 0; i < refitPixels.size(); i++) differentPixels += glm::any(glm::greaterThan(glm::abs(refitPixels[i] - rebuiltPixels[i]), glm::vec3(1.0f / 255.0f)));
+
+            allAgree &= mismatches == 0 && differentPixels == 0;
+            std::cout << editedVertices << ',' << stats.editedTriangles << ',' << stats.updatedRecords << ',' << stats.refitNodes << ',' << incrementalSeconds * 1000.0 << ','
+                << rebakeSeconds * 1000.0 << ',' << rebakeSeconds / incrementalSeconds << ',' << mismatches << ',' << differentPixels << std::endl;
+        }
+
+        return allAgree ? 0 : 1;
+    }
+
+    int pagedBlocks(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount, const std::filesystem::path& file) {
+        if(cameras.empty()) return 0;
+        //Fractions of the blocks that fit into the cache
+        constexpr double CACHE_FRACTIONS[] = {1.0, 0.25, 0.05, 0.01};
+
+        const auto renderAll = [&](const CPUScene& scene, std::vector<std::vector<glm::vec3>>& images) {
+            const CPURenderer renderer(scene, threadCount);
+            images.resize(cameras.size());
+
+            double seconds = 0.0;
+            for(size_t i = 0; i < cameras.size(); i++) {
+                const glm::mat4 view = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(cameras[i]));
+                seconds += renderer.render(view, path.resolution, images[i]).seconds;
+            }
+
+            return seconds;
+        };
+
+        const CPUScene memoryScene(BakedMesh::bake(mesh));
+        std::vector<std::vector<glm::vec3>> memoryImages;
+        const double memorySeconds = renderAll(memoryScene, memoryImages);
+
+        auto start = std::chrono::steady_clock::now();
+        PagedBlocks::bake(mesh, file);
+        const double bakeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const size_t blockBytes = PagedBlocks::open(file, 0).pages->blockBytes();
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << mesh.triangles.size() << " base triangles, " << static_cast<double>(blockBytes) / 1e6 << " MB of blocks, "
+            << static_cast<double>(std::filesystem::file_size(file)) / 1e6 << " MB file baked in " << bakeSeconds * 1000.0 << " ms, " << cameras.size() << " views at " << path.resolution.x << "x" << path.resolution.y << std::endl;
+        std::cout << "cache,cache_mb,ms,slowdown,hits,misses,hit_rate,evictions,prefetched_blocks,read_mb,resident_mb,different_pixels" << std::endl;
+        std::cout << "memory,-," << memorySeconds * 1000.0 << ",1.000,-,-,-,-,-,-," << static_cast<double>(memoryScene.getMesh().sizeInBytes()) / 1e6 << ",0" << std::endl;
+
+        bool allAgree = true;
+        for(const double fraction : CACHE_FRACTIONS) {
+            const auto cacheBytes = static_cast<size_t>(fraction * static_cast<double>(blockBytes));
+            const CPUScene pagedScene(PagedBlocks::open(file, cacheBytes));
+
+            //Creating the scene reads every block once to pick the traversals, only the frames are measured
+            PagedBlocks& pages = *pagedScene.getMesh().pages;
+            pages.resetStats();
+
+            std::vector<std::vector<glm::vec3>> pagedImages;
+            const double seconds = renderAll(pagedScene, pagedImages);
+            const BlockCacheStats stats = pages.stats();
+
+            //The blocks hold the same values as the vectors, so the images must be identical
+            size_t differentPixels = 0;
+            for(size_t i = 0; i < cameras.size(); i++) {
+                for(size_t p = 0; p < pagedImages[i].size(); p++) differentPixels += pagedImages[i][p] != memoryImages[i][p];
+            }
+            allAgree &= differentPixels == 0;
+
+            std::cout << fraction << ',' << static_cast<double>(cacheBytes) / 1e6 << ',' << seconds * 1000.0 << ',' << seconds / memorySeconds << ',' << stats.hits << ','
+                << stats.misses << ',' << stats.hitRate() << ',' << stats.evictions << ',' << stats.prefetchedBlocks << ',' << static_cast<double>(stats.bytesRead) / 1e6 << ','
+                << static_cast<double>(stats.residentBytes) / 1e6 << ',' << differentPixels << std::endl;
+        }
+
+        std::filesystem::remove(file);
+        return allAgree ? 0 : 1;
+    }
+
+    int vertexOrder(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount) {
+        std::set<int> subdivisionLevels;
+        for(const Triangle& t : mesh.triangles) subdivisionLevels.insert(t.subdivisionLevel());
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << mesh.triangles.size() << " base triangles" << std::endl;
+        std::cout << "subdivision_level,node_level,nodes,vertices_per_node,row_major_lines,bird_curve_lines,reduction" << std::endl;
+
+        std::vector<VertexOrdering::GridTriangle> nodes;
+        std::vector<size_t> lines;
+        for(const int subdivisionLevel : subdivisionLevels) {
+            const std::vector<std::uint32_t>& curve = VertexOrdering::birdCurve(subdivisionLevel);
+
+            for(int level = 0; level <= subdivisionLevel; level++) {
+                nodes.clear();
+                collectGridTriangles(VertexOrdering::root(subdivisionLevel), level, nodes);
+
+                size_t rowMajorLines = 0, curveLines = 0;
+                for(const VertexOrdering::GridTriangle& node : nodes) {
+                    rowMajorLines += cacheLines(node, nullptr, lines);
+                    curveLines += cacheLines(node, &curve, lines);
+                }
+
+                const unsigned int size = 1u << (subdivisionLevel - level);
+                const double count = static_cast<double>(nodes.size());
+                std::cout << subdivisionLevel << ',' << level << ',' << nodes.size() << ',' << (size + 1) * (size + 2) / 2 << ','
+                    << static_cast<double>(rowMajorLines) / count << ',' << static_cast<double>(curveLines) / count << ','
+                    << static_cast<double>(rowMajorLines) / static_cast<double>(curveLines) << std::endl;
+            }
+        }
+
+        if(cameras.empty()) return 0;
+
+        //The same scales in another order, so the images must be identical
+        std::cout << "order,ms,speedup,different_pixels" << std::endl;
+        std::vector<std::vector<glm::vec3>> rowMajorImages(cameras.size());
+        double rowMajorSeconds = 0.0;
+        bool allAgree = true;
+        for(const VertexOrder order : {VertexOrder::ROW_MAJOR, VertexOrder::BIRD_CURVE}) {
+            const CPUScene scene(BakedMesh::bake(mesh, order));
+            const CPURenderer renderer(scene, threadCount);
+
+            double seconds = 0.0;
+            size_t differentPixels = 0;
+            for(size_t i = 0; i < cameras.size(); i++) {
+                const glm::mat4 view = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(cameras[i]));
+                std::vector<glm::vec3> pixels;
+                seconds += renderer.render(view, path.resolution, pixels).seconds;
+
+                if(order == VertexOrder::ROW_MAJOR) {
+                    rowMajorImages[i] = std::move(pixels);
+                    continue;
+                }
+                for(size_t p = 0; p < pixels.size(); p++) differentPixels += pixels[p] != rowMajorImages[i][p];
+            }
+            if(order == VertexOrder::ROW_MAJOR) rowMajorSeconds = seconds;
+            allAgree &= differentPixels == 0;
+
+            std::cout << (order == VertexOrder::ROW_MAJOR ? "row_major" : "bird_curve") << ',' << seconds * 1000.0 << ',' << rowMajorSeconds / seconds << ','
+                << differentPixels << std::endl;
+        }
+
+        return allAgree ? 0 : 1;
+    }
+
+    int quantizedHierarchy(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount) {
+        const CPUScene fullScene(BakedMesh::bake(mesh));
+
+        auto start = std::chrono::steady_clock::now();
+        BakedMesh quantized = BakedMesh::bake(mesh);
+        quantized.quantizeHierarchy();
+        const double quantizeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const CPUScene quantizedScene(std::move(quantized));
+
+        const BakedMesh& full = fullScene.getMesh();
+        const BakedMesh& q = quantizedScene.getMesh();
+        const size_t fullBytes = full.minMaxDisplacements.size() * sizeof(glm::vec2) + full.deltas.size() * sizeof(float);
+        const size_t quantizedBytes = q.quantizedBounds.size() * sizeof(QuantizedBounds) + q.hierarchyRanges.size() * sizeof(HierarchyRange);
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << mesh.triangles.size() << " base triangles, " << full.deltas.size() << " hierarchy records, baked and quantized in " << quantizeSeconds * 1000.0
+            << " ms" << std::endl;
+        std::cout << "hierarchy,hierarchy_mb,mesh_mb,saved_mb" << std::endl;
+        std::cout << "full," << static_cast<double>(fullBytes) / 1e6 << ',' << static_cast<double>(full.sizeInBytes()) / 1e6 << ",0.000" << std::endl;
+        std::cout << "quantized," << static_cast<double>(quantizedBytes) / 1e6 << ',' << static_cast<double>(q.sizeInBytes()) / 1e6 << ','
+            << (static_cast<double>(fullBytes) - static_cast<double>(quantizedBytes)) / 1e6 << std::endl;
+
+        if(cameras.empty()) return 0;
+
+        //Looser bounds only cost tests: a pixel that the full hierarchy hits and the quantized one misses is a lost hit
+        std::cout << "# " << cameras.size() << " views at " << path.resolution.x << "x" << path.resolution.y << std::endl;
+        std::cout << "hierarchy,ms,speedup,hierarchy_nodes_per_ray,bounding_triangle_tests_per_ray,micro_triangle_tests_per_ray,lost_hits,different_pixels" << std::endl;
+        std::vector<std::vector<glm::vec3>> fullImages(cameras.size());
+        double fullSeconds = 0.0;
+        bool noneLost = true;
+        for(const CPUScene* scene : {&fullScene, &quantizedScene}) {
+            const bool isFull = scene == &fullScene;
+            const CPURenderer renderer(*scene, threadCount);
+
+            FrameStats total;
+            size_t lostHits = 0, differentPixels = 0;
+            for(size_t i = 0; i < cameras.size(); i++) {
+                const glm::mat4 view = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(cameras[i]));
+                std::vector<glm::vec3> pixels;
+                const FrameStats frame = renderer.render(view, path.resolution, pixels);
+                total.seconds += frame.seconds;
+                total.traversal += frame.traversal;
+
+                if(isFull) {
+                    fullImages[i] = std::move(pixels);
+                    continue;
+                }
+                for(size_t p = 0; p < pixels.size(); p++) {
+                    differentPixels += pixels[p] != fullImages[i][p];
+                    lostHits += pixels[p] == Shading::missColor && fullImages[i][p] != Shading::missColor;
+                }
+            }
+            if(isFull) fullSeconds = total.seconds;
+            noneLost &= lostHits == 0;
+
+            const double rays = static_cast<double>(std::max<uint64_t>(1, total.traversal.rays));
+            std::cout << (isFull ? "full" : "quantized") << ',' << total.seconds * 1000.0 << ',' << fullSeconds / total.seconds << ','
+                << static_cast<double>(total.traversal.hierarchyNodesVisited) / rays << ',' << static_cast<double>(total.traversal.boundingTriangleTests) / rays << ','
+                << static_cast<double>(total.traversal.microTriangleTests) / rays << ',' << lostHits << ',' << differentPixels << std::endl;
+        }
+
+        return noneLost ? 0 : 1;
+    }
+
+    int sparseHierarchy(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount) {
+        constexpr float TOLERANCES[] = {0.0f, 1e-4f, 1e-3f, 1e-2f};
+
+        const CPUScene fullScene(BakedMesh::bake(mesh));
+        const BakedMesh& full = fullScene.getMesh();
+        size_t fullRecords = 0;
+        for(const TriangleData& td : full.triangleData) fullRecords += BakedMesh::hierarchyRecordCount(td);
+        const size_t fullBytes = full.minMaxDisplacements.size() * sizeof(glm::vec2) + full.deltas.size() * sizeof(float);
+
+        const auto renderAll = [&](const CPUScene& scene, std::vector<std::vector<glm::vec3>>& images) {
+            const CPURenderer renderer(scene, threadCount);
+            images.resize(cameras.size());
+
+            FrameStats total;
+            for(size_t i = 0; i < cameras.size(); i++) {
+                const glm::mat4 view = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(cameras[i]));
+                const FrameStats frame = renderer.render(view, path.resolution, images[i]);
+                total.seconds += frame.seconds;
+                total.traversal += frame.traversal;
+            }
+
+            return total;
+        };
+
+        std::vector<std::vector<glm::vec3>> fullImages;
+        const FrameStats fullStats = renderAll(fullScene, fullImages);
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << mesh.triangles.size() << " base triangles, " << fullRecords << " hierarchy records, " << cameras.size() << " views at " << path.resolution.x
+            << "x" << path.resolution.y << std::endl;
+        std::cout << "tolerance,records,flat_leaves,saved_records,hierarchy_mb,saved_mb,collapse_ms,ms,speedup,hierarchy_nodes_per_ray,flat_leaves_per_ray,"
+            "micro_triangle_tests_per_ray,lost_hits,different_pixels" << std::endl;
+
+        const auto printRow = [&](const std::string& tolerance, const size_t records, const size_t flatLeaves, const size_t bytes, const double collapseSeconds,
+                                  const FrameStats& stats, const size_t lostHits, const size_t differentPixels) {
+            const double rays = static_cast<double>(std::max<uint64_t>(1, stats.traversal.rays));
+            std::cout << tolerance << ',' << records << ',' << flatLeaves << ',' << fullRecords - records << ',' << static_cast<double>(bytes) / 1e6 << ','
+                << (static_cast<double>(fullBytes) - static_cast<double>(bytes)) / 1e6 << ',' << collapseSeconds * 1000.0 << ',' << stats.seconds * 1000.0 << ','
+                << fullStats.seconds / stats.seconds << ',' << static_cast<double>(stats.traversal.hierarchyNodesVisited) / rays << ','
+                << static_cast<double>(stats.traversal.flatLeaves) / rays << ',' << static_cast<double>(stats.traversal.microTriangleTests) / rays << ',' << lostHits << ','
+                << differentPixels << std::endl;
+        };
+        printRow("full", fullRecords, 0, fullBytes, 0.0, fullStats, 0, 0);
+
+        //Exactly flat subtrees lie in the plane of their flat leaf, so at a tolerance of 0 no hit may be lost. A pixel at the
+        //edge of a flat leaf can still differ, since the ray-triangle test has more slack around one large triangle.
+        bool noneLost = true;
+        for(const float tolerance : TOLERANCES) {
+            BakedMesh sparse = BakedMesh::bake(mesh);
+            const auto start = std::chrono::steady_clock::now();
+            const size_t flatLeaves = sparse.collapseFlatSubtrees(tolerance);
+            const double collapseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            const size_t records = fullRecords == 0 ? 0 : sparse.deltas.size(); //Without records there is one dummy value
+            const size_t bytes = sparse.minMaxDisplacements.size() * sizeof(glm::vec2) + sparse.deltas.size() * sizeof(float)
+                + sparse.interiorWords.size() * sizeof(InteriorWord) + sparse.interiorOffsets.size() * sizeof(std::uint32_t);
+
+            const CPUScene sparseScene(std::move(sparse));
+            std::vector<std::vector<glm::vec3>> images;
+            const FrameStats stats = renderAll(sparseScene, images);
+
+            size_t lostHits = 0, differentPixels = 0;
+            for(size_t i = 0; i < cameras.size(); i++) {
+                for(size_t p = 0; p < images[i].size(); p++) {
+                    differentPixels += glm::any(glm::greaterThan(glm::abs(images[i][p] - fullImages[i][p]), glm::vec3(1.0f / 255.0f)));
+                    lostHits += images[i][p] == Shading::missColor && fullImages[i][p] != Shading::missColor;
+                }
+            }
+            if(tolerance == 0.0f) noneLost = lostHits == 0;
+
+            std::ostringstream label;
+            label << std::defaultfloat << tolerance;
+            printRow(label.str(), records, flatLeaves, bytes, collapseSeconds, stats, lostHits, differentPixels);
+        }
+
+        return noneLost ? 0 : 1;
+    }
+
+    int instancing(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount) {
+        constexpr int COPIES_PER_SIDE[] = {1, 2, 4, 8};
+        constexpr int MAX_FLATTENED_PER_SIDE = 4; //Flattening more copies takes too much memory for large meshes
+
+        const auto renderAll = [&](const RayTracedScene& scene, std::vector<std::vector<glm::vec3>>& images) {
+            CPURenderer renderer(scene, threadCount);
+            images.resize(cameras.size());
+
+            FrameStats total;
+            for(size_t i = 0; i < cameras.size(); i++) {
+                const glm::mat4 view = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(cameras[i]));
+                const FrameStats frame = renderer.render(view, path.resolution, images[i]);
+                total.seconds += frame.seconds;
+                total.traversal += frame.traversal;
+            }
+
+            return total;
+        };
+
+        const BakedMesh baked = BakedMesh::bake(mesh);
+        AABB bounds;
+        for(const AABB& aabb : baked.AABBs) bounds.extend(aabb);
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << mesh.triangles.size() << " base triangles per copy, copies scaled to fit the mesh, " << cameras.size() << " views at " << path.resolution.x
+            << "x" << path.resolution.y << std::endl;
+        std::cout << "copies,instanced_mb,mesh_mb,instance_kb,flattened_mb,instanced_ms,flattened_ms,instanced_mrays_per_s,flattened_mrays_per_s,bvh_nodes_per_ray,"
+            "lost_hits,different_pixels" << std::endl;
+
+        //The copies are the same micro-triangles, only transformed, so apart from rounding at their edges they must be hit alike
+        size_t totalLostHits = 0, totalPixels = 0;
+        for(const int copiesPerSide : COPIES_PER_SIDE) {
+            const std::vector<glm::mat4> transforms = gridTransforms(bounds, copiesPerSide);
+            std::vector<InstancedScene::Instance> instances;
+            for(const glm::mat4& transform : transforms) instances.push_back({0, transform});
+
+            std::vector<CPUScene> unique;
+            unique.emplace_back(baked);
+            const InstancedScene instanced(std::move(unique), std::move(instances));
+            std::vector<std::vector<glm::vec3>> instancedImages;
+            const FrameStats instancedStats = renderAll(instanced, instancedImages);
+            const size_t instancedBytes = instanced.meshSizeInBytes() + instanced.instanceSizeInBytes();
+            const double rays = static_cast<double>(std::max<uint64_t>(1, instancedStats.traversal.rays));
+
+            std::cout << transforms.size() << ',' << static_cast<double>(instancedBytes) / 1e6 << ',' << static_cast<double>(instanced.meshSizeInBytes()) / 1e6 << ','
+                << static_cast<double>(instanced.instanceSizeInBytes()) / 1e3 << ',';
+            if(copiesPerSide <= MAX_FLATTENED_PER_SIDE) {
+                const CPUScene flattened(BakedMesh::bake(flattenCopies(mesh, transforms)));
+                std::vector<std::vector<glm::vec3>> flattenedImages;
+                const FrameStats flattenedStats = renderAll(flattened, flattenedImages);
+
+                size_t lostHits = 0, differentPixels = 0;
+                for(size_t i = 0; i < cameras.size(); i++) {
+                    for(size_t p = 0; p < flattenedImages[i].size(); p++) {
+                        differentPixels += glm::any(glm::greaterThan(glm::abs(instancedImages[i][p] - flattenedImages[i][p]), glm::vec3(1.0f / 255.0f)));
+                        lostHits += (instancedImages[i][p] == Shading::missColor) != (flattenedImages[i][p] == Shading::missColor);
+                    }
+                    totalPixels += flattenedImages[i].size();
+                }
+                totalLostHits += lostHits;
+
+                std::cout << static_cast<double>(flattened.getMesh().sizeInBytes() + flattened.accelerationSizeInBytes()) / 1e6 << ',' << instancedStats.seconds * 1000.0 << ','
+                    << flattenedStats.seconds * 1000.0 << ',' << instancedStats.raysPerSecond() / 1e6 << ',' << flattenedStats.raysPerSecond() / 1e6 << ','
+                    << static_cast<double>(instancedStats.traversal.bvhNodesVisited) / rays << ',' << lostHits << ',' << differentPixels << std::endl;
+            } else {
+                std::cout << ',' << instancedStats.seconds * 1000.0 << ",," << instancedStats.raysPerSecond() / 1e6 << ",,"
+                    << static_cast<double>(instancedStats.traversal.bvhNodesVisited) / rays << ",," << std::endl;
+            }
+        }
+
+        return totalLostHits <= totalPixels / 1000 ? 0 : 1;
+    }
+
+    int bvhRefit(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount) {
+        if(mesh.triangles.empty() || cameras.empty()) return 0;
+        constexpr int FRAMES = 8;
+        const glm::mat4 firstView = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(cameras.front()));
+
+        AABB bounds;
+        for(const Vertex& v : mesh.vertices) bounds.extend(v.position);
+
+        //The vertices nearest to a corner of the mesh, so that a part of it moves like a limb
+        std::vector<unsigned int> byDistance(mesh.vertices.size());
+        std::iota(byDistance.begin(), byDistance.end(), 0u);
+        std::ranges::sort(byDistance, {}, [&](const unsigned int v) { return glm::length(mesh.vertices[v].position - bounds.maxPos); });
+
+        //Fractions of the vertices that move, and how far they are twisted and pulled at the last frame
+        struct Round {
+            float fraction;
+            float twist;
+            float pull;
+        };
+        const Round rounds[] = {{0.01f, 0.5f, 0.0f}, {0.1f, 0.5f, 0.0f}, {0.1f, 0.5f, 2.0f}, {1.0f, 0.5f, 0.0f}, {1.0f, 10.0f, 0.0f}};
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << mesh.vertices.size() << " base vertices, " << mesh.triangles.size() << " base triangles, " << FRAMES << " frames per animation, first of " << cameras.size()
+            << " views at " << path.resolution.x << "x" << path.resolution.y << ", rebuild above " << CPUScene::MAX_REFIT_SAH_RATIO << " times the SAH cost" << std::endl;
+        std::cout << "moved_vertices,moved_triangles,twist,pull,move_ms,refit_ms,rebuild_ms,speedup,refit_nodes,sah_ratio,rebuilds,mismatches,different_pixels" << std::endl;
+
+        bool allAgree = true;
+        for(const auto& [fraction, twist, pull] : rounds) {
+            const size_t count = std::max<size_t>(1, static_cast<size_t>(fraction * static_cast<float>(mesh.vertices.size())));
+            const std::vector<unsigned int> indices(byDistance.begin(), byDistance.begin() + static_cast<std::ptrdiff_t>(count));
+
+            //The twist fades out towards the farthest moved vertex, so the mesh stays closed
+            const float radius = glm::length(mesh.vertices[indices.back()].position - bounds.maxPos);
+            std::vector<float> weights;
+            for(const unsigned int v : indices) weights.push_back(fraction < 1.0f && radius > 0.0f ? 1.0f - glm::length(mesh.vertices[v].position - bounds.maxPos) / radius : 1.0f);
+
+            Mesh moving = mesh;
+            CPUScene scene(BakedMesh::bake(moving));
+
+            double moveSeconds = 0.0, refitSeconds = 0.0, rebuildSeconds = 0.0;
+            CPUScene::MotionStats stats;
+            size_t movedTriangles = 0, refitNodes = 0, rebuilds = 0;
+            for(int frame = 1; frame <= FRAMES; frame++) {
+                const std::vector<Vertex> moved = twistVertices(mesh.vertices, indices, weights, bounds, twist * static_cast<float>(frame) / FRAMES, pull * static_cast<float>(frame) / FRAMES);
+
+                auto start = std::chrono::steady_clock::now();
+                const std::vector<unsigned int> triangles = moving.moveVertices(indices, moved);
+                moveSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                start = std::chrono::steady_clock::now();
+                stats = scene.applyMotion(moving, triangles, threadCount);
+                refitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                movedTriangles = stats.movedTriangles;
+                refitNodes += stats.refitNodes;
+                rebuilds += stats.rebuilt;
+            }
+
+            //What every frame costs without a refit
+            auto start = std::chrono::steady_clock::now();
+            const CPUScene rebuilt(BakedMesh::bake(moving));
+            rebuildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            //The AABBs and hierarchy records are computed from the moved micro-vertices by the same code as a full bake
+            const BakedMesh& a = scene.getMesh();
+            const BakedMesh& b = rebuilt.getMesh();
+            size_t mismatches = 0;
+            for(size_t i = 0; i < a.vertices.size(); i++) mismatches += a.vertices[i].position != b.vertices[i].position || a.vertices[i].direction != b.vertices[i].direction;
+            for(size_t i = 0; i < a.minMaxDisplacements.size(); i++) mismatches += a.minMaxDisplacements[i] != b.minMaxDisplacements[i];
+            for(size_t i = 0; i < a.deltas.size(); i++) mismatches += a.deltas[i] != b.deltas[i];
+            for(size_t i = 0; i < a.AABBs.size(); i++) mismatches += a.AABBs[i].minPos != b.AABBs[i].minPos || a.AABBs[i].maxPos != b.AABBs[i].maxPos;
+
+            //The displacement scales are not compared: the rebaked ones are divided out of the moved micro-vertices again,
+            //which loses precision where a direction component is close to 0. The refit tree must find the same hits as
+            //one built from scratch over the same baked data.
+            BakedMesh updated = scene.getMesh();
+            const CPUScene sameData(std::move(updated));
+            std::vector<glm::vec3> refitPixels, rebuiltPixels;
+            CPURenderer(scene, threadCount).render(firstView, path.resolution, refitPixels);
+            CPURenderer(sameData, threadCount).render(firstView, path.resolution, rebuiltPixels);
+            size_t differentPixels = 0;
+            for(size_t i = 0; i < refitPixels.size(); i++) differentPixels += glm::any(glm::greaterThan(glm::abs(refitPixels[i] - rebuiltPixels[i]), glm::vec3(1.0f / 255.0f)));
+
+            allAgree &= mismatches == 0 && differentPixels == 0;
+            const double refitMs = refitSeconds * 1000.0 / FRAMES;
+            std::cout << count << ',' << movedTriangles << ',' << twist << ',' << pull << ',' << moveSeconds * 1000.0 / FRAMES << ',' << refitMs << ',' << rebuildSeconds * 1000.0 << ','
+                << rebuildSeconds * 1000.0 / refitMs << ',' << refitNodes / FRAMES << ',' << stats.sahRatio << ',' << rebuilds << ',' << mismatches << ',' << differentPixels << std::endl;
+        }
+
+        return allAgree ? 0 : 1;
+    }
+
+    int shardedBake(const Mesh& mesh, const unsigned int threadCount, const std::filesystem::path& directory) {
+        constexpr unsigned int SHARD_COUNTS[] = {1, 2, 7, 32};
+        const unsigned int threads = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+        std::filesystem::create_directories(directory);
+
+        auto start = std::chrono::steady_clock::now();
+        const BakedMesh reference = BakedMesh::bake(mesh);
+        const double referenceSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << mesh.triangles.size() << " base triangles, " << reference.displacementScales.size() << " displacement scales, "
+            << reference.minMaxDisplacements.size() << " hierarchy records, " << referenceSeconds * 1000.0 << " ms in one bake" << std::endl;
+
+        //Every shard as if a process of its own baked it, through a file. The slowest shard is what the bake takes on
+        //as many processes, the merge is what the coordinator adds to it.
+        std::cout << "shards,order,slowest_shard_ms,total_shard_ms,merge_ms,shard_mb" << std::endl;
+        for(const VertexOrder order : {VertexOrder::ROW_MAJOR, VertexOrder::BIRD_CURVE}) {
+            for(const unsigned int shardCount : SHARD_COUNTS) {
+                const std::vector<ShardedBake::Range> ranges = ShardedBake::split(mesh, {0, static_cast<unsigned int>(mesh.triangles.size())}, shardCount);
+
+                double slowestSeconds = 0.0, totalSeconds = 0.0;
+                size_t bytes = 0;
+                std::vector<std::filesystem::path> files;
+                for(size_t i = 0; i < ranges.size(); i++) {
+                    start = std::chrono::steady_clock::now();
+                    const std::filesystem::path file = directory / ("shard-bench-" + std::to_string(i) + ".shard");
+                    ShardedBake::write(ShardedBake::bakeShard(mesh, ranges[i], order), file);
+                    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                    slowestSeconds = std::max(slowestSeconds, seconds);
+                    totalSeconds += seconds;
+                    bytes += std::filesystem::file_size(file);
+                    files.push_back(file);
+                }
+
+                start = std::chrono::steady_clock::now();
+                std::vector<ShardedBake::Shard> shards;
+                for(const std::filesystem::path& file : files) shards.push_back(ShardedBake::read(file));
+                [[maybe_unused]] const BakedMesh merged = ShardedBake::merge(std::move(shards));
+                const double mergeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                for(const std::filesystem::path& file : files) std::filesystem::remove(file);
+
+                std::cout << ranges.size() << ',' << (order == VertexOrder::ROW_MAJOR ? "row-major" : "bird-curve") << ',' << slowestSeconds * 1000.0 << ','
+                    << totalSeconds * 1000.0 << ',' << mergeSeconds * 1000.0 << ',' << static_cast<double>(bytes) / (1024.0 * 1024.0) << std::endl;
+            }
+        }
+
+        //The same split within one process, on threads
+        std::vector<unsigned int> threadCounts{1};
+        if(threads > 1) threadCounts.push_back(threads);
+        std::cout << "threads,ms,speedup" << std::endl;
+        for(const unsigned int t : threadCounts) {
+            start = std::chrono::steady_clock::now();
+            const BakedMesh baked = ShardedBake::bake(mesh, VertexOrder::ROW_MAJOR, t);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << t << ',' << seconds * 1000.0 << ',' << referenceSeconds / seconds << std::endl;
+        }
+
+        return 0;
+    }
+
+    int rayQuery(const BakedMesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, const unsigned int threadCount) {
+        constexpr int RUNS = 3;
+
+        const CPUScene hierarchy(mesh, CPUScene::TraversalMode::HIERARCHY);
+        const CPUScene grid(mesh, CPUScene::TraversalMode::GRID);
+        const CPUScene tessellated(mesh, CPUScene::TraversalMode::HIERARCHY, false, mesh.maxSubdivisionLevel + 1);
+        const std::pair<const char*, const CPUScene*> scenes[] = {{"hierarchy", &hierarchy}, {"grid", &grid}, {"tessellated", &tessellated}};
+
+        //Primary rays in blocks of a packet, as a tool that samples visibility from a viewpoint would order them
+        QueryRays cameraRays;
+        for(const CameraKeyframe& camera : cameras) {
+            const glm::mat4 invViewProj = glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(camera));
+            for(unsigned int blockY = 0; blockY < path.resolution.y; blockY += CPURenderer::PACKET_HEIGHT) {
+                for(unsigned int blockX = 0; blockX < path.resolution.x; blockX += CPURenderer::PACKET_WIDTH) {
+                    for(unsigned int y = blockY; y < std::min(blockY + CPURenderer::PACKET_HEIGHT, path.resolution.y); y++) {
+                        for(unsigned int x = blockX; x < std::min(blockX + CPURenderer::PACKET_WIDTH, path.resolution.x); x++) {
+                            cameraRays.push(CPURenderer::generateRay(invViewProj, {x, y}, path.resolution));
+                        }
+                    }
+                }
+            }
+        }
+
+        //As many segments between random points of the bounds, like visibility and collision tests between points of a scene
+        QueryRays randomRays;
+        const AABB bounds = hierarchy.bounds();
+        std::mt19937 rng(13);
+        std::uniform_real_distribution<float> along(0.0f, 1.0f);
+        const auto randomPoint = [&] {
+            return bounds.minPos + glm::vec3(along(rng), along(rng), along(rng)) * (bounds.maxPos - bounds.minPos);
+        };
+        for(size_t i = 0; i < cameraRays.size(); i++) {
+            const glm::vec3 from = randomPoint();
+            randomRays.push({from, 0.0f, randomPoint() - from, 1.0f});
+        }
+        const std::pair<const char*, const QueryRays*> raySets[] = {{"camera", &cameraRays}, {"random", &randomRays}};
+
+        const unsigned int threads = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<unsigned int> threadCounts{1};
+        if(threads > 1) threadCounts.push_back(threads);
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "# " << mesh.triangleData.size() << " base triangles, " << cameraRays.size() << " rays per set, packets of " << RAY_PACKET_SIZE << " rays, best of "
+            << RUNS << " runs" << std::endl;
+        std::cout << "rays,traversal,threads,packets,mrays_per_s,speedup,hits,different_hits" << std::endl;
+
+        for(const auto& [rayName, rays] : raySets) {
+            //Every query is compared with single rays through the hierarchy on one thread
+            QueryHits reference(rays->size());
+            double referenceRate = 0.0;
+
+            for(const auto& [sceneName, scene] : scenes) {
+                for(const bool packets : {false, true}) {
+                    for(const unsigned int t : threadCounts) {
+                        const RayQuery query(*scene, t, packets);
+                        QueryHits hits(rays->size());
+
+                        QueryStats best;
+                        for(int run = 0; run < RUNS; run++) {
+                            const QueryStats stats = query.trace(rays->arrays(), hits.arrays());
+                            if(run == 0 || stats.seconds < best.seconds) best = stats;
+                        }
+                        if(referenceRate == 0.0) {
+                            reference = hits;
+                            referenceRate = best.raysPerSecond();
+                        }
+
+                        //Rays that graze several micro-triangles can report another one of them, like in Benchmarks::packetTraversal
+                        size_t differentHits = 0;
+                        for(size_t i = 0; i < rays->size(); i++) differentHits += hits.baseTriangle[i] != reference.baseTriangle[i] || hits.microTriangle[i] != reference.microTriangle[i];
+
+                        std::cout << rayName << ',' << sceneName << ',' << t << ',' << (packets ? "yes" : "no") << ',' << best.raysPerSecond() / 1e6 << ','
+                            << best.raysPerSecond() / referenceRate << ',' << best.traversal.hits << ',' << differentHits << std::endl;
+                    }
+                }
+            }
+        }
+
+        return 0;
+    }
+}
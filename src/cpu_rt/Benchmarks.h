@@ -0,0 +1,183 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "CameraPath.h"
+#include "CPUScene.h"
+
+//Self-checks and microbenchmarks of the CPU ray tracer's kernels. They print their results and return an exit code.
+namespace Benchmarks {
+    /**
+     * Measures the throughput of every SIMD implementation of the edge kernels next to the scalar one, on random
+     * triangles and rays. That they give bit-identical results is checked by the tests (tests/EdgeKernelsTests.cpp).
+     *
+     * @return 0
+     */
+    int edgeKernels();
+
+    /**
+     * Plays thousands of animated channels forwards and compares sampling them from a map (how TransformationChannel
+     * used to store keyframes) with a binary search in the flat keyframe arrays, with a cursor per channel, and with all
+     * channels in one pass (TransformationChannels). Also checks that a cubic spline reproduces a cubic polynomial.
+     *
+     * @return 0 if every implementation gives bit-identical results to the map and the spline is exact, 1 otherwise
+     */
+    int transformationChannels();
+
+    /**
+     * Skins a synthetic character of a million base vertices, bent by a chain of joints, with every implementation of
+     * the skinning kernels on one and on all threads, over a few frames of an animation, and prints the vertices per
+     * second of each. That they give bit-identical vertices is checked by the tests (tests/SkinningTests.cpp).
+     *
+     * @param threadCount the number of threads to compare with one, 0 for every hardware thread
+     * @return 0
+     */
+    int skinning(unsigned int threadCount);
+
+    /**
+     * Renders every camera with single rays and with ray packets, and compares their rays per second and images.
+     *
+     * @param scene the scene to render
+     * @param cameras the views to render
+     * @param path the resolution and field of view of the cameras
+     * @param threadCount the number of threads to render with, 0 uses every hardware thread
+     */
+    int packetTraversal(const CPUScene& scene, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount);
+
+    /**
+     * Renders every camera at 1, 4 and 16 times its distance, with full detail and with level of detail termination,
+     * and compares their rays per second and images.
+     *
+     * @param lodPixels the level of detail to compare with, see CPURenderer::setLevelOfDetail
+     */
+    int levelOfDetail(const CPUScene& scene, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount, float lodPixels);
+
+    /**
+     * Counts per subdivision level how many base triangles support and prefer grid marching, then renders every camera
+     * with each traversal mode and compares their rays per second, work per ray and images with those of the hierarchy.
+     *
+     * @param scene the scene to render. Its traversal mode is changed while measuring and restored afterwards.
+     */
+    int gridTraversal(CPUScene& scene, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount);
+
+    /**
+     * Builds the scene with one AABB per base triangle and with split AABBs (see splitAABBs), renders every camera with
+     * both and compares how many procedural intersections they invoke per ray, their rays per second and their images.
+     */
+    int aabbSplitting(const BakedMesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount);
+
+    /**
+     * Builds the scene with every tessellation level from fully procedural to fully tessellated (see CPUScene), renders
+     * every camera with each and reports their memory, rays per second and images. Also prints the throughput crossover
+     * (the fastest level) and the memory crossover (the first level whose acceleration structure outweighs the baked mesh).
+     */
+    int hybridTessellation(const BakedMesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount);
+
+    /**
+     * Measures the throughput of the scalar AABB builder and of the parallel SIMD one, single-threaded and with every
+     * thread. Small meshes are repeated to a few million micro-vertices. That both give bit-identical AABBs is checked by
+     * the tests (tests/AABBBuilderTests.cpp).
+     *
+     * @return 0
+     */
+    int aabbBuild(const Mesh& mesh, unsigned int threadCount);
+
+    /**
+     * Renders the first camera once after baking the mesh eagerly and once after baking it lazily, and compares the time
+     * to the first image. Also reports how many base triangles the lazy frame had to build.
+     *
+     * @return 0 if both images are identical, 1 otherwise
+     */
+    int lazyBake(const std::shared_ptr<const Mesh>& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount);
+
+    /**
+     * Edits growing numbers of micro-vertex displacements and compares updating the scene with CPUScene::applyEdits to
+     * baking it again. Checks that the updated baked data is the same as the rebaked one, and that the first camera
+     * sees the same image through both.
+     *
+     * @return 0 if the updated scene agrees with the rebaked one after every edit, 1 otherwise
+     */
+    int incrementalBake(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount);
+
+    /**
+     * Bakes the mesh into a paged file (see PagedBlocks) and renders every camera from it with caches of shrinking size,
+     * compared to rendering the mesh from memory. Reports the time, hit rate, evictions and bytes read of each cache.
+     *
+     * @param file where to write the paged file, removed afterwards
+     * @return 0 if every cache gives the same images as the mesh in memory, 1 otherwise
+     */
+    int pagedBlocks(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount, const std::filesystem::path& file);
+
+    /**
+     * Compares row-major and bird-curve order of the displacement scales (see VertexOrder). For every subdivision level
+     * of the mesh and every level of its hierarchy, prints how many cache lines the scales of a hierarchy triangle span
+     * on average in each order, which is what a traversal that reaches the triangle cold misses. Then renders every
+     * camera with each order.
+     *
+     * @return 0 if both orders give identical images, 1 otherwise
+     */
+    int vertexOrder(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount);
+
+    /**
+     * Compares the full hierarchy records with quantized ones (see BakedMesh::quantizeHierarchy): prints the memory of
+     * both, then renders every camera with each and prints the time and the hierarchy triangles, bounding triangle tests
+     * and micro-triangle tests per ray, which grow with the looser quantized bounds.
+     *
+     * @return 0 if the quantized hierarchy finds every hit that the full one finds, 1 otherwise
+     */
+    int quantizedHierarchy(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount);
+
+    /**
+     * Makes the hierarchy sparse (see BakedMesh::collapseFlatSubtrees) with growing tolerances and prints how many
+     * records and how much memory each saves, then renders every camera with each and prints the time and the hierarchy
+     * triangles, flat leaves and micro-triangle tests per ray, next to the full hierarchy.
+     *
+     * @return 0 if collapsing only exactly flat subtrees loses no hit of the full hierarchy, 1 otherwise
+     */
+    int sparseHierarchy(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount);
+
+    /**
+     * Instances the mesh on grids of 1, 4, 16 and 64 copies, scaled down to fit its bounds so that the same cameras see
+     * all of them, and prints the memory of the instanced scene (see InstancedScene) next to that of one mesh with every
+     * copy baked into it. Renders every camera with both and compares their time, rays per second and images. Only up to
+     * 16 copies are flattened.
+     *
+     * @return 0 if the instanced and flattened copies are hit alike in all but a thousandth of the pixels, 1 otherwise
+     */
+    int instancing(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount);
+
+    /**
+     * Twists and pulls growing parts of the mesh over a few frames, like a skinned animation, and compares updating the
+     * scene with CPUScene::applyMotion (refitting its BVH) every frame to baking it again. The last animation twists the
+     * whole mesh so far that the refit BVH degrades and is rebuilt. After every animation, checks that the updated
+     * vertices, AABBs and hierarchy records are the same as the rebaked ones, and that the first camera sees the same
+     * image through the refit BVH as through one built from scratch.
+     *
+     * @return 0 if the updated scene agrees with the rebaked one after every animation, 1 otherwise
+     */
+    int bvhRefit(const Mesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount);
+
+    /**
+     * Bakes the mesh in 1, 2, 7 and 32 shards (see ShardedBake), each through a file as if another process baked it,
+     * and merges them, in row-major and bird-curve order. Prints the time of the slowest shard, of all shards and of the
+     * merge, and the size of the shard files. Then bakes the mesh in pieces on threads. That the merged meshes are
+     * bit-identical to BakedMesh::bake is checked by the tests (tests/ShardedBakeTests.cpp).
+     *
+     * @param directory where to write the shard files, which are removed afterwards
+     * @return 0
+     */
+    int shardedBake(const Mesh& mesh, unsigned int threadCount, const std::filesystem::path& directory);
+
+    /**
+     * Queries the primary rays of every camera, in blocks of a packet, and as many segments between random points of
+     * the bounds through RayQuery, with the hierarchy, the micro-grid and fully tessellated base triangles, with single
+     * rays and packets, on one thread and on all. Prints the rays per second of each, and how many hits differ from
+     * single rays through the hierarchy on one thread. That every hit point is where its micro-triangle and barycentrics
+     * put it, and that more threads give bit-identical hits, is checked by the tests (tests/RayQueryTests.cpp).
+     *
+     * @return 0
+     */
+    int rayQuery(const BakedMesh& mesh, const std::vector<CameraKeyframe>& cameras, const CameraPath& path, unsigned int threadCount);
+}
@@ -0,0 +1,212 @@
+#include "CPURenderer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+#include <framework/image.h>
+
+#include "Shading.h"
+
+//Every thread counts its own statistics, padded to a cache line since the counters are written for every ray
+struct alignas(64) ThreadStats {
+    TraversalStats traversal;
+};
+
+CPURenderer::CPURenderer(const RayTracedScene& sceneToRender, const unsigned int requestedThreadCount, const Schedule pixelSchedule, const unsigned int stealingTileSize):
+    scene(sceneToRender), threadCount(requestedThreadCount > 0 ? requestedThreadCount : std::max(1u, std::thread::hardware_concurrency())), schedule(pixelSchedule),
+    tileSize(stealingTileSize)
+{
+    arenas.reserve(threadCount);
+    for(unsigned int i = 0; i < threadCount; i++) arenas.push_back(scene.createArena());
+}
+
+unsigned int CPURenderer::getThreadCount() const {
+    return threadCount;
+}
+
+CPURenderer::Schedule CPURenderer::getSchedule() const {
+    return schedule;
+}
+
+void CPURenderer::setPacketTraversal(const bool enabled) {
+    packetTraversal = enabled;
+}
+
+bool CPURenderer::getPacketTraversal() const {
+    return packetTraversal;
+}
+
+void CPURenderer::setLevelOfDetail(const float pixels) {
+    lodPixels = std::max(0.0f, pixels);
+}
+
+float CPURenderer::getLevelOfDetail() const {
+    return lodPixels;
+}
+
+RayCone CPURenderer::primaryRayCone(const glm::mat4& invViewProj, const glm::uvec2& resolution) const {
+    if(lodPixels <= 0.0f) return {};
+
+    //The angle between the rays through two neighbouring pixels in the center of the frame. A pinhole camera has no width at the origin.
+    const glm::uvec2 center = resolution / 2u;
+    const glm::vec3 d0 = generateRay(invViewProj, center, resolution).direction;
+    const glm::vec3 d1 = generateRay(invViewProj, center + glm::uvec2(1, 0), resolution).direction;
+
+    return {0.0f, lodPixels * std::acos(std::clamp(glm::dot(d0, d1), -1.0f, 1.0f))};
+}
+
+RayDesc CPURenderer::generateRay(const glm::mat4& invViewProj, const glm::uvec2& pixel, const glm::uvec2& resolution) {
+    // Convert to [0, 1]
+    const glm::vec2 screenUV = (glm::vec2(pixel) + 0.5f) / glm::vec2(resolution);
+
+    // Convert to Normalized Device Coordinates [-1, 1]
+    glm::vec2 ndc = screenUV * 2.0f - 1.0f;
+    ndc.y *= -1.0f; // Flip Y for DX convention
+
+    // Unproject to world space
+    glm::vec4 nearPoint = invViewProj * glm::vec4(ndc.x, ndc.y, 0.0f, 1.0f);
+    glm::vec4 farPoint = invViewProj * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+
+    nearPoint /= nearPoint.w;
+    farPoint /= farPoint.w;
+
+    return {glm::vec3(nearPoint), 0.001f, glm::normalize(glm::vec3(farPoint) - glm::vec3(nearPoint)), 10000.0f};
+}
+
+glm::vec3 CPURenderer::shadePixel(const glm::mat4& invViewProj, const glm::uvec2& pixel, const glm::uvec2& resolution, TraversalStats& stats, TraversalArena& arena,
+                                  const RayCone& cone) const {
+    HitInfo hit;
+    if(!scene.traceRay(generateRay(invViewProj, pixel, resolution), hit, stats, arena, cone)) return Shading::missColor;
+
+    return Shading::shade(hit.N, hit.V);
+}
+
+FrameStats CPURenderer::render(const glm::mat4& invViewProj, const glm::uvec2& resolution, std::vector<glm::vec3>& pixels) const {
+    return render(invViewProj, resolution, {{0, 0}, resolution}, pixels);
+}
+
+FrameStats CPURenderer::render(const glm::mat4& invViewProj, const glm::uvec2& resolution, const Tile& window, std::vector<glm::vec3>& pixels) const {
+    assert(window.max.x <= resolution.x && window.max.y <= resolution.y);
+    const glm::uvec2 size = window.max - window.min;
+    pixels.resize(static_cast<size_t>(size.x) * size.y);
+
+    const auto start = std::chrono::steady_clock::now();
+    //The footprint of the rays depends on the frame rather than the window, so a split frame has the same level of detail
+    const RayCone cone = primaryRayCone(invViewProj, resolution);
+    FrameStats frameStats = schedule == Schedule::STATIC_BANDS ? renderBands(invViewProj, resolution, cone, window, pixels)
+                                                               : renderTiles(invViewProj, resolution, cone, window, pixels);
+    frameStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return frameStats;
+}
+
+FrameStats CPURenderer::renderBands(const glm::mat4& invViewProj, const glm::uvec2& resolution, const RayCone& cone, const Tile& window,
+                                    std::vector<glm::vec3>& pixels) const {
+    const unsigned int height = window.max.y - window.min.y;
+    const unsigned int bands = std::clamp(threadCount, 1u, std::max(1u, height));
+    std::vector<ThreadStats> bandStats(bands);
+
+    const auto renderBand = [&](const unsigned int band) {
+        const unsigned int yBegin = window.min.y + static_cast<unsigned int>(static_cast<uint64_t>(height) * band / bands);
+        const unsigned int yEnd = window.min.y + static_cast<unsigned int>(static_cast<uint64_t>(height) * (band + 1) / bands);
+
+        renderRegion(invViewProj, resolution, cone, window, {{window.min.x, yBegin}, {window.max.x, yEnd}}, pixels, bandStats[band].traversal, arenas[band]);
+    };
+
+    //The calling thread renders the last band itself
+    std::vector<std::thread> workers;
+    workers.reserve(bands - 1);
+    for(unsigned int band = 0; band + 1 < bands; band++) workers.emplace_back(renderBand, band);
+    renderBand(bands - 1);
+    for(std::thread& worker : workers) worker.join();
+
+    FrameStats frameStats;
+    for(const ThreadStats& stats : bandStats) frameStats.traversal += stats.traversal;
+
+    return frameStats;
+}
+
+FrameStats CPURenderer::renderTiles(const glm::mat4& invViewProj, const glm::uvec2& resolution, const RayCone& cone, const Tile& window,
+                                    std::vector<glm::vec3>& pixels) const {
+    //The tiles are laid out over the window and moved to where it is in the frame
+    const TileScheduler scheduler(window.max - window.min, tileSize, threadCount);
+
+    std::vector<ThreadStats> workerStats(threadCount);
+
+    FrameStats frameStats;
+    frameStats.stolenTiles = scheduler.run([&](const unsigned int worker, const Tile& tile) {
+        renderRegion(invViewProj, resolution, cone, window, {tile.min + window.min, tile.max + window.min}, pixels, workerStats[worker].traversal, arenas[worker]);
+    });
+
+    for(const ThreadStats& stats : workerStats) frameStats.traversal += stats.traversal;
+
+    return frameStats;
+}
+
+void CPURenderer::renderRegion(const glm::mat4& invViewProj, const glm::uvec2& resolution, const RayCone& cone, const Tile& window, const Tile& region,
+                               std::vector<glm::vec3>& pixels, TraversalStats& stats, TraversalArena& arena) const {
+    const unsigned int width = window.max.x - window.min.x;
+    const auto pixelIndex = [&](const glm::uvec2& pixel) { return static_cast<size_t>(pixel.y - window.min.y) * width + (pixel.x - window.min.x); };
+
+    if(!packetTraversal) {
+        for(unsigned int y = region.min.y; y < region.max.y; y++) {
+            for(unsigned int x = region.min.x; x < region.max.x; x++) {
+                pixels[pixelIndex({x, y})] = shadePixel(invViewProj, {x, y}, resolution, stats, arena, cone);
+            }
+        }
+        return;
+    }
+
+    //Lane i of a packet is pixel (i % PACKET_WIDTH, i / PACKET_WIDTH) of the block, lanes outside of the region are inactive
+    for(unsigned int blockY = region.min.y; blockY < region.max.y; blockY += PACKET_HEIGHT) {
+        for(unsigned int blockX = region.min.x; blockX < region.max.x; blockX += PACKET_WIDTH) {
+            RayPacket packet;
+            for(unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+                const glm::uvec2 pixel(blockX + lane % PACKET_WIDTH, blockY + lane / PACKET_WIDTH);
+                if(pixel.x >= region.max.x || pixel.y >= region.max.y) continue;
+
+                packet.rays[lane] = generateRay(invViewProj, pixel, resolution);
+                packet.activeMask |= 1u << lane;
+            }
+
+            HitInfo hits[RAY_PACKET_SIZE];
+            const unsigned int hitMask = scene.tracePacket(packet, hits, stats, arena, cone);
+
+            for(unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+                if(!(packet.activeMask & (1u << lane))) continue;
+
+                const glm::uvec2 pixel(blockX + lane % PACKET_WIDTH, blockY + lane / PACKET_WIDTH);
+                pixels[pixelIndex(pixel)] = (hitMask & (1u << lane)) ? Shading::shade(hits[lane].N, hits[lane].V) : Shading::missColor;
+            }
+        }
+    }
+}
+
+void CPURenderer::writeImage(const std::vector<glm::vec3>& pixels, const glm::uvec2& resolution, const std::filesystem::path& filePath) {
+    writeImage(toRGB8(pixels), resolution, filePath);
+}
+
+std::vector<uint8_t> CPURenderer::toRGB8(const std::vector<glm::vec3>& pixels) {
+    //The same conversion as Image::set_pixel
+    std::vector<uint8_t> rgb(3 * pixels.size());
+    for(size_t i = 0; i < pixels.size(); i++) {
+        const glm::vec3 color = glm::clamp(pixels[i], 0.0f, 1.0f);
+        for(int channel = 0; channel < 3; channel++) rgb[3 * i + static_cast<size_t>(channel)] = static_cast<uint8_t>(color[channel] * 255.0f);
+    }
+
+    return rgb;
+}
+
+void CPURenderer::writeImage(const std::vector<uint8_t>& rgb, const glm::uvec2& resolution, const std::filesystem::path& filePath) {
+    if(rgb.size() != 3 * static_cast<size_t>(resolution.x) * resolution.y) throw std::invalid_argument("The image does not have 3 bytes for every pixel");
+
+    Image image(static_cast<int>(resolution.x), static_cast<int>(resolution.y), 3);
+    std::copy(rgb.begin(), rgb.end(), image.get_data());
+
+    const bool written = filePath.extension() == ".bmp" ? image.writeBitmapToFile(filePath) : image.writePNGToFile(filePath);
+    if(!written) throw std::runtime_error("Could not write " + filePath.string());
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "RayDesc.h"
+#include "RayTracedScene.h"
+#include "TileScheduler.h"
+#include "TraversalArena.h"
+
+struct FrameStats {
+    double seconds = 0.0;
+    TraversalStats traversal;
+    unsigned int stolenTiles = 0;
+
+    [[nodiscard]] double raysPerSecond() const {
+        return seconds > 0.0 ? static_cast<double>(traversal.rays) / seconds : 0.0;
+    }
+};
+
+//Renders a CPUScene or InstancedScene the same way the ray tracing pipeline does: rays are generated like raygen.hlsl does, and shaded like closesthit.hlsl and miss.hlsl
+class CPURenderer {
+public:
+    enum class Schedule {
+        STATIC_BANDS, //One contiguous band of rows per thread
+        WORK_STEALING //Small tiles in Morton order, see TileScheduler
+    };
+
+    /**
+     * @param sceneToRender the scene to render
+     * @param requestedThreadCount the number of threads to render with, 0 uses every hardware thread
+     * @param pixelSchedule how the pixels are distributed over the threads
+     * @param stealingTileSize the size of the tiles when work stealing
+     */
+    explicit CPURenderer(const RayTracedScene& sceneToRender, unsigned int requestedThreadCount = 0, Schedule pixelSchedule = Schedule::WORK_STEALING,
+                         unsigned int stealingTileSize = TileScheduler::DEFAULT_TILE_SIZE);
+
+    [[nodiscard]] unsigned int getThreadCount() const;
+    [[nodiscard]] Schedule getSchedule() const;
+
+    //Trace the primary rays of blocks of PACKET_WIDTH x PACKET_HEIGHT pixels as packets, see CPUScene::tracePacket
+    void setPacketTraversal(bool enabled);
+    [[nodiscard]] bool getPacketTraversal() const;
+
+    /**
+     * Level of detail: the micro-mesh traversal stops at hierarchy triangles that are smaller than this many pixels
+     * (see RayCone). 0 disables level of detail, which is the default.
+     */
+    void setLevelOfDetail(float pixels);
+    [[nodiscard]] float getLevelOfDetail() const;
+
+    //The footprint of the primary rays of a frame, given the level of detail
+    [[nodiscard]] RayCone primaryRayCone(const glm::mat4& invViewProj, const glm::uvec2& resolution) const;
+
+    static constexpr unsigned int PACKET_WIDTH = 4;
+    static constexpr unsigned int PACKET_HEIGHT = RAY_PACKET_SIZE / PACKET_WIDTH;
+
+    //Generates the primary ray through the center of a pixel, exactly like raygen.hlsl
+    [[nodiscard]] static RayDesc generateRay(const glm::mat4& invViewProj, const glm::uvec2& pixel, const glm::uvec2& resolution);
+
+    [[nodiscard]] glm::vec3 shadePixel(const glm::mat4& invViewProj, const glm::uvec2& pixel, const glm::uvec2& resolution, TraversalStats& stats, TraversalArena& arena,
+                                       const RayCone& cone = {}) const;
+
+    /**
+     * Renders a full frame on all threads. Every thread uses its own preallocated traversal arena, so a renderer can
+     * only render one frame at a time.
+     *
+     * @param invViewProj the inverse of projection * view
+     * @param resolution the resolution of the frame
+     * @param pixels the output colors, row by row starting at the top. Resized to fit the resolution.
+     * @return timings and traversal statistics of this frame
+     */
+    FrameStats render(const glm::mat4& invViewProj, const glm::uvec2& resolution, std::vector<glm::vec3>& pixels) const;
+
+    /**
+     * Renders a rectangle of a frame on all threads, with the same results as the same pixels of render(), so that a
+     * frame can be split between several renderers. With packet traversal that only holds for a window that starts at a
+     * multiple of the tile size, which groups the rays into the same packets.
+     *
+     * @param window the pixels to render, within the resolution
+     * @param pixels the output colors of the window, row by row starting at its top. Resized to fit the window.
+     */
+    FrameStats render(const glm::mat4& invViewProj, const glm::uvec2& resolution, const Tile& window, std::vector<glm::vec3>& pixels) const;
+
+    /**
+     * Writes the output of render() to an image file. The format is chosen by the extension: .bmp writes a bitmap,
+     * anything else a PNG. Throws std::runtime_error if the file could not be written, for example because its
+     * directory does not exist.
+     *
+     * @param pixels the colors in [0, 1], row by row starting at the top
+     * @param resolution the resolution of the frame
+     * @param filePath the file to write to
+     */
+    static void writeImage(const std::vector<glm::vec3>& pixels, const glm::uvec2& resolution, const std::filesystem::path& filePath);
+
+    //Converts colors in [0, 1] to 8 bits per channel, exactly as writeImage stores them
+    [[nodiscard]] static std::vector<uint8_t> toRGB8(const std::vector<glm::vec3>& pixels);
+    //Writes colors that were converted with toRGB8, see writeImage
+    static void writeImage(const std::vector<uint8_t>& rgb, const glm::uvec2& resolution, const std::filesystem::path& filePath);
+
+private:
+    const RayTracedScene& scene;
+    unsigned int threadCount;
+    Schedule schedule;
+    unsigned int tileSize;
+    bool packetTraversal = false;
+    float lodPixels = 0.0f;
+    mutable std::vector<TraversalArena> arenas; //One per thread
+
+    //Renders the pixels of a rectangle of the frame into the pixels of the window that contains it
+    void renderRegion(const glm::mat4& invViewProj, const glm::uvec2& resolution, const RayCone& cone, const Tile& window, const Tile& region,
+                      std::vector<glm::vec3>& pixels, TraversalStats& stats, TraversalArena& arena) const;
+
+    FrameStats renderBands(const glm::mat4& invViewProj, const glm::uvec2& resolution, const RayCone& cone, const Tile& window, std::vector<glm::vec3>& pixels) const;
+    FrameStats renderTiles(const glm::mat4& invViewProj, const glm::uvec2& resolution, const RayCone& cone, const Tile& window, std::vector<glm::vec3>& pixels) const;
+};
@@ -0,0 +1,345 @@
+#include "CPUScene.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <span>
+
+#include "AABBSplitter.h"
+#include "PagedBlocks.h"
+
+//Rays of a packet whose directions differ by more than about 8 degrees are traced one by one
+static constexpr float MIN_PACKET_COHERENCE = 0.99f;
+
+bool CPUScene::isCoherent(const RayPacket& packet) {
+    const int first = std::countr_zero(packet.activeMask);
+
+    for(int lane = first + 1; lane < RAY_PACKET_SIZE; lane++) {
+        if((packet.activeMask & (1u << lane)) && glm::dot(packet.rays[lane].direction, packet.rays[first].direction) < MIN_PACKET_COHERENCE) return false;
+    }
+
+    return true;
+}
+
+CPUScene::CPUScene(BakedMesh mesh, const TraversalMode mode, const bool splitTriangles, const int tessellationLevel): bakedMesh(std::move(mesh)) {
+    buildBVH(splitTriangles, tessellationLevel);
+    setTraversalMode(mode);
+}
+
+CPUScene CPUScene::bakeLazily(std::shared_ptr<const Mesh> mesh, const TraversalMode mode, const bool splitTriangles, const int tessellationLevel, const VertexOrder order) {
+    CPUScene scene;
+    scene.bakedMesh = BakedMesh::bakeLazily(*mesh, order);
+    scene.lazyHierarchy = std::make_unique<LazyHierarchy>(std::move(mesh), scene.bakedMesh);
+
+    //The split AABBs are chosen with the hierarchy records of every base triangle
+    if(splitTriangles) scene.lazyHierarchy->buildAll();
+
+    scene.buildBVH(splitTriangles, tessellationLevel);
+    scene.setTraversalMode(mode);
+    return scene;
+}
+
+void CPUScene::buildBVH(const bool splitTriangles, const int tessellationLevel) {
+    //A rebuild starts from scratch
+    tessellateBelowLevel = tessellationLevel;
+    bvhPrimitives.clear();
+    microTriangles.clear();
+    splitBounds.clear();
+    trianglePrimitives.clear();
+    splitBaseTriangles = 0;
+    tessellatedTriangles = 0;
+
+    if(!splitTriangles && tessellationLevel <= 0) {
+        bvh = BVH(bakedMesh.AABBs);
+        return;
+    }
+
+    SplitAABBs procedural;
+    if(splitTriangles) {
+        procedural = splitAABBs(bakedMesh);
+    } else {
+        procedural.AABBs = bakedMesh.AABBs;
+        for(unsigned int i = 0; i < bakedMesh.triangleData.size(); i++) procedural.nodes.push_back({i, 0, 0});
+    }
+
+    //Procedural primitives come first, then the micro-triangles of the tessellated base triangles
+    const auto isTessellated = [&](const unsigned int primitiveIndex) { return bakedMesh.triangleData[primitiveIndex].subDivisionLevel < tessellationLevel; };
+
+    std::vector<AABB> AABBs;
+    for(size_t i = 0; i < procedural.nodes.size(); i++) {
+        const MicroMeshNode& node = procedural.nodes[i];
+        if(isTessellated(node.primitiveIndex)) continue;
+
+        AABBs.push_back(procedural.AABBs[i]);
+        bvhPrimitives.push_back(node);
+        if(splitTriangles) splitBounds.push_back(procedural.AABBs[i]);
+
+        //Every split base triangle has exactly one node with local index 0 below the root
+        if(node.level > 0 && node.localIndex == 0) splitBaseTriangles++;
+    }
+
+    for(unsigned int i = 0; i < bakedMesh.triangleData.size(); i++) {
+        if(!isTessellated(i)) continue;
+
+        const std::vector<MicroTriangle> triangles = tessellateMicroMeshTriangle(bakedMesh, i);
+        microTriangles.insert(microTriangles.end(), triangles.begin(), triangles.end());
+        tessellatedTriangles++;
+    }
+
+    for(const MicroTriangle& triangle : microTriangles) {
+        AABB& aabb = AABBs.emplace_back();
+        for(const glm::vec3& v : triangle.vertices) aabb.extend(v);
+    }
+
+    bvh = BVH(AABBs);
+}
+
+void CPUScene::findTrianglePrimitives() {
+    trianglePrimitives.assign(bakedMesh.triangleData.size(), glm::uvec2(0));
+
+    //The primitives of a base triangle are next to each other
+    const auto add = [&](const unsigned int primitiveIndex, const unsigned int bvhPrimitive) {
+        glm::uvec2& range = trianglePrimitives[primitiveIndex];
+        if(range.x == range.y) range.x = bvhPrimitive;
+        range.y = bvhPrimitive + 1;
+    };
+
+    for(unsigned int i = 0; i < bvhPrimitives.size(); i++) add(bvhPrimitives[i].primitiveIndex, i);
+    for(unsigned int i = 0; i < microTriangles.size(); i++) add(microTriangles[i].primitiveIndex, static_cast<unsigned int>(bvhPrimitives.size()) + i);
+}
+
+CPUScene::EditStats CPUScene::applyEdits(const Mesh& mesh) {
+    //The records of the edited base triangles are updated, so they have to exist
+    if(lazyHierarchy) lazyHierarchy->buildAll();
+
+    const BakedMeshUpdate update = bakedMesh.applyEdits(mesh, mesh.dirtyMicroVertices(), editedHierarchies);
+
+    //Whether the micro-grid pays off depends on the displacements
+    for(const unsigned int i : update.triangles) gridTraversal[i] = usesGridTraversal(i);
+
+    const std::vector<unsigned int> primitives = updatePrimitives(update.triangles);
+
+    EditStats stats;
+    stats.editedTriangles = update.triangles.size();
+    stats.updatedRecords = update.updatedRecords;
+    stats.refitNodes = bvh.refit(primitives, [&](const unsigned int bvhPrimitive) { return primitiveBounds(bvhPrimitive); });
+    return stats;
+}
+
+CPUScene::MotionStats CPUScene::applyMotion(const Mesh& mesh, const std::span<const unsigned int> triangles, const unsigned int threadCount, const float maxSahRatio) {
+    //The records of the moved base triangles are recomputed, and the lazy ones would be computed from the old positions
+    if(lazyHierarchy) lazyHierarchy->buildAll();
+
+    const BakedMeshUpdate update = bakedMesh.applyMotion(mesh, triangles, threadCount);
+
+    //Whether the micro-grid pays off depends on how far the displacements move micro-vertices along the triangle
+    for(const unsigned int i : update.triangles) gridTraversal[i] = usesGridTraversal(i);
+
+    MotionStats stats;
+    stats.movedTriangles = update.triangles.size();
+    stats.updatedRecords = update.updatedRecords;
+
+    const std::vector<unsigned int> primitives = updatePrimitives(update.triangles);
+    stats.refitNodes = bvh.refit(primitives, [&](const unsigned int bvhPrimitive) { return primitiveBounds(bvhPrimitive); }, threadCount);
+
+    const float builtCost = bvh.builtSahCost();
+    stats.sahRatio = builtCost > 0.0f ? bvh.sahCost() / builtCost : 1.0f;
+    if(stats.sahRatio > maxSahRatio) {
+        buildBVH(!splitBounds.empty(), tessellateBelowLevel);
+        stats.refitNodes = 0;
+        stats.rebuilt = true;
+    }
+
+    return stats;
+}
+
+std::vector<unsigned int> CPUScene::updatePrimitives(const std::span<const unsigned int> triangles) {
+    std::vector<unsigned int> primitives;
+    if(bvhPrimitives.empty() && microTriangles.empty()) {
+        primitives.assign(triangles.begin(), triangles.end());
+    } else {
+        if(trianglePrimitives.empty()) findTrianglePrimitives();
+
+        for(const unsigned int i : triangles) {
+            const glm::uvec2 range = trianglePrimitives[i];
+
+            if(range.x >= bvhPrimitives.size()) {
+                //The descent does not depend on the displacements or positions, so there are as many micro-triangles as before
+                const std::vector<MicroTriangle> tessellated = tessellateMicroMeshTriangle(bakedMesh, i);
+                std::copy_n(tessellated.begin(), std::min<size_t>(tessellated.size(), range.y - range.x), microTriangles.begin() + static_cast<std::ptrdiff_t>(range.x - bvhPrimitives.size()));
+            } else if(!splitBounds.empty()) {
+                refitSplitAABBs(bakedMesh, std::span(bvhPrimitives).subspan(range.x, range.y - range.x), std::span(splitBounds).subspan(range.x, range.y - range.x));
+            }
+
+            for(unsigned int bvhPrimitive = range.x; bvhPrimitive < range.y; bvhPrimitive++) primitives.push_back(bvhPrimitive);
+        }
+    }
+
+    return primitives;
+}
+
+bool CPUScene::usesGridTraversal(const unsigned int primitiveIndex) const {
+    if(traversalMode == TraversalMode::HIERARCHY) return false;
+
+    return traversalMode == TraversalMode::GRID ? supportsGridTraversal(bakedMesh, primitiveIndex) : prefersGridTraversal(bakedMesh, primitiveIndex);
+}
+
+AABB CPUScene::primitiveBounds(const unsigned int bvhPrimitive) const {
+    if(bvhPrimitives.empty() && microTriangles.empty()) return bakedMesh.AABBs[bvhPrimitive];
+
+    //The same AABBs buildBVH builds the BVH from
+    if(bvhPrimitive >= bvhPrimitives.size()) {
+        AABB aabb;
+        for(const glm::vec3& v : microTriangles[bvhPrimitive - bvhPrimitives.size()].vertices) aabb.extend(v);
+        return aabb;
+    }
+    if(!splitBounds.empty()) return splitBounds[bvhPrimitive];
+
+    return bakedMesh.AABBs[bvhPrimitives[bvhPrimitive].primitiveIndex];
+}
+
+void CPUScene::setTraversalMode(const TraversalMode mode) {
+    traversalMode = mode;
+    gridTraversal.resize(bakedMesh.triangleData.size());
+    for(unsigned int i = 0; i < gridTraversal.size(); i++) gridTraversal[i] = usesGridTraversal(i);
+}
+
+CPUScene::TraversalMode CPUScene::getTraversalMode() const {
+    return traversalMode;
+}
+
+size_t CPUScene::gridTriangleCount() const {
+    return static_cast<size_t>(std::ranges::count(gridTraversal, 1));
+}
+
+size_t CPUScene::primitiveCount() const {
+    if(bvhPrimitives.empty() && microTriangles.empty()) return bakedMesh.triangleData.size();
+
+    return bvhPrimitives.size() + microTriangles.size();
+}
+
+size_t CPUScene::splitTriangleCount() const {
+    return splitBaseTriangles;
+}
+
+size_t CPUScene::tessellatedTriangleCount() const {
+    return tessellatedTriangles;
+}
+
+size_t CPUScene::microTriangleCount() const {
+    return microTriangles.size();
+}
+
+size_t CPUScene::accelerationSizeInBytes() const {
+    return bvh.sizeInBytes() + bvhPrimitives.size() * sizeof(MicroMeshNode) + microTriangles.size() * sizeof(MicroTriangle) + splitBounds.size() * sizeof(AABB)
+        + trianglePrimitives.size() * sizeof(glm::uvec2);
+}
+
+int CPUScene::wholeBaseTriangle(const unsigned int bvhPrimitive) const {
+    if(bvhPrimitives.empty() && microTriangles.empty()) return static_cast<int>(bvhPrimitive);
+    if(bvhPrimitive >= bvhPrimitives.size() || bvhPrimitives[bvhPrimitive].level > 0) return -1;
+
+    return static_cast<int>(bvhPrimitives[bvhPrimitive].primitiveIndex);
+}
+
+bool CPUScene::intersectTriangle(const unsigned int primitiveIndex, const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena, const RayCone& cone) const {
+    if(lazyHierarchy) lazyHierarchy->ensureBuilt(primitiveIndex);
+    if(gridTraversal[primitiveIndex] && !cone.isEnabled()) return intersectMicroMeshTriangleGrid(bakedMesh, primitiveIndex, ray, hit, stats, arena);
+
+    return intersectMicroMeshTriangle(bakedMesh, primitiveIndex, ray, hit, stats, arena, cone);
+}
+
+bool CPUScene::intersectPrimitive(const unsigned int bvhPrimitive, const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena, const RayCone& cone) const {
+    if(bvhPrimitives.empty() && microTriangles.empty()) return intersectTriangle(bvhPrimitive, ray, hit, stats, arena, cone);
+    if(bvhPrimitive >= bvhPrimitives.size()) return intersectMicroTriangle(microTriangles[bvhPrimitive - bvhPrimitives.size()], ray, hit, stats);
+
+    const MicroMeshNode& node = bvhPrimitives[bvhPrimitive];
+    if(node.level == 0) return intersectTriangle(node.primitiveIndex, ray, hit, stats, arena, cone);
+
+    if(lazyHierarchy) lazyHierarchy->ensureBuilt(node.primitiveIndex);
+
+    return intersectMicroMeshNode(bakedMesh, node, ray, hit, stats, arena, cone);
+}
+
+bool CPUScene::traceRay(const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena, const RayCone& cone) const {
+    stats.rays++;
+
+    hit.t = ray.tMax;
+    const bool anyHit = intersect(ray, hit, stats, arena, cone);
+
+    if(anyHit) stats.hits++;
+    return anyHit;
+}
+
+bool CPUScene::intersect(const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena, const RayCone& cone) const {
+    bool anyHit = false;
+
+    bvh.traverse(ray, hit.t, [&](const unsigned int bvhPrimitive) {
+        anyHit |= intersectPrimitive(bvhPrimitive, ray, hit, stats, arena, cone);
+    }, stats);
+
+    if(anyHit && bakedMesh.pages) bakedMesh.pages->prefetchAround(hit.primitiveIndex);
+    return anyHit;
+}
+
+unsigned int CPUScene::tracePacket(const RayPacket& packet, HitInfo (&hits)[RAY_PACKET_SIZE], TraversalStats& stats, TraversalArena& arena, const RayCone& cone) const {
+    if(!packet.activeMask) return 0;
+
+    if(!isCoherent(packet)) {
+        unsigned int hitMask = 0;
+        for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            if((packet.activeMask & (1u << lane)) && traceRay(packet.rays[lane], hits[lane], stats, arena, cone)) hitMask |= 1u << lane;
+        }
+
+        return hitMask;
+    }
+
+    stats.rays += static_cast<uint64_t>(std::popcount(packet.activeMask));
+    for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) hits[lane].t = packet.rays[lane].tMax;
+
+    const unsigned int hitMask = intersectPacket(packet, hits, stats, arena, cone);
+
+    stats.hits += static_cast<uint64_t>(std::popcount(hitMask));
+    return hitMask;
+}
+
+unsigned int CPUScene::intersectPacket(const RayPacket& packet, HitInfo (&hits)[RAY_PACKET_SIZE], TraversalStats& stats, TraversalArena& arena, const RayCone& cone) const {
+    unsigned int hitMask = 0;
+    bvh.traversePacket(packet, hits, [&](const unsigned int bvhPrimitive, const unsigned int laneMask) {
+        //Packets traverse whole base triangles only, hierarchy triangles and micro-triangles are traced ray by ray
+        const int primitiveIndex = wholeBaseTriangle(bvhPrimitive);
+
+        if(primitiveIndex >= 0 && std::popcount(laneMask) >= MIN_PACKET_LANES && (!gridTraversal[static_cast<size_t>(primitiveIndex)] || cone.isEnabled())) {
+            if(lazyHierarchy) lazyHierarchy->ensureBuilt(static_cast<unsigned int>(primitiveIndex));
+            hitMask |= intersectMicroMeshTrianglePacket(bakedMesh, static_cast<unsigned int>(primitiveIndex), packet, laneMask, hits, stats, arena, cone);
+            return;
+        }
+
+        for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            if((laneMask & (1u << lane)) && intersectPrimitive(bvhPrimitive, packet.rays[lane], hits[lane], stats, arena, cone)) hitMask |= 1u << lane;
+        }
+    }, stats);
+
+    if(bakedMesh.pages && hitMask) bakedMesh.pages->prefetchAround(hits[std::countr_zero(hitMask)].primitiveIndex);
+    return hitMask;
+}
+
+TraversalArena CPUScene::createArena() const {
+    return TraversalArena(bakedMesh.maxSubdivisionLevel);
+}
+
+AABB CPUScene::bounds() const {
+    return bvh.getNodes().empty() ? AABB{} : bvh.getNodes().front().bounds;
+}
+
+const BakedMesh& CPUScene::getMesh() const {
+    return bakedMesh;
+}
+
+const BVH& CPUScene::getBVH() const {
+    return bvh;
+}
+
+const LazyHierarchy* CPUScene::getLazyHierarchy() const {
+    return lazyHierarchy.get();
+}
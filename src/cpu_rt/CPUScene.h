@@ -0,0 +1,185 @@
+#pragma once
+
+#include "BakedMesh.h"
+#include "BVH.h"
+#include "LazyHierarchy.h"
+#include "MicroMeshTraversal.h"
+#include "RayDesc.h"
+#include "RayTracedScene.h"
+#include "TraversalArena.h"
+
+#include <memory>
+#include <span>
+
+//A baked micro-mesh together with a BVH over its base triangles, which can be ray traced on the CPU
+class CPUScene : public RayTracedScene {
+public:
+    //How the micro-triangles of a base triangle are found, see intersectMicroMeshTriangle and intersectMicroMeshTriangleGrid
+    enum class TraversalMode {
+        HIERARCHY, //Always descend the hierarchy
+        GRID, //March the micro-grid of every base triangle that supports it
+        AUTOMATIC //March the micro-grid of the base triangles where prefersGridTraversal expects it to be faster
+    };
+
+private:
+    BakedMesh bakedMesh;
+    BVH bvh;
+    TraversalMode traversalMode = TraversalMode::AUTOMATIC;
+    std::vector<unsigned char> gridTraversal; //Per base triangle, whether its micro-grid is marched
+    int tessellateBelowLevel = 0; //The tessellationLevel of the constructor
+    //What every primitive of the BVH is: first the procedural ones (see splitAABBs), then the micro-triangles of the
+    //tessellated base triangles. Both are empty if every primitive is a whole base triangle.
+    std::vector<MicroMeshNode> bvhPrimitives;
+    std::vector<MicroTriangle> microTriangles;
+    std::vector<AABB> splitBounds; //The AABBs of the procedural primitives, only if AABBs were split
+    size_t splitBaseTriangles = 0;
+    size_t tessellatedTriangles = 0;
+    std::unique_ptr<LazyHierarchy> lazyHierarchy; //Only for scenes created with bakeLazily
+    //Only filled by applyEdits: the hierarchies of the edited base triangles, and which primitives of the BVH each base
+    //triangle was split or tessellated into (if any were)
+    TriangleHierarchies editedHierarchies;
+    std::vector<glm::uvec2> trianglePrimitives;
+
+    void buildBVH(bool splitTriangles, int tessellationLevel);
+    void findTrianglePrimitives();
+    //Bounds and tessellates the changed base triangles again, returns their primitives of the BVH
+    std::vector<unsigned int> updatePrimitives(std::span<const unsigned int> triangles);
+
+    [[nodiscard]] bool usesGridTraversal(unsigned int primitiveIndex) const;
+    [[nodiscard]] AABB primitiveBounds(unsigned int bvhPrimitive) const;
+
+    //The base triangle if a primitive of the BVH is a whole base triangle, -1 otherwise
+    [[nodiscard]] int wholeBaseTriangle(unsigned int bvhPrimitive) const;
+
+    bool intersectTriangle(unsigned int primitiveIndex, const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena, const RayCone& cone) const;
+    bool intersectPrimitive(unsigned int bvhPrimitive, const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena, const RayCone& cone) const;
+
+public:
+    //What applyEdits updated
+    struct EditStats {
+        size_t editedTriangles = 0;
+        size_t updatedRecords = 0; //Hierarchy records (min-max displacements and deltas)
+        size_t refitNodes = 0; //BVH nodes whose bounds changed
+    };
+
+    //What applyMotion updated
+    struct MotionStats {
+        size_t movedTriangles = 0;
+        size_t updatedRecords = 0; //Hierarchy records (min-max displacements and deltas)
+        size_t refitNodes = 0; //BVH nodes whose bounds changed, 0 if the BVH was rebuilt
+        float sahRatio = 1.0f; //The cost of the refit BVH by the surface area heuristic, relative to right after it was built
+        bool rebuilt = false;
+    };
+
+    //When a refit makes the BVH this much more expensive than right after it was built, applyMotion rebuilds it
+    static constexpr float MAX_REFIT_SAH_RATIO = 1.5f;
+
+    CPUScene() = default;
+    /**
+     * @param mesh the baked mesh
+     * @param mode the traversal of the base triangles, see setTraversalMode
+     * @param splitTriangles whether to split the AABBs of base triangles where the surface area heuristic says it pays, see splitAABBs
+     * @param tessellationLevel base triangles with a lower subdivision level are tessellated: their micro-triangles are
+     * put into the BVH as plain triangles instead of traversing them procedurally. 0 tessellates none.
+     */
+    explicit CPUScene(BakedMesh mesh, TraversalMode mode = TraversalMode::AUTOMATIC, bool splitTriangles = false, int tessellationLevel = 0);
+
+    /**
+     * Creates a scene whose hierarchy records (min-max displacements and deltas) are only computed for the base triangles
+     * that rays reach, when they first reach them, see LazyHierarchy. Splitting AABBs needs every record, so it builds
+     * them all up front. The other parameters are the same as those of the constructor.
+     *
+     * @param order the order of the displacement scales, see BakedMesh::vertexOrder
+     */
+    static CPUScene bakeLazily(std::shared_ptr<const Mesh> mesh, TraversalMode mode = TraversalMode::AUTOMATIC, bool splitTriangles = false, int tessellationLevel = 0,
+                               VertexOrder order = VertexOrder::ROW_MAJOR);
+
+    /**
+     * Updates the scene after displacements of micro-vertices of the mesh it was baked from were edited: the baked mesh
+     * (see BakedMesh::applyEdits), the traversal of the edited base triangles, their primitives and the BVH nodes above
+     * them, which are refit without changing the tree. Split and tessellated base triangles are bounded and tessellated
+     * again as a whole. The caller clears the dirty micro-vertices of the mesh afterwards.
+     *
+     * @param mesh the edited mesh, see Mesh::setDisplacement
+     */
+    EditStats applyEdits(const Mesh& mesh);
+
+    /**
+     * Updates the scene after base vertices of the mesh it was baked from moved, for example every frame of a skinned or
+     * keyframed animation: the baked mesh (see BakedMesh::applyMotion), the traversal and primitives of the moved base
+     * triangles and the BVH nodes above them, which are refit bottom-up in parallel without changing the tree. The work
+     * grows with the number of moved base triangles, not with the size of the mesh. Once the primitives have moved so
+     * far that the tree is a lot worse than a new one would be (its surface area heuristic cost grew by more than
+     * maxSahRatio since it was built), the BVH is rebuilt instead.
+     *
+     * @param mesh the moved mesh
+     * @param triangles the triangles around the moved vertices, as returned by Mesh::moveVertices
+     * @param threadCount the number of threads, including the calling thread. 0 uses every hardware thread.
+     * @param maxSahRatio how much the refit BVH may degrade before it is rebuilt
+     */
+    MotionStats applyMotion(const Mesh& mesh, std::span<const unsigned int> triangles, unsigned int threadCount = 0, float maxSahRatio = MAX_REFIT_SAH_RATIO);
+
+    //Picks the traversal of every base triangle. With level of detail (a ray cone), the hierarchy is always used.
+    void setTraversalMode(TraversalMode mode);
+    [[nodiscard]] TraversalMode getTraversalMode() const;
+    //The number of base triangles whose micro-grid is marched
+    [[nodiscard]] size_t gridTriangleCount() const;
+    //The number of AABBs in the BVH, and the number of base triangles that were split over more than one of them
+    [[nodiscard]] size_t primitiveCount() const;
+    [[nodiscard]] size_t splitTriangleCount() const;
+    //The number of tessellated base triangles and of their micro-triangles in the BVH
+    [[nodiscard]] size_t tessellatedTriangleCount() const;
+    [[nodiscard]] size_t microTriangleCount() const;
+    //Memory of the BVH and of what its primitives refer to, excluding the baked mesh
+    [[nodiscard]] size_t accelerationSizeInBytes() const;
+
+    /**
+     * Finds the closest hit of a ray, like TraceRay(...) does for the GPU acceleration structure.
+     *
+     * @param ray the ray
+     * @param hit the closest hit. Only valid when this function returns true.
+     * @param stats counters that are updated while tracing
+     * @param arena scratch memory of the calling thread, see createArena()
+     * @param cone the footprint of the ray, for level of detail. See intersectMicroMeshTriangle.
+     * @return true if the ray hit the mesh
+     */
+    bool traceRay(const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena, const RayCone& cone = {}) const override;
+
+    /**
+     * Like traceRay, but only looks for hits closer than hit.t and does not count the ray, so that a ray can be traced
+     * through several scenes one after another, see InstancedScene.
+     *
+     * @param ray the ray
+     * @param hit the closest hit so far, only changed if a closer one is found
+     * @return true if a closer hit was found
+     */
+    bool intersect(const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena, const RayCone& cone = {}) const;
+
+    /**
+     * Finds the closest hits of a packet of rays. Packets whose rays are not coherent (their directions differ too
+     * much) are traced ray by ray, and so are base triangles that fewer than MIN_PACKET_LANES rays of the packet reach.
+     *
+     * @param packet the rays
+     * @param hits the closest hit of every ray. Only valid for the rays whose bit is set in the returned mask.
+     * @param stats counters that are updated while tracing
+     * @param arena scratch memory of the calling thread, see createArena()
+     * @param cone the footprint of every ray of the packet, for level of detail
+     * @return a mask of the rays that hit the mesh
+     */
+    unsigned int tracePacket(const RayPacket& packet, HitInfo (&hits)[RAY_PACKET_SIZE], TraversalStats& stats, TraversalArena& arena, const RayCone& cone = {}) const override;
+
+    //Like tracePacket for a coherent packet, but only looks for hits closer than hits[i].t and does not count the rays, see intersect
+    unsigned int intersectPacket(const RayPacket& packet, HitInfo (&hits)[RAY_PACKET_SIZE], TraversalStats& stats, TraversalArena& arena, const RayCone& cone = {}) const;
+
+    //Whether the rays of a packet point in nearly the same direction, so that they are worth tracing together
+    [[nodiscard]] static bool isCoherent(const RayPacket& packet);
+
+    [[nodiscard]] TraversalArena createArena() const override;
+    //The bounds of the root of the BVH
+    [[nodiscard]] AABB bounds() const override;
+
+    [[nodiscard]] const BakedMesh& getMesh() const;
+    [[nodiscard]] const BVH& getBVH() const;
+    //nullptr unless the scene was created with bakeLazily
+    [[nodiscard]] const LazyHierarchy* getLazyHierarchy() const;
+};
@@ -0,0 +1,132 @@
+#include "CameraPath.h"
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <json.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+static glm::vec3 toVec3(const json& j) {
+    return {j.at(0).get<float>(), j.at(1).get<float>(), j.at(2).get<float>()};
+}
+
+CameraPath::CameraPath() {
+    lookAtChannel.setInterpolationMode(interpolationMode);
+    rotationChannel.setInterpolationMode(interpolationMode);
+    distanceChannel.setInterpolationMode(interpolationMode);
+}
+
+CameraPath CameraPath::load(const std::filesystem::path& filePath) {
+    std::ifstream file(filePath);
+    if(!file) throw std::runtime_error("Could not open camera path " + filePath.string());
+
+    const json j = json::parse(file);
+
+    CameraPath path;
+    path.framesPerSecond = j.value("fps", path.framesPerSecond);
+    path.fovy = glm::radians(j.value("fov", glm::degrees(path.fovy)));
+    if(j.contains("resolution")) path.resolution = {j["resolution"].at(0).get<unsigned int>(), j["resolution"].at(1).get<unsigned int>()};
+
+    path.interpolationMode = j.value("interpolation", path.interpolationMode);
+    if(path.interpolationMode != "LINEAR" && path.interpolationMode != "STEP") throw std::invalid_argument("Unsupported camera path interpolation: " + path.interpolationMode);
+
+    path.lookAtChannel.setInterpolationMode(path.interpolationMode);
+    path.rotationChannel.setInterpolationMode(path.interpolationMode);
+    path.distanceChannel.setInterpolationMode(path.interpolationMode);
+
+    for(const auto& k : j.at("keyframes")) {
+        path.addKeyframe({k.at("time").get<float>(), toVec3(k.at("lookAt")), toVec3(k.at("rotation")), k.at("distance").get<float>()});
+    }
+
+    if(path.keyframes.empty()) throw std::invalid_argument("Camera path " + filePath.string() + " does not contain any keyframes");
+
+    return path;
+}
+
+void CameraPath::save(const std::filesystem::path& filePath) const {
+    json j;
+    j["fps"] = framesPerSecond;
+    j["resolution"] = {resolution.x, resolution.y};
+    j["fov"] = glm::degrees(fovy);
+    j["interpolation"] = interpolationMode;
+    j["keyframes"] = json::array();
+
+    for(const auto& k : keyframes) {
+        j["keyframes"].push_back({
+            {"time", k.time},
+            {"lookAt", {k.lookAt.x, k.lookAt.y, k.lookAt.z}},
+            {"rotation", {k.rotation.x, k.rotation.y, k.rotation.z}},
+            {"distance", k.distance}
+        });
+    }
+
+    std::ofstream file(filePath);
+    if(!file) throw std::runtime_error("Could not write camera path " + filePath.string());
+
+    file << j.dump(4) << std::endl;
+}
+
+void CameraPath::addKeyframe(const CameraKeyframe& keyframe) {
+    const auto position = std::ranges::upper_bound(keyframes, keyframe.time, {}, &CameraKeyframe::time);
+    keyframes.insert(position, keyframe);
+
+    lookAtChannel.addTransformations({keyframe.time}, {keyframe.lookAt});
+    rotationChannel.addTransformations({keyframe.time}, {keyframe.rotation});
+    distanceChannel.addTransformations({keyframe.time}, {keyframe.distance});
+}
+
+const std::vector<CameraKeyframe>& CameraPath::getKeyframes() const {
+    return keyframes;
+}
+
+float CameraPath::startTime() const {
+    return keyframes.front().time;
+}
+
+float CameraPath::endTime() const {
+    return keyframes.back().time;
+}
+
+int CameraPath::frameCount() const {
+    if(keyframes.empty()) return 0;
+
+    return static_cast<int>(std::floor((endTime() - startTime()) * framesPerSecond)) + 1;
+}
+
+float CameraPath::frameTime(const int frame) const {
+    return std::min(startTime() + static_cast<float>(frame) / framesPerSecond, endTime());
+}
+
+CameraKeyframe CameraPath::sample(float time) {
+    time = std::clamp(time, startTime(), endTime());
+
+    return {time, lookAtChannel.getTransformation(time), rotationChannel.getTransformation(time), distanceChannel.getTransformation(time)};
+}
+
+CameraKeyframe CameraPath::frameBounds(const AABB& bounds, const float angle, const float time) const {
+    const float radius = std::max(0.5f * glm::length(bounds.maxPos - bounds.minPos), 1e-3f);
+    const float aspect = static_cast<float>(resolution.x) / static_cast<float>(resolution.y);
+    const float halfFov = std::min(0.5f * fovy, std::atan(std::tan(0.5f * fovy) * aspect));
+
+    return {time, bounds.centroid(), {0.0f, angle, 0.0f}, radius / std::sin(halfFov)};
+}
+
+glm::mat4 CameraPath::viewMatrix(const CameraKeyframe& camera) {
+    const glm::quat rotation(camera.rotation);
+
+    const glm::vec3 position = camera.lookAt + rotation * glm::vec3(0, 0, -camera.distance);
+    const glm::vec3 up = rotation * glm::vec3(0, 1, 0);
+
+    return glm::lookAt(position, camera.lookAt, up);
+}
+
+glm::mat4 CameraPath::projectionMatrix() const {
+    return glm::perspective(fovy, static_cast<float>(resolution.x) / static_cast<float>(resolution.y), 0.1f, 1000.0f);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <filesystem>
+#include <framework/TransformationChannel.h>
+#include <string>
+#include <vector>
+
+#include "AABB.h"
+
+//A camera state, with the same parameters as Trackball::setCamera(...)
+struct CameraKeyframe {
+    float time; //In seconds
+    glm::vec3 lookAt;
+    glm::vec3 rotation; //Euler angles in radians
+    float distance; //Distance from the camera to the look-at point
+};
+
+/**
+ * A camera flythrough, stored as keyframes that are interpolated over time.
+ *
+ * The file format is JSON:
+ * {
+ *     "fps": 30,                    (optional, default 30)
+ *     "resolution": [1024, 1024],   (optional, default 1024x1024)
+ *     "fov": 80,                    (optional, vertical field of view in degrees, default 80)
+ *     "interpolation": "LINEAR",    (optional, LINEAR or STEP, default LINEAR)
+ *     "keyframes": [
+ *         {"time": 0.0, "lookAt": [0, 0, 0], "rotation": [0, 0, 0], "distance": 4.0},
+ *         ...
+ *     ]
+ * }
+ */
+class CameraPath {
+    std::vector<CameraKeyframe> keyframes; //Sorted on time
+    TransformationChannel<glm::vec3> lookAtChannel;
+    TransformationChannel<glm::vec3> rotationChannel;
+    TransformationChannel<float> distanceChannel;
+
+    std::string interpolationMode = "LINEAR";
+
+public:
+    float framesPerSecond = 30.0f;
+    glm::uvec2 resolution{1024, 1024};
+    float fovy = glm::radians(80.0f);
+
+    CameraPath();
+
+    static CameraPath load(const std::filesystem::path& filePath);
+    void save(const std::filesystem::path& filePath) const;
+
+    void addKeyframe(const CameraKeyframe& keyframe);
+
+    [[nodiscard]] const std::vector<CameraKeyframe>& getKeyframes() const;
+
+    [[nodiscard]] float startTime() const;
+    [[nodiscard]] float endTime() const;
+
+    //Number of frames to render the whole path at framesPerSecond. Both the first and the last keyframe get a frame.
+    [[nodiscard]] int frameCount() const;
+    [[nodiscard]] float frameTime(int frame) const;
+
+    //Interpolates the camera at a given time. Times outside the path are clamped to the first or last keyframe.
+    [[nodiscard]] CameraKeyframe sample(float time);
+
+    /**
+     * A camera that fits the bounding sphere of some bounds in the narrowest field of view of this path, looking at
+     * their centroid.
+     *
+     * @param bounds the bounds to see
+     * @param angle the rotation of the camera around the vertical axis, in radians
+     * @param time the time of the keyframe
+     */
+    [[nodiscard]] CameraKeyframe frameBounds(const AABB& bounds, float angle, float time = 0.0f) const;
+
+    //Same view matrix as Trackball::viewMatrix() for a camera with these settings
+    [[nodiscard]] static glm::mat4 viewMatrix(const CameraKeyframe& camera);
+
+    //Same projection as the Application uses for the interactive renderer
+    [[nodiscard]] glm::mat4 projectionMatrix() const;
+};
@@ -0,0 +1,362 @@
+#include "EdgeKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(EDGE_KERNELS_SSE)
+#include <immintrin.h>
+#elif defined(EDGE_KERNELS_NEON)
+#include <arm_neon.h>
+#endif
+
+/*
+ * All implementations do the same operations in the same order as the scalar code, without reciprocal approximations
+ * or fused multiply-adds, so that their results are bit-identical. std::min(a, b) returns a unless b < a, which is
+ * _mm_min_ps(b, a); the same holds for std::max and _mm_max_ps.
+ */
+
+namespace EdgeKernels {
+    //Same as rayIntersectsEdge in the traversal
+    static bool rayIntersectsEdge(const glm::vec2& origin, const glm::vec2& direction, const glm::vec2& start, const glm::vec2& end, float& t) {
+        const glm::vec2 val1 = origin - start;
+        const glm::vec2 val2 = end - start;
+        const glm::vec2 val3(-direction.y, direction.x);
+
+        const float denom = glm::dot(val2, val3);
+
+        if(std::abs(denom) < 1e-6f) return false; //ray and edge are parallel; no intersection
+
+        const float t1 = (val2.x * val1.y - val2.y * val1.x) / denom;
+        const float t2 = glm::dot(val1, val3) / denom;
+
+        if(t1 >= 0 && t2 >= 0 && t2 <= 1) {
+            t = t1;
+            return true;
+        }
+
+        return false;
+    }
+
+    //Same as intersect in the traversal
+    static glm::vec2 intersect(const glm::vec2& p1, const glm::vec2& p2, const glm::vec2& p3, const glm::vec2& p4) {
+        const float val1 = p1.x * p2.y - p1.y * p2.x;
+        const float val2 = p3.x * p4.y - p3.y * p4.x;
+        const float denom = (p1.x - p2.x) * (p3.y - p4.y) - (p1.y - p2.y) * (p3.x - p4.x);
+
+        const float px = (val1 * (p3.x - p4.x) - (p1.x - p2.x) * val2) / denom;
+        const float py = (val1 * (p3.y - p4.y) - (p1.y - p2.y) * val2) / denom;
+
+        return {px, py};
+    }
+
+    ChildHits intersectChildrenScalar(const ChildTriangles& triangles, const glm::vec2& origin, const glm::vec2& direction, const unsigned int activeMask) {
+        ChildHits hits{};
+
+        for(int child = 0; child < CHILDREN; child++) {
+            float ts[3] = {MISS_T, MISS_T, MISS_T};
+            bool hit = false;
+            for(int edge = 0; edge < 3; edge++) {
+                hit |= rayIntersectsEdge(origin, direction, triangles.get(child, edge), triangles.get(child, (edge + 1) % 3), ts[edge]);
+            }
+
+            hits.entryT[child] = std::min(ts[0] < 0 ? MAX_T : ts[0], std::min(ts[1] < 0 ? MAX_T : ts[1], ts[2] < 0 ? MAX_T : ts[2]));
+            hits.exitT[child] = std::max(ts[0], std::max(ts[1], ts[2]));
+            if(hit) hits.mask |= 1u << child;
+        }
+
+        hits.mask &= activeMask;
+        return hits;
+    }
+
+    void expandChildrenScalar(ChildTriangles& triangles, const float (&distances)[CHILDREN]) {
+        for(int child = 0; child < CHILDREN; child++) {
+            const glm::vec2 verts[3] = {triangles.get(child, 0), triangles.get(child, 1), triangles.get(child, 2)};
+
+            glm::vec2 ods[3]; //Outward directions
+            for(int i = 0; i < 3; i++) {
+                const glm::vec2 edge = verts[(i + 1) % 3] - verts[i];
+
+                ods[i] = distances[child] * glm::normalize(glm::vec2(edge.y, -edge.x));
+            }
+
+            triangles.set(child, 0, intersect(verts[0] + ods[0], verts[1] + ods[0], verts[2] + ods[2], verts[0] + ods[2]));
+            triangles.set(child, 1, intersect(verts[0] + ods[0], verts[1] + ods[0], verts[1] + ods[1], verts[2] + ods[1]));
+            triangles.set(child, 2, intersect(verts[1] + ods[1], verts[2] + ods[1], verts[2] + ods[2], verts[0] + ods[2]));
+        }
+    }
+
+#if defined(EDGE_KERNELS_SSE)
+    //The ray parameters of one edge of four triangles, MISS_T where the edge is not hit
+    static __m128 rayIntersectsEdgesSSE(const __m128 ox, const __m128 oy, const __m128 nx, const __m128 ny,
+                                        const __m128 sx, const __m128 sy, const __m128 ex, const __m128 ey) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+
+        const __m128 val1x = _mm_sub_ps(ox, sx);
+        const __m128 val1y = _mm_sub_ps(oy, sy);
+        const __m128 val2x = _mm_sub_ps(ex, sx);
+        const __m128 val2y = _mm_sub_ps(ey, sy);
+
+        //(nx, ny) = (-direction.y, direction.x)
+        const __m128 denom = _mm_add_ps(_mm_mul_ps(val2x, nx), _mm_mul_ps(val2y, ny));
+        const __m128 notParallel = _mm_cmpge_ps(_mm_andnot_ps(signMask, denom), _mm_set1_ps(1e-6f));
+
+        const __m128 t1 = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(val2x, val1y), _mm_mul_ps(val2y, val1x)), denom);
+        const __m128 t2 = _mm_div_ps(_mm_add_ps(_mm_mul_ps(val1x, nx), _mm_mul_ps(val1y, ny)), denom);
+
+        const __m128 hit = _mm_and_ps(_mm_and_ps(notParallel, _mm_cmpge_ps(t1, zero)), _mm_and_ps(_mm_cmpge_ps(t2, zero), _mm_cmple_ps(t2, one)));
+
+        return _mm_or_ps(_mm_and_ps(hit, t1), _mm_andnot_ps(hit, _mm_set1_ps(MISS_T)));
+    }
+
+    //Combines the ray parameters of the three edges of four triangles
+    static ChildHits combineEdgesSSE(const __m128 ts0, const __m128 ts1, const __m128 ts2, const unsigned int activeMask) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 maxT = _mm_set1_ps(MAX_T);
+
+        //ts < 0 ? MAX_T : ts
+        const auto entryCandidate = [&](const __m128 ts) {
+            const __m128 missed = _mm_cmplt_ps(ts, zero);
+            return _mm_or_ps(_mm_and_ps(missed, maxT), _mm_andnot_ps(missed, ts));
+        };
+
+        ChildHits hits;
+        _mm_store_ps(hits.entryT, _mm_min_ps(_mm_min_ps(entryCandidate(ts2), entryCandidate(ts1)), entryCandidate(ts0)));
+        _mm_store_ps(hits.exitT, _mm_max_ps(_mm_max_ps(ts2, ts1), ts0));
+
+        //An edge is hit when its t is not negative
+        const __m128 anyHit = _mm_or_ps(_mm_or_ps(_mm_cmpge_ps(ts0, zero), _mm_cmpge_ps(ts1, zero)), _mm_cmpge_ps(ts2, zero));
+        hits.mask = static_cast<unsigned int>(_mm_movemask_ps(anyHit)) & activeMask;
+
+        return hits;
+    }
+
+    ChildHits intersectChildrenSSE(const ChildTriangles& triangles, const glm::vec2& origin, const glm::vec2& direction, const unsigned int activeMask) {
+        const __m128 ox = _mm_set1_ps(origin.x);
+        const __m128 oy = _mm_set1_ps(origin.y);
+        const __m128 nx = _mm_set1_ps(-direction.y);
+        const __m128 ny = _mm_set1_ps(direction.x);
+
+        const __m128 x[3] = {_mm_load_ps(triangles.x[0]), _mm_load_ps(triangles.x[1]), _mm_load_ps(triangles.x[2])};
+        const __m128 y[3] = {_mm_load_ps(triangles.y[0]), _mm_load_ps(triangles.y[1]), _mm_load_ps(triangles.y[2])};
+
+        const __m128 ts0 = rayIntersectsEdgesSSE(ox, oy, nx, ny, x[0], y[0], x[1], y[1]);
+        const __m128 ts1 = rayIntersectsEdgesSSE(ox, oy, nx, ny, x[1], y[1], x[2], y[2]);
+        const __m128 ts2 = rayIntersectsEdgesSSE(ox, oy, nx, ny, x[2], y[2], x[0], y[0]);
+
+        return combineEdgesSSE(ts0, ts1, ts2, activeMask);
+    }
+
+    //Intersection points of the lines (p1, p2) and (p3, p4) of four triangles
+    static void intersectSSE(const __m128 p1x, const __m128 p1y, const __m128 p2x, const __m128 p2y, const __m128 p3x, const __m128 p3y,
+                             const __m128 p4x, const __m128 p4y, float* outX, float* outY) {
+        const __m128 val1 = _mm_sub_ps(_mm_mul_ps(p1x, p2y), _mm_mul_ps(p1y, p2x));
+        const __m128 val2 = _mm_sub_ps(_mm_mul_ps(p3x, p4y), _mm_mul_ps(p3y, p4x));
+        const __m128 d12x = _mm_sub_ps(p1x, p2x);
+        const __m128 d12y = _mm_sub_ps(p1y, p2y);
+        const __m128 d34x = _mm_sub_ps(p3x, p4x);
+        const __m128 d34y = _mm_sub_ps(p3y, p4y);
+        const __m128 denom = _mm_sub_ps(_mm_mul_ps(d12x, d34y), _mm_mul_ps(d12y, d34x));
+
+        _mm_store_ps(outX, _mm_div_ps(_mm_sub_ps(_mm_mul_ps(val1, d34x), _mm_mul_ps(d12x, val2)), denom));
+        _mm_store_ps(outY, _mm_div_ps(_mm_sub_ps(_mm_mul_ps(val1, d34y), _mm_mul_ps(d12y, val2)), denom));
+    }
+
+    void expandChildrenSSE(ChildTriangles& triangles, const float (&distances)[CHILDREN]) {
+        const __m128 s = _mm_loadu_ps(distances);
+        const __m128 one = _mm_set1_ps(1.0f);
+
+        const __m128 x[3] = {_mm_load_ps(triangles.x[0]), _mm_load_ps(triangles.x[1]), _mm_load_ps(triangles.x[2])};
+        const __m128 y[3] = {_mm_load_ps(triangles.y[0]), _mm_load_ps(triangles.y[1]), _mm_load_ps(triangles.y[2])};
+
+        //Edge i moved outwards: (start, end) = (v_i + od_i, v_i+1 + od_i)
+        __m128 startX[3], startY[3], endX[3], endY[3];
+        for(int i = 0; i < 3; i++) {
+            const int next = (i + 1) % 3;
+            const __m128 nx = _mm_sub_ps(y[next], y[i]); //(edge.y, -edge.x)
+            const __m128 ny = _mm_xor_ps(_mm_sub_ps(x[next], x[i]), _mm_set1_ps(-0.0f));
+            const __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny))));
+            const __m128 odx = _mm_mul_ps(s, _mm_mul_ps(nx, invLength));
+            const __m128 ody = _mm_mul_ps(s, _mm_mul_ps(ny, invLength));
+
+            startX[i] = _mm_add_ps(x[i], odx);
+            startY[i] = _mm_add_ps(y[i], ody);
+            endX[i] = _mm_add_ps(x[next], odx);
+            endY[i] = _mm_add_ps(y[next], ody);
+        }
+
+        //Vertex i is where edge i-1 meets edge i, in the same argument order as expandTriangle
+        intersectSSE(startX[0], startY[0], endX[0], endY[0], startX[2], startY[2], endX[2], endY[2], triangles.x[0], triangles.y[0]);
+        intersectSSE(startX[0], startY[0], endX[0], endY[0], startX[1], startY[1], endX[1], endY[1], triangles.x[1], triangles.y[1]);
+        intersectSSE(startX[1], startY[1], endX[1], endY[1], startX[2], startY[2], endX[2], endY[2], triangles.x[2], triangles.y[2]);
+    }
+#endif
+
+#if defined(EDGE_KERNELS_AVX2)
+    //Edges 0 and 1 of the four triangles share one 8-wide pass, edge 2 uses the 4-wide SSE kernel
+    ChildHits intersectChildrenAVX2(const ChildTriangles& triangles, const glm::vec2& origin, const glm::vec2& direction, const unsigned int activeMask) {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        const __m256 ox = _mm256_set1_ps(origin.x);
+        const __m256 oy = _mm256_set1_ps(origin.y);
+        const __m256 nx = _mm256_set1_ps(-direction.y);
+        const __m256 ny = _mm256_set1_ps(direction.x);
+
+        //x[vertex][child] is contiguous: (x[0], x[1]) are the starts of edges 0 and 1, (x[1], x[2]) their ends
+        const __m256 sx = _mm256_loadu_ps(triangles.x[0]);
+        const __m256 sy = _mm256_loadu_ps(triangles.y[0]);
+        const __m256 ex = _mm256_loadu_ps(triangles.x[1]);
+        const __m256 ey = _mm256_loadu_ps(triangles.y[1]);
+
+        const __m256 val1x = _mm256_sub_ps(ox, sx);
+        const __m256 val1y = _mm256_sub_ps(oy, sy);
+        const __m256 val2x = _mm256_sub_ps(ex, sx);
+        const __m256 val2y = _mm256_sub_ps(ey, sy);
+
+        const __m256 denom = _mm256_add_ps(_mm256_mul_ps(val2x, nx), _mm256_mul_ps(val2y, ny));
+        const __m256 notParallel = _mm256_cmp_ps(_mm256_andnot_ps(signMask, denom), _mm256_set1_ps(1e-6f), _CMP_GE_OQ);
+
+        const __m256 t1 = _mm256_div_ps(_mm256_sub_ps(_mm256_mul_ps(val2x, val1y), _mm256_mul_ps(val2y, val1x)), denom);
+        const __m256 t2 = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(val1x, nx), _mm256_mul_ps(val1y, ny)), denom);
+
+        const __m256 hit = _mm256_and_ps(_mm256_and_ps(notParallel, _mm256_cmp_ps(t1, zero, _CMP_GE_OQ)),
+                                         _mm256_and_ps(_mm256_cmp_ps(t2, zero, _CMP_GE_OQ), _mm256_cmp_ps(t2, one, _CMP_LE_OQ)));
+        const __m256 ts01 = _mm256_blendv_ps(_mm256_set1_ps(MISS_T), t1, hit);
+
+        const __m128 ts2 = rayIntersectsEdgesSSE(_mm256_castps256_ps128(ox), _mm256_castps256_ps128(oy), _mm256_castps256_ps128(nx), _mm256_castps256_ps128(ny),
+                                                 _mm_load_ps(triangles.x[2]), _mm_load_ps(triangles.y[2]), _mm_load_ps(triangles.x[0]), _mm_load_ps(triangles.y[0]));
+
+        return combineEdgesSSE(_mm256_castps256_ps128(ts01), _mm256_extractf128_ps(ts01, 1), ts2, activeMask);
+    }
+#endif
+
+#if defined(EDGE_KERNELS_NEON)
+    //Same as std::min(a, b) and std::max(a, b), including which operand is returned when they compare equal
+    static float32x4_t minNEON(const float32x4_t a, const float32x4_t b) { return vbslq_f32(vcltq_f32(b, a), b, a); }
+    static float32x4_t maxNEON(const float32x4_t a, const float32x4_t b) { return vbslq_f32(vcltq_f32(a, b), b, a); }
+
+    static float32x4_t rayIntersectsEdgesNEON(const float32x4_t ox, const float32x4_t oy, const float32x4_t nx, const float32x4_t ny,
+                                              const float32x4_t sx, const float32x4_t sy, const float32x4_t ex, const float32x4_t ey) {
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+
+        const float32x4_t val1x = vsubq_f32(ox, sx);
+        const float32x4_t val1y = vsubq_f32(oy, sy);
+        const float32x4_t val2x = vsubq_f32(ex, sx);
+        const float32x4_t val2y = vsubq_f32(ey, sy);
+
+        const float32x4_t denom = vaddq_f32(vmulq_f32(val2x, nx), vmulq_f32(val2y, ny));
+        const uint32x4_t notParallel = vcgeq_f32(vabsq_f32(denom), vdupq_n_f32(1e-6f));
+
+        const float32x4_t t1 = vdivq_f32(vsubq_f32(vmulq_f32(val2x, val1y), vmulq_f32(val2y, val1x)), denom);
+        const float32x4_t t2 = vdivq_f32(vaddq_f32(vmulq_f32(val1x, nx), vmulq_f32(val1y, ny)), denom);
+
+        const uint32x4_t hit = vandq_u32(vandq_u32(notParallel, vcgeq_f32(t1, zero)), vandq_u32(vcgeq_f32(t2, zero), vcleq_f32(t2, vdupq_n_f32(1.0f))));
+
+        return vbslq_f32(hit, t1, vdupq_n_f32(MISS_T));
+    }
+
+    ChildHits intersectChildrenNEON(const ChildTriangles& triangles, const glm::vec2& origin, const glm::vec2& direction, const unsigned int activeMask) {
+        const float32x4_t ox = vdupq_n_f32(origin.x);
+        const float32x4_t oy = vdupq_n_f32(origin.y);
+        const float32x4_t nx = vdupq_n_f32(-direction.y);
+        const float32x4_t ny = vdupq_n_f32(direction.x);
+
+        const float32x4_t x[3] = {vld1q_f32(triangles.x[0]), vld1q_f32(triangles.x[1]), vld1q_f32(triangles.x[2])};
+        const float32x4_t y[3] = {vld1q_f32(triangles.y[0]), vld1q_f32(triangles.y[1]), vld1q_f32(triangles.y[2])};
+
+        float32x4_t ts[3];
+        for(int edge = 0; edge < 3; edge++) ts[edge] = rayIntersectsEdgesNEON(ox, oy, nx, ny, x[edge], y[edge], x[(edge + 1) % 3], y[(edge + 1) % 3]);
+
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const float32x4_t maxT = vdupq_n_f32(MAX_T);
+        float32x4_t entry[3];
+        for(int edge = 0; edge < 3; edge++) entry[edge] = vbslq_f32(vcltq_f32(ts[edge], zero), maxT, ts[edge]);
+
+        ChildHits hits;
+        vst1q_f32(hits.entryT, minNEON(entry[0], minNEON(entry[1], entry[2])));
+        vst1q_f32(hits.exitT, maxNEON(ts[0], maxNEON(ts[1], ts[2])));
+
+        const uint32x4_t anyHit = vorrq_u32(vorrq_u32(vcgeq_f32(ts[0], zero), vcgeq_f32(ts[1], zero)), vcgeq_f32(ts[2], zero));
+        const uint32_t bits[4] = {1, 2, 4, 8};
+        hits.mask = vaddvq_u32(vandq_u32(anyHit, vld1q_u32(bits))) & activeMask;
+
+        return hits;
+    }
+
+    static void intersectNEON(const float32x4_t p1x, const float32x4_t p1y, const float32x4_t p2x, const float32x4_t p2y, const float32x4_t p3x,
+                              const float32x4_t p3y, const float32x4_t p4x, const float32x4_t p4y, float* outX, float* outY) {
+        const float32x4_t val1 = vsubq_f32(vmulq_f32(p1x, p2y), vmulq_f32(p1y, p2x));
+        const float32x4_t val2 = vsubq_f32(vmulq_f32(p3x, p4y), vmulq_f32(p3y, p4x));
+        const float32x4_t d12x = vsubq_f32(p1x, p2x);
+        const float32x4_t d12y = vsubq_f32(p1y, p2y);
+        const float32x4_t d34x = vsubq_f32(p3x, p4x);
+        const float32x4_t d34y = vsubq_f32(p3y, p4y);
+        const float32x4_t denom = vsubq_f32(vmulq_f32(d12x, d34y), vmulq_f32(d12y, d34x));
+
+        vst1q_f32(outX, vdivq_f32(vsubq_f32(vmulq_f32(val1, d34x), vmulq_f32(d12x, val2)), denom));
+        vst1q_f32(outY, vdivq_f32(vsubq_f32(vmulq_f32(val1, d34y), vmulq_f32(d12y, val2)), denom));
+    }
+
+    void expandChildrenNEON(ChildTriangles& triangles, const float (&distances)[CHILDREN]) {
+        const float32x4_t s = vld1q_f32(distances);
+
+        const float32x4_t x[3] = {vld1q_f32(triangles.x[0]), vld1q_f32(triangles.x[1]), vld1q_f32(triangles.x[2])};
+        const float32x4_t y[3] = {vld1q_f32(triangles.y[0]), vld1q_f32(triangles.y[1]), vld1q_f32(triangles.y[2])};
+
+        float32x4_t startX[3], startY[3], endX[3], endY[3];
+        for(int i = 0; i < 3; i++) {
+            const int next = (i + 1) % 3;
+            const float32x4_t nx = vsubq_f32(y[next], y[i]);
+            const float32x4_t ny = vnegq_f32(vsubq_f32(x[next], x[i]));
+            const float32x4_t invLength = vdivq_f32(vdupq_n_f32(1.0f), vsqrtq_f32(vaddq_f32(vmulq_f32(nx, nx), vmulq_f32(ny, ny))));
+            const float32x4_t odx = vmulq_f32(s, vmulq_f32(nx, invLength));
+            const float32x4_t ody = vmulq_f32(s, vmulq_f32(ny, invLength));
+
+            startX[i] = vaddq_f32(x[i], odx);
+            startY[i] = vaddq_f32(y[i], ody);
+            endX[i] = vaddq_f32(x[next], odx);
+            endY[i] = vaddq_f32(y[next], ody);
+        }
+
+        intersectNEON(startX[0], startY[0], endX[0], endY[0], startX[2], startY[2], endX[2], endY[2], triangles.x[0], triangles.y[0]);
+        intersectNEON(startX[0], startY[0], endX[0], endY[0], startX[1], startY[1], endX[1], endY[1], triangles.x[1], triangles.y[1]);
+        intersectNEON(startX[1], startY[1], endX[1], endY[1], startX[2], startY[2], endX[2], endY[2], triangles.x[2], triangles.y[2]);
+    }
+#endif
+
+    ChildHits intersectChildren(const ChildTriangles& triangles, const glm::vec2& origin, const glm::vec2& direction, const unsigned int activeMask) {
+#if defined(EDGE_KERNELS_AVX2)
+        return intersectChildrenAVX2(triangles, origin, direction, activeMask);
+#elif defined(EDGE_KERNELS_SSE)
+        return intersectChildrenSSE(triangles, origin, direction, activeMask);
+#elif defined(EDGE_KERNELS_NEON)
+        return intersectChildrenNEON(triangles, origin, direction, activeMask);
+#else
+        return intersectChildrenScalar(triangles, origin, direction, activeMask);
+#endif
+    }
+
+    void expandChildren(ChildTriangles& triangles, const float (&distances)[CHILDREN]) {
+#if defined(EDGE_KERNELS_SSE)
+        expandChildrenSSE(triangles, distances);
+#elif defined(EDGE_KERNELS_NEON)
+        expandChildrenNEON(triangles, distances);
+#else
+        expandChildrenScalar(triangles, distances);
+#endif
+    }
+
+    const char* instructionSet() {
+#if defined(EDGE_KERNELS_AVX2)
+        return "AVX2";
+#elif defined(EDGE_KERNELS_SSE)
+        return "SSE2";
+#elif defined(EDGE_KERNELS_NEON)
+        return "NEON";
+#else
+        return "scalar";
+#endif
+    }
+}
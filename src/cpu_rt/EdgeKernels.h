@@ -0,0 +1,90 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+
+/*
+ * Which instruction set the kernels are compiled for. AVX2 has to be enabled by the compiler (/arch:AVX2 or -mavx2,
+ * see the CPU_RT_AVX2 option), SSE2 is always available on x64, and NEON on AArch64.
+ */
+#if defined(__AVX2__)
+#define EDGE_KERNELS_AVX2
+#define EDGE_KERNELS_SSE
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EDGE_KERNELS_SSE
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define EDGE_KERNELS_NEON
+#endif
+
+namespace EdgeKernels {
+    static constexpr int CHILDREN = 4;
+    static constexpr float MISS_T = -1.0f; //Ray parameter of an edge that is not hit
+    static constexpr float MAX_T = 100000.0f; //Entry t of a triangle that is not hit. Should coincide (or be higher) with the maximum ray length
+
+    //The 2D (bounding) triangles of the four children of a hierarchy triangle, as a structure of arrays: x[vertex][child]
+    struct ChildTriangles {
+        alignas(16) float x[3][CHILDREN];
+        alignas(16) float y[3][CHILDREN];
+
+        void set(const int child, const int vertex, const glm::vec2& position) {
+            x[vertex][child] = position.x;
+            y[vertex][child] = position.y;
+        }
+
+        [[nodiscard]] glm::vec2 get(const int child, const int vertex) const {
+            return {x[vertex][child], y[vertex][child]};
+        }
+    };
+
+    //Result of intersecting a 2D ray with the 12 edges of the four children
+    struct ChildHits {
+        alignas(16) float entryT[CHILDREN]; //Smallest t of the hit edges, MAX_T if no edge was hit
+        alignas(16) float exitT[CHILDREN]; //Largest t of the hit edges, MISS_T if no edge was hit
+        unsigned int mask; //Bit i is set if the ray hits an edge of child i
+    };
+
+    /**
+     * Intersects a 2D ray with all edges of four triangles, with exactly the same arithmetic as rayIntersectsEdge in the
+     * traversal (and intersection.hlsl), so every implementation gives bit-identical results.
+     *
+     * @param triangles the four triangles
+     * @param origin the origin of the 2D ray
+     * @param direction the (normalized) direction of the 2D ray
+     * @param activeMask bit i is set if child i should be tested. The hit mask is limited to these children.
+     */
+    [[nodiscard]] ChildHits intersectChildrenScalar(const ChildTriangles& triangles, const glm::vec2& origin, const glm::vec2& direction, unsigned int activeMask);
+#if defined(EDGE_KERNELS_SSE)
+    [[nodiscard]] ChildHits intersectChildrenSSE(const ChildTriangles& triangles, const glm::vec2& origin, const glm::vec2& direction, unsigned int activeMask);
+#endif
+#if defined(EDGE_KERNELS_AVX2)
+    [[nodiscard]] ChildHits intersectChildrenAVX2(const ChildTriangles& triangles, const glm::vec2& origin, const glm::vec2& direction, unsigned int activeMask);
+#endif
+#if defined(EDGE_KERNELS_NEON)
+    [[nodiscard]] ChildHits intersectChildrenNEON(const ChildTriangles& triangles, const glm::vec2& origin, const glm::vec2& direction, unsigned int activeMask);
+#endif
+
+    //The widest implementation the build supports
+    [[nodiscard]] ChildHits intersectChildren(const ChildTriangles& triangles, const glm::vec2& origin, const glm::vec2& direction, unsigned int activeMask);
+
+    /**
+     * Expands four triangles by moving all their edges outwards, like expandTriangle in the traversal.
+     *
+     * @param triangles the triangles, overwritten with the expanded triangles
+     * @param distances how far the edges of each triangle are moved
+     */
+    void expandChildrenScalar(ChildTriangles& triangles, const float (&distances)[CHILDREN]);
+#if defined(EDGE_KERNELS_SSE)
+    void expandChildrenSSE(ChildTriangles& triangles, const float (&distances)[CHILDREN]);
+#endif
+#if defined(EDGE_KERNELS_NEON)
+    void expandChildrenNEON(ChildTriangles& triangles, const float (&distances)[CHILDREN]);
+#endif
+
+    //The widest implementation the build supports
+    void expandChildren(ChildTriangles& triangles, const float (&distances)[CHILDREN]);
+
+    //Name of the instruction set intersectChildren(...) and expandChildren(...) use
+    [[nodiscard]] const char* instructionSet();
+}
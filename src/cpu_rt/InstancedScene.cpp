@@ -0,0 +1,137 @@
+#include "InstancedScene.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+InstancedScene::InstancedScene(std::vector<CPUScene> uniqueScenes, std::vector<Instance> placedInstances): scenes(std::move(uniqueScenes)) {
+    std::vector<AABB> worldBounds;
+
+    for(const Instance& instance : placedInstances) {
+        const float determinant = glm::determinant(glm::mat3(instance.transform));
+        const AABB objectBounds = scenes.at(instance.scene).bounds();
+        if(determinant == 0.0f || !std::isfinite(determinant) || objectBounds.isEmpty()) continue;
+
+        const glm::mat4 worldToObject = glm::inverse(instance.transform);
+        instances.push_back(instance);
+        placements.push_back({worldToObject, glm::transpose(glm::mat3(worldToObject)), 1.0f / std::cbrt(std::abs(determinant))});
+
+        //The AABB of the transformed corners of the AABB in object space
+        AABB bounds;
+        for(int corner = 0; corner < 8; corner++) {
+            const glm::vec3 p{corner & 1 ? objectBounds.maxPos.x : objectBounds.minPos.x, corner & 2 ? objectBounds.maxPos.y : objectBounds.minPos.y,
+                              corner & 4 ? objectBounds.maxPos.z : objectBounds.minPos.z};
+            bounds.extend(glm::vec3(instance.transform * glm::vec4(p, 1.0f)));
+        }
+        worldBounds.push_back(bounds);
+    }
+
+    bvh = BVH(worldBounds);
+}
+
+RayDesc InstancedScene::toObject(const unsigned int instance, const RayDesc& ray) const {
+    const glm::mat4& worldToObject = placements[instance].worldToObject;
+
+    return {glm::vec3(worldToObject * glm::vec4(ray.origin, 1.0f)), ray.tMin, glm::vec3(worldToObject * glm::vec4(ray.direction, 0.0f)), ray.tMax};
+}
+
+RayCone InstancedScene::toObject(const unsigned int instance, const RayCone& cone) const {
+    //The traversal measures the distance along the ray in object space as well, so only the width at the origin changes
+    return {cone.width * placements[instance].coneScale, cone.spreadAngle};
+}
+
+void InstancedScene::toWorld(const unsigned int instance, const RayDesc& ray, HitInfo& hit) const {
+    hit.N = glm::normalize(placements[instance].normalToWorld * hit.N);
+    hit.V = -ray.direction;
+    hit.instanceIndex = instance;
+}
+
+bool InstancedScene::traceRay(const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena, const RayCone& cone) const {
+    stats.rays++;
+
+    hit.t = ray.tMax;
+    bool anyHit = false;
+
+    bvh.traverse(ray, hit.t, [&](const unsigned int instance) {
+        if(scenes[instances[instance].scene].intersect(toObject(instance, ray), hit, stats, arena, toObject(instance, cone))) {
+            toWorld(instance, ray, hit);
+            anyHit = true;
+        }
+    }, stats);
+
+    if(anyHit) stats.hits++;
+    return anyHit;
+}
+
+unsigned int InstancedScene::tracePacket(const RayPacket& packet, HitInfo (&hits)[RAY_PACKET_SIZE], TraversalStats& stats, TraversalArena& arena, const RayCone& cone) const {
+    if(!packet.activeMask) return 0;
+
+    //Coherence is decided in world space, the scale of an instance changes the length of the transformed directions
+    if(!CPUScene::isCoherent(packet)) {
+        unsigned int hitMask = 0;
+        for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            if((packet.activeMask & (1u << lane)) && traceRay(packet.rays[lane], hits[lane], stats, arena, cone)) hitMask |= 1u << lane;
+        }
+
+        return hitMask;
+    }
+
+    stats.rays += static_cast<uint64_t>(std::popcount(packet.activeMask));
+    for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) hits[lane].t = packet.rays[lane].tMax;
+
+    unsigned int hitMask = 0;
+    bvh.traversePacket(packet, hits, [&](const unsigned int instance, const unsigned int laneMask) {
+        RayPacket objectPacket;
+        objectPacket.activeMask = laneMask;
+        for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            if(laneMask & (1u << lane)) objectPacket.rays[lane] = toObject(instance, packet.rays[lane]);
+        }
+
+        const unsigned int instanceHits = scenes[instances[instance].scene].intersectPacket(objectPacket, hits, stats, arena, toObject(instance, cone));
+        for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            if(instanceHits & (1u << lane)) toWorld(instance, packet.rays[lane], hits[lane]);
+        }
+        hitMask |= instanceHits;
+    }, stats);
+
+    stats.hits += static_cast<uint64_t>(std::popcount(hitMask));
+    return hitMask;
+}
+
+TraversalArena InstancedScene::createArena() const {
+    int maxSubdivisionLevel = 0;
+    for(const CPUScene& scene : scenes) maxSubdivisionLevel = std::max(maxSubdivisionLevel, scene.getMesh().maxSubdivisionLevel);
+
+    return TraversalArena(maxSubdivisionLevel);
+}
+
+AABB InstancedScene::bounds() const {
+    return bvh.getNodes().empty() ? AABB{} : bvh.getNodes().front().bounds;
+}
+
+void InstancedScene::setTraversalMode(const CPUScene::TraversalMode mode) {
+    for(CPUScene& scene : scenes) scene.setTraversalMode(mode);
+}
+
+const std::vector<CPUScene>& InstancedScene::getScenes() const {
+    return scenes;
+}
+
+const std::vector<InstancedScene::Instance>& InstancedScene::getInstances() const {
+    return instances;
+}
+
+const BVH& InstancedScene::getBVH() const {
+    return bvh;
+}
+
+size_t InstancedScene::meshSizeInBytes() const {
+    size_t bytes = 0;
+    for(const CPUScene& scene : scenes) bytes += scene.getMesh().sizeInBytes() + scene.accelerationSizeInBytes();
+
+    return bytes;
+}
+
+size_t InstancedScene::instanceSizeInBytes() const {
+    return instances.size() * (sizeof(Instance) + sizeof(Placement)) + bvh.sizeInBytes();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <vector>
+
+#include "BVH.h"
+#include "CPUScene.h"
+#include "RayTracedScene.h"
+
+/**
+ * Instances of micro-meshes, traced through two levels of BVHs like the top-level and bottom-level acceleration
+ * structures on the GPU: a BVH over the world space AABBs of the instances, whose leaves transform the ray into the
+ * space of their mesh and trace it through the BVH of its CPUScene. Every unique mesh is baked once, however often it is
+ * instanced, so memory grows with the number of unique meshes instead of the number of instances.
+ *
+ * The direction of a transformed ray is not normalized, so a hit has the same ray parameter in world and object space,
+ * and the closest hit over all instances is the one with the smallest ray parameter.
+ */
+class InstancedScene : public RayTracedScene {
+public:
+    struct Instance {
+        unsigned int scene; //Index of the scenes this was created with
+        glm::mat4 transform; //From the space of the scene to world space
+    };
+
+    /**
+     * @param uniqueScenes the unique meshes
+     * @param placedInstances where the meshes appear. Instances of empty meshes and instances whose transform can not be
+     * inverted are left out, see getInstances.
+     */
+    InstancedScene(std::vector<CPUScene> uniqueScenes, std::vector<Instance> placedInstances);
+
+    /**
+     * Finds the closest hit of a ray over all instances. The normal and view direction of the hit are in world space,
+     * its primitive index is that of the base triangle in its mesh, and its instance index that of the instance.
+     */
+    bool traceRay(const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena, const RayCone& cone = {}) const override;
+
+    //Finds the closest hits of a packet of rays. The rays of a coherent packet share the traversal of both BVHs, see CPUScene::tracePacket.
+    unsigned int tracePacket(const RayPacket& packet, HitInfo (&hits)[RAY_PACKET_SIZE], TraversalStats& stats, TraversalArena& arena, const RayCone& cone = {}) const override;
+
+    //Large enough for the mesh with the highest subdivision level
+    [[nodiscard]] TraversalArena createArena() const override;
+    [[nodiscard]] AABB bounds() const override;
+
+    //Picks the traversal of the base triangles of every mesh, see CPUScene::setTraversalMode
+    void setTraversalMode(CPUScene::TraversalMode mode);
+
+    [[nodiscard]] const std::vector<CPUScene>& getScenes() const;
+    [[nodiscard]] const std::vector<Instance>& getInstances() const;
+    [[nodiscard]] const BVH& getBVH() const;
+
+    //Memory of the baked meshes and their BVHs, once per unique mesh
+    [[nodiscard]] size_t meshSizeInBytes() const;
+    //Memory of the instances and the BVH over them
+    [[nodiscard]] size_t instanceSizeInBytes() const;
+
+private:
+    //What a ray needs to be traced through an instance
+    struct Placement {
+        glm::mat4 worldToObject;
+        glm::mat3 normalToWorld; //The inverse transpose of the transform
+        float coneScale; //How much narrower a ray cone is in object space, for a uniform scale the inverse of that scale
+    };
+
+    std::vector<CPUScene> scenes;
+    std::vector<Instance> instances;
+    std::vector<Placement> placements; //Per instance
+    BVH bvh;
+
+    //Transforms a ray and its cone into the space of an instance
+    [[nodiscard]] RayDesc toObject(unsigned int instance, const RayDesc& ray) const;
+    [[nodiscard]] RayCone toObject(unsigned int instance, const RayCone& cone) const;
+    //Transforms a hit that was found in the space of an instance back to world space
+    void toWorld(unsigned int instance, const RayDesc& ray, HitInfo& hit) const;
+};
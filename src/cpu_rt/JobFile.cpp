@@ -0,0 +1,272 @@
+#include "JobFile.h"
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <toml/toml.hpp>
+DISABLE_WARNINGS_POP()
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+RenderSettings RenderSettings::orDefaults(const RenderSettings& defaults) const {
+    RenderSettings settings = *this;
+    if(!settings.resolution) settings.resolution = defaults.resolution;
+    if(!settings.fovy) settings.fovy = defaults.fovy;
+    if(!settings.samples) settings.samples = defaults.samples;
+    if(!settings.traversal) settings.traversal = defaults.traversal;
+    if(!settings.packets) settings.packets = defaults.packets;
+    if(!settings.lodPixels) settings.lodPixels = defaults.lodPixels;
+
+    return settings;
+}
+
+namespace {
+    //Where the text comes from, for errors and relative paths
+    struct Source {
+        const std::string& name;
+        const std::filesystem::path& directory;
+
+        [[noreturn]] void fail(const toml::node& node, const std::string& message) const {
+            throw std::invalid_argument(name + ":" + std::to_string(node.source().begin.line) + ": " + message);
+        }
+    };
+}
+
+//Throws on keys that are not one of `keys`, since they are most likely typos
+static void checkKeys(const Source& source, const toml::table& table, const std::initializer_list<std::string_view> keys, const std::string& what) {
+    for(const auto& [key, node] : table) {
+        bool known = false;
+        for(const std::string_view allowed : keys) known |= key.str() == allowed;
+        if(!known) source.fail(node, "unknown key \"" + std::string(key.str()) + "\" in " + what);
+    }
+}
+
+static const toml::table& asTable(const Source& source, const toml::node& node, const std::string& what) {
+    const toml::table* table = node.as_table();
+    if(!table) source.fail(node, what + " must be a table");
+    return *table;
+}
+
+static const toml::array& asArray(const Source& source, const toml::node& node, const std::string& what) {
+    const toml::array* array = node.as_array();
+    if(!array) source.fail(node, what + " must be an array");
+    return *array;
+}
+
+static std::string asString(const Source& source, const toml::node& node, const std::string& what) {
+    const std::optional<std::string> text = node.value<std::string>();
+    if(!text || text->empty()) source.fail(node, what + " must be a string that is not empty");
+    return *text;
+}
+
+static int64_t asInteger(const Source& source, const toml::node& node, const std::string& what, const int64_t min, const int64_t max) {
+    const std::optional<int64_t> value = node.is_integer() ? node.value<int64_t>() : std::nullopt;
+    if(!value || *value < min || *value > max) source.fail(node, what + " must be an integer from " + std::to_string(min) + " to " + std::to_string(max));
+    return *value;
+}
+
+//Integers are numbers as well, so that 80 can be written rather than 80.0
+static float asNumber(const Source& source, const toml::node& node, const std::string& what) {
+    std::optional<double> value;
+    if(node.is_integer()) value = static_cast<double>(*node.value<int64_t>());
+    else if(node.is_floating_point()) value = node.value<double>();
+    if(!value || !std::isfinite(*value)) source.fail(node, what + " must be a number");
+    return static_cast<float>(*value);
+}
+
+static bool asBoolean(const Source& source, const toml::node& node, const std::string& what) {
+    const std::optional<bool> value = node.is_boolean() ? node.value<bool>() : std::nullopt;
+    if(!value) source.fail(node, what + " must be true or false");
+    return *value;
+}
+
+static glm::vec3 asVec3(const Source& source, const toml::node& node, const std::string& what) {
+    const toml::array& array = asArray(source, node, what);
+    if(array.size() != 3) source.fail(node, what + " must have 3 numbers");
+    return {asNumber(source, *array.get(0), what), asNumber(source, *array.get(1), what), asNumber(source, *array.get(2), what)};
+}
+
+static std::filesystem::path asPath(const Source& source, const toml::node& node, const std::string& what) {
+    return (source.directory / std::filesystem::path(asString(source, node, what))).lexically_normal();
+}
+
+//Parses the settings in a table, and leaves the ones it does not have unset
+static RenderSettings parseSettings(const Source& source, const toml::table& table) {
+    RenderSettings settings;
+    if(const toml::node* node = table.get("resolution")) {
+        const toml::array& array = asArray(source, *node, "resolution");
+        if(array.size() != 2) source.fail(*node, "resolution must be [width, height]");
+        settings.resolution = glm::uvec2(asInteger(source, *array.get(0), "the width", 1, 1 << 15), asInteger(source, *array.get(1), "the height", 1, 1 << 15));
+    }
+    if(const toml::node* node = table.get("fov")) {
+        const float degrees = asNumber(source, *node, "fov");
+        if(degrees <= 0.0f || degrees >= 180.0f) source.fail(*node, "fov must be between 0 and 180 degrees");
+        settings.fovy = glm::radians(degrees);
+    }
+    if(const toml::node* node = table.get("samples")) {
+        const auto samples = static_cast<unsigned int>(asInteger(source, *node, "samples", 1, 1024));
+        const auto root = static_cast<unsigned int>(std::lround(std::sqrt(static_cast<double>(samples))));
+        if(root * root != samples) source.fail(*node, "samples must be a square number, such as 1, 4, 9 or 16");
+        settings.samples = samples;
+    }
+    if(const toml::node* node = table.get("traversal")) {
+        const std::string mode = asString(source, *node, "traversal");
+        if(mode == "hierarchy") settings.traversal = CPUScene::TraversalMode::HIERARCHY;
+        else if(mode == "grid") settings.traversal = CPUScene::TraversalMode::GRID;
+        else if(mode == "auto") settings.traversal = CPUScene::TraversalMode::AUTOMATIC;
+        else source.fail(*node, "traversal must be \"hierarchy\", \"grid\" or \"auto\"");
+    }
+    if(const toml::node* node = table.get("packets")) settings.packets = asBoolean(source, *node, "packets");
+    if(const toml::node* node = table.get("lod")) {
+        settings.lodPixels = asNumber(source, *node, "lod");
+        if(*settings.lodPixels < 0.0f) source.fail(*node, "lod must not be negative");
+    }
+
+    return settings;
+}
+
+//Translation, then rotation in degrees around x, y and z, then a uniform or per axis scale, all optional
+static glm::mat4 parseTransform(const Source& source, const toml::table& table) {
+    glm::mat4 transform(1.0f);
+    if(const toml::node* node = table.get("translation")) transform = glm::translate(transform, asVec3(source, *node, "translation"));
+    if(const toml::node* node = table.get("rotation")) transform *= glm::mat4_cast(glm::quat(glm::radians(asVec3(source, *node, "rotation"))));
+    if(const toml::node* node = table.get("scale")) {
+        const glm::vec3 scale = node->is_array() ? asVec3(source, *node, "scale") : glm::vec3(asNumber(source, *node, "scale"));
+        if(scale.x == 0.0f || scale.y == 0.0f || scale.z == 0.0f) source.fail(*node, "scale must not be 0");
+        transform = glm::scale(transform, scale);
+    }
+
+    return transform;
+}
+
+//Maps the names of meshes or scenes to their index, and throws on a name that is used twice
+static std::unordered_map<std::string, unsigned int> indexNames(const Source& source, const toml::array& entries, const std::vector<std::string>& names, const std::string& what) {
+    std::unordered_map<std::string, unsigned int> indices;
+    for(unsigned int i = 0; i < names.size(); i++) {
+        if(!indices.emplace(names[i], i).second) source.fail(*entries.get(i), "there is more than one " + what + " named \"" + names[i] + "\"");
+    }
+
+    return indices;
+}
+
+static unsigned int lookUp(const Source& source, const toml::node& node, const std::unordered_map<std::string, unsigned int>& indices, const std::string& what) {
+    const std::string name = asString(source, node, what);
+    const auto found = indices.find(name);
+    if(found == indices.end()) source.fail(node, "there is no " + what + " named \"" + name + "\"");
+    return found->second;
+}
+
+JobFile JobFile::load(const std::filesystem::path& filePath) {
+    std::ifstream file(filePath);
+    if(!file) throw std::runtime_error("Could not open job file " + filePath.string());
+
+    std::ostringstream text;
+    text << file.rdbuf();
+    return parse(text.str(), filePath.parent_path(), filePath.string());
+}
+
+JobFile JobFile::parse(const std::string_view text, const std::filesystem::path& directory, const std::string& sourceName) {
+    const Source source{sourceName, directory};
+
+    toml::table root;
+    try {
+        root = toml::parse(text, sourceName);
+    } catch(const toml::parse_error& e) {
+        throw std::invalid_argument(sourceName + ":" + std::to_string(e.source().begin.line) + ": " + std::string(e.description()));
+    }
+    checkKeys(source, root, {"threads", "defaults", "mesh", "scene", "job"}, "the job file");
+
+    JobFile jobFile;
+    if(const toml::node* node = root.get("threads")) jobFile.threadCount = static_cast<unsigned int>(asInteger(source, *node, "threads", 0, 4096));
+    if(const toml::node* node = root.get("defaults")) {
+        const toml::table& table = asTable(source, *node, "defaults");
+        checkKeys(source, table, {"resolution", "fov", "samples", "traversal", "packets", "lod"}, "defaults");
+        jobFile.defaults = parseSettings(source, table);
+    }
+
+    const toml::array none;
+    const toml::array& meshes = root.contains("mesh") ? asArray(source, *root.get("mesh"), "mesh") : none;
+    const toml::array& scenes = root.contains("scene") ? asArray(source, *root.get("scene"), "scene") : none;
+    const toml::array& jobs = root.contains("job") ? asArray(source, *root.get("job"), "job") : none;
+    if(jobs.empty()) throw std::invalid_argument(sourceName + ": there are no jobs");
+
+    std::vector<std::string> meshNames;
+    for(const toml::node& node : meshes) {
+        const toml::table& table = asTable(source, node, "a mesh");
+        checkKeys(source, table, {"name", "file", "order"}, "a mesh");
+        if(!table.contains("name") || !table.contains("file")) source.fail(node, "a mesh needs a name and a file");
+
+        MeshEntry& mesh = jobFile.meshes.emplace_back();
+        mesh.name = asString(source, *table.get("name"), "name");
+        mesh.file = asPath(source, *table.get("file"), "file");
+        if(const toml::node* order = table.get("order")) {
+            const std::string text = asString(source, *order, "order");
+            if(text == "row-major") mesh.order = VertexOrder::ROW_MAJOR;
+            else if(text == "bird-curve") mesh.order = VertexOrder::BIRD_CURVE;
+            else source.fail(*order, "order must be \"row-major\" or \"bird-curve\"");
+        }
+        meshNames.push_back(mesh.name);
+    }
+    const std::unordered_map<std::string, unsigned int> meshIndices = indexNames(source, meshes, meshNames, "mesh");
+
+    std::vector<std::string> sceneNames;
+    for(const toml::node& node : scenes) {
+        const toml::table& table = asTable(source, node, "a scene");
+        checkKeys(source, table, {"name", "instances"}, "a scene");
+        if(!table.contains("name") || !table.contains("instances")) source.fail(node, "a scene needs a name and instances");
+
+        SceneEntry& scene = jobFile.scenes.emplace_back();
+        scene.name = asString(source, *table.get("name"), "name");
+        for(const toml::node& instanceNode : asArray(source, *table.get("instances"), "instances")) {
+            const toml::table& instance = asTable(source, instanceNode, "an instance");
+            checkKeys(source, instance, {"mesh", "translation", "rotation", "scale"}, "an instance");
+            if(!instance.contains("mesh")) source.fail(instanceNode, "an instance needs a mesh");
+            scene.instances.push_back({lookUp(source, *instance.get("mesh"), meshIndices, "mesh"), parseTransform(source, instance)});
+        }
+        if(scene.instances.empty()) source.fail(node, "scene \"" + scene.name + "\" has no instances");
+        sceneNames.push_back(scene.name);
+    }
+    const std::unordered_map<std::string, unsigned int> sceneIndices = indexNames(source, scenes, sceneNames, "scene");
+
+    for(const toml::node& node : jobs) {
+        const toml::table& table = asTable(source, node, "a job");
+        checkKeys(source, table, {"name", "mesh", "scene", "output", "turntable", "camera_path", "cameras", "resolution", "fov", "samples", "traversal", "packets", "lod"}, "a job");
+
+        Job& job = jobFile.jobs.emplace_back();
+        job.name = table.contains("name") ? asString(source, *table.get("name"), "name") : "job" + std::to_string(jobFile.jobs.size() - 1);
+        if(table.contains("mesh") == table.contains("scene")) source.fail(node, "job \"" + job.name + "\" needs either a mesh or a scene");
+        if(const toml::node* mesh = table.get("mesh")) job.mesh = lookUp(source, *mesh, meshIndices, "mesh");
+        if(const toml::node* scene = table.get("scene")) job.scene = lookUp(source, *scene, sceneIndices, "scene");
+        if(const toml::node* output = table.get("output")) job.output = asPath(source, *output, "output");
+
+        if(table.contains("turntable") + table.contains("camera_path") + table.contains("cameras") > 1) {
+            source.fail(node, "job \"" + job.name + "\" can only have one of turntable, camera_path and cameras");
+        }
+        if(const toml::node* turntable = table.get("turntable")) job.turntableFrames = static_cast<int>(asInteger(source, *turntable, "turntable", 1, 1 << 20));
+        if(const toml::node* cameraPath = table.get("camera_path")) job.cameraPath = asPath(source, *cameraPath, "camera_path");
+        if(const toml::node* cameras = table.get("cameras")) {
+            for(const toml::node& cameraNode : asArray(source, *cameras, "cameras")) {
+                const toml::table& camera = asTable(source, cameraNode, "a camera");
+                checkKeys(source, camera, {"look_at", "rotation", "distance"}, "a camera");
+                if(!camera.contains("distance")) source.fail(cameraNode, "a camera needs a distance");
+
+                const glm::vec3 lookAt = camera.contains("look_at") ? asVec3(source, *camera.get("look_at"), "look_at") : glm::vec3(0.0f);
+                const glm::vec3 rotation = camera.contains("rotation") ? glm::radians(asVec3(source, *camera.get("rotation"), "rotation")) : glm::vec3(0.0f);
+                const float distance = asNumber(source, *camera.get("distance"), "distance");
+                if(distance <= 0.0f) source.fail(cameraNode, "the distance of a camera must be positive");
+                job.cameras.push_back({0.0f, lookAt, rotation, distance});
+            }
+            if(job.cameras.empty()) source.fail(*cameras, "job \"" + job.name + "\" has an empty list of cameras");
+        }
+
+        job.settings = parseSettings(source, table);
+    }
+
+    return jobFile;
+}
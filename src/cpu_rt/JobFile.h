@@ -0,0 +1,115 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CameraPath.h"
+#include "CPUScene.h"
+#include "VertexOrder.h"
+
+//Settings of the renders of a job, which it takes from the defaults of its file where it has none, see JobFile
+struct RenderSettings {
+    std::optional<glm::uvec2> resolution;
+    std::optional<float> fovy; //In radians
+    std::optional<unsigned int> samples; //Rays per pixel, a square number, see BatchRunner
+    std::optional<CPUScene::TraversalMode> traversal;
+    std::optional<bool> packets;
+    std::optional<float> lodPixels;
+
+    //These settings, with those of `defaults` where these have none
+    [[nodiscard]] RenderSettings orDefaults(const RenderSettings& defaults) const;
+};
+
+/**
+ * A batch of offline renders and benchmarks, see BatchRunner. Meshes are baked once per file however many jobs render
+ * them, and every job renders one mesh or one scene of instanced meshes from one or more cameras.
+ *
+ * The file format is TOML, relative paths are relative to the job file:
+ *
+ *     threads = 8                                 (optional, 0 or left out uses every hardware thread)
+ *
+ *     [defaults]                                  (optional, for every job that does not set them)
+ *     resolution = [1920, 1080]                   (default 1024x1024, jobs with a camera path use that of the path)
+ *     fov = 80                                    (vertical field of view in degrees, default 80, likewise)
+ *     samples = 1                                 (rays per pixel on a regular grid, 1, 4, 9, ...)
+ *     traversal = "auto"                          ("hierarchy", "grid" or "auto")
+ *     packets = false
+ *     lod = 0.0                                   (see CPURenderer::setLevelOfDetail)
+ *
+ *     [[mesh]]
+ *     name = "bunny"
+ *     file = "meshes/bunny.gltf"
+ *     order = "row-major"                         (optional, "row-major" or "bird-curve")
+ *
+ *     [[scene]]
+ *     name = "herd"
+ *     instances = [
+ *         { mesh = "bunny" },
+ *         { mesh = "bunny", translation = [2, 0, 0], rotation = [0, 90, 0], scale = 0.5 },
+ *     ]                                           (rotation in degrees around x, y and z, scale uniform or per axis)
+ *
+ *     [[job]]
+ *     name = "bunny-turntable"                    (optional, default "job<index>")
+ *     mesh = "bunny"                              (either a mesh or a scene)
+ *     output = "out/bunny.png"                    (optional, without it the frames are only timed. Numbered if there is more than one.)
+ *     turntable = 36                              (frames of an orbit around the mesh, the default is 1 frame)
+ *     camera_path = "paths/flythrough.json"       (or every frame of a camera path, see CameraPath)
+ *     cameras = [{ look_at = [0, 0, 0], rotation = [-20, 45, 0], distance = 4 }]   (or fixed cameras, rotation in degrees)
+ *     resolution, fov, samples, traversal, packets, lod   (optional, override the defaults)
+ *
+ * Unknown keys, names that are used twice or do not exist, and values out of range are errors, so that a typo does not
+ * silently render with the default instead.
+ */
+struct JobFile {
+    struct MeshEntry {
+        std::string name;
+        std::filesystem::path file;
+        VertexOrder order = VertexOrder::ROW_MAJOR;
+    };
+
+    struct SceneEntry {
+        struct Instance {
+            unsigned int mesh; //Index of meshes
+            glm::mat4 transform; //From the space of the mesh to world space
+        };
+
+        std::string name;
+        std::vector<Instance> instances;
+    };
+
+    struct Job {
+        std::string name;
+        std::optional<unsigned int> mesh; //Index of meshes, if the job renders a mesh
+        std::optional<unsigned int> scene; //Index of scenes, if the job renders a scene
+        std::filesystem::path output;
+        int turntableFrames = 1;
+        std::filesystem::path cameraPath;
+        std::vector<CameraKeyframe> cameras;
+        RenderSettings settings; //Only what the job sets itself, see RenderSettings::orDefaults
+    };
+
+    unsigned int threadCount = 0;
+    RenderSettings defaults;
+    std::vector<MeshEntry> meshes;
+    std::vector<SceneEntry> scenes;
+    std::vector<Job> jobs;
+
+    //Reads a job file, throws std::invalid_argument with the file and line of the first problem in it
+    static JobFile load(const std::filesystem::path& filePath);
+
+    /**
+     * Parses the text of a job file.
+     *
+     * @param text the TOML
+     * @param directory what relative paths are relative to
+     * @param sourceName the name of the text in errors
+     */
+    static JobFile parse(std::string_view text, const std::filesystem::path& directory, const std::string& sourceName = "job file");
+};
@@ -0,0 +1,66 @@
+#include "LazyHierarchy.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+LazyHierarchy::LazyHierarchy(std::shared_ptr<const Mesh> sourceMesh, BakedMesh& baked):
+    mesh(std::move(sourceMesh)), triangleData(baked.triangleData), minMaxDisplacements(baked.minMaxDisplacements), deltas(baked.deltas),
+    states(std::make_unique<std::atomic<unsigned char>[]>(baked.triangleData.size()))
+{
+    //Base triangles without a hierarchy have nothing to build
+    for(size_t i = 0; i < triangleData.size(); i++) {
+        const bool hasRecords = BakedMesh::hierarchyRecordCount(triangleData[i]) > 0;
+        states[i].store(hasRecords ? NOT_BUILT : BUILT, std::memory_order_relaxed);
+        if(!hasRecords) built.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void LazyHierarchy::build(const unsigned int primitiveIndex) const {
+    std::atomic<unsigned char>& state = states[primitiveIndex];
+
+    unsigned char current = NOT_BUILT;
+    if(!state.compare_exchange_strong(current, BUILDING, std::memory_order_acquire)) {
+        //Another thread builds (or has just built) this triangle
+        while(current != BUILT) {
+            state.wait(current, std::memory_order_acquire);
+            current = state.load(std::memory_order_acquire);
+        }
+        return;
+    }
+
+    const Triangle& triangle = mesh->triangles[primitiveIndex];
+    const TriangleData& td = triangleData[primitiveIndex];
+    size_t count = BakedMesh::hierarchyRecordCount(td);
+
+    std::vector<glm::vec2> triangleMinMax;
+    std::vector<float> triangleDeltas;
+    triangleMinMax.reserve(count);
+    triangleDeltas.reserve(count);
+    mesh->triangleMinMaxDisplacements(triangle, triangleMinMax);
+    mesh->triangleDeltas(triangle, triangleDeltas);
+    count = std::min({count, triangleMinMax.size(), triangleDeltas.size()}); //Only differs for irregular micro-meshes, which would not fit the layout anyway
+
+    //The root min-max displacements were written by bakeLazily and may be read concurrently, so they are left alone
+    if(count > 0) {
+        const auto end = static_cast<std::ptrdiff_t>(count);
+        std::copy(triangleMinMax.begin() + 1, triangleMinMax.begin() + end, minMaxDisplacements.begin() + td.minMaxOffset + 1);
+        std::copy(triangleDeltas.begin(), triangleDeltas.begin() + end, deltas.begin() + td.minMaxOffset);
+    }
+
+    built.fetch_add(1, std::memory_order_relaxed);
+    state.store(BUILT, std::memory_order_release);
+    state.notify_all();
+}
+
+bool LazyHierarchy::isBuilt(const unsigned int primitiveIndex) const {
+    return states[primitiveIndex].load(std::memory_order_acquire) == BUILT;
+}
+
+void LazyHierarchy::buildAll() const {
+    for(unsigned int i = 0; i < triangleData.size(); i++) ensureBuilt(i);
+}
+
+size_t LazyHierarchy::builtCount() const {
+    return built.load(std::memory_order_relaxed);
+}
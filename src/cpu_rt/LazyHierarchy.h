@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <framework/mesh.h>
+#include <memory>
+#include <span>
+
+#include "BakedMesh.h"
+
+/**
+ * Computes the hierarchy records (min-max displacements and deltas) of a mesh baked with BakedMesh::bakeLazily, one
+ * base triangle at a time, the first time a ray reaches it. For huge meshes most base triangles are never reached from
+ * a given camera, so the time to the first image no longer grows with the cost of baking them all.
+ *
+ * The root min-max displacements are already computed by bakeLazily, since prefersGridTraversal needs them up front.
+ * Every base triangle is built exactly once: the first thread that reaches it claims it and builds it, other threads
+ * that reach it in the meantime wait for it. The records are published with a release store of the triangle's state,
+ * so a thread that sees the triangle as built (with an acquire load) also sees its records. Once built, a triangle only
+ * costs one atomic load per intersection.
+ */
+class LazyHierarchy {
+public:
+    /**
+     * @param sourceMesh the mesh that was baked. It is kept alive as long as this object.
+     * @param baked the result of BakedMesh::bakeLazily(*sourceMesh). Its vectors are filled in place, so they must not be
+     * resized afterwards. Moving the BakedMesh is fine, since that keeps their storage.
+     */
+    LazyHierarchy(std::shared_ptr<const Mesh> sourceMesh, BakedMesh& baked);
+
+    //Builds the records of a base triangle if that has not happened yet, and returns once they can be read
+    void ensureBuilt(unsigned int primitiveIndex) const {
+        if(states[primitiveIndex].load(std::memory_order_acquire) != BUILT) build(primitiveIndex);
+    }
+
+    [[nodiscard]] bool isBuilt(unsigned int primitiveIndex) const;
+    //Builds the records of every base triangle that is not built yet, on the calling thread
+    void buildAll() const;
+
+    //The number of base triangles whose records have been built, including those without records (subdivision level 0)
+    [[nodiscard]] size_t builtCount() const;
+
+private:
+    static constexpr unsigned char NOT_BUILT = 0;
+    static constexpr unsigned char BUILDING = 1;
+    static constexpr unsigned char BUILT = 2;
+
+    std::shared_ptr<const Mesh> mesh;
+    std::span<const TriangleData> triangleData;
+    std::span<glm::vec2> minMaxDisplacements;
+    std::span<float> deltas;
+
+    std::unique_ptr<std::atomic<unsigned char>[]> states;
+    mutable std::atomic<size_t> built{0};
+
+    void build(unsigned int primitiveIndex) const;
+};
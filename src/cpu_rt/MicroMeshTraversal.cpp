@@ -0,0 +1,937 @@
+#include "MicroMeshTraversal.h"
+
+#include "EdgeKernels.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+static constexpr float MAX_FLOAT = std::numeric_limits<float>::max();
+
+using Triangle2DPositions = std::array<glm::vec2, 3>; //float3x2 in the shader
+
+struct Ray2D {
+    glm::vec2 origin;
+    glm::vec2 direction;
+
+    [[nodiscard]] glm::vec2 on(const float t) const {
+        return origin + t * direction;
+    }
+};
+
+//Everything that stays the same while traversing a single base triangle
+struct TriangleContext {
+    const BakedMesh& mesh;
+    const unsigned int primitiveIndex;
+    const TriangleData& td;
+    const TriangleBlock block;
+    const TBNPlane::Plane plane;
+    const glm::vec3 directions[3];
+    TraversalStats& stats;
+};
+
+//A ray and its projection onto the plane of the base triangle. Holds pointers rather than references, so that a packet can keep an array of them.
+struct RayContext {
+    const RayDesc* ray3D;
+    Ray2D ray;
+    float originHeight; //Height of the 3D ray origin above the plane
+    float heightPerT; //How much the height of the 3D ray changes per unit of the 2D ray parameter
+    bool cull; //False if the ray is (almost) parallel to the plane normal. The 2D ray is then degenerate and we can not cull in 2D.
+    RayCone cone;
+
+    HitInfo* hit;
+
+    //Computes the height from a point on the 2D ray to its corresponding point on the 3D ray
+    [[nodiscard]] float heightTo3DRay(const float t2d) const {
+        return originHeight + t2d * heightPerT;
+    }
+};
+
+//The (up to 4) sub-triangles of a hierarchy triangle
+struct SubTriangles {
+    MicroVertex2D v0[4];
+    MicroVertex2D v1[4];
+    MicroVertex2D v2[4];
+    int boundingTriIndices[4]; //Index in the min-max displacements and deltas of the block
+    int count;
+};
+
+//The 2D bounding triangles and displacement ranges of sub-triangles. They are the same for every ray.
+struct SubTriangleBounds {
+    EdgeKernels::ChildTriangles triangles;
+    glm::vec2 minMaxDispls[EdgeKernels::CHILDREN];
+};
+
+static constexpr unsigned int pathVals[4] = {0, 1, 3, 2};
+
+static MicroVertex2D middle(const MicroVertex2D& start, const MicroVertex2D& end) {
+    return {(start.position + end.position) * 0.5f, (start.bc + end.bc) * 0.5f, (start.coordinates + end.coordinates) / 2u};
+}
+
+//Same as BakedMesh::displacementScale, but from the block of the base triangle
+static float displacementScale(const TriangleContext& tri, const glm::uvec2& coords) {
+    const unsigned int index = (coords.x * (coords.x + 1)) / 2 + coords.y;
+
+    return tri.block.displacementScales[tri.block.vertexOrder ? tri.block.vertexOrder[index] : index];
+}
+
+//Computes the displacement vector of a micro-vertex
+static glm::vec3 computeDisplacement(const TriangleContext& tri, const MicroVertex2D& v) {
+    const glm::vec3 interpolDir = v.bc.x * tri.directions[0] + v.bc.y * tri.directions[1] + v.bc.z * tri.directions[2];
+
+    return displacementScale(tri, v.coordinates) * interpolDir;
+}
+
+//Creates a displaced triangle by moving the undisplaced vertex positions on the plane.
+//This is equivalent to unprojecting the vertices to 3D space, applying displacements, and projecting them orthogonally back to the plane.
+static Triangle2DPositions createDisplacedTriangle(const TriangleContext& tri, const MicroVertex2D (&triVerts)[3]) {
+    Triangle2DPositions displacedVerts;
+
+    for(size_t i = 0; i < 3; i++) {
+        const glm::vec3 displacement = computeDisplacement(tri, triVerts[i]);
+        displacedVerts[i] = triVerts[i].position + glm::vec2(glm::dot(displacement, tri.plane.T), glm::dot(displacement, tri.plane.B));
+    }
+
+    return displacedVerts;
+}
+
+//Checks if the 3D ray passes entirely above or below the displacements of a triangle, between where its 2D ray enters and exits the (bounding) triangle
+static bool isOutsideDisplacementRegion(const RayContext& ray, const float tEntry, const float tExit, const glm::vec2& minMaxDispl) {
+    //If we have only 1 intersection point we can not reliably determine if the 3D ray crosses the displacement region.
+    //So we return that it crosses it, even if it might not be the case.
+    if(std::abs(tEntry - tExit) < 0.0001f) return false;
+
+    const float heightEntry = ray.heightTo3DRay(tEntry);
+    const float heightExit = ray.heightTo3DRay(tExit);
+
+    return (heightEntry < minMaxDispl.x && heightExit < minMaxDispl.x) || (heightEntry > minMaxDispl.y && heightExit > minMaxDispl.y);
+}
+
+//Subdivides a hierarchy triangle one level
+static SubTriangles subdivide(const TriangleContext& tri, const StackElement& t) {
+    /*
+     * We have our triangle t defined by vertices v0-v1-v2 and we are going to subdivide like so:
+     *       v0
+     *      /   \
+     *     /     \
+     *   uv0-----uv2
+     *   / \    /  \
+     *  /   \  /    \
+     * v1----uv1----v2
+     */
+    const MicroVertex2D& v0 = t.vertices[0];
+    const MicroVertex2D& v1 = t.vertices[1];
+    const MicroVertex2D& v2 = t.vertices[2];
+
+    const MicroVertex2D uv0 = middle(v0, v1);
+    const MicroVertex2D uv1 = middle(v1, v2);
+    const MicroVertex2D uv2 = middle(v2, v0);
+
+    const int level = t.level;
+    const int subDivLvl = tri.td.subDivisionLevel;
+
+    //Index of the first child in the min-max displacements and deltas of the block. Children are stored per level, 4 siblings next to each other.
+    int firstChild;
+    if(!tri.block.interior) {
+        const int fourPower = 1 << (2 * (level + 1)); //This computes 4^(level+1)
+        firstChild = (fourPower - 1) / 3 + 4 * static_cast<int>(t.localIndex);
+    } else {
+        //Below a flat leaf there are no records, only descents that visit every micro-triangle get there
+        firstChild = t.record >= 0 && hasChildren(tri.block.interior, t.record) ? firstChildRecord(tri.block.interior, t.record) : -1;
+    }
+
+    SubTriangles sub{
+        {v0, uv0, uv2, uv0},
+        {uv0, v1, uv1, uv1},
+        {uv2, uv1, v2, uv2},
+        {firstChild, firstChild + 1, firstChild + 3, firstChild + 2},
+        4
+    };
+    if(firstChild < 0) std::ranges::fill(sub.boundingTriIndices, -1);
+
+    //When neighbouring triangles have a lower subdivision level, micro-vertices on the edge may be missing at the lowest level
+    if(!tri.mesh.uniformSubdivisionLevel) {
+        const bool uv0Present = displacementScale(tri, uv0.coordinates) != -1.0f;
+        const bool uv1Present = displacementScale(tri, uv1.coordinates) != -1.0f;
+        const bool uv2Present = displacementScale(tri, uv2.coordinates) != -1.0f;
+        sub.count = uv0Present + uv1Present + uv2Present + 1;
+
+        if(level + 1 == subDivLvl && sub.count != 4) {
+            if(uv0Present && !uv1Present && !uv2Present) {
+                sub.v2[0] = v2;
+                sub.v2[1] = v2;
+            } else if(!uv0Present && uv1Present && !uv2Present) {
+                sub.v1[0] = v1;
+                sub.v2[0] = uv1;
+                sub.v0[1] = v0;
+                sub.v1[1] = uv1;
+                sub.v2[1] = v2;
+            } else if(!uv0Present && !uv1Present && uv2Present) {
+                sub.v1[0] = v1;
+                sub.v0[1] = v1;
+                sub.v1[1] = v2;
+                sub.v2[1] = uv2;
+            } else if(uv0Present && !uv1Present && uv2Present) {
+                sub.v2[1] = uv2;
+                sub.v0[2] = v1;
+                sub.v1[2] = v2;
+                sub.v2[2] = uv2;
+            } else if(uv0Present && uv1Present && !uv2Present) {
+                sub.v2[0] = v2;
+                sub.v0[2] = uv0;
+            } else if(!uv0Present && uv1Present && uv2Present) {
+                sub.v1[0] = v1;
+                sub.v0[1] = v1;
+                sub.v1[1] = uv1;
+                sub.v2[1] = uv2;
+            }
+        }
+    }
+
+    return sub;
+}
+
+//The delta of a hierarchy triangle
+static float nodeDelta(const TriangleContext& tri, const int index) {
+    if(tri.block.quantizedBounds) return dequantize(0.0f, tri.block.range->maxDelta, tri.block.quantizedBounds[index].delta);
+
+    return tri.block.deltas[index];
+}
+
+//Computes the 2D bounding triangles and displacement ranges of the sub-triangles of a hierarchy triangle
+static SubTriangleBounds computeBounds(const TriangleContext& tri, const SubTriangles& sub, const StackElement& t) {
+    const bool lastLevel = t.level + 1 == tri.td.subDivisionLevel;
+    SubTriangleBounds bounds;
+    float deltas[EdgeKernels::CHILDREN];
+
+    for(int i = 0; i < EdgeKernels::CHILDREN; i++) {
+        //Unused lanes repeat the first sub-triangle, so that every lane holds a valid triangle
+        if(i >= sub.count) {
+            for(int v = 0; v < 3; v++) bounds.triangles.set(i, v, bounds.triangles.get(0, v));
+            deltas[i] = deltas[0];
+            bounds.minMaxDispls[i] = bounds.minMaxDispls[0];
+            continue;
+        }
+
+        const MicroVertex2D triVerts[3] = {sub.v0[i], sub.v1[i], sub.v2[i]};
+        const Triangle2DPositions vPositions = createDisplacedTriangle(tri, triVerts);
+        for(int v = 0; v < 3; v++) bounds.triangles.set(i, v, vPositions[static_cast<size_t>(v)]);
+
+        if(lastLevel) {
+            deltas[i] = 0.0f;
+            bounds.minMaxDispls[i] = glm::vec2(MAX_FLOAT, -MAX_FLOAT);
+
+            for(const auto& v : triVerts) {
+                const float height = glm::dot(computeDisplacement(tri, v), tri.plane.N);
+
+                bounds.minMaxDispls[i].x = std::min(bounds.minMaxDispls[i].x, height);
+                bounds.minMaxDispls[i].y = std::max(bounds.minMaxDispls[i].y, height);
+            }
+        } else if(tri.block.quantizedBounds) {
+            const QuantizedBounds& q = tri.block.quantizedBounds[sub.boundingTriIndices[i]];
+            deltas[i] = dequantize(0.0f, tri.block.range->maxDelta, q.delta);
+            bounds.minMaxDispls[i] = dequantizeMinMax(t.minMaxDispl, q);
+        } else {
+            deltas[i] = tri.block.deltas[sub.boundingTriIndices[i]];
+            bounds.minMaxDispls[i] = tri.block.minMaxDisplacements[sub.boundingTriIndices[i]];
+        }
+    }
+
+    //At the lowest level the displaced triangles themselves are tested
+    if(!lastLevel) EdgeKernels::expandChildren(bounds.triangles, deltas);
+
+    return bounds;
+}
+
+//Tests the bounding triangles of all sub-triangles against a ray at once, see EdgeKernels
+// @return a mask of the sub-triangles that the ray crosses
+static unsigned int intersectSubTriangles(const TriangleContext& tri, const RayContext& ray, const SubTriangles& sub, const SubTriangleBounds& bounds, EdgeKernels::ChildHits& hits) {
+    tri.stats.boundingTriangleTests += static_cast<uint64_t>(sub.count);
+
+    hits = EdgeKernels::intersectChildren(bounds.triangles, ray.ray.origin, ray.ray.direction, (1u << sub.count) - 1);
+    unsigned int hitMask = hits.mask;
+
+    for(int i = 0; i < sub.count; i++) {
+        if((hitMask & (1u << i)) && isOutsideDisplacementRegion(ray, hits.entryT[i], hits.exitT[i], bounds.minMaxDispls[i])) hitMask &= ~(1u << i);
+    }
+
+    return hitMask;
+}
+
+//Given a triangle, we subdivide it one level and push the sub-triangles that the ray crosses onto the stack (sorted, so the one the ray enters first is popped first)
+static void addIntersectedTriangles(const TriangleContext& tri, const RayContext& ray, const StackElement& t, std::vector<StackElement>& stack) {
+    const SubTriangles sub = subdivide(tri, t);
+
+    unsigned int hitMask = (1u << sub.count) - 1;
+    EdgeKernels::ChildHits hits{};
+    SubTriangleBounds bounds;
+    if(ray.cull) {
+        bounds = computeBounds(tri, sub, t);
+        hitMask = intersectSubTriangles(tri, ray, sub, bounds, hits);
+    }
+
+    const auto oldStackTop = stack.size();
+
+    for(int i = 0; i < sub.count; i++) {
+        if(!(hitMask & (1u << i))) continue;
+
+        const float tEntry = ray.cull ? hits.entryT[i] : 0.0f;
+        const glm::vec2 minMaxDispl = ray.cull ? bounds.minMaxDispls[i] : glm::vec2(0.0f); //Without culling the bounds are never read
+        stack.push_back({{sub.v0[i], sub.v1[i], sub.v2[i]}, t.level + 1, 4 * t.localIndex + pathVals[i], tEntry, minMaxDispl, sub.boundingTriIndices[i]});
+    }
+
+    //Since a stack is LIFO, we sort in decreasing order so that the triangles with the smallest `entryT` are popped first
+    std::sort(stack.begin() + static_cast<std::ptrdiff_t>(oldStackTop), stack.end(), [](const StackElement& a, const StackElement& b) { return a.entryT > b.entryT; });
+}
+
+//Same as addIntersectedTriangles for the rays of a packet. The bounds of the sub-triangles are computed once, every
+//sub-triangle is pushed with the rays that cross it and sorted by the earliest entry of these rays.
+static void addIntersectedTrianglesPacket(const TriangleContext& tri, const RayContext (&rays)[RAY_PACKET_SIZE], const PacketStackElement& t,
+                                          std::vector<PacketStackElement>& stack) {
+    const SubTriangles sub = subdivide(tri, t.element);
+
+    bool anyCull = false;
+    for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) anyCull |= (t.laneMask & (1u << lane)) && rays[lane].cull;
+
+    SubTriangleBounds bounds;
+    if(anyCull) bounds = computeBounds(tri, sub, t.element);
+
+    unsigned int childLanes[4] = {};
+    float childEntryT[4] = {MAX_FLOAT, MAX_FLOAT, MAX_FLOAT, MAX_FLOAT};
+
+    for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+        if(!(t.laneMask & (1u << lane))) continue;
+
+        EdgeKernels::ChildHits hits{};
+        const unsigned int hitMask = rays[lane].cull ? intersectSubTriangles(tri, rays[lane], sub, bounds, hits) : (1u << sub.count) - 1;
+
+        for(int i = 0; i < sub.count; i++) {
+            if(!(hitMask & (1u << i))) continue;
+
+            childLanes[i] |= 1u << lane;
+            childEntryT[i] = std::min(childEntryT[i], rays[lane].cull ? hits.entryT[i] : 0.0f);
+        }
+    }
+
+    const auto oldStackTop = stack.size();
+
+    for(int i = 0; i < sub.count; i++) {
+        if(!childLanes[i]) continue;
+
+        const glm::vec2 minMaxDispl = anyCull ? bounds.minMaxDispls[i] : glm::vec2(0.0f);
+        stack.push_back({{{sub.v0[i], sub.v1[i], sub.v2[i]}, t.element.level + 1, 4 * t.element.localIndex + pathVals[i], childEntryT[i], minMaxDispl,
+                          sub.boundingTriIndices[i]}, childLanes[i]});
+    }
+
+    std::sort(stack.begin() + static_cast<std::ptrdiff_t>(oldStackTop), stack.end(), [](const PacketStackElement& a, const PacketStackElement& b) { return a.element.entryT > b.element.entryT; });
+}
+
+//Ray-triangle test in 3D (Möller-Trumbore). Reports the hit if it lies within the ray interval and is closer than the current hit.
+static bool rayTraceTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, const unsigned int primitiveIndex, const RayDesc& ray, HitInfo& hit,
+                             TraversalStats& stats) {
+    constexpr float epsilon = 1e-3f; //Needed for small floating-point errors
+
+    stats.microTriangleTests++;
+
+    const glm::vec3& origin = ray.origin;
+    const glm::vec3& dir = ray.direction;
+
+    const glm::vec3 edge1 = v1 - v0;
+    const glm::vec3 edge2 = v2 - v0;
+
+    const glm::vec3 pvec = glm::cross(dir, edge2);
+    const float det = glm::dot(edge1, pvec);
+    if(std::abs(det) < 1e-8f) return false;
+
+    const float invDet = 1.0f / det;
+    const glm::vec3 tvec = origin - v0;
+    const float u = glm::dot(tvec, pvec) * invDet;
+    if(u < -epsilon || u > 1.0f + epsilon) return false;
+
+    const glm::vec3 qvec = glm::cross(tvec, edge1);
+    const float v = glm::dot(dir, qvec) * invDet;
+    if(v < -epsilon || u + v > 1.0f + epsilon) return false;
+
+    const float t = glm::dot(edge2, qvec) * invDet;
+
+    //Same acceptance rule as ReportHit: t must lie within [TMin, RayTCurrent]
+    if(t < ray.tMin || t > hit.t) return false;
+
+    hit.t = t;
+    hit.N = glm::normalize(glm::cross(edge1, edge2));
+    hit.V = -dir;
+    hit.primitiveIndex = primitiveIndex;
+    hit.barycentrics = {u, v}; //In the triangle that was tested, see locateMicroTriangle
+
+    return true;
+}
+
+/**
+ * Turns the barycentrics of a hit in a tested triangle into the micro-triangle it lies in and the barycentrics in that
+ * micro-triangle, see HitInfo::microTriangleIndex. Hierarchy triangles that stand in for their micro-triangles, and
+ * leaves that span several micro-triangles around missing micro-vertices, report the micro-triangle under the hit.
+ *
+ * @param c0, c1, c2 the micro-vertex coordinates of the corners of the tested triangle, in the order it was tested in
+ */
+static void locateMicroTriangle(const glm::uvec2& c0, const glm::uvec2& c1, const glm::uvec2& c2, HitInfo& hit) {
+    const glm::uvec2 low = glm::min(glm::min(c0, c1), c2);
+    const glm::uvec2 high = glm::max(glm::max(c0, c1), c2);
+
+    glm::vec2 uv = hit.barycentrics;
+    unsigned int row = low.x, column = low.y;
+    bool upsideDown;
+    if(high.x - low.x == 1 && high.y - low.y == 1) {
+        //A micro-triangle: the upside down ones have two corners in their upper row
+        upsideDown = (c0.x == low.x) + (c1.x == low.x) + (c2.x == low.x) == 2;
+    } else {
+        uv = glm::max(uv, 0.0f);
+        if(uv.x + uv.y > 1.0f) uv /= uv.x + uv.y;
+        const glm::vec2 point = glm::vec2(c0) + uv.x * (glm::vec2(c1) - glm::vec2(c0)) + uv.y * (glm::vec2(c2) - glm::vec2(c0));
+
+        row = std::clamp(static_cast<unsigned int>(std::max(0.0f, std::floor(point.x))), low.x, high.x - 1);
+        column = std::min(static_cast<unsigned int>(std::max(0.0f, std::floor(point.y))), row);
+        upsideDown = column < row && point.y - static_cast<float>(column) > point.x - static_cast<float>(row);
+    }
+
+    //The corners relative to the first corner of the micro-triangle are small, so this is exact for micro-triangles
+    const glm::vec2 base(static_cast<float>(row), static_cast<float>(column));
+    const glm::vec2 p0 = glm::vec2(c0) - base, p1 = glm::vec2(c1) - base, p2 = glm::vec2(c2) - base;
+    const glm::vec2 local = p0 + uv.x * (p1 - p0) + uv.y * (p2 - p0);
+
+    hit.microTriangleIndex = row * row + 2 * column + (upsideDown ? 1 : 0);
+    hit.barycentrics = upsideDown ? glm::vec2(local.x, local.y - local.x) : glm::vec2(local.x - local.y, local.y);
+}
+
+static void locateMicroTriangle(const StackElement& t, HitInfo& hit) {
+    locateMicroTriangle(t.vertices[0].coordinates, t.vertices[1].coordinates, t.vertices[2].coordinates, hit);
+}
+
+static bool rayTraceTriangle(const TriangleContext& tri, const RayContext& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) {
+    return rayTraceTriangle(v0, v1, v2, tri.primitiveIndex, *ray.ray3D, *ray.hit, tri.stats);
+}
+
+//Checks if a hierarchy triangle is smaller than the footprint of the ray where the ray reaches it, so that its
+//displaced triangle can stand in for all of its micro-triangles
+static bool isBelowFootprint(const TriangleContext& tri, const RayContext& ray, const StackElement& t) {
+    if(!ray.cone.isEnabled()) return false;
+
+    const glm::vec2& p0 = t.vertices[0].position;
+    const glm::vec2& p1 = t.vertices[1].position;
+    const glm::vec2& p2 = t.vertices[2].position;
+    const float size = std::sqrt(std::max({glm::dot(p1 - p0, p1 - p0), glm::dot(p2 - p1, p2 - p1), glm::dot(p0 - p2, p0 - p2)}));
+
+    const glm::vec3 center = tri.plane.unproject((p0 + p1 + p2) / 3.0f, 0);
+
+    return size <= ray.cone.widthAt(glm::length(center - ray.ray3D->origin));
+}
+
+//Checks if a hierarchy triangle is a flat leaf of a sparse hierarchy, so that its displaced triangle stands in for all of its micro-triangles
+static bool isFlatLeaf(const TriangleContext& tri, const StackElement& t) {
+    return tri.block.interior && t.level < tri.td.subDivisionLevel && !hasChildren(tri.block.interior, t.record);
+}
+
+//Computes the displaced 3D vertices of a micro-triangle, or of the corners of a hierarchy triangle
+static void microTriangleVertices(const TriangleContext& tri, const StackElement& t, glm::vec3 (&vs3D)[3]) {
+    for(int i = 0; i < 3; i++) {
+        vs3D[i] = tri.plane.unproject(t.vertices[i].position, 0) + computeDisplacement(tri, t.vertices[i]);
+    }
+}
+
+//Ray trace a micro mesh triangle (a triangle which can be subdivided) with an explicit stack, like the shader does
+static bool rayTraceMMTriangle(const TriangleContext& tri, const RayContext& ray, const StackElement& rootTri, TraversalArena& arena) {
+    std::vector<StackElement>& stack = arena.clearedStack();
+    stack.push_back(rootTri);
+
+    while(!stack.empty()) {
+        const StackElement current = stack.back();
+        stack.pop_back();
+        tri.stats.hierarchyNodesVisited++;
+
+        const bool flatLeaf = isFlatLeaf(tri, current);
+        const bool lodReached = !flatLeaf && current.level < tri.td.subDivisionLevel && isBelowFootprint(tri, ray, current);
+        if(flatLeaf) tri.stats.flatLeaves++;
+        if(lodReached) tri.stats.lodTerminations++;
+
+        if(current.level == tri.td.subDivisionLevel || flatLeaf || lodReached) { //Base case. Raytrace micro triangles (or the hierarchy triangle that stands in for them) directly
+            glm::vec3 vs3D[3];
+            microTriangleVertices(tri, current, vs3D);
+
+            //Ray hits triangle, so we can stop searching
+            if(rayTraceTriangle(tri, ray, vs3D[0], vs3D[1], vs3D[2])) {
+                locateMicroTriangle(current, *ray.hit);
+                return true;
+            }
+        } else {
+            addIntersectedTriangles(tri, ray, current, stack);
+        }
+    }
+
+    return false;
+}
+
+//Same as rayTraceMMTriangle for the rays of a packet. Every ray stops at its first hit.
+// @return a mask of the rays that found a hit
+static unsigned int rayTraceMMTrianglePacket(const TriangleContext& tri, const RayContext (&rays)[RAY_PACKET_SIZE], const PacketStackElement& rootTri, TraversalArena& arena) {
+    std::vector<PacketStackElement>& stack = arena.clearedPacketStack();
+    stack.push_back(rootTri);
+
+    unsigned int hitMask = 0;
+
+    while(!stack.empty()) {
+        const StackElement current = stack.back().element;
+        const unsigned int laneMask = stack.back().laneMask & ~hitMask; //Rays that found a hit are done
+        stack.pop_back();
+        if(!laneMask) continue;
+
+        //Too few rays are left to share the work, finish them one by one
+        if(std::popcount(laneMask) < MIN_PACKET_LANES) {
+            for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+                if((laneMask & (1u << lane)) && rayTraceMMTriangle(tri, rays[lane], current, arena)) hitMask |= 1u << lane;
+            }
+            continue;
+        }
+
+        tri.stats.hierarchyNodesVisited++;
+
+        const bool flatLeaf = isFlatLeaf(tri, current);
+        bool lodReached = !flatLeaf && current.level < tri.td.subDivisionLevel;
+        for(int lane = 0; lane < RAY_PACKET_SIZE && lodReached; lane++) lodReached = !(laneMask & (1u << lane)) || isBelowFootprint(tri, rays[lane], current);
+        if(flatLeaf) tri.stats.flatLeaves++;
+        if(lodReached) tri.stats.lodTerminations++;
+
+        if(current.level == tri.td.subDivisionLevel || flatLeaf || lodReached) {
+            glm::vec3 vs3D[3];
+            microTriangleVertices(tri, current, vs3D);
+
+            for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+                if((laneMask & (1u << lane)) && rayTraceTriangle(tri, rays[lane], vs3D[0], vs3D[1], vs3D[2])) {
+                    locateMicroTriangle(current, *rays[lane].hit);
+                    hitMask |= 1u << lane;
+                }
+            }
+        } else {
+            addIntersectedTrianglesPacket(tri, rays, {current, laneMask}, stack);
+        }
+    }
+
+    return hitMask;
+}
+
+//Projects a ray onto the plane of a base triangle
+static RayContext createRayContext(const TBNPlane::Plane& p, const RayDesc& ray, HitInfo& hit, const RayCone& cone) {
+    const glm::vec3 D_plane = ray.direction - glm::dot(ray.direction, p.N) * p.N;
+    const float lenPlane = glm::length(D_plane);
+    const bool degenerate = lenPlane <= 1e-6f * glm::length(ray.direction);
+
+    const Ray2D ray2D{
+        glm::vec2(p.projectOnto(ray.origin)),
+        degenerate ? glm::vec2(1, 0) : glm::normalize(glm::vec2(glm::dot(D_plane, p.T), glm::dot(D_plane, p.B)))
+    };
+
+    return {
+        &ray, ray2D,
+        glm::dot(ray.origin - p.origin, p.N),
+        degenerate ? 0.0f : glm::dot(ray.direction, p.N) / lenPlane,
+        !degenerate,
+        cone,
+        &hit
+    };
+}
+
+//The base triangle projected onto its plane, the root of the hierarchy
+static StackElement createRootTriangle(const TriangleContext& tri) {
+    const TriangleData& td = tri.td;
+
+    return {
+        {
+            {glm::vec2(tri.plane.projectOnto(tri.mesh.vertices[td.vIndices.x].position)), {1, 0, 0}, {0, 0}},
+            {glm::vec2(tri.plane.projectOnto(tri.mesh.vertices[td.vIndices.y].position)), {0, 1, 0}, {td.nRows - 1, 0}},
+            {glm::vec2(tri.plane.projectOnto(tri.mesh.vertices[td.vIndices.z].position)), {0, 0, 1}, {td.nRows - 1, td.nRows - 1}}
+        },
+        0, 0, -1, tri.block.range ? tri.block.range->rootMinMax : glm::vec2(0.0f), 0
+    };
+}
+
+//Descends from the root to the hierarchy triangle at `level` with `localIndex`. The local index holds the path to it, 2 bits per level.
+static StackElement createNodeTriangle(const TriangleContext& tri, const int level, const unsigned int localIndex) {
+    static constexpr int childOfPathVal[4] = {0, 1, 3, 2}; //Inverse of pathVals
+
+    StackElement current = createRootTriangle(tri);
+    for(int l = 1; l <= level; l++) {
+        //The hierarchy triangle lies within a flat leaf, which then stands in for it
+        if(isFlatLeaf(tri, current)) break;
+
+        const unsigned int pathVal = (localIndex >> (2 * (level - l))) & 3u;
+        const SubTriangles sub = subdivide(tri, current);
+        const int i = childOfPathVal[pathVal];
+        const glm::vec2 minMaxDispl = tri.block.quantizedBounds ? dequantizeMinMax(current.minMaxDispl, tri.block.quantizedBounds[sub.boundingTriIndices[i]]) : glm::vec2(0.0f);
+
+        current = {{sub.v0[i], sub.v1[i], sub.v2[i]}, l, 4 * current.localIndex + pathVal, -1, minMaxDispl, sub.boundingTriIndices[i]};
+    }
+
+    return current;
+}
+
+//The bounding triangle of a hierarchy triangle, in every lane of the edge kernels (only the first one is used)
+static EdgeKernels::ChildTriangles createBoundingTriangle(const TriangleContext& tri, const StackElement& t) {
+    const Triangle2DPositions vPositions = createDisplacedTriangle(tri, t.vertices);
+    EdgeKernels::ChildTriangles boundingTri;
+    float deltas[EdgeKernels::CHILDREN];
+    for(int i = 0; i < EdgeKernels::CHILDREN; i++) {
+        for(int v = 0; v < 3; v++) boundingTri.set(i, v, vPositions[static_cast<size_t>(v)]);
+        deltas[i] = nodeDelta(tri, t.record);
+    }
+    EdgeKernels::expandChildren(boundingTri, deltas);
+
+    return boundingTri;
+}
+
+//Early opt-out against the bounding triangle of the hierarchy triangle where the traversal starts
+static bool crossesBoundingTriangle(const TriangleContext& tri, const RayContext& ray, const StackElement& t, const EdgeKernels::ChildTriangles& boundingTri) {
+    tri.stats.boundingTriangleTests++;
+
+    const EdgeKernels::ChildHits hits = EdgeKernels::intersectChildren(boundingTri, ray.ray.origin, ray.ray.direction, 1u);
+
+    const glm::vec2 minMaxDispl = tri.block.quantizedBounds ? t.minMaxDispl : tri.block.minMaxDisplacements[t.record];
+
+    return hits.mask && !isOutsideDisplacementRegion(ray, hits.entryT[0], hits.exitT[0], minMaxDispl);
+}
+
+//The min-max displacements of the whole base triangle
+static glm::vec2 rootMinMax(const TriangleContext& tri) {
+    return tri.block.range ? tri.block.range->rootMinMax : tri.block.minMaxDisplacements[0];
+}
+
+static TriangleContext createTriangleContext(const BakedMesh& mesh, const unsigned int primitiveIndex, TraversalStats& stats) {
+    const TriangleData& td = mesh.triangleData[primitiveIndex];
+
+    return {
+        mesh, primitiveIndex, td, mesh.block(primitiveIndex), mesh.plane(td),
+        {mesh.vertices[td.vIndices.x].direction, mesh.vertices[td.vIndices.y].direction, mesh.vertices[td.vIndices.z].direction},
+        stats
+    };
+}
+
+//The regular micro-grid of a base triangle on its plane. Grid coordinates (a, b) are the continuous version of the
+//micro-vertex coordinates: a goes from v0 (0) to the edge v1-v2 (segments), b from the edge v0-v1 towards v2.
+struct MicroGrid {
+    int segments; //Number of rows of micro-triangles
+    glm::vec2 origin; //v0
+    glm::vec2 rowStep; //From micro-vertex (x, y) to (x + 1, y)
+    glm::vec2 columnStep; //From micro-vertex (x, y) to (x, y + 1)
+    glm::vec2 toA; //Row of the inverse of [rowStep columnStep], so that a = dot(toA, p - origin)
+    glm::vec2 toB;
+
+    [[nodiscard]] glm::vec2 position(const int x, const int y) const {
+        return origin + static_cast<float>(x) * rowStep + static_cast<float>(y) * columnStep;
+    }
+};
+
+//Slack in grid units, for floating point errors in the conversion to grid coordinates
+static constexpr float GRID_EPSILON = 0.01f;
+//Micro-triangles may stray at most this far (in grid units) from their cell, so that a hit in one row can only be beaten by one in the next row
+static constexpr float MAX_GRID_STRAY = 0.5f;
+//Triangles up to this subdivision level are marched, they have at most 2^level rows
+static constexpr int GRID_MAX_LEVEL = 4;
+//Deeper triangles are marched if their displacements span at most this many rows in height, since a ray that is not
+//steep crosses about that many rows. Measured with --grid-bench, the hierarchy wins from about twice as many rows on.
+static constexpr float GRID_FLAT_ROWS = 32.0f;
+
+static MicroGrid createMicroGrid(const TriangleContext& tri, const StackElement& rootTri) {
+    const int segments = tri.td.nRows - 1;
+    const glm::vec2 rowStep = (rootTri.vertices[1].position - rootTri.vertices[0].position) / static_cast<float>(segments);
+    const glm::vec2 columnStep = (rootTri.vertices[2].position - rootTri.vertices[1].position) / static_cast<float>(segments);
+    const float det = rowStep.x * columnStep.y - rowStep.y * columnStep.x;
+
+    return {segments, rootTri.vertices[0].position, rowStep, columnStep, glm::vec2(columnStep.y, -columnStep.x) / det, glm::vec2(-rowStep.y, rowStep.x) / det};
+}
+
+//How far (in grid units along a and b) the displaced micro-triangles of a base triangle can lie outside of their cell
+static glm::vec2 gridStray(const TriangleContext& tri, const MicroGrid& grid) {
+    const float tangential = tri.mesh.tangentialDisplacements[tri.primitiveIndex];
+
+    return tangential * glm::vec2(glm::length(grid.toA), glm::length(grid.toB));
+}
+
+static GridVertex gridVertex(const TriangleContext& tri, const MicroGrid& grid, const int x, const int y) {
+    const float segments = static_cast<float>(grid.segments);
+    const MicroVertex2D v{grid.position(x, y), glm::vec3(segments - static_cast<float>(x), x - y, y) / segments, glm::uvec2(x, y)};
+    const glm::vec3 displacement = computeDisplacement(tri, v);
+
+    return {tri.plane.unproject(v.position, 0) + displacement, glm::dot(displacement, tri.plane.N)};
+}
+
+//Tests a micro-triangle if its heights overlap those of the ray where it crosses the row. Its vertices come in the order of HitInfo::microTriangleIndex.
+static bool rayTraceGridTriangle(const TriangleContext& tri, const RayContext& ray, const GridVertex& v0, const GridVertex& v1, const GridVertex& v2, const glm::vec2& rayHeights,
+                                 const unsigned int microTriangleIndex) {
+    tri.stats.gridCellsVisited++;
+
+    const float minHeight = std::min({v0.height, v1.height, v2.height});
+    const float maxHeight = std::max({v0.height, v1.height, v2.height});
+    if(maxHeight < rayHeights.x || minHeight > rayHeights.y) return false;
+
+    if(!rayTraceTriangle(tri, ray, v0.position, v1.position, v2.position)) return false;
+
+    ray.hit->microTriangleIndex = microTriangleIndex;
+    return true;
+}
+
+/**
+ * Marches the 2D ray row by row across the micro-grid. Row x holds the upright micro-triangles
+ * (x, y) (x + 1, y) (x + 1, y + 1) and the upside down ones (x, y) (x + 1, y + 1) (x, y + 1). In every row, only the
+ * micro-triangles whose cells the 2D ray passes (widened by how far displacements move them sideways) are considered.
+ *
+ * @param tRange the part of the 2D ray inside the bounding triangle of the base triangle
+ * @param tSurface the part of tRange where the ray lies between the lowest and highest displacement. Only rows that
+ * this part crosses are marched.
+ */
+static bool rayTraceMMTriangleGrid(const TriangleContext& tri, const RayContext& ray, const StackElement& rootTri, const glm::vec2& tRange, const glm::vec2& tSurface,
+                                   TraversalArena& arena) {
+    const MicroGrid grid = createMicroGrid(tri, rootTri);
+    const glm::vec2 stray = gridStray(tri, grid) + GRID_EPSILON;
+
+    const float a0 = glm::dot(grid.toA, ray.ray.origin - grid.origin);
+    const float b0 = glm::dot(grid.toB, ray.ray.origin - grid.origin);
+    const float da = glm::dot(grid.toA, ray.ray.direction);
+    const float db = glm::dot(grid.toB, ray.ray.direction);
+
+    //The rows in the order that the ray crosses them
+    const float aBegin = a0 + tSurface.x * da;
+    const float aEnd = a0 + tSurface.y * da;
+    const int firstRow = std::clamp(static_cast<int>(std::floor(std::min(aBegin, aEnd) - stray.x)), 0, grid.segments - 1);
+    const int lastRow = std::clamp(static_cast<int>(std::floor(std::max(aBegin, aEnd) + stray.x)), 0, grid.segments - 1);
+    const int step = da >= 0.0f ? 1 : -1;
+
+    int hitRow = -1;
+    for(int row = step > 0 ? firstRow : lastRow; row >= firstRow && row <= lastRow; row += step) {
+        //The part of the ray that lies in this row. It is not limited to tSurface, so that the heights of the ray in the row
+        //do not collapse to a single value for flat triangles.
+        float t0 = tRange.x, t1 = tRange.y;
+        if(std::abs(da) > 1e-8f) {
+            const float tRowStart = (static_cast<float>(row) - stray.x - a0) / da;
+            const float tRowEnd = (static_cast<float>(row + 1) + stray.x - a0) / da;
+            t0 = std::max(t0, std::min(tRowStart, tRowEnd));
+            t1 = std::min(t1, std::max(tRowStart, tRowEnd));
+        }
+        if(t0 > t1) continue;
+
+        const float bStart = b0 + t0 * db;
+        const float bEnd = b0 + t1 * db;
+        const int firstColumn = std::max(0, static_cast<int>(std::floor(std::min(bStart, bEnd) - stray.y)));
+        const int lastColumn = std::min(row, static_cast<int>(std::floor(std::max(bStart, bEnd) + stray.y)));
+        if(firstColumn > lastColumn) continue;
+
+        const float heightStart = ray.heightTo3DRay(t0);
+        const float heightEnd = ray.heightTo3DRay(t1);
+        const glm::vec2 rayHeights(std::min(heightStart, heightEnd), std::max(heightStart, heightEnd));
+
+        //Micro-vertices of the top and bottom of the row, from firstColumn on
+        std::vector<GridVertex>& top = arena.clearedGridRow(0);
+        std::vector<GridVertex>& bottom = arena.clearedGridRow(1);
+        for(int y = firstColumn; y <= std::min(row, lastColumn + 1); y++) top.push_back(gridVertex(tri, grid, row, y));
+        for(int y = firstColumn; y <= lastColumn + 1; y++) bottom.push_back(gridVertex(tri, grid, row + 1, y));
+
+        for(int y = firstColumn; y <= lastColumn; y++) {
+            const int i = y - firstColumn;
+            const auto upright = static_cast<unsigned int>(row * row + 2 * y);
+
+            if(rayTraceGridTriangle(tri, ray, top[i], bottom[i], bottom[i + 1], rayHeights, upright) && hitRow < 0) hitRow = row;
+            if(y < row && rayTraceGridTriangle(tri, ray, top[i], bottom[i + 1], top[i + 1], rayHeights, upright + 1) && hitRow < 0) hitRow = row;
+        }
+
+        //Micro-triangles of the next row can reach into this one, so they may still hold a closer hit
+        if(hitRow >= 0 && row != hitRow) break;
+    }
+
+    return hitRow >= 0;
+}
+
+bool intersectMicroMeshTriangle(const BakedMesh& mesh, const unsigned int primitiveIndex, const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena,
+                                const RayCone& cone) {
+    stats.intersectionCalls++;
+
+    const TriangleContext tri = createTriangleContext(mesh, primitiveIndex, stats);
+    const RayContext rayContext = createRayContext(tri.plane, ray, hit, cone);
+    const StackElement rootTri = createRootTriangle(tri);
+
+    //Triangles with subdivision level 0 have no hierarchy data, their single micro-triangle is tested directly
+    if(rayContext.cull && tri.td.subDivisionLevel > 0 && !crossesBoundingTriangle(tri, rayContext, rootTri, createBoundingTriangle(tri, rootTri))) return false;
+
+    return rayTraceMMTriangle(tri, rayContext, rootTri, arena);
+}
+
+bool intersectMicroMeshTriangleGrid(const BakedMesh& mesh, const unsigned int primitiveIndex, const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena) {
+    const TriangleContext tri = createTriangleContext(mesh, primitiveIndex, stats);
+    const RayContext rayContext = createRayContext(tri.plane, ray, hit, {});
+    const StackElement rootTri = createRootTriangle(tri);
+
+    //A ray along the normal has no 2D direction to march in
+    if(!rayContext.cull || tri.td.subDivisionLevel == 0) return intersectMicroMeshTriangle(mesh, primitiveIndex, ray, hit, stats, arena);
+
+    stats.intersectionCalls++;
+    stats.boundingTriangleTests++;
+
+    const EdgeKernels::ChildHits rootHits = EdgeKernels::intersectChildren(createBoundingTriangle(tri, rootTri), rayContext.ray.origin, rayContext.ray.direction, 1u);
+    if(!rootHits.mask) return false;
+
+    //If the ray only crosses one edge, it starts inside the bounding triangle
+    const float tEntry = rootHits.entryT[0] < rootHits.exitT[0] ? rootHits.entryT[0] : 0.0f;
+
+    //Skip the parts of the ray that pass above or below all displacements (the root of the min-max pyramid), and those before tMin
+    const glm::vec2 minMaxDispl = rootMinMax(tri);
+    const float lengthOnPlane = glm::length(ray.direction - glm::dot(ray.direction, tri.plane.N) * tri.plane.N);
+    const glm::vec2 tRange(std::max(tEntry, ray.tMin * lengthOnPlane), rootHits.exitT[0]);
+    glm::vec2 tSurface = tRange;
+
+    if(rayContext.heightPerT != 0.0f) {
+        const float tMin = (minMaxDispl.x - rayContext.originHeight) / rayContext.heightPerT;
+        const float tMax = (minMaxDispl.y - rayContext.originHeight) / rayContext.heightPerT;
+        tSurface.x = std::max(tSurface.x, std::min(tMin, tMax));
+        tSurface.y = std::min(tSurface.y, std::max(tMin, tMax));
+    } else if(rayContext.originHeight < minMaxDispl.x || rayContext.originHeight > minMaxDispl.y) {
+        return false;
+    }
+    if(tSurface.x > tSurface.y) return false;
+
+    return rayTraceMMTriangleGrid(tri, rayContext, rootTri, tRange, tSurface, arena);
+}
+
+bool supportsGridTraversal(const BakedMesh& mesh, const unsigned int primitiveIndex) {
+    TraversalStats stats;
+    const TriangleContext tri = createTriangleContext(mesh, primitiveIndex, stats);
+
+    //Missing micro-vertices break the regular grid
+    if(!mesh.uniformSubdivisionLevel) {
+        const int vertexCount = tri.td.nRows * (tri.td.nRows + 1) / 2;
+        const float* begin = tri.block.displacementScales;
+        if(std::find(begin, begin + vertexCount, -1.0f) != begin + vertexCount) return false;
+    }
+
+    const glm::vec2 stray = gridStray(tri, createMicroGrid(tri, createRootTriangle(tri)));
+
+    return stray.x <= MAX_GRID_STRAY && stray.y <= MAX_GRID_STRAY;
+}
+
+bool prefersGridTraversal(const BakedMesh& mesh, const unsigned int primitiveIndex) {
+    const TriangleData& td = mesh.triangleData[primitiveIndex];
+    if(td.subDivisionLevel == 0 || !supportsGridTraversal(mesh, primitiveIndex)) return false;
+    if(td.subDivisionLevel <= GRID_MAX_LEVEL) return true;
+
+    //Distance between two rows: the height of the base triangle on the edge v1-v2, divided by the number of rows
+    TraversalStats stats;
+    const TriangleContext tri = createTriangleContext(mesh, primitiveIndex, stats);
+    const MicroGrid grid = createMicroGrid(tri, createRootTriangle(tri));
+    const float rowDistance = 1.0f / glm::length(grid.toA);
+    const glm::vec2 minMaxDispl = rootMinMax(tri);
+
+    return minMaxDispl.y - minMaxDispl.x <= GRID_FLAT_ROWS * rowDistance;
+}
+
+unsigned int intersectMicroMeshTrianglePacket(const BakedMesh& mesh, const unsigned int primitiveIndex, const RayPacket& packet, unsigned int laneMask,
+                                              HitInfo (&hits)[RAY_PACKET_SIZE], TraversalStats& stats, TraversalArena& arena, const RayCone& cone) {
+    laneMask &= packet.activeMask;
+    stats.intersectionCalls += static_cast<uint64_t>(std::popcount(laneMask));
+
+    const TriangleContext tri = createTriangleContext(mesh, primitiveIndex, stats);
+    const StackElement rootTri = createRootTriangle(tri);
+
+    RayContext rays[RAY_PACKET_SIZE];
+    for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+        if(laneMask & (1u << lane)) rays[lane] = createRayContext(tri.plane, packet.rays[lane], hits[lane], cone);
+    }
+
+    if(tri.td.subDivisionLevel > 0) {
+        const EdgeKernels::ChildTriangles boundingTri = createBoundingTriangle(tri, rootTri);
+
+        for(int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            if((laneMask & (1u << lane)) && rays[lane].cull && !crossesBoundingTriangle(tri, rays[lane], rootTri, boundingTri)) laneMask &= ~(1u << lane);
+        }
+    }
+    if(!laneMask) return 0;
+
+    return rayTraceMMTrianglePacket(tri, rays, {rootTri, laneMask}, arena);
+}
+
+bool intersectMicroMeshNode(const BakedMesh& mesh, const MicroMeshNode& node, const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena,
+                            const RayCone& cone) {
+    if(node.level == 0) return intersectMicroMeshTriangle(mesh, node.primitiveIndex, ray, hit, stats, arena, cone);
+
+    stats.intersectionCalls++;
+
+    const TriangleContext tri = createTriangleContext(mesh, node.primitiveIndex, stats);
+    const RayContext rayContext = createRayContext(tri.plane, ray, hit, cone);
+    const StackElement nodeTri = createNodeTriangle(tri, node.level, node.localIndex);
+
+    if(rayContext.cull && !crossesBoundingTriangle(tri, rayContext, nodeTri, createBoundingTriangle(tri, nodeTri))) return false;
+
+    return rayTraceMMTriangle(tri, rayContext, nodeTri, arena);
+}
+
+std::vector<AABB> microMeshNodeBounds(const BakedMesh& mesh, const unsigned int primitiveIndex, const int level) {
+    TraversalStats stats;
+    const TriangleContext tri = createTriangleContext(mesh, primitiveIndex, stats);
+
+    std::vector<AABB> bounds(size_t(1) << (2 * level));
+    std::vector<StackElement> stack{createRootTriangle(tri)};
+
+    //Visit every micro-triangle and add it to the hierarchy triangle that it descends from
+    while(!stack.empty()) {
+        const StackElement current = stack.back();
+        stack.pop_back();
+
+        if(current.level == tri.td.subDivisionLevel) {
+            glm::vec3 vs3D[3];
+            microTriangleVertices(tri, current, vs3D);
+
+            AABB& nodeBounds = bounds[current.localIndex >> (2 * (current.level - level))];
+            for(const glm::vec3& v : vs3D) nodeBounds.extend(v);
+            continue;
+        }
+
+        const SubTriangles sub = subdivide(tri, current);
+        for(int i = 0; i < sub.count; i++) stack.push_back({{sub.v0[i], sub.v1[i], sub.v2[i]}, current.level + 1, 4 * current.localIndex + pathVals[i], 0.0f, glm::vec2(0.0f),
+                                                                 sub.boundingTriIndices[i]});
+    }
+
+    return bounds;
+}
+
+std::vector<MicroTriangle> tessellateMicroMeshTriangle(const BakedMesh& mesh, const unsigned int primitiveIndex) {
+    TraversalStats stats;
+    const TriangleContext tri = createTriangleContext(mesh, primitiveIndex, stats);
+
+    std::vector<MicroTriangle> triangles;
+    std::vector<StackElement> stack{createRootTriangle(tri)};
+
+    //The same descent as the traversal, so that the micro-triangles (including those around missing micro-vertices) are the same
+    while(!stack.empty()) {
+        const StackElement current = stack.back();
+        stack.pop_back();
+
+        if(current.level == tri.td.subDivisionLevel) {
+            MicroTriangle& triangle = triangles.emplace_back();
+            microTriangleVertices(tri, current, triangle.vertices);
+            triangle.primitiveIndex = primitiveIndex;
+            for(int i = 0; i < 3; i++) triangle.coordinates[i] = glm::u16vec2(current.vertices[i].coordinates);
+            continue;
+        }
+
+        const SubTriangles sub = subdivide(tri, current);
+        for(int i = 0; i < sub.count; i++) stack.push_back({{sub.v0[i], sub.v1[i], sub.v2[i]}, current.level + 1, 4 * current.localIndex + pathVals[i], 0.0f, glm::vec2(0.0f),
+                                                                 sub.boundingTriIndices[i]});
+    }
+
+    return triangles;
+}
+
+bool intersectMicroTriangle(const MicroTriangle& triangle, const RayDesc& ray, HitInfo& hit, TraversalStats& stats) {
+    if(!rayTraceTriangle(triangle.vertices[0], triangle.vertices[1], triangle.vertices[2], triangle.primitiveIndex, ray, hit, stats)) return false;
+
+    locateMicroTriangle(glm::uvec2(triangle.coordinates[0]), glm::uvec2(triangle.coordinates[1]), glm::uvec2(triangle.coordinates[2]), hit);
+    return true;
+}
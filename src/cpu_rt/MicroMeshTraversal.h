@@ -0,0 +1,124 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/ext/vector_uint2_sized.hpp>
+DISABLE_WARNINGS_POP()
+#include <vector>
+
+#include "AABB.h"
+#include "BakedMesh.h"
+#include "RayDesc.h"
+#include "TraversalArena.h"
+
+//A hierarchy triangle of a base triangle, identified by its path: its level and its index among the hierarchy triangles of that level
+struct MicroMeshNode {
+    unsigned int primitiveIndex; //The base triangle
+    int level; //0 is the base triangle itself
+    unsigned int localIndex; //See StackElement
+};
+
+/**
+ * CPU port of the intersection shader (intersection.hlsl).
+ *
+ * Traverses the hierarchical subdivision of a single base triangle in 2D (projected onto the base triangle's plane),
+ * using the min-max displacements and deltas of the baked mesh to cull hierarchy triangles, and tests the micro-triangles
+ * at the lowest subdivision level in 3D.
+ *
+ * With a ray cone, the descent stops at the first hierarchy triangle that is smaller than the width of the cone where
+ * the ray reaches it. The displaced triangle between its corners is then tested instead of its micro-triangles. The
+ * reported hit is off by at most about the width of the cone, and rays can slip through cracks between neighbouring
+ * hierarchy triangles that stopped at different levels.
+ *
+ * @param mesh the baked mesh
+ * @param primitiveIndex the base triangle to intersect
+ * @param ray the ray
+ * @param hit the closest hit so far. hit.t is used as the maximum ray parameter (like RayTCurrent() in HLSL), and is
+ * only overwritten when a closer hit is found
+ * @param stats counters that are updated during the traversal
+ * @param arena scratch memory of the calling thread
+ * @param cone the footprint of the ray, used for level of detail
+ * @return true if a hit closer than hit.t was found
+ */
+bool intersectMicroMeshTriangle(const BakedMesh& mesh, unsigned int primitiveIndex, const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena,
+                                const RayCone& cone = {});
+
+/**
+ * Alternative to intersectMicroMeshTriangle that does not descend the hierarchy, but marches the 2D ray row by row
+ * across the regular micro-grid of the base triangle, like a heightfield ray marcher. The micro-vertices are addressed
+ * with the same grid coordinates as BakedMesh::displacementScale. In every row only the micro-triangles under the 2D ray
+ * are considered, and only those whose heights overlap the ray's heights in that row are tested in 3D. The min-max
+ * displacements of the base triangle (the root of the min-max pyramid) cut off the parts of the ray that pass entirely
+ * above or below the displacements.
+ *
+ * Only valid for base triangles for which supportsGridTraversal is true. The ray cone is ignored: the grid is always
+ * marched at full detail.
+ *
+ * @param mesh the baked mesh
+ * @param primitiveIndex the base triangle to intersect
+ * @param ray the ray
+ * @param hit the closest hit so far, see intersectMicroMeshTriangle
+ * @param stats counters that are updated during the traversal
+ * @param arena scratch memory of the calling thread
+ * @return true if a hit closer than hit.t was found
+ */
+bool intersectMicroMeshTriangleGrid(const BakedMesh& mesh, unsigned int primitiveIndex, const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena);
+
+//Checks if intersectMicroMeshTriangleGrid finds the same hits as intersectMicroMeshTriangle for a base triangle: all of
+//its micro-vertices are present and its displacements move them at most half a micro-triangle sideways
+[[nodiscard]] bool supportsGridTraversal(const BakedMesh& mesh, unsigned int primitiveIndex);
+
+//Heuristic that picks grid marching for the base triangles where it is expected to be faster than the hierarchy:
+//those with few rows, and those whose displacements are so flat that a ray crosses only a few rows near the surface
+[[nodiscard]] bool prefersGridTraversal(const BakedMesh& mesh, unsigned int primitiveIndex);
+
+/**
+ * Intersects a packet of rays with a single base triangle. The rays share the descent through the hierarchy: the
+ * bounding triangles of every hierarchy triangle are computed once for the whole packet, and each ray only tests
+ * them against its own 2D ray and displacement slab. Hierarchy triangles that fewer than MIN_PACKET_LANES rays cross
+ * are finished with single-ray traversal.
+ *
+ * Every ray ends its traversal at its first accepted micro-triangle hit, like the single-ray traversal does. Because
+ * the packet visits the hierarchy in one shared order, a ray that hits several micro-triangles of the same base
+ * triangle can (rarely) report another one than it would on its own.
+ *
+ * @param mesh the baked mesh
+ * @param primitiveIndex the base triangle to intersect
+ * @param packet the rays
+ * @param laneMask the rays of the packet to intersect
+ * @param hits the closest hit so far of every ray, see intersectMicroMeshTriangle
+ * @param stats counters that are updated during the traversal
+ * @param arena scratch memory of the calling thread
+ * @param cone the footprint of every ray of the packet. A hierarchy triangle is only used in place of its micro-triangles
+ * if it is smaller than the footprint of all rays that reach it.
+ * @return a mask of the rays for which a hit closer than their hit.t was found
+ */
+unsigned int intersectMicroMeshTrianglePacket(const BakedMesh& mesh, unsigned int primitiveIndex, const RayPacket& packet, unsigned int laneMask,
+                                              HitInfo (&hits)[RAY_PACKET_SIZE], TraversalStats& stats, TraversalArena& arena, const RayCone& cone = {});
+
+/**
+ * Same as intersectMicroMeshTriangle, but only finds the micro-triangles of a single hierarchy triangle: the traversal
+ * starts at that triangle, after testing its bounding triangle. Lets a base triangle be split over several primitives.
+ *
+ * @param node the hierarchy triangle. Its level must be lower than the subdivision level of its base triangle.
+ */
+bool intersectMicroMeshNode(const BakedMesh& mesh, const MicroMeshNode& node, const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena,
+                            const RayCone& cone = {});
+
+//Computes the AABB around the displaced micro-triangles of every hierarchy triangle at `level` of a base triangle, indexed by their local index
+[[nodiscard]] std::vector<AABB> microMeshNodeBounds(const BakedMesh& mesh, unsigned int primitiveIndex, int level);
+
+//A micro-triangle with its displaced vertices, for base triangles that are tessellated rather than traversed
+struct MicroTriangle {
+    glm::vec3 vertices[3];
+    unsigned int primitiveIndex; //The base triangle
+    glm::u16vec2 coordinates[3]; //Micro-vertex coordinates of the vertices, to report the micro-triangle of a hit
+};
+
+//Computes every micro-triangle of a base triangle, with exactly the vertices the traversal tests
+[[nodiscard]] std::vector<MicroTriangle> tessellateMicroMeshTriangle(const BakedMesh& mesh, unsigned int primitiveIndex);
+
+//Tests a single micro-triangle like the traversal tests the micro-triangles it reaches, and reports the same hit
+bool intersectMicroTriangle(const MicroTriangle& triangle, const RayDesc& ray, HitInfo& hit, TraversalStats& stats);
+
+static constexpr int MIN_PACKET_LANES = 2;
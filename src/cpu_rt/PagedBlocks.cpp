@@ -0,0 +1,332 @@
+#include "PagedBlocks.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr char MAGIC[8] = {'U', 'M', 'E', 'S', 'H', 'P', 'G', '\0'};
+static constexpr std::uint32_t VERSION = 1;
+
+//Followed by the vertices, triangle data, AABBs and tangential displacements, the block table and the blocks
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t uniformSubdivisionLevel;
+    std::int32_t maxSubdivisionLevel;
+    std::uint32_t vertexOrder;
+    std::uint64_t vertexCount;
+    std::uint64_t triangleCount;
+    std::uint64_t blockTableOffset; //triangleCount offsets of the blocks, in bytes from the start of the file
+};
+
+template<typename T>
+static void writeArray(std::ofstream& out, const std::vector<T>& values) {
+    out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template<typename T>
+static void readArray(std::ifstream& in, std::vector<T>& values, const size_t count) {
+    values.resize(count);
+    in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+static std::uint64_t alignBlock(const std::uint64_t offset) {
+    return (offset + PagedBlocks::BLOCK_ALIGNMENT - 1) / PagedBlocks::BLOCK_ALIGNMENT * PagedBlocks::BLOCK_ALIGNMENT;
+}
+
+double BlockCacheStats::hitRate() const {
+    const size_t lookups = hits + misses;
+    return lookups == 0 ? 1.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+}
+
+PagedBlocks::Layout PagedBlocks::layout(const TriangleData& td) {
+    const size_t scales = static_cast<size_t>(td.nRows) * static_cast<size_t>(td.nRows + 1) / 2;
+    const size_t records = BakedMesh::hierarchyRecordCount(td);
+
+    return {scales, scales + 2 * records, scales + 3 * records};
+}
+
+void PagedBlocks::bake(const Mesh& mesh, const std::filesystem::path& file, const VertexOrder order) {
+    BakedMesh baked = BakedMesh::bakeWithoutHierarchy(mesh, order);
+
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if(!out) throw std::runtime_error("Could not open " + file.string());
+
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.uniformSubdivisionLevel = baked.uniformSubdivisionLevel;
+    header.maxSubdivisionLevel = baked.maxSubdivisionLevel;
+    header.vertexOrder = static_cast<std::uint32_t>(baked.vertexOrder);
+    header.vertexCount = baked.vertices.size();
+    header.triangleCount = baked.triangleData.size();
+    header.blockTableOffset = sizeof(FileHeader)
+        + baked.vertices.size() * sizeof(BaseVertex)
+        + baked.triangleData.size() * (sizeof(TriangleData) + sizeof(AABB) + sizeof(float));
+
+    //The sizes of the blocks only depend on the triangle data, so the table is written before the blocks
+    std::vector<std::uint64_t> blockTable;
+    blockTable.reserve(baked.triangleData.size());
+    std::uint64_t offset = alignBlock(header.blockTableOffset + baked.triangleData.size() * sizeof(std::uint64_t));
+    for(const TriangleData& td : baked.triangleData) {
+        blockTable.push_back(offset);
+        offset = alignBlock(offset + layout(td).floatCount * sizeof(float));
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(out, baked.vertices);
+    writeArray(out, baked.triangleData);
+    writeArray(out, baked.AABBs);
+    writeArray(out, baked.tangentialDisplacements);
+    writeArray(out, blockTable);
+
+    //Same records as BakedMesh::bake, see LazyHierarchy::build
+    std::vector<float> block;
+    std::vector<glm::vec2> triangleMinMax;
+    std::vector<float> triangleDeltas;
+    for(size_t i = 0; i < baked.triangleData.size(); i++) {
+        const TriangleData& td = baked.triangleData[i];
+        const Layout l = layout(td);
+        const size_t records = l.floatCount - l.deltaOffset;
+
+        block.assign(l.floatCount, 0.0f);
+        std::copy_n(baked.displacementScales.begin() + td.displacementOffset, l.minMaxOffset, block.begin());
+
+        if(records > 0) {
+            triangleMinMax.clear();
+            triangleDeltas.clear();
+            mesh.triangleMinMaxDisplacements(mesh.triangles[i], triangleMinMax);
+            mesh.triangleDeltas(mesh.triangles[i], triangleDeltas);
+
+            const size_t count = std::min({records, triangleMinMax.size(), triangleDeltas.size()});
+            std::memcpy(block.data() + l.minMaxOffset, triangleMinMax.data(), count * sizeof(glm::vec2));
+            std::copy_n(triangleDeltas.begin(), count, block.begin() + static_cast<std::ptrdiff_t>(l.deltaOffset));
+        }
+
+        out.seekp(static_cast<std::streamoff>(blockTable[i]));
+        writeArray(out, block);
+    }
+
+    if(!out) throw std::runtime_error("Could not write " + file.string());
+}
+
+BakedMesh PagedBlocks::open(const std::filesystem::path& file, const size_t cacheBytes) {
+    std::ifstream in(file, std::ios::binary);
+    if(!in) throw std::runtime_error("Could not open " + file.string());
+
+    FileHeader header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(!in || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+        throw std::runtime_error("Not a paged micro-mesh file: " + file.string());
+    }
+
+    //The counts must fit into the file before the arrays are allocated, a corrupt header would otherwise ask for any amount of memory
+    const std::uintmax_t arrayBytes = std::filesystem::file_size(file) - sizeof(FileHeader);
+    const std::uintmax_t triangleBytes = sizeof(TriangleData) + sizeof(AABB) + sizeof(float);
+    if(header.vertexCount > arrayBytes / sizeof(BaseVertex) || header.triangleCount > (arrayBytes - header.vertexCount * sizeof(BaseVertex)) / triangleBytes) {
+        throw std::runtime_error("Truncated paged micro-mesh file: " + file.string());
+    }
+
+    BakedMesh baked;
+    readArray(in, baked.vertices, header.vertexCount);
+    readArray(in, baked.triangleData, header.triangleCount);
+    readArray(in, baked.AABBs, header.triangleCount);
+    readArray(in, baked.tangentialDisplacements, header.triangleCount);
+    if(!in) throw std::runtime_error("Could not read " + file.string());
+
+    baked.uniformSubdivisionLevel = header.uniformSubdivisionLevel != 0;
+    baked.maxSubdivisionLevel = header.maxSubdivisionLevel;
+    baked.vertexOrder = static_cast<VertexOrder>(header.vertexOrder);
+    baked.pages = std::make_shared<PagedBlocks>(file, header.blockTableOffset, baked.triangleData, cacheBytes);
+
+    return baked;
+}
+
+PagedBlocks::PagedBlocks(const std::filesystem::path& file, const std::uint64_t blockTableOffset, const std::vector<TriangleData>& triangleData, const size_t cacheBytes):
+    shardBudget(cacheBytes / SHARD_COUNT)
+{
+#ifdef _WIN32
+    fileHandle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if(fileHandle == INVALID_HANDLE_VALUE) throw std::runtime_error("Could not open " + file.string());
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(fileHandle, &size);
+    mappingSize = static_cast<size_t>(size.QuadPart);
+
+    mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mappingHandle) mapping = static_cast<const std::byte*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if(!mapping) {
+        if(mappingHandle) CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        throw std::runtime_error("Could not map " + file.string());
+    }
+#else
+    fileDescriptor = ::open(file.c_str(), O_RDONLY);
+    if(fileDescriptor < 0) throw std::runtime_error("Could not open " + file.string());
+
+    struct stat status {};
+    fstat(fileDescriptor, &status);
+    mappingSize = static_cast<size_t>(status.st_size);
+
+    void* address = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if(address == MAP_FAILED) {
+        close(fileDescriptor);
+        throw std::runtime_error("Could not map " + file.string());
+    }
+    mapping = static_cast<const std::byte*>(address);
+
+    //Which blocks are needed follows the rays, not the file, so the kernel should only read ahead when asked to
+    madvise(address, mappingSize, MADV_RANDOM);
+#endif
+
+    //The block table and every block must lie within the file before anything is read from them, a truncated file
+    //would otherwise fault on the first access past its end
+    const bool tableFits = blockTableOffset <= mappingSize && triangleData.size() <= (mappingSize - blockTableOffset) / sizeof(std::uint64_t);
+    if(!tableFits) {
+        unmap();
+        throw std::runtime_error("Truncated paged micro-mesh file: " + file.string());
+    }
+
+    blockOffsets = reinterpret_cast<const std::uint64_t*>(mapping + blockTableOffset);
+    blockFloats.reserve(triangleData.size());
+    for(size_t i = 0; i < triangleData.size(); i++) {
+        blockFloats.push_back(static_cast<std::uint32_t>(layout(triangleData[i]).floatCount));
+        if(blockOffsets[i] > mappingSize || blockFloats.back() * sizeof(float) > mappingSize - blockOffsets[i]) {
+            unmap();
+            throw std::runtime_error("Truncated paged micro-mesh file: " + file.string());
+        }
+    }
+}
+
+PagedBlocks::~PagedBlocks() {
+    unmap();
+}
+
+void PagedBlocks::unmap() {
+    if(!mapping) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mapping);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+#else
+    munmap(const_cast<std::byte*>(mapping), mappingSize);
+    close(fileDescriptor);
+#endif
+    mapping = nullptr;
+}
+
+std::shared_ptr<const std::vector<float>> PagedBlocks::load(const unsigned int primitiveIndex) {
+    Shard& shard = shards[primitiveIndex % SHARD_COUNT];
+
+    {
+        std::scoped_lock lock(shard.mutex);
+        if(const auto it = shard.entries.find(primitiveIndex); it != shard.entries.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second.position);
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second.block;
+        }
+    }
+
+    //Read outside of the lock, page faults on the mapping would stall every other thread of the shard
+    const float* source = reinterpret_cast<const float*>(mapping + blockOffsets[primitiveIndex]);
+    auto block = std::make_shared<const std::vector<float>>(source, source + blockFloats[primitiveIndex]);
+    const size_t bytes = block->size() * sizeof(float);
+    misses.fetch_add(1, std::memory_order_relaxed);
+    bytesRead.fetch_add(bytes, std::memory_order_relaxed);
+
+    std::scoped_lock lock(shard.mutex);
+    const auto [it, inserted] = shard.entries.try_emplace(primitiveIndex);
+    if(!inserted) { //Another thread read it in the meantime
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second.position);
+        return it->second.block;
+    }
+
+    shard.lru.push_front(primitiveIndex);
+    it->second = {block, shard.lru.begin()};
+    shard.bytes += bytes;
+
+    //The block that was just read stays, even if it alone is over the budget
+    while(shard.bytes > shardBudget && shard.lru.size() > 1) {
+        const auto evicted = shard.entries.find(shard.lru.back());
+        shard.bytes -= evicted->second.block->size() * sizeof(float);
+        shard.entries.erase(evicted);
+        shard.lru.pop_back();
+        evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return block;
+}
+
+void PagedBlocks::prefetchAround(const unsigned int primitiveIndex) {
+    if(primitiveIndex >= blockFloats.size()) return;
+
+    //Rays next to each other mostly hit the same neighbourhood, one hint per neighbourhood is enough
+    thread_local const PagedBlocks* lastBlocks = nullptr;
+    thread_local unsigned int lastIndex = 0;
+    const unsigned int distance = primitiveIndex > lastIndex ? primitiveIndex - lastIndex : lastIndex - primitiveIndex;
+    if(lastBlocks == this && distance <= PREFETCH_RADIUS / 2) return;
+    lastBlocks = this;
+    lastIndex = primitiveIndex;
+
+    const unsigned int first = primitiveIndex - std::min(primitiveIndex, PREFETCH_RADIUS);
+    const unsigned int last = static_cast<unsigned int>(std::min<size_t>(blockFloats.size() - 1, static_cast<size_t>(primitiveIndex) + PREFETCH_RADIUS));
+    const size_t begin = blockOffsets[first];
+    const size_t end = blockOffsets[last] + blockFloats[last] * sizeof(float);
+    prefetchedBlocks.fetch_add(last - first + 1, std::memory_order_relaxed);
+
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range{const_cast<std::byte*>(mapping + begin), end - begin};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    //madvise needs a page-aligned address
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t alignedBegin = begin / pageSize * pageSize;
+    madvise(const_cast<std::byte*>(mapping + alignedBegin), end - alignedBegin, MADV_WILLNEED);
+#endif
+}
+
+BlockCacheStats PagedBlocks::stats() const {
+    BlockCacheStats result;
+    result.hits = hits.load(std::memory_order_relaxed);
+    result.misses = misses.load(std::memory_order_relaxed);
+    result.evictions = evictions.load(std::memory_order_relaxed);
+    result.prefetchedBlocks = prefetchedBlocks.load(std::memory_order_relaxed);
+    result.bytesRead = bytesRead.load(std::memory_order_relaxed);
+
+    for(Shard& shard : shards) {
+        std::scoped_lock lock(shard.mutex);
+        result.residentBlocks += shard.entries.size();
+        result.residentBytes += shard.bytes;
+    }
+
+    return result;
+}
+
+void PagedBlocks::resetStats() {
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+    prefetchedBlocks = 0;
+    bytesRead = 0;
+}
+
+size_t PagedBlocks::blockBytes() const {
+    size_t bytes = 0;
+    for(const std::uint32_t floats : blockFloats) bytes += floats * sizeof(float);
+
+    return bytes;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <framework/mesh.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "BakedMesh.h"
+
+//Counters of a PagedBlocks cache since it was opened or since resetStats
+struct BlockCacheStats {
+    size_t hits = 0;
+    size_t misses = 0; //Blocks read from the file
+    size_t evictions = 0;
+    size_t prefetchedBlocks = 0; //Blocks around hit triangles that the OS was asked to read ahead
+    size_t bytesRead = 0;
+    size_t residentBlocks = 0;
+    size_t residentBytes = 0;
+
+    [[nodiscard]] double hitRate() const;
+};
+
+/**
+ * Out-of-core storage of the data of a BakedMesh that grows with the number of micro-vertices: the displacement scales,
+ * min-max displacements and deltas of every base triangle are written to a file as one block per base triangle, which is
+ * memory-mapped and copied into a bounded LRU cache when the traversal first needs it. Everything else (vertices,
+ * triangle data, AABBs and tangential displacements) is small and stays in memory, so the BVH is built as usual.
+ *
+ * The cache is split into shards by base triangle, each with its own lock, LRU list and share of the budget, so threads
+ * tracing different parts of the mesh rarely wait for each other. Blocks are handed out as shared pointers: a block that
+ * is evicted while a ray still traverses its triangle stays alive until that ray is done with it. After a hit, the blocks
+ * of the base triangles next to it in the file are prefetched with an OS hint, since neighbouring rays tend to hit them next.
+ *
+ * The file stores the structs as they are in memory, so it can only be read by the build that wrote it.
+ */
+class PagedBlocks {
+public:
+    static constexpr size_t SHARD_COUNT = 16;
+    static constexpr unsigned int PREFETCH_RADIUS = 8; //Base triangles on either side of a hit whose blocks are prefetched
+    static constexpr size_t BLOCK_ALIGNMENT = 64; //Blocks start on a cache line in the file
+
+    //Where the parts of a block are, in floats from its start
+    struct Layout {
+        size_t minMaxOffset; //After the displacement scales
+        size_t deltaOffset;
+        size_t floatCount;
+    };
+    [[nodiscard]] static Layout layout(const TriangleData& td);
+
+    /**
+     * Bakes a mesh straight into a file, one base triangle at a time: the hierarchy records of a base triangle are
+     * computed, written and dropped before the next one, so they never all have to be in memory at once.
+     *
+     * @param mesh the mesh to bake
+     * @param file the file to write, overwritten if it exists
+     * @param order the order of the displacement scales in the blocks
+     */
+    static void bake(const Mesh& mesh, const std::filesystem::path& file, VertexOrder order = VertexOrder::ROW_MAJOR);
+
+    /**
+     * Opens a file written by bake.
+     *
+     * @param file the file
+     * @param cacheBytes how many bytes of blocks the cache may hold. It always holds at least one block per shard.
+     * @return the baked mesh with its pages set, see BakedMesh::block
+     */
+    [[nodiscard]] static BakedMesh open(const std::filesystem::path& file, size_t cacheBytes);
+
+    PagedBlocks(const std::filesystem::path& file, std::uint64_t blockTableOffset, const std::vector<TriangleData>& triangleData, size_t cacheBytes);
+    ~PagedBlocks();
+    PagedBlocks(const PagedBlocks&) = delete;
+    PagedBlocks& operator=(const PagedBlocks&) = delete;
+
+    //The block of a base triangle: its displacement scales, min-max displacements and deltas, see layout
+    [[nodiscard]] std::shared_ptr<const std::vector<float>> load(unsigned int primitiveIndex);
+
+    //Asks the OS to read the blocks of the base triangles around a hit one ahead. Repeated calls for the same
+    //neighbourhood from one thread are skipped.
+    void prefetchAround(unsigned int primitiveIndex);
+
+    [[nodiscard]] BlockCacheStats stats() const;
+    void resetStats();
+
+    //Bytes of all blocks in the file
+    [[nodiscard]] size_t blockBytes() const;
+
+private:
+    struct Shard {
+        struct Entry {
+            std::shared_ptr<const std::vector<float>> block;
+            std::list<unsigned int>::iterator position;
+        };
+
+        std::mutex mutex;
+        std::list<unsigned int> lru; //Most recently used first
+        std::unordered_map<unsigned int, Entry> entries;
+        size_t bytes = 0;
+    };
+
+    const std::byte* mapping = nullptr;
+    size_t mappingSize = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+
+    const std::uint64_t* blockOffsets = nullptr; //Per base triangle, in the mapping
+    std::vector<std::uint32_t> blockFloats;
+    size_t shardBudget;
+    mutable std::array<Shard, SHARD_COUNT> shards; //Locked by stats() as well
+
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+    std::atomic<size_t> evictions{0};
+    std::atomic<size_t> prefetchedBlocks{0};
+    std::atomic<size_t> bytesRead{0};
+
+    void unmap();
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <cstdint>
+
+//Same as RayDesc in HLSL
+struct RayDesc {
+    glm::vec3 origin;
+    float tMin;
+    glm::vec3 direction;
+    float tMax;
+};
+
+//The footprint of a ray: a cone around it whose width at distance t is width + t * spreadAngle. A spread angle of 0 disables level of detail.
+struct RayCone {
+    float width = 0.0f;
+    float spreadAngle = 0.0f;
+
+    [[nodiscard]] float widthAt(const float t) const {
+        return width + t * spreadAngle;
+    }
+
+    [[nodiscard]] bool isEnabled() const {
+        return width > 0.0f || spreadAngle > 0.0f;
+    }
+};
+
+static constexpr int RAY_PACKET_SIZE = 8;
+
+//Rays that are traced together, such as the primary rays of a block of 4x2 pixels. Lanes whose bit is not set in activeMask are ignored.
+struct RayPacket {
+    RayDesc rays[RAY_PACKET_SIZE];
+    unsigned int activeMask = 0;
+};
+
+//The closest hit of a ray. N and V are the same attributes that the intersection shader reports to the closest hit shader
+struct HitInfo {
+    float t;
+    glm::vec3 N; //normal
+    glm::vec3 V; //view direction
+    unsigned int primitiveIndex;
+    unsigned int instanceIndex = 0; //Like InstanceIndex() in HLSL, only set by InstancedScene
+    /**
+     * The micro-triangle of the base triangle that was hit. In the grid of micro-vertex coordinates (x, y) with
+     * 0 <= y <= x (see BakedMesh::displacementScale), the upright micro-triangle (x, y) (x + 1, y) (x + 1, y + 1) is
+     * x * x + 2 * y and the upside down one (x, y) (x + 1, y + 1) (x, y + 1) is x * x + 2 * y + 1. Where a larger
+     * triangle stands in for micro-triangles (a flat leaf or level of detail), the micro-triangle under the hit.
+     */
+    unsigned int microTriangleIndex = 0;
+    glm::vec2 barycentrics{0.0f}; //Of the hit in that micro-triangle, the weights of its second and third vertex in the order above
+};
+
+//Counters that are gathered while tracing rays. Every thread keeps its own and they are added together afterwards.
+struct TraversalStats {
+    uint64_t rays = 0;
+    uint64_t hits = 0;
+    uint64_t bvhNodesVisited = 0;
+    uint64_t intersectionCalls = 0; //How often the (procedural) intersection of a base triangle was invoked
+    uint64_t hierarchyNodesVisited = 0; //Stack elements popped during the micro-mesh traversal
+    uint64_t boundingTriangleTests = 0;
+    uint64_t microTriangleTests = 0;
+    uint64_t lodTerminations = 0; //Hierarchy triangles that were tested in place of their micro-triangles, see RayCone
+    uint64_t flatLeaves = 0; //Flat leaves of a sparse hierarchy that were tested in place of their micro-triangles, see BakedMesh::collapseFlatSubtrees
+    uint64_t gridCellsVisited = 0; //Micro-triangles that the grid traversal considered, see intersectMicroMeshTriangleGrid
+
+    TraversalStats& operator+=(const TraversalStats& other) {
+        rays += other.rays;
+        hits += other.hits;
+        bvhNodesVisited += other.bvhNodesVisited;
+        intersectionCalls += other.intersectionCalls;
+        hierarchyNodesVisited += other.hierarchyNodesVisited;
+        boundingTriangleTests += other.boundingTriangleTests;
+        microTriangleTests += other.microTriangleTests;
+        lodTerminations += other.lodTerminations;
+        flatLeaves += other.flatLeaves;
+        gridCellsVisited += other.gridCellsVisited;
+
+        return *this;
+    }
+};
@@ -0,0 +1,95 @@
+#include "RayQuery.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+//Every thread counts its own statistics, padded to a cache line since the counters are written for every ray
+struct alignas(64) WorkerStats {
+    TraversalStats traversal;
+};
+
+RayQuery::RayQuery(const RayTracedScene& scene, const unsigned int threadCount, const bool packets): scene(scene),
+    threadCount(threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency())), packets(packets) {}
+
+unsigned int RayQuery::getThreadCount() const {
+    return threadCount;
+}
+
+bool RayQuery::getPacketTraversal() const {
+    return packets;
+}
+
+static RayDesc loadRay(const RayArrays& rays, const size_t i) {
+    return {{rays.originX[i], rays.originY[i], rays.originZ[i]}, rays.tMin ? rays.tMin[i] : 0.0f,
+            {rays.directionX[i], rays.directionY[i], rays.directionZ[i]}, rays.tMax ? rays.tMax[i] : std::numeric_limits<float>::max()};
+}
+
+static void storeHit(const HitArrays& hits, const size_t i, const bool hit, const HitInfo& info) {
+    if(hits.t) hits.t[i] = hit ? info.t : std::numeric_limits<float>::infinity();
+    if(hits.baseTriangle) hits.baseTriangle[i] = hit ? info.primitiveIndex : RayQuery::MISS;
+    if(hits.microTriangle) hits.microTriangle[i] = hit ? info.microTriangleIndex : RayQuery::MISS;
+    if(hits.u) hits.u[i] = hit ? info.barycentrics.x : 0.0f;
+    if(hits.v) hits.v[i] = hit ? info.barycentrics.y : 0.0f;
+    if(hits.instance) hits.instance[i] = hit ? info.instanceIndex : RayQuery::MISS;
+}
+
+QueryStats RayQuery::trace(const RayArrays& rays, const HitArrays& hits) const {
+    if(rays.count > 0 && (!rays.originX || !rays.originY || !rays.originZ || !rays.directionX || !rays.directionY || !rays.directionZ)) {
+        throw std::invalid_argument("Every ray needs an origin and a direction");
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const size_t chunks = (rays.count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const auto workers = static_cast<unsigned int>(std::min<size_t>(threadCount, chunks));
+    std::vector<WorkerStats> workerStats(std::max(1u, workers));
+    std::atomic<size_t> nextChunk{0};
+
+    const auto work = [&](const unsigned int worker) {
+        TraversalArena arena = scene.createArena();
+        TraversalStats& stats = workerStats[worker].traversal;
+
+        for(size_t chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+            const size_t begin = chunk * CHUNK_SIZE;
+            const size_t end = std::min(begin + CHUNK_SIZE, rays.count);
+
+            if(!packets) {
+                for(size_t i = begin; i < end; i++) {
+                    HitInfo hit;
+                    const bool found = scene.traceRay(loadRay(rays, i), hit, stats, arena);
+                    storeHit(hits, i, found, hit);
+                }
+                continue;
+            }
+
+            for(size_t first = begin; first < end; first += RAY_PACKET_SIZE) {
+                const auto lanes = static_cast<int>(std::min<size_t>(RAY_PACKET_SIZE, end - first));
+
+                RayPacket packet;
+                for(int lane = 0; lane < lanes; lane++) packet.rays[lane] = loadRay(rays, first + lane);
+                for(int lane = lanes; lane < RAY_PACKET_SIZE; lane++) packet.rays[lane] = packet.rays[0];
+                packet.activeMask = (1u << lanes) - 1;
+
+                HitInfo packetHits[RAY_PACKET_SIZE];
+                const unsigned int hitMask = scene.tracePacket(packet, packetHits, stats, arena);
+                for(int lane = 0; lane < lanes; lane++) storeHit(hits, first + lane, (hitMask & (1u << lane)) != 0, packetHits[lane]);
+            }
+        }
+    };
+
+    //The calling thread works as well
+    std::vector<std::thread> threads;
+    for(unsigned int worker = 1; worker < workers; worker++) threads.emplace_back(work, worker);
+    if(workers > 0) work(0);
+    for(std::thread& thread : threads) thread.join();
+
+    QueryStats queryStats;
+    for(const WorkerStats& stats : workerStats) queryStats.traversal += stats.traversal;
+    queryStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return queryStats;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "RayDesc.h"
+#include "RayTracedScene.h"
+
+//Rays as a structure of arrays, one element per ray, see RayQuery
+struct RayArrays {
+    size_t count = 0;
+    const float* originX = nullptr;
+    const float* originY = nullptr;
+    const float* originZ = nullptr;
+    //The directions do not have to be normalized, t is measured in multiples of them
+    const float* directionX = nullptr;
+    const float* directionY = nullptr;
+    const float* directionZ = nullptr;
+    const float* tMin = nullptr; //0 for every ray if null
+    const float* tMax = nullptr; //Unbounded for every ray if null
+};
+
+//The closest hits of RayArrays, one element per ray. Arrays that are null are not written.
+struct HitArrays {
+    float* t = nullptr; //Infinity for a miss
+    uint32_t* baseTriangle = nullptr; //RayQuery::MISS for a miss
+    uint32_t* microTriangle = nullptr; //See HitInfo::microTriangleIndex
+    float* u = nullptr; //Barycentrics in the micro-triangle, see HitInfo::barycentrics
+    float* v = nullptr;
+    uint32_t* instance = nullptr; //Always 0 for a CPUScene
+};
+
+struct QueryStats {
+    double seconds = 0.0;
+    TraversalStats traversal;
+
+    [[nodiscard]] double raysPerSecond() const {
+        return seconds > 0.0 ? static_cast<double>(traversal.rays) / seconds : 0.0;
+    }
+};
+
+/**
+ * Finds the closest hits of large batches of rays for tools other than the renderer, such as visibility sampling,
+ * picking and placement. The rays are split into chunks that the threads take one at a time, and every chunk is traced
+ * in packets of RAY_PACKET_SIZE consecutive rays (see CPUScene::tracePacket), whose coherent packets share the traversal
+ * and test the children of hierarchy triangles with the SIMD kernels of EdgeKernels. Incoherent packets fall back to
+ * single rays, so callers that order their rays by origin and direction get the most out of the packets.
+ *
+ * Unlike CPURenderer, a query allocates the scratch memory of its threads itself, so several threads can run queries
+ * on the same RayQuery at once.
+ */
+class RayQuery {
+public:
+    static constexpr uint32_t MISS = ~0u;
+    //Rays that a thread takes at once, a multiple of RAY_PACKET_SIZE
+    static constexpr size_t CHUNK_SIZE = 64 * RAY_PACKET_SIZE;
+
+    /**
+     * @param scene the scene to trace the rays through, which must outlive the query
+     * @param threadCount the number of threads per query, including the calling thread. 0 uses every hardware thread.
+     * @param packets whether to trace the rays in packets rather than one by one
+     */
+    explicit RayQuery(const RayTracedScene& scene, unsigned int threadCount = 0, bool packets = true);
+
+    [[nodiscard]] unsigned int getThreadCount() const;
+    [[nodiscard]] bool getPacketTraversal() const;
+
+    /**
+     * Finds the closest hit of every ray. Throws std::invalid_argument if an origin or direction array is missing.
+     *
+     * @param rays the rays
+     * @param hits where the hits are written
+     * @return the time and traversal statistics of the query
+     */
+    QueryStats trace(const RayArrays& rays, const HitArrays& hits) const;
+
+private:
+    const RayTracedScene& scene;
+    unsigned int threadCount;
+    bool packets;
+};
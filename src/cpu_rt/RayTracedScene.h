@@ -0,0 +1,21 @@
+#pragma once
+
+#include "AABB.h"
+#include "RayDesc.h"
+#include "TraversalArena.h"
+
+//What CPURenderer traces rays through: a single micro-mesh (CPUScene) or instances of several of them (InstancedScene)
+class RayTracedScene {
+public:
+    virtual ~RayTracedScene() = default;
+
+    //Finds the closest hit of a ray, see CPUScene::traceRay
+    virtual bool traceRay(const RayDesc& ray, HitInfo& hit, TraversalStats& stats, TraversalArena& arena, const RayCone& cone = {}) const = 0;
+    //Finds the closest hits of a packet of rays, see CPUScene::tracePacket
+    virtual unsigned int tracePacket(const RayPacket& packet, HitInfo (&hits)[RAY_PACKET_SIZE], TraversalStats& stats, TraversalArena& arena, const RayCone& cone = {}) const = 0;
+
+    //Creates scratch memory that is large enough to trace any ray through this scene without allocating
+    [[nodiscard]] virtual TraversalArena createArena() const = 0;
+    //The bounds of everything in the scene in world space, empty if there is nothing
+    [[nodiscard]] virtual AABB bounds() const = 0;
+};
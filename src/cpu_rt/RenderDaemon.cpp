@@ -0,0 +1,354 @@
+#include "RenderDaemon.h"
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/gtc/constants.hpp>
+#include <json.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "CameraPath.h"
+#include "CPURenderer.h"
+#include "ShardedBake.h"
+#include "Socket.h"
+
+using json = nlohmann::json;
+
+static glm::vec3 toVec3(const json& j) {
+    return {j.at(0).get<float>(), j.at(1).get<float>(), j.at(2).get<float>()};
+}
+
+static json toJson(const glm::vec3& v) {
+    return {v.x, v.y, v.z};
+}
+
+static std::string hexHash(const std::uint64_t hash) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+    return text;
+}
+
+//Renders the frame of a render request, see RenderDaemon
+static json renderFrame(const json& request, const RayTracedScene& scene, const unsigned int threadCount, const RenderDaemon::Options& options,
+                        const std::filesystem::path& output) {
+    CameraPath path;
+    if(request.contains("resolution")) path.resolution = {request["resolution"].at(0).get<unsigned int>(), request["resolution"].at(1).get<unsigned int>()};
+    if(path.resolution.x == 0 || path.resolution.y == 0 || path.resolution.x > 16384 || path.resolution.y > 16384) {
+        throw std::invalid_argument("The resolution must be between 1 and 16384 pixels on both axes");
+    }
+    path.fovy = glm::radians(request.value("fov", glm::degrees(path.fovy)));
+
+    CameraKeyframe camera;
+    if(request.contains("camera")) {
+        const json& c = request["camera"];
+        camera = {0.0f, toVec3(c.at("lookAt")), toVec3(c.at("rotation")), c.at("distance").get<float>()};
+    } else {
+        camera = path.frameBounds(scene.bounds(), request.value("angle", 0.0f));
+    }
+
+    CPURenderer renderer(scene, threadCount);
+    renderer.setPacketTraversal(request.value("packets", options.packets));
+    renderer.setLevelOfDetail(std::max(0.0f, request.value("lod", options.lodPixels)));
+
+    //A tile of the frame is sent back rather than written, see TileCoordinator
+    Tile window{{0, 0}, path.resolution};
+    if(request.contains("tile")) {
+        const json& t = request["tile"];
+        window.min = {t.at(0).get<unsigned int>(), t.at(1).get<unsigned int>()};
+        window.max = window.min + glm::uvec2(t.at(2).get<unsigned int>(), t.at(3).get<unsigned int>());
+        if(window.max.x <= window.min.x || window.max.y <= window.min.y || window.max.x > path.resolution.x || window.max.y > path.resolution.y) {
+            throw std::invalid_argument("The tile must be a non-empty rectangle within the resolution");
+        }
+    }
+
+    std::vector<glm::vec3> pixels;
+    const FrameStats fs = renderer.render(glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(camera)), path.resolution, window, pixels);
+
+    json response;
+    if(request.contains("tile")) {
+        response["pixels"] = encodeBase64(CPURenderer::toRGB8(pixels));
+    } else if(!output.empty()) {
+        CPURenderer::writeImage(pixels, path.resolution, output);
+        response["output"] = output.string();
+    }
+    response["threads"] = renderer.getThreadCount();
+    response["renderMs"] = fs.seconds * 1000.0;
+    response["rays"] = fs.traversal.rays;
+    response["mraysPerSecond"] = fs.raysPerSecond() / 1e6;
+
+    return response;
+}
+
+//Traces the rays of a query request, see RenderDaemon
+static json queryRays(const json& request, const RayTracedScene& scene) {
+    TraversalArena arena = scene.createArena();
+    TraversalStats stats;
+
+    json hits = json::array();
+    for(const json& r : request.at("rays")) {
+        //The same ray interval as primary rays by default, see CPURenderer::generateRay
+        const RayDesc ray{toVec3(r.at("origin")), r.value("tMin", 0.001f), toVec3(r.at("direction")), r.value("tMax", 10000.0f)};
+
+        HitInfo hit;
+        if(!scene.traceRay(ray, hit, stats, arena)) {
+            hits.push_back({{"hit", false}});
+            continue;
+        }
+
+        hits.push_back({{"hit", true}, {"t", hit.t}, {"primitive", hit.primitiveIndex}, {"instance", hit.instanceIndex},
+                        {"microTriangle", hit.microTriangleIndex}, {"barycentrics", {hit.barycentrics.x, hit.barycentrics.y}},
+                        {"position", toJson(ray.origin + hit.t * ray.direction)}, {"normal", toJson(hit.N)}});
+    }
+
+    return {{"hits", std::move(hits)}};
+}
+
+//Bakes the shard of a bake request and writes it, see RenderDaemon
+static json bakeShard(const json& request, const Mesh& mesh, const unsigned int threadCount, const std::filesystem::path& output) {
+    const ShardedBake::Range range{request.at("first").get<unsigned int>(), request.at("count").get<unsigned int>()};
+    const std::string order = request.value("order", std::string("row-major"));
+    if(order != "row-major" && order != "bird-curve") throw std::invalid_argument("Unknown vertex order: " + order);
+
+    const auto start = std::chrono::steady_clock::now();
+    const ShardedBake::Shard shard = ShardedBake::bakeShard(mesh, range, order == "bird-curve" ? VertexOrder::BIRD_CURVE : VertexOrder::ROW_MAJOR, threadCount);
+    ShardedBake::write(shard, output);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return {{"meshTriangles", mesh.triangles.size()}, {"bakeMs", seconds * 1000.0}, {"bytes", std::filesystem::file_size(output)}};
+}
+
+RenderDaemon::RenderDaemon(SceneCache::Loader loader, Options daemonOptions, MeshLoader bakeMeshLoader):
+    options(std::move(daemonOptions)), cache(std::move(loader), options.cacheBytes), meshLoader(std::move(bakeMeshLoader))
+{
+    if(options.threadCount == 0) options.threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    //As many workers as threads, so every running job has at least one
+    for(unsigned int i = 0; i < options.threadCount; i++) workers.emplace_back(&RenderDaemon::work, this);
+}
+
+RenderDaemon::~RenderDaemon() {
+    {
+        std::scoped_lock lock(queueMutex);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+
+    for(std::thread& worker : workers) worker.join();
+}
+
+unsigned int RenderDaemon::getThreadCount() const {
+    return options.threadCount;
+}
+
+std::filesystem::path RenderDaemon::outputPath(const std::string& output) const {
+    if(options.outputDirectory.empty()) {
+        if(Socket::isTcpAddress(options.address)) throw std::invalid_argument("This daemon does not write outputs without an output directory");
+        return output;
+    }
+
+    //Resolves symbolic links and "..", so the output can not leave the directory through either
+    const std::filesystem::path directory = std::filesystem::weakly_canonical(options.outputDirectory);
+    const std::filesystem::path path = std::filesystem::weakly_canonical(directory / output);
+    const std::filesystem::path relative = path.lexically_relative(directory);
+    if(relative.empty() || relative == "." || *relative.begin() == "..") throw std::invalid_argument("The output is not within the output directory: " + output);
+
+    return path;
+}
+
+std::shared_ptr<const Mesh> RenderDaemon::loadBakeMesh(const std::filesystem::path& file, const std::uint64_t hash) {
+    if(!meshLoader) throw std::runtime_error("This daemon does not bake meshes");
+
+    std::scoped_lock lock(meshMutex);
+    if(!bakeMesh || bakeMeshHash != hash) {
+        bakeMesh.reset();
+        bakeMesh = std::make_shared<const Mesh>(meshLoader(file));
+        bakeMeshHash = hash;
+    }
+
+    return bakeMesh;
+}
+
+void RenderDaemon::work() {
+    while(true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(queueMutex);
+            queueChanged.wait(lock, [&] { return stopping || !queue.empty(); });
+            if(queue.empty()) return;
+
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        job();
+    }
+}
+
+void RenderDaemon::submit(std::function<void(unsigned int threadCount)> job) {
+    auto task = std::make_shared<std::packaged_task<void()>>([this, job = std::move(job)] {
+        //The threads are split between the jobs that run when this one starts
+        const unsigned int running = ++activeJobs;
+        struct Done {
+            std::atomic<unsigned int>& activeJobs;
+            ~Done() { --activeJobs; }
+        } done{activeJobs};
+
+        job(std::max(1u, options.threadCount / running));
+    });
+    std::future<void> result = task->get_future();
+
+    {
+        std::scoped_lock lock(queueMutex);
+        queue.emplace_back([task] { (*task)(); });
+    }
+    queueChanged.notify_one();
+
+    result.get();
+}
+
+std::string RenderDaemon::handle(const std::string& request) {
+    json response;
+    try {
+        const json j = json::parse(request);
+        if(j.contains("id")) response["id"] = j["id"];
+
+        const std::string type = j.at("type").get<std::string>();
+        if(type == "render" || type == "query") {
+            const std::filesystem::path mesh = j.at("mesh").get<std::string>();
+            //Tiles are sent back rather than written
+            const std::filesystem::path output = type == "render" && !j.contains("tile") && j.contains("output") ? outputPath(j["output"].get<std::string>())
+                                                                                                              : std::filesystem::path();
+
+            json result;
+            SceneCache::Result cached;
+            try {
+                submit([&](const unsigned int threadCount) {
+                    cached = cache.get(mesh);
+                    result = type == "render" ? renderFrame(j, *cached.scene, threadCount, options, output) : queryRays(j, *cached.scene);
+                });
+            } catch(...) {
+                failedJobs++;
+                throw;
+            }
+            completedJobs++;
+
+            response["ok"] = true;
+            response["hash"] = hexHash(cached.hash);
+            response["cached"] = cached.hit;
+            response["loadMs"] = cached.loadSeconds * 1000.0;
+            response.update(result);
+        } else if(type == "bake") {
+            const std::filesystem::path mesh = j.at("mesh").get<std::string>();
+            const std::filesystem::path output = outputPath(j.at("output").get<std::string>());
+
+            json result;
+            std::uint64_t hash = 0;
+            try {
+                submit([&](const unsigned int threadCount) {
+                    hash = cache.contentHash(mesh);
+                    result = bakeShard(j, *loadBakeMesh(mesh, hash), threadCount, output);
+                });
+            } catch(...) {
+                failedJobs++;
+                throw;
+            }
+            completedJobs++;
+
+            response["ok"] = true;
+            response["hash"] = hexHash(hash);
+            response.update(result);
+        } else if(type == "stats") {
+            const SceneCacheStats stats = cache.stats();
+            response["ok"] = true;
+            response["threads"] = options.threadCount;
+            response["activeJobs"] = activeJobs.load();
+            response["completedJobs"] = completedJobs.load();
+            response["failedJobs"] = failedJobs.load();
+            response["cacheHits"] = stats.hits;
+            response["cacheMisses"] = stats.misses;
+            response["cacheEvictions"] = stats.evictions;
+            response["residentScenes"] = stats.residentScenes;
+            response["residentBytes"] = stats.residentBytes;
+            response["budgetBytes"] = cache.budget();
+        } else if(type == "shutdown") {
+            shutdownRequested = true;
+            response["ok"] = true;
+        } else {
+            throw std::invalid_argument("Unknown request type: " + type);
+        }
+    } catch(const std::exception& e) {
+        response["ok"] = false;
+        response["error"] = e.what();
+    }
+
+    //Paths and errors may contain bytes that are not UTF-8, which should not take the response down with them
+    return response.dump(-1, ' ', false, json::error_handler_t::replace);
+}
+
+void RenderDaemon::serve(Socket connection) {
+    std::string line;
+    while(connection.readLine(line)) {
+        if(line.empty()) continue;
+
+        if(!connection.sendAll(handle(line) + '\n')) break;
+        //Only once the response is out, since run() closes every connection when it stops
+        if(shutdownRequested) wakeListener();
+    }
+
+    //Notified with the lock held: run() may destroy the daemon as soon as it sees the last connection go
+    const std::intptr_t handle = connection.handle();
+    connection = Socket();
+    std::scoped_lock lock(connectionMutex);
+    connections.erase(handle);
+    connectionsClosed.notify_all();
+}
+
+void RenderDaemon::wakeListener() const {
+    //A daemon that listens on every interface is reached on the loopback interface
+    std::string address = options.address;
+    if(Socket::isTcpAddress(address)) {
+        const std::string host = address.substr(0, address.rfind(':'));
+        if(host == "*" || host == "0.0.0.0") address = "127.0.0.1" + address.substr(host.size());
+        else if(host == "[::]") address = "[::1]" + address.substr(host.size());
+    }
+
+    try {
+        (void)Socket::connect(address);
+    } catch(const std::runtime_error&) {
+        //run() has already stopped listening
+    }
+}
+
+void RenderDaemon::run() {
+    if(!options.allowRemote && !Socket::isLocalAddress(options.address)) {
+        throw std::runtime_error("Other machines could connect to " + options.address + ", which needs --allow-remote, see the trust model of --daemon");
+    }
+
+    const Socket listener = Socket::listen(options.address);
+    std::cout << "Listening on " << options.address << " with " << options.threadCount << " threads and a " << (options.cacheBytes >> 20) << " MB scene cache"
+              << std::endl;
+
+    while(!shutdownRequested) {
+        Socket connection = listener.accept();
+        if(!connection.valid()) continue;
+        if(shutdownRequested) break;
+
+        std::scoped_lock lock(connectionMutex);
+        connections.insert(connection.handle());
+        std::thread(&RenderDaemon::serve, this, std::move(connection)).detach();
+    }
+
+    if(!Socket::isTcpAddress(options.address)) std::filesystem::remove(options.address);
+
+    //Stop reading from the other clients, their jobs that already run still finish before their connections close
+    std::unique_lock lock(connectionMutex);
+    for(const std::intptr_t connection : connections) Socket::shutdown(connection);
+    connectionsClosed.wait(lock, [&] { return connections.empty(); });
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <framework/mesh.h>
+
+#include "SceneCache.h"
+#include "Socket.h"
+
+/**
+ * A headless renderer that stays resident between jobs: it listens on a local (Unix domain) socket or a TCP port, and
+ * every scene it loads stays baked in a SceneCache, so rendering a mesh again goes straight to tracing rays.
+ *
+ * Clients send one JSON object per line and get one JSON object per line back, in the same order. Every request may have
+ * an "id", which the response repeats. The requests are:
+ *
+ *     {"type": "render", "mesh": "path.gltf",      Renders a frame like --render does
+ *      "output": "frame.png",                      (optional, the image is not written without it)
+ *      "resolution": [1024, 1024], "fov": 80,      (optional, defaults as in a camera path)
+ *      "camera": {"lookAt": [0, 0, 0], "rotation": [0, 0, 0], "distance": 4},
+ *                                                  (optional, a keyframe as in a camera path, by default the mesh is framed)
+ *      "angle": 0,                                 (optional, radians around the mesh when it is framed)
+ *      "packets": false, "lod": 0,                 (optional, see CPURenderer, defaults from the daemon's options)
+ *      "tile": [x, y, width, height]}              (optional, renders only these pixels and sends them back instead of writing them)
+ *     -> {"ok": true, "hash": "...", "cached": true, "loadMs": ..., "renderMs": ..., "rays": ..., "mraysPerSecond": ...,
+ *         "pixels": "..."}                         (for a tile, its pixels row by row as 8-bit RGB in base64, see CPURenderer::toRGB8)
+ *
+ *     {"type": "query", "mesh": "path.gltf",      Finds the closest hits of rays
+ *      "rays": [{"origin": [0, 0, 5], "direction": [0, 0, -1], "tMin": 0.001, "tMax": 10000}, ...]}
+ *     -> {"ok": true, ..., "hits": [{"hit": true, "t": ..., "primitive": ..., "instance": ..., "microTriangle": ...,
+ *         "barycentrics": [u, v], "position": [...], "normal": [...]}, {"hit": false}, ...]}   (see HitInfo)
+ *
+ *     {"type": "bake", "mesh": "path.gltf",       Bakes a shard of the mesh and writes it to a file, see ShardedBake and BakeCoordinator
+ *      "first": 0, "count": 1000,                  (the base triangles of the shard)
+ *      "order": "row-major",                       (optional, or "bird-curve", see VertexOrder)
+ *      "output": "shard.bin"}
+ *     -> {"ok": true, "hash": "...", "meshTriangles": ..., "bakeMs": ..., "bytes": ...}
+ *
+ *     {"type": "stats"}                            Counters of the scene cache and the jobs
+ *     {"type": "shutdown"}                         Stops the daemon once the jobs that were sent are done
+ *
+ * A request that fails gets {"ok": false, "error": "..."}. Render, query and bake jobs of all connections run on one pool
+ * of worker threads: a job that starts while others are running renders with its share of the threads, and jobs that do not
+ * fit wait in a queue. Bake jobs do not go through the scene cache, but keep the last mesh they loaded, since the shards
+ * of a mesh tend to come one after another.
+ *
+ * There is no authentication: whoever can connect can have the daemon read any mesh file that it can read, write
+ * outputs and shut it down. So by default only this machine can connect, and TCP addresses on other interfaces need
+ * Options::allowRemote, for networks where every peer is trusted. Outputs are written within Options::outputDirectory
+ * only, and a "../" or an absolute path that leaves it fails the request. Without an output directory, outputs are
+ * refused over TCP, and clients of a Unix domain socket, which its file permissions already restrict, write anywhere.
+ */
+class RenderDaemon {
+public:
+    struct Options {
+        std::string address; //A Unix domain socket or a TCP "host:port", see Socket
+        unsigned int threadCount = 0; //Threads shared by all jobs, 0 uses every hardware thread
+        size_t cacheBytes = size_t(4) << 30; //Budget of the scene cache
+        bool packets = false; //Default of render jobs
+        float lodPixels = 0.0f; //Default of render jobs
+        bool allowRemote = false; //Listen on TCP addresses that other machines can reach, see the trust model above
+        std::filesystem::path outputDirectory; //Where requests may write their outputs, see the trust model above
+    };
+
+    //Loads the mesh of a file for bake jobs
+    using MeshLoader = std::function<Mesh(const std::filesystem::path& file)>;
+
+    /**
+     * Starts the worker threads, but does not listen yet, see run.
+     *
+     * @param loader loads and bakes a scene, see SceneCache
+     * @param daemonOptions the socket, threads and cache
+     * @param bakeMeshLoader loads meshes for bake jobs, which fail without one
+     */
+    RenderDaemon(SceneCache::Loader loader, Options daemonOptions, MeshLoader bakeMeshLoader = {});
+    ~RenderDaemon();
+    RenderDaemon(const RenderDaemon&) = delete;
+    RenderDaemon& operator=(const RenderDaemon&) = delete;
+
+    /**
+     * Listens on the address and serves every connection on a thread of its own, until a shutdown request. Replaces a stale
+     * socket file. Throws if the address can be reached from other machines without Options::allowRemote.
+     */
+    void run();
+
+    //Handles one request line and returns its response line, without the newline. Thread-safe.
+    [[nodiscard]] std::string handle(const std::string& request);
+
+    [[nodiscard]] unsigned int getThreadCount() const;
+
+private:
+    Options options;
+    SceneCache cache;
+
+    MeshLoader meshLoader;
+    std::mutex meshMutex;
+    std::uint64_t bakeMeshHash = 0; //Locked by meshMutex
+    std::shared_ptr<const Mesh> bakeMesh; //The mesh of the last bake job, locked by meshMutex
+
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    std::deque<std::function<void()>> queue;
+    std::vector<std::thread> workers;
+    bool stopping = false; //Locked by queueMutex
+    std::atomic<unsigned int> activeJobs{0};
+    std::atomic<size_t> completedJobs{0};
+    std::atomic<size_t> failedJobs{0};
+
+    std::atomic<bool> shutdownRequested{false};
+    std::mutex connectionMutex;
+    std::condition_variable connectionsClosed;
+    std::set<std::intptr_t> connections; //Open client sockets, so shutting down can unblock their reads
+
+    //The file that a request may write as its output, throws if the output is not allowed, see the trust model above
+    [[nodiscard]] std::filesystem::path outputPath(const std::string& output) const;
+
+    //The mesh of a bake job, loaded unless it is the one of the last bake job
+    [[nodiscard]] std::shared_ptr<const Mesh> loadBakeMesh(const std::filesystem::path& file, std::uint64_t hash);
+
+    //Runs a job on the worker threads and waits until it is done. Rethrows its errors.
+    void submit(std::function<void(unsigned int threadCount)> job);
+    void work();
+
+    //Reads the requests of a connection and writes their responses until the client disconnects
+    void serve(Socket connection);
+    //Connects to the socket, so that run() returns from accepting and sees the shutdown request
+    void wakeListener() const;
+};
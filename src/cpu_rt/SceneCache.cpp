@@ -0,0 +1,196 @@
+#include "SceneCache.h"
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <json.hpp>
+DISABLE_WARNINGS_POP()
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+
+using json = nlohmann::json;
+
+static constexpr std::uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+static constexpr std::uint64_t FNV_PRIME = 0x100000001b3ull;
+
+static std::uint64_t fnv1a(std::uint64_t hash, const void* data, const size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for(size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+//Decodes the %XX escapes of a relative URI, as tinygltf does before it opens the file
+static std::string decodeUri(const std::string& uri) {
+    std::string decoded;
+    for(size_t i = 0; i < uri.size(); i++) {
+        if(uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) && std::isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+            decoded.push_back(static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        } else {
+            decoded.push_back(uri[i]);
+        }
+    }
+
+    return decoded;
+}
+
+//Every file a glTF document loads besides itself: the URIs of buffers, images and micromaps, and the micro-meshes that
+//nodes of a scene reference in their extras (see TinyGLTFLoader::loadScene)
+static void collectReferences(const json& j, const std::filesystem::path& directory, std::vector<std::filesystem::path>& references) {
+    if(j.is_object()) {
+        for(const auto& [key, value] : j.items()) {
+            if(value.is_string()) {
+                const std::string& text = value.get_ref<const std::string&>();
+                if(key == "uri" && !text.starts_with("data:")) references.push_back(std::filesystem::weakly_canonical(directory / decodeUri(text)));
+                else if(key == "umesh") references.push_back(std::filesystem::weakly_canonical(directory / text));
+            } else {
+                collectReferences(value, directory, references);
+            }
+        }
+    } else if(j.is_array()) {
+        for(const auto& value : j) collectReferences(value, directory, references);
+    }
+}
+
+SceneCache::SceneCache(Loader sceneLoader, const size_t byteBudget): loader(std::move(sceneLoader)), budgetBytes(byteBudget) {}
+
+SceneCache::Result SceneCache::get(const std::filesystem::path& file) {
+    const auto start = std::chrono::steady_clock::now();
+    const std::uint64_t hash = contentHash(file);
+
+    std::promise<std::shared_ptr<const RayTracedScene>> promise;
+    std::shared_future<std::shared_ptr<const RayTracedScene>> future;
+    bool load = false;
+    {
+        std::scoped_lock lock(mutex);
+        const auto [it, inserted] = entries.try_emplace(hash);
+        if(inserted) {
+            lru.push_front(hash);
+            it->second.position = lru.begin();
+            it->second.scene = promise.get_future().share();
+            counters.misses++;
+            load = true;
+        } else {
+            lru.splice(lru.begin(), lru, it->second.position);
+            counters.hits++;
+        }
+
+        future = it->second.scene;
+    }
+
+    //Loaded outside of the lock, so jobs for other scenes are not held up by it
+    if(load) {
+        try {
+            Loaded loaded = loader(file, hash);
+            {
+                std::scoped_lock lock(mutex);
+                Entry& entry = entries.at(hash); //Loading entries are never evicted
+                entry.bytes = loaded.bytes;
+                entry.loading = false;
+                bytes += loaded.bytes;
+                evict(hash);
+            }
+            promise.set_value(std::move(loaded.scene));
+        } catch(...) {
+            //Jobs that wait for this load get the same error, later jobs try again
+            {
+                std::scoped_lock lock(mutex);
+                const auto it = entries.find(hash);
+                lru.erase(it->second.position);
+                entries.erase(it);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+    std::shared_ptr<const RayTracedScene> scene = future.get();
+    return {std::move(scene), !load, hash, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+}
+
+void SceneCache::evict(const std::uint64_t keep) {
+    for(auto it = lru.end(); bytes > budgetBytes && it != lru.begin();) {
+        --it;
+        const auto entry = entries.find(*it);
+        if(entry->second.loading || *it == keep) continue;
+
+        bytes -= entry->second.bytes;
+        entries.erase(entry);
+        it = lru.erase(it);
+        counters.evictions++;
+    }
+}
+
+std::uint64_t SceneCache::contentHash(const std::filesystem::path& file) {
+    if(!std::filesystem::is_regular_file(file)) throw std::runtime_error("Could not open " + file.string());
+
+    //Depth first over the references, every file once
+    std::uint64_t hash = FNV_OFFSET;
+    std::vector<std::filesystem::path> pending{std::filesystem::weakly_canonical(file)};
+    std::unordered_set<std::string> visited;
+    while(!pending.empty()) {
+        const std::filesystem::path next = std::move(pending.back());
+        pending.pop_back();
+        if(!visited.insert(next.string()).second) continue;
+
+        const FileHash fileHash = hashFile(next);
+        hash = fnv1a(hash, &fileHash.hash, sizeof(fileHash.hash));
+        for(auto it = fileHash.references.rbegin(); it != fileHash.references.rend(); ++it) {
+            //Files that do not exist are left to the loader to complain about
+            if(std::filesystem::is_regular_file(*it)) pending.push_back(*it);
+        }
+    }
+
+    return hash;
+}
+
+SceneCache::FileHash SceneCache::hashFile(const std::filesystem::path& file) {
+    const std::uintmax_t size = std::filesystem::file_size(file);
+    const std::filesystem::file_time_type modified = std::filesystem::last_write_time(file);
+    {
+        std::scoped_lock lock(hashMutex);
+        if(const auto it = fileHashes.find(file.string()); it != fileHashes.end() && it->second.size == size && it->second.modified == modified) return it->second;
+    }
+
+    std::ifstream stream(file, std::ios::binary);
+    if(!stream) throw std::runtime_error("Could not open " + file.string());
+
+    FileHash result{size, modified, FNV_OFFSET, {}};
+    if(file.extension() == ".gltf") {
+        //The whole document is needed to find its references
+        const std::string text{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+        result.hash = fnv1a(result.hash, text.data(), text.size());
+        collectReferences(json::parse(text), file.parent_path(), result.references);
+    } else {
+        std::vector<char> chunk(size_t(1) << 20);
+        while(stream) {
+            stream.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            result.hash = fnv1a(result.hash, chunk.data(), static_cast<size_t>(stream.gcount()));
+        }
+    }
+
+    std::scoped_lock lock(hashMutex);
+    fileHashes[file.string()] = result;
+    return result;
+}
+
+SceneCacheStats SceneCache::stats() const {
+    std::scoped_lock lock(mutex);
+    SceneCacheStats result = counters;
+    result.residentScenes = entries.size();
+    result.residentBytes = bytes;
+
+    return result;
+}
+
+size_t SceneCache::budget() const {
+    return budgetBytes;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "RayTracedScene.h"
+
+//Counters of a SceneCache since it was created
+struct SceneCacheStats {
+    size_t hits = 0; //Scenes that were resident or already being loaded by another job
+    size_t misses = 0; //Scenes that were loaded and baked
+    size_t evictions = 0;
+    size_t residentScenes = 0;
+    size_t residentBytes = 0;
+};
+
+/**
+ * Baked scenes that stay in memory between jobs, keyed by the content of their files: a file that is loaded again, under
+ * the same or another path, is traced right away instead of being loaded, baked and built again. The least recently used
+ * scenes are evicted when the cache holds more bytes than its budget.
+ *
+ * Scenes are handed out as shared pointers, so a scene that is evicted while a job still traces it stays alive until that
+ * job is done with it. Jobs that ask for a file that another job is loading wait for that load instead of starting their own.
+ */
+class SceneCache {
+public:
+    struct Loaded {
+        std::unique_ptr<RayTracedScene> scene;
+        size_t bytes; //Memory of the scene, counted against the budget
+    };
+    //Loads the scene of a file with a content hash, which identifies anything that is derived from the file, such as a baked copy of it
+    using Loader = std::function<Loaded(const std::filesystem::path& file, std::uint64_t hash)>;
+
+    struct Result {
+        std::shared_ptr<const RayTracedScene> scene;
+        bool hit; //False if this call loaded the scene
+        std::uint64_t hash; //See contentHash
+        double loadSeconds; //Time spent in this call hashing, loading or waiting for another load
+    };
+
+    /**
+     * @param sceneLoader loads and bakes the scene of a file. Called without holding any lock, so several files can load at once.
+     * @param byteBudget how many bytes of scenes the cache may hold. It always holds the scene that was loaded last.
+     */
+    SceneCache(Loader sceneLoader, size_t byteBudget);
+
+    //The scene of a file, loaded with the loader if no file with the same content is resident. Rethrows the errors of the loader.
+    [[nodiscard]] Result get(const std::filesystem::path& file);
+
+    /**
+     * FNV-1a hash of the content of a file and, for a .gltf, of every external file it references by URI. Hashes are
+     * remembered per file with its size and modification time, so only files that changed are read again.
+     */
+    [[nodiscard]] std::uint64_t contentHash(const std::filesystem::path& file);
+
+    [[nodiscard]] SceneCacheStats stats() const;
+    [[nodiscard]] size_t budget() const;
+
+private:
+    struct Entry {
+        std::shared_future<std::shared_ptr<const RayTracedScene>> scene;
+        std::list<std::uint64_t>::iterator position;
+        size_t bytes = 0;
+        bool loading = true; //Not counted against the budget and never evicted until it is done
+    };
+
+    //The hash of one file, without the files it references
+    struct FileHash {
+        std::uintmax_t size;
+        std::filesystem::file_time_type modified;
+        std::uint64_t hash;
+        std::vector<std::filesystem::path> references; //The external files a .gltf references
+    };
+
+    Loader loader;
+    size_t budgetBytes;
+
+    mutable std::mutex mutex;
+    std::list<std::uint64_t> lru; //Most recently used first
+    std::unordered_map<std::uint64_t, Entry> entries;
+    size_t bytes = 0;
+    SceneCacheStats counters;
+
+    std::mutex hashMutex;
+    std::unordered_map<std::string, FileHash> fileHashes; //By absolute path
+
+    [[nodiscard]] FileHash hashFile(const std::filesystem::path& file);
+    //Evicts the least recently used scenes that are done loading, except one, until the cache fits its budget. Needs the mutex.
+    void evict(std::uint64_t keep);
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cmath>
+
+//CPU port of the shading in closesthit.hlsl and miss.hlsl. Constants and light setup must stay in sync with the shaders.
+namespace Shading {
+    static constexpr float shadingWeight = 1.0f;
+    static constexpr float metallic = 0.25f;
+    static constexpr float roughness = 0.45f;
+    static constexpr float ao = 0.1f;
+    static constexpr glm::vec3 meshColor{0.51f, 0.62f, 0.82f};
+    static constexpr glm::vec3 lightColor{1.0f, 1.0f, 1.0f};
+    static constexpr float lightIntensity = 22.0f;
+    static constexpr float PI = 3.14159265359f;
+
+    static constexpr glm::vec3 missColor{0.29f, 0.29f, 0.29f};
+
+    inline float distributionGGX(const glm::vec3& N, const glm::vec3& H, const float surfaceRoughness) {
+        const float a = surfaceRoughness * surfaceRoughness;
+        const float a2 = a * a;
+        const float NdotH = std::max(glm::dot(N, H), 0.0f);
+        const float NdotH2 = NdotH * NdotH;
+
+        float denom = (NdotH2 * (a2 - 1.0f) + 1.0f);
+        denom = PI * denom * denom;
+
+        return a2 / denom;
+    }
+
+    inline float geometrySchlickGGX(const float NdotV, const float surfaceRoughness) {
+        const float r = (surfaceRoughness + 1.0f);
+        const float k = (r * r) / 8.0f;
+
+        return NdotV / (NdotV * (1.0f - k) + k);
+    }
+
+    inline float geometrySmith(const glm::vec3& N, const glm::vec3& V, const glm::vec3& L, const float surfaceRoughness) {
+        const float NdotV = std::max(glm::dot(N, V), 0.0f);
+        const float NdotL = std::max(glm::dot(N, L), 0.0f);
+
+        return geometrySchlickGGX(NdotL, surfaceRoughness) * geometrySchlickGGX(NdotV, surfaceRoughness);
+    }
+
+    inline glm::vec3 fresnelSchlick(const float cosTheta, const glm::vec3& F0) {
+        return F0 + (1.0f - F0) * std::pow(std::clamp(1.0f - cosTheta, 0.0f, 1.0f), 5.0f);
+    }
+
+    //Cook-Torrance shading with the 4 directional lights of closesthit.hlsl
+    // @param N: surface normal
+    // @param V: view direction
+    // @return the color of the surface, tone mapped
+    inline glm::vec3 shade(const glm::vec3& N, const glm::vec3& V) {
+        const glm::vec3 albedo = meshColor;
+        const glm::vec3 F0 = glm::mix(glm::vec3(0.04f), albedo, metallic);
+
+        constexpr glm::vec3 lightDirs[4] = {
+            {0.0f, 0.0f, 1.0f},
+            {0.0f, 1.0f, 0.0f},
+            {0.0f, 0.0f, -1.0f},
+            {0.0f, -1.0f, 0.0f}
+        };
+
+        constexpr float intensities[4] = {
+            lightIntensity,
+            lightIntensity / 2.0f,
+            lightIntensity,
+            lightIntensity / 2.0f
+        };
+
+        // reflectance equation
+        glm::vec3 Lo(0.0f);
+        for(int i = 0; i < 4; ++i) {
+            // calculate per-light radiance
+            const glm::vec3 L = glm::normalize(lightDirs[i]);
+            const glm::vec3 H = glm::normalize(V + L);
+            const glm::vec3 radiance = lightColor * intensities[i];
+
+            // cook-torrance brdf
+            const float NDF = distributionGGX(N, H, roughness);
+            const float G = geometrySmith(N, V, L, roughness);
+            const glm::vec3 F = fresnelSchlick(std::max(glm::dot(H, V), 0.0f), F0);
+
+            const glm::vec3 kS = F;
+            const glm::vec3 kD = (glm::vec3(1.0f) - kS) * (1.0f - metallic);
+
+            const glm::vec3 numerator = NDF * G * F;
+            const float denominator = 4.0f * std::max(glm::dot(N, V), 0.0f) * std::max(glm::dot(N, L), 0.0f) + 0.0001f;
+            const glm::vec3 specular = numerator / denominator;
+
+            // add to outgoing radiance Lo
+            const float NdotL = std::max(glm::dot(N, L), 0.0f);
+            Lo += (kD * albedo / PI + specular) * radiance * NdotL;
+        }
+
+        const glm::vec3 ambient = albedo * ao * lightIntensity * 0.1f;
+        glm::vec3 fcolor = ambient + Lo;
+
+        fcolor = fcolor / (fcolor + glm::vec3(1.0f));
+        return glm::mix(albedo, fcolor, shadingWeight);
+    }
+}
@@ -0,0 +1,279 @@
+#include "ShardedBake.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+static constexpr char MAGIC[8] = {'U', 'M', 'E', 'S', 'H', 'S', 'D', '\0'};
+static constexpr std::uint32_t VERSION = 1;
+
+//Followed by the vertices, triangle data, displacement scales, min-max displacements, deltas, AABBs and tangential displacements
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t vertexOrder;
+    std::uint32_t firstTriangle;
+    std::uint32_t triangleCount;
+    std::uint64_t meshTriangles;
+    std::uint64_t vertexCount;
+    std::uint64_t scaleCount;
+    std::uint64_t recordCount;
+    std::uint32_t uniformSubdivisionLevel;
+    std::int32_t maxSubdivisionLevel;
+};
+
+template<typename T>
+static void writeArray(std::ofstream& out, const std::vector<T>& values) {
+    out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template<typename T>
+static void readArray(std::ifstream& in, std::vector<T>& values, const size_t count) {
+    values.resize(count);
+    in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+//The number of hierarchy records of a baked mesh without the dummy record of a mesh that has none
+static size_t recordCount(const BakedMesh& baked) {
+    size_t records = 0;
+    for(const TriangleData& td : baked.triangleData) records += BakedMesh::hierarchyRecordCount(td);
+
+    return records;
+}
+
+//Moves the values of a shard to the end of the merged array and releases them
+template<typename T>
+static void append(std::vector<T>& merged, std::vector<T>& values, const size_t count) {
+    merged.insert(merged.end(), values.begin(), values.begin() + static_cast<std::ptrdiff_t>(count));
+    std::vector<T>().swap(values);
+}
+
+namespace ShardedBake {
+    std::vector<Range> split(const Mesh& mesh, const Range range, const unsigned int shardCount) {
+        if(static_cast<size_t>(range.firstTriangle) + range.triangleCount > mesh.triangles.size()) throw std::out_of_range("The base triangles to split are not within the mesh");
+        const size_t triangles = range.triangleCount;
+        const size_t shards = std::clamp<size_t>(shardCount, 1, std::max<size_t>(1, triangles));
+        const std::span<const Triangle> inRange(mesh.triangles.data() + range.firstTriangle, triangles);
+
+        size_t microVertices = 0;
+        for(const Triangle& t : inRange) microVertices += t.uVertices.size();
+
+        //A shard ends once it reaches its share of the micro-vertices, but leaves at least one base triangle for every later shard
+        std::vector<Range> ranges;
+        ranges.reserve(shards);
+        size_t first = 0, covered = 0;
+        for(size_t shard = 0; shard < shards; shard++) {
+            const size_t target = microVertices * (shard + 1) / shards;
+            const size_t lastEnd = shard + 1 == shards ? triangles : triangles - (shards - shard - 1);
+
+            size_t end = first;
+            while(end < lastEnd && (end == first || covered < target || shard + 1 == shards)) covered += inRange[end++].uVertices.size();
+
+            ranges.push_back({range.firstTriangle + static_cast<unsigned int>(first), static_cast<unsigned int>(end - first)});
+            first = end;
+        }
+
+        return ranges;
+    }
+
+    Shard bakeShard(const Mesh& mesh, const Range range, const VertexOrder order, const unsigned int threadCount) {
+        const unsigned int threads = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+        if(threads == 1) return {range, mesh.triangles.size(), BakedMesh::bakeRange(mesh, range.firstTriangle, range.triangleCount, order)};
+
+        //Base triangles differ a lot in subdivision level, so the threads take pieces until none are left
+        const std::vector<Range> pieces = split(mesh, range, PIECES_PER_THREAD * threads);
+        std::vector<Shard> shards(pieces.size());
+
+        //Every thread bakes its own pieces, so the output needs no synchronization
+        std::atomic<size_t> nextPiece{0};
+        const auto work = [&] {
+            for(size_t piece = nextPiece++; piece < pieces.size(); piece = nextPiece++) shards[piece] = bakeShard(mesh, pieces[piece], order, 1);
+        };
+
+        //The calling thread works as well
+        std::vector<std::thread> workers;
+        const unsigned int started = static_cast<unsigned int>(std::min<size_t>(threads, pieces.size()));
+        workers.reserve(started - 1);
+        for(unsigned int thread = 0; thread + 1 < started; thread++) workers.emplace_back(work);
+        work();
+        for(std::thread& worker : workers) worker.join();
+
+        return combine(std::move(shards));
+    }
+
+    Shard combine(std::vector<Shard> shards) {
+        if(shards.empty()) throw std::invalid_argument("There are no shards to merge");
+        std::ranges::sort(shards, {}, [](const Shard& shard) { return shard.range.firstTriangle; });
+
+        const Shard& front = shards.front();
+        size_t scales = 0, records = 0, next = front.range.firstTriangle;
+        for(const Shard& shard : shards) {
+            const BakedMesh& baked = shard.baked;
+            if(shard.meshTriangles != front.meshTriangles || shard.range.firstTriangle != next) throw std::invalid_argument("The shards are not consecutive base triangles of one mesh");
+            if(baked.triangleData.size() != shard.range.triangleCount || baked.AABBs.size() != shard.range.triangleCount
+               || baked.tangentialDisplacements.size() != shard.range.triangleCount) {
+                throw std::invalid_argument("A shard does not have the data of every base triangle of its range");
+            }
+            if(baked.vertexOrder != front.baked.vertexOrder || baked.vertices.size() != front.baked.vertices.size()
+               || std::memcmp(baked.vertices.data(), front.baked.vertices.data(), baked.vertices.size() * sizeof(BaseVertex)) != 0) {
+                throw std::invalid_argument("The shards were not baked from the same mesh in the same vertex order");
+            }
+            if(baked.hasQuantizedHierarchy() || baked.hasSparseHierarchy() || baked.pages) throw std::invalid_argument("Only shards in memory with a full hierarchy can be merged");
+            for(const TriangleData& td : baked.triangleData) {
+                const size_t scaleEnd = static_cast<size_t>(td.displacementOffset) + static_cast<size_t>(td.nRows) * static_cast<size_t>(td.nRows + 1) / 2;
+                const size_t recordEnd = static_cast<size_t>(td.minMaxOffset) + BakedMesh::hierarchyRecordCount(td);
+                if(td.displacementOffset < 0 || td.minMaxOffset < 0 || scaleEnd > baked.displacementScales.size() || recordEnd > baked.minMaxDisplacements.size()
+                   || recordEnd > baked.deltas.size()) {
+                    throw std::invalid_argument("The offsets of a shard are outside of its arrays");
+                }
+            }
+
+            next += shard.range.triangleCount;
+            scales += baked.displacementScales.size();
+            records += recordCount(baked);
+        }
+        if(next > front.meshTriangles) throw std::invalid_argument("The shards are not consecutive base triangles of one mesh");
+        if(scales > INT_MAX || records > INT_MAX) throw std::overflow_error("The merged shards have too many micro-vertices for the offsets of TriangleData");
+
+        Shard merged;
+        merged.range = {front.range.firstTriangle, static_cast<unsigned int>(next - front.range.firstTriangle)};
+        merged.meshTriangles = front.meshTriangles;
+
+        BakedMesh& mesh = merged.baked;
+        mesh.vertices = front.baked.vertices;
+        mesh.vertexOrder = front.baked.vertexOrder;
+        mesh.triangleData.reserve(merged.range.triangleCount);
+        mesh.AABBs.reserve(merged.range.triangleCount);
+        mesh.tangentialDisplacements.reserve(merged.range.triangleCount);
+        mesh.displacementScales.reserve(scales);
+        mesh.minMaxDisplacements.reserve(std::max<size_t>(1, records));
+        mesh.deltas.reserve(std::max<size_t>(1, records));
+
+        for(Shard& shard : shards) {
+            BakedMesh& baked = shard.baked;
+            const int scaleBase = static_cast<int>(mesh.displacementScales.size());
+            const int recordBase = static_cast<int>(mesh.minMaxDisplacements.size());
+
+            //Base triangles without a hierarchy keep the minMaxOffset of 0 that bake gives them
+            for(TriangleData td : baked.triangleData) {
+                td.displacementOffset += scaleBase;
+                if(td.subDivisionLevel > 0) td.minMaxOffset += recordBase;
+                mesh.triangleData.push_back(td);
+            }
+
+            const size_t shardRecords = recordCount(baked);
+            append(mesh.displacementScales, baked.displacementScales, baked.displacementScales.size());
+            append(mesh.minMaxDisplacements, baked.minMaxDisplacements, shardRecords);
+            append(mesh.deltas, baked.deltas, shardRecords);
+            append(mesh.AABBs, baked.AABBs, baked.AABBs.size());
+            append(mesh.tangentialDisplacements, baked.tangentialDisplacements, baked.tangentialDisplacements.size());
+            std::vector<TriangleData>().swap(baked.triangleData);
+            std::vector<BaseVertex>().swap(baked.vertices);
+        }
+
+        //One dummy value if there are no records, like bake
+        if(mesh.minMaxDisplacements.empty()) mesh.minMaxDisplacements.emplace_back(0.0f);
+        if(mesh.deltas.empty()) mesh.deltas.push_back(0.0f);
+
+        for(const TriangleData& td : mesh.triangleData) {
+            mesh.maxSubdivisionLevel = std::max(mesh.maxSubdivisionLevel, td.subDivisionLevel);
+            mesh.uniformSubdivisionLevel &= td.subDivisionLevel == mesh.triangleData.front().subDivisionLevel;
+        }
+
+        return merged;
+    }
+
+    BakedMesh merge(std::vector<Shard> shards) {
+        Shard merged = combine(std::move(shards));
+        if(merged.range.firstTriangle != 0 || merged.range.triangleCount != merged.meshTriangles) throw std::invalid_argument("The shards do not cover every base triangle of the mesh");
+
+        return std::move(merged.baked);
+    }
+
+    BakedMesh bake(const Mesh& mesh, const VertexOrder order, const unsigned int threadCount) {
+        return bakeShard(mesh, {0, static_cast<unsigned int>(mesh.triangles.size())}, order, threadCount).baked;
+    }
+
+    void write(const Shard& shard, const std::filesystem::path& file) {
+        const BakedMesh& baked = shard.baked;
+
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        if(!out) throw std::runtime_error("Could not open " + file.string());
+
+        FileHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.vertexOrder = static_cast<std::uint32_t>(baked.vertexOrder);
+        header.firstTriangle = shard.range.firstTriangle;
+        header.triangleCount = shard.range.triangleCount;
+        header.meshTriangles = shard.meshTriangles;
+        header.vertexCount = baked.vertices.size();
+        header.scaleCount = baked.displacementScales.size();
+        header.recordCount = baked.minMaxDisplacements.size();
+        header.uniformSubdivisionLevel = baked.uniformSubdivisionLevel;
+        header.maxSubdivisionLevel = baked.maxSubdivisionLevel;
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeArray(out, baked.vertices);
+        writeArray(out, baked.triangleData);
+        writeArray(out, baked.displacementScales);
+        writeArray(out, baked.minMaxDisplacements);
+        writeArray(out, baked.deltas);
+        writeArray(out, baked.AABBs);
+        writeArray(out, baked.tangentialDisplacements);
+
+        if(!out) throw std::runtime_error("Could not write " + file.string());
+    }
+
+    Shard read(const std::filesystem::path& file) {
+        std::ifstream in(file, std::ios::binary);
+        if(!in) throw std::runtime_error("Could not open " + file.string());
+
+        FileHeader header{};
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if(!in || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+            throw std::runtime_error("Not a baked shard file: " + file.string());
+        }
+
+        //Every array must fit into the rest of the file before it is allocated, a corrupt count would otherwise ask for any amount of memory
+        std::uintmax_t remainingBytes = std::filesystem::file_size(file) - sizeof(FileHeader);
+        const auto fits = [&](const std::uint64_t count, const size_t bytesPerValue) {
+            if(count > remainingBytes / bytesPerValue) return false;
+            remainingBytes -= count * bytesPerValue;
+            return true;
+        };
+        if(!fits(header.vertexCount, sizeof(BaseVertex)) || !fits(header.triangleCount, sizeof(TriangleData) + sizeof(AABB) + sizeof(float))
+           || !fits(header.scaleCount, sizeof(float)) || !fits(header.recordCount, sizeof(glm::vec2) + sizeof(float))) {
+            throw std::runtime_error("Truncated shard file: " + file.string());
+        }
+
+        Shard shard;
+        shard.range = {header.firstTriangle, header.triangleCount};
+        shard.meshTriangles = header.meshTriangles;
+
+        BakedMesh& baked = shard.baked;
+        readArray(in, baked.vertices, header.vertexCount);
+        readArray(in, baked.triangleData, header.triangleCount);
+        readArray(in, baked.displacementScales, header.scaleCount);
+        readArray(in, baked.minMaxDisplacements, header.recordCount);
+        readArray(in, baked.deltas, header.recordCount);
+        readArray(in, baked.AABBs, header.triangleCount);
+        readArray(in, baked.tangentialDisplacements, header.triangleCount);
+        if(!in) throw std::runtime_error("Could not read " + file.string());
+
+        baked.vertexOrder = static_cast<VertexOrder>(header.vertexOrder);
+        baked.uniformSubdivisionLevel = header.uniformSubdivisionLevel != 0;
+        baked.maxSubdivisionLevel = header.maxSubdivisionLevel;
+
+        return shard;
+    }
+}
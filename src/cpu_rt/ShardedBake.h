@@ -0,0 +1,79 @@
+#pragma once
+
+#include <framework/mesh.h>
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+#include "BakedMesh.h"
+
+/**
+ * Bakes a mesh in shards of consecutive base triangles, in parallel or in other processes (see BakeCoordinator), and
+ * merges the shards into the same BakedMesh as BakedMesh::bake.
+ *
+ * Every pass of BakedMesh::bake appends to arrays that span all base triangles, so the offsets of a base triangle
+ * (TriangleData::displacementOffset and minMaxOffset) depend on every base triangle before it. A shard is baked as if
+ * its base triangles were the whole mesh: its offsets start at 0 and its arrays only hold its own base triangles. The
+ * merge moves the offsets of every shard past the arrays of the shards before it and concatenates the arrays. Every
+ * value of a base triangle only depends on that base triangle and the base vertices, so the merged mesh is bit-identical
+ * to a single bake, which Benchmarks::shardedBake checks.
+ *
+ * The offsets are ints, as on the GPU, so the merged mesh is limited to 2^31 displacement scales and hierarchy records
+ * like one that is baked at once; the merge throws beyond that.
+ */
+namespace ShardedBake {
+    //Consecutive base triangles of a mesh
+    struct Range {
+        unsigned int firstTriangle = 0;
+        unsigned int triangleCount = 0;
+    };
+
+    struct Shard {
+        Range range;
+        size_t meshTriangles = 0; //Of the whole mesh, so the merge can check that the shards cover it
+        //The base triangles of the range as if they were a mesh of their own, with offsets from 0, and all base vertices
+        BakedMesh baked;
+    };
+
+    //Pieces that bakeShard splits its range into per thread, so that threads which finish early take more
+    static constexpr unsigned int PIECES_PER_THREAD = 4;
+
+    /**
+     * Splits base triangles of a mesh into ranges with about the same number of micro-vertices, since baking a base
+     * triangle takes time in proportion to them.
+     *
+     * @param mesh the mesh
+     * @param range the base triangles to split
+     * @param shardCount the number of ranges, fewer if there are fewer base triangles
+     */
+    [[nodiscard]] std::vector<Range> split(const Mesh& mesh, Range range, unsigned int shardCount);
+
+    /**
+     * Bakes the base triangles of a range, like BakedMesh::bake. Throws if the range is not within the mesh.
+     *
+     * @param threadCount the number of threads, including the calling thread, which bake pieces of the range that are
+     * combined. 0 uses every hardware thread.
+     */
+    [[nodiscard]] Shard bakeShard(const Mesh& mesh, Range range, VertexOrder order = VertexOrder::ROW_MAJOR, unsigned int threadCount = 1);
+
+    /**
+     * Combines shards of consecutive base triangles into one shard of all of them. The shards can come in any order,
+     * but must not overlap or leave gaps and must agree on the base vertices and vertex order, otherwise this throws.
+     * Every shard's arrays are released once they are copied, so the shards and the result are not all in memory at once.
+     */
+    [[nodiscard]] Shard combine(std::vector<Shard> shards);
+
+    //Combines shards that cover every base triangle of their mesh into the mesh, bit-identical to BakedMesh::bake. Throws if they do not.
+    [[nodiscard]] BakedMesh merge(std::vector<Shard> shards);
+
+    //Bakes a mesh in pieces on threads and merges them, see bakeShard. threadCount 0 uses every hardware thread.
+    [[nodiscard]] BakedMesh bake(const Mesh& mesh, VertexOrder order = VertexOrder::ROW_MAJOR, unsigned int threadCount = 0);
+
+    /**
+     * Writes a shard to a file, for a merge in another process. Like the files of PagedBlocks, the file stores the
+     * structs as they are in memory, so it can only be read by the build that wrote it.
+     */
+    void write(const Shard& shard, const std::filesystem::path& file);
+    //Reads a file written by write, throws if it is not one or is truncated
+    [[nodiscard]] Shard read(const std::filesystem::path& file);
+}
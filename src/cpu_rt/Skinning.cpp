@@ -0,0 +1,311 @@
+#include "Skinning.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+#if defined(EDGE_KERNELS_SSE)
+#include <immintrin.h>
+#elif defined(EDGE_KERNELS_NEON)
+#include <arm_neon.h>
+#endif
+
+/*
+ * Every implementation runs skinLanes with the operations of its instruction set, so the order of the arithmetic is the
+ * same by construction. The scalar one runs it on one vertex at a time.
+ *
+ * Neighbouring vertices usually belong to the same part of a character, so the lanes often share a joint. The SIMD
+ * implementations then broadcast the elements of its matrix instead of gathering them, which loads the same values.
+ */
+
+namespace {
+    struct ScalarOps {
+        using V = float;
+        using Offsets = uint32_t;
+        static constexpr size_t WIDTH = 1;
+
+        static V load(const float* p) { return *p; }
+        static void store(float* p, const V v) { *p = v; }
+        static Offsets loadOffsets(const uint32_t* p) { return *p; }
+        static V gather(const float* joints, const Offsets offset) { return joints[offset]; }
+        static V add(const V a, const V b) { return a + b; }
+        static V mul(const V a, const V b) { return a * b; }
+        //1 / length, or 1 if the length is 0
+        static V inverseLength(const V length) { return length > 0.0f ? 1.0f / length : 1.0f; }
+        static V sqrt(const V v) { return std::sqrt(v); }
+    };
+
+#if defined(EDGE_KERNELS_SSE)
+    struct SSEOps {
+        using V = __m128;
+        struct Offsets {
+            const uint32_t* lanes;
+            bool shared; //Every lane has the same joint
+        };
+        static constexpr size_t WIDTH = 4;
+
+        static V load(const float* p) { return _mm_loadu_ps(p); }
+        static void store(float* p, const V v) { _mm_storeu_ps(p, v); }
+        static Offsets loadOffsets(const uint32_t* p) { return {p, p[0] == p[1] && p[0] == p[2] && p[0] == p[3]}; }
+        //SSE2 has no gather
+        static V gather(const float* joints, const Offsets offsets) {
+            if(offsets.shared) return _mm_set1_ps(joints[offsets.lanes[0]]);
+            return _mm_setr_ps(joints[offsets.lanes[0]], joints[offsets.lanes[1]], joints[offsets.lanes[2]], joints[offsets.lanes[3]]);
+        }
+        static V add(const V a, const V b) { return _mm_add_ps(a, b); }
+        static V mul(const V a, const V b) { return _mm_mul_ps(a, b); }
+        static V inverseLength(const V length) {
+            const V one = _mm_set1_ps(1.0f);
+            const V positive = _mm_cmpgt_ps(length, _mm_setzero_ps());
+            return _mm_or_ps(_mm_and_ps(positive, _mm_div_ps(one, length)), _mm_andnot_ps(positive, one));
+        }
+        static V sqrt(const V v) { return _mm_sqrt_ps(v); }
+    };
+#endif
+
+#if defined(EDGE_KERNELS_AVX2)
+    struct AVX2Ops {
+        using V = __m256;
+        struct Offsets {
+            __m256i lanes;
+            uint32_t first;
+            bool shared; //Every lane has the same joint
+        };
+        static constexpr size_t WIDTH = 8;
+
+        static V load(const float* p) { return _mm256_loadu_ps(p); }
+        static void store(float* p, const V v) { _mm256_storeu_ps(p, v); }
+        static Offsets loadOffsets(const uint32_t* p) {
+            const __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            return {lanes, p[0], _mm256_movemask_epi8(_mm256_cmpeq_epi32(lanes, _mm256_set1_epi32(static_cast<int>(p[0])))) == -1};
+        }
+        static V gather(const float* joints, const Offsets offsets) {
+            return offsets.shared ? _mm256_broadcast_ss(joints + offsets.first) : _mm256_i32gather_ps(joints, offsets.lanes, 4);
+        }
+        static V add(const V a, const V b) { return _mm256_add_ps(a, b); }
+        static V mul(const V a, const V b) { return _mm256_mul_ps(a, b); }
+        static V inverseLength(const V length) {
+            const V one = _mm256_set1_ps(1.0f);
+            return _mm256_blendv_ps(one, _mm256_div_ps(one, length), _mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_GT_OQ));
+        }
+        static V sqrt(const V v) { return _mm256_sqrt_ps(v); }
+    };
+#endif
+
+#if defined(EDGE_KERNELS_NEON)
+    struct NEONOps {
+        using V = float32x4_t;
+        struct Offsets {
+            const uint32_t* lanes;
+            bool shared; //Every lane has the same joint
+        };
+        static constexpr size_t WIDTH = 4;
+
+        static V load(const float* p) { return vld1q_f32(p); }
+        static void store(float* p, const V v) { vst1q_f32(p, v); }
+        static Offsets loadOffsets(const uint32_t* p) { return {p, p[0] == p[1] && p[0] == p[2] && p[0] == p[3]}; }
+        static V gather(const float* joints, const Offsets offsets) {
+            if(offsets.shared) return vld1q_dup_f32(joints + offsets.lanes[0]);
+            const float lanes[4] = {joints[offsets.lanes[0]], joints[offsets.lanes[1]], joints[offsets.lanes[2]], joints[offsets.lanes[3]]};
+            return vld1q_f32(lanes);
+        }
+        //vmlaq_f32 may be fused, so multiplications and additions stay separate
+        static V add(const V a, const V b) { return vaddq_f32(a, b); }
+        static V mul(const V a, const V b) { return vmulq_f32(a, b); }
+        static V inverseLength(const V length) {
+            const V one = vdupq_n_f32(1.0f);
+            return vbslq_f32(vcgtq_f32(length, vdupq_n_f32(0.0f)), vdivq_f32(one, length), one);
+        }
+        static V sqrt(const V v) { return vsqrtq_f32(v); }
+    };
+#endif
+
+    //Skins Ops::WIDTH vertices at a time: m = ((w0 * J0 + w1 * J1) + w2 * J2) + w3 * J3, then p' = ((m0 * x + m3 * y) + m6 * z) + m9 per row
+    template<typename Ops>
+    void skinLanes(const Skinning::RestPose& rest, const float* joints, Skinning::VertexArrays& posed, const size_t begin, const size_t end) {
+        using V = typename Ops::V;
+        constexpr size_t ELEMENTS = Skinning::JOINT_FLOATS;
+
+        for(size_t block = begin; block < end; block++) {
+            const Skinning::InfluenceBlock& influences = rest.influences[block];
+            const Skinning::VertexBlock& in = rest.vertices.blocks[block];
+            Skinning::VertexBlock& out = posed.blocks[block];
+
+            for(size_t lane = 0; lane < Skinning::LANES; lane += Ops::WIDTH) {
+                V m[ELEMENTS];
+                {
+                    const V weight = Ops::load(&influences.weights[0][lane]);
+                    const typename Ops::Offsets offsets = Ops::loadOffsets(&influences.joints[0][lane]);
+                    for(size_t e = 0; e < ELEMENTS; e++) m[e] = Ops::mul(weight, Ops::gather(joints + e, offsets));
+                }
+                for(int influence = 1; influence < Skinning::INFLUENCES; influence++) {
+                    const V weight = Ops::load(&influences.weights[influence][lane]);
+                    const typename Ops::Offsets offsets = Ops::loadOffsets(&influences.joints[influence][lane]);
+                    for(size_t e = 0; e < ELEMENTS; e++) m[e] = Ops::add(m[e], Ops::mul(weight, Ops::gather(joints + e, offsets)));
+                }
+
+                //Points get the translation, normals and directions only the linear part
+                const auto transform = [&](const float (&from)[3][Skinning::LANES], float (&to)[3][Skinning::LANES], const bool point, const bool normalize) {
+                    const V x = Ops::load(&from[0][lane]);
+                    const V y = Ops::load(&from[1][lane]);
+                    const V z = Ops::load(&from[2][lane]);
+
+                    V result[3];
+                    for(int row = 0; row < 3; row++) {
+                        result[row] = Ops::add(Ops::add(Ops::mul(m[row], x), Ops::mul(m[3 + row], y)), Ops::mul(m[6 + row], z));
+                        if(point) result[row] = Ops::add(result[row], m[9 + row]);
+                    }
+
+                    if(normalize) {
+                        const V length = Ops::sqrt(Ops::add(Ops::add(Ops::mul(result[0], result[0]), Ops::mul(result[1], result[1])), Ops::mul(result[2], result[2])));
+                        const V inverse = Ops::inverseLength(length);
+                        for(V& r : result) r = Ops::mul(r, inverse);
+                    }
+
+                    for(int row = 0; row < 3; row++) Ops::store(&to[row][lane], result[row]);
+                };
+
+                transform(in.position, out.position, true, false);
+                transform(in.normal, out.normal, false, true);
+                transform(in.direction, out.direction, false, false);
+            }
+        }
+    }
+}
+
+namespace Skinning {
+    void VertexArrays::resize(const size_t vertexCount) {
+        count = vertexCount;
+        blocks.resize((vertexCount + LANES - 1) / LANES, VertexBlock{});
+    }
+
+    Vertex VertexArrays::get(const size_t vertex) const {
+        const VertexBlock& block = blocks[vertex / LANES];
+        const size_t lane = vertex % LANES;
+
+        return {{block.position[0][lane], block.position[1][lane], block.position[2][lane]},
+                {block.normal[0][lane], block.normal[1][lane], block.normal[2][lane]},
+                {block.direction[0][lane], block.direction[1][lane], block.direction[2][lane]}};
+    }
+
+    void VertexArrays::set(const size_t vertex, const Vertex& v) {
+        VertexBlock& block = blocks[vertex / LANES];
+        const size_t lane = vertex % LANES;
+
+        for(int axis = 0; axis < 3; axis++) {
+            block.position[axis][lane] = v.position[axis];
+            block.normal[axis][lane] = v.normal[axis];
+            block.direction[axis][lane] = v.direction[axis];
+        }
+    }
+
+    RestPose::RestPose(const std::span<const Vertex> restVertices, const std::span<const glm::uvec4> vertexJoints, const std::span<const glm::vec4> vertexWeights) {
+        if(vertexJoints.size() != restVertices.size() || vertexWeights.size() != restVertices.size()) throw std::runtime_error("Every vertex needs joints and weights");
+
+        vertices.resize(restVertices.size());
+        influences.resize(vertices.blocks.size(), InfluenceBlock{});
+
+        for(size_t v = 0; v < restVertices.size(); v++) {
+            vertices.set(v, restVertices[v]);
+
+            InfluenceBlock& block = influences[v / LANES];
+            for(int influence = 0; influence < INFLUENCES; influence++) {
+                block.joints[influence][v % LANES] = static_cast<uint32_t>(JOINT_FLOATS * vertexJoints[v][influence]);
+                block.weights[influence][v % LANES] = vertexWeights[v][influence];
+                jointCount = std::max(jointCount, vertexJoints[v][influence] + 1);
+            }
+        }
+    }
+
+    std::vector<float> packJoints(const std::span<const glm::mat4> jointMatrices) {
+        std::vector<float> packed;
+        packed.reserve(JOINT_FLOATS * jointMatrices.size());
+        for(const glm::mat4& matrix : jointMatrices) {
+            for(int column = 0; column < 4; column++) {
+                for(int row = 0; row < 3; row++) packed.push_back(matrix[column][row]);
+            }
+        }
+
+        return packed;
+    }
+
+    void skinScalar(const RestPose& rest, const float* joints, VertexArrays& posed, const size_t begin, const size_t end) {
+        skinLanes<ScalarOps>(rest, joints, posed, begin, end);
+    }
+
+#if defined(EDGE_KERNELS_SSE)
+    void skinSSE(const RestPose& rest, const float* joints, VertexArrays& posed, const size_t begin, const size_t end) {
+        skinLanes<SSEOps>(rest, joints, posed, begin, end);
+    }
+#endif
+
+#if defined(EDGE_KERNELS_AVX2)
+    void skinAVX2(const RestPose& rest, const float* joints, VertexArrays& posed, const size_t begin, const size_t end) {
+        skinLanes<AVX2Ops>(rest, joints, posed, begin, end);
+    }
+#endif
+
+#if defined(EDGE_KERNELS_NEON)
+    void skinNEON(const RestPose& rest, const float* joints, VertexArrays& posed, const size_t begin, const size_t end) {
+        skinLanes<NEONOps>(rest, joints, posed, begin, end);
+    }
+#endif
+
+    void skin(const Kernel kernel, const RestPose& rest, const std::span<const glm::mat4> jointMatrices, VertexArrays& posed, const unsigned int threadCount) {
+        if(jointMatrices.size() < rest.jointCount) throw std::runtime_error("The vertices use more joints than there are joint matrices");
+
+        const std::vector<float> joints = packJoints(jointMatrices);
+        posed.resize(rest.vertices.count);
+
+        const size_t blocks = rest.vertices.blocks.size();
+        const size_t chunks = (blocks + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        const unsigned int requested = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+        const unsigned int threads = static_cast<unsigned int>(std::clamp<size_t>(requested, 1, std::max<size_t>(1, chunks)));
+
+        //Every thread writes its own chunks, so the output needs no synchronization
+        std::atomic<size_t> nextChunk{0};
+        const auto work = [&] {
+            for(size_t chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+                kernel(rest, joints.data(), posed, chunk * CHUNK_SIZE, std::min(blocks, (chunk + 1) * CHUNK_SIZE));
+            }
+        };
+
+        //The calling thread works as well
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for(unsigned int thread = 0; thread + 1 < threads; thread++) workers.emplace_back(work);
+        work();
+        for(std::thread& worker : workers) worker.join();
+    }
+
+    void skin(const RestPose& rest, const std::span<const glm::mat4> jointMatrices, VertexArrays& posed, const unsigned int threadCount) {
+#if defined(EDGE_KERNELS_AVX2)
+        skin(skinAVX2, rest, jointMatrices, posed, threadCount);
+#elif defined(EDGE_KERNELS_SSE)
+        skin(skinSSE, rest, jointMatrices, posed, threadCount);
+#elif defined(EDGE_KERNELS_NEON)
+        skin(skinNEON, rest, jointMatrices, posed, threadCount);
+#else
+        skin(skinScalar, rest, jointMatrices, posed, threadCount);
+#endif
+    }
+
+    const char* instructionSet() {
+        return EdgeKernels::instructionSet();
+    }
+
+    std::vector<unsigned int> moveVertices(Mesh& mesh, const VertexArrays& posed) {
+        if(posed.count != mesh.vertices.size()) throw std::runtime_error("The skinned vertices do not belong to this mesh");
+
+        std::vector<unsigned int> indices(posed.count);
+        std::vector<Vertex> moved(posed.count);
+        for(size_t v = 0; v < posed.count; v++) {
+            indices[v] = static_cast<unsigned int>(v);
+            moved[v] = posed.get(v);
+        }
+
+        return mesh.moveVertices(indices, moved);
+    }
+}
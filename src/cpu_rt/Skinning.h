@@ -0,0 +1,111 @@
+#pragma once
+
+#include <framework/mesh.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "EdgeKernels.h"
+
+/*
+ * Linear blend skinning of the base vertices of a mesh on the CPU: every position, normal and displacement direction is
+ * transformed by the sum of the matrices of its (at most four) joints, weighted by its weights. The vertices are stored
+ * in blocks of 8 as a structure of arrays, so the SIMD kernels transform 4 (SSE2, NEON) or 8 (AVX2) vertices at once,
+ * gathering the joint matrices of each lane. Normals are normalized afterwards; directions are not, since their length
+ * scales the displacements.
+ *
+ * Every implementation blends the matrices and transforms the vertices with the same operations in the same order,
+ * without fused multiply-adds or reciprocal approximations, so they give bit-identical results.
+ */
+namespace Skinning {
+    static constexpr int INFLUENCES = 4; //Joints per vertex, as JOINTS_0 and WEIGHTS_0 in glTF
+    static constexpr size_t LANES = 8; //Vertices per block, the width of the widest kernel
+    static constexpr size_t JOINT_FLOATS = 12; //Floats per packed joint matrix, see packJoints
+    //Blocks per work item
+    static constexpr size_t CHUNK_SIZE = 512;
+
+    //Positions, normals and displacement directions of LANES vertices as a structure of arrays
+    struct VertexBlock {
+        alignas(32) float position[3][LANES]; //x, y and z
+        alignas(32) float normal[3][LANES];
+        alignas(32) float direction[3][LANES];
+    };
+
+    /**
+     * Vertices in blocks of LANES. Separate arrays per component would be read at the same offsets within their pages,
+     * which conflict in the L1 cache once there are more of them than it has ways; a block keeps every component of its
+     * vertices in a few cache lines. The last block is padded with zeros.
+     */
+    struct VertexArrays {
+        std::vector<VertexBlock> blocks;
+        size_t count = 0; //Without the padding
+
+        void resize(size_t vertexCount);
+        [[nodiscard]] Vertex get(size_t vertex) const;
+        void set(size_t vertex, const Vertex& v);
+    };
+
+    //The joints and weights of LANES vertices
+    struct InfluenceBlock {
+        alignas(32) uint32_t joints[INFLUENCES][LANES]; //The offset of the packed joint matrix (JOINT_FLOATS * joint), so the kernels can gather with it directly
+        alignas(32) float weights[INFLUENCES][LANES];
+    };
+
+    //The base vertices of a mesh in their bind pose, with their joints and weights
+    struct RestPose {
+        VertexArrays vertices;
+        std::vector<InfluenceBlock> influences; //Per block of vertices
+        uint32_t jointCount = 0; //One more than the highest joint a vertex uses
+
+        RestPose() = default;
+        //One joint and weight per vertex. Padding vertices have no weight, so they are skinned to zero.
+        RestPose(std::span<const Vertex> restVertices, std::span<const glm::uvec4> vertexJoints, std::span<const glm::vec4> vertexWeights);
+    };
+
+    //The upper three rows of every joint matrix, column by column (so the last three floats are the translation), which is all an affine transform needs
+    [[nodiscard]] std::vector<float> packJoints(std::span<const glm::mat4> jointMatrices);
+
+    /**
+     * Skins the blocks of vertices begin until end.
+     *
+     * @param rest the bind pose
+     * @param joints the packed joint matrices, see packJoints
+     * @param posed the skinned vertices, with as many blocks as rest.vertices
+     */
+    void skinScalar(const RestPose& rest, const float* joints, VertexArrays& posed, size_t begin, size_t end);
+#if defined(EDGE_KERNELS_SSE)
+    void skinSSE(const RestPose& rest, const float* joints, VertexArrays& posed, size_t begin, size_t end);
+#endif
+#if defined(EDGE_KERNELS_AVX2)
+    void skinAVX2(const RestPose& rest, const float* joints, VertexArrays& posed, size_t begin, size_t end);
+#endif
+#if defined(EDGE_KERNELS_NEON)
+    void skinNEON(const RestPose& rest, const float* joints, VertexArrays& posed, size_t begin, size_t end);
+#endif
+
+    using Kernel = void (*)(const RestPose& rest, const float* joints, VertexArrays& posed, size_t begin, size_t end);
+
+    /**
+     * Skins every vertex in parallel with a kernel.
+     *
+     * @param kernel one of the implementations above
+     * @param rest the bind pose
+     * @param jointMatrices per joint, the transform from the bind pose to the pose, see MeshSkin::jointMatrices
+     * @param posed the skinned vertices, resized to the size of rest.vertices
+     * @param threadCount the number of threads, including the calling thread. 0 uses every hardware thread.
+     */
+    void skin(Kernel kernel, const RestPose& rest, std::span<const glm::mat4> jointMatrices, VertexArrays& posed, unsigned int threadCount = 0);
+
+    //Skins every vertex in parallel with the widest implementation the build supports
+    void skin(const RestPose& rest, std::span<const glm::mat4> jointMatrices, VertexArrays& posed, unsigned int threadCount = 0);
+
+    //Name of the instruction set skin(...) uses
+    [[nodiscard]] const char* instructionSet();
+
+    /**
+     * Moves the base vertices of a mesh to their skinned pose, see Mesh::moveVertices.
+     *
+     * @return the triangles that use a moved vertex, for CPUScene::applyMotion
+     */
+    std::vector<unsigned int> moveVertices(Mesh& mesh, const VertexArrays& posed);
+}
@@ -0,0 +1,328 @@
+#include "Socket.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+using NativeSocket = SOCKET;
+//The lengths that Winsock takes as int
+using AddressLength = int;
+using BufferLength = int;
+static constexpr int SEND_FLAGS = 0;
+
+static void closeSocket(const std::intptr_t socket) {
+    closesocket(static_cast<NativeSocket>(socket));
+}
+
+static void initializeSockets() {
+    static const bool initialized = [] {
+        WSADATA wsaData;
+        return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+    }();
+    if(!initialized) throw std::runtime_error("Could not initialize Winsock");
+}
+
+//std::filesystem does not tell the reparse points of AF_UNIX socket files apart, so their tag is checked directly. Links are not followed.
+static bool isSocketFile(const std::string& path) {
+    WIN32_FIND_DATAA data;
+    const HANDLE find = FindFirstFileA(path.c_str(), &data);
+    if(find == INVALID_HANDLE_VALUE) return false;
+    FindClose(find);
+
+    return (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) && data.dwReserved0 == IO_REPARSE_TAG_AF_UNIX;
+}
+#else
+using NativeSocket = int;
+using AddressLength = socklen_t;
+using BufferLength = size_t;
+#ifdef MSG_NOSIGNAL
+static constexpr int SEND_FLAGS = MSG_NOSIGNAL; //A peer that disconnects early should not kill the process with SIGPIPE
+#else
+static constexpr int SEND_FLAGS = 0;
+#endif
+
+static void closeSocket(const std::intptr_t socket) {
+    close(static_cast<NativeSocket>(socket));
+}
+
+static void initializeSockets() {}
+
+//Links are not followed
+static bool isSocketFile(const std::string& path) {
+    return std::filesystem::is_socket(std::filesystem::symlink_status(path));
+}
+#endif
+
+static constexpr std::intptr_t INVALID = -1;
+
+static sockaddr_un unixAddress(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+
+    if(path.size() >= sizeof(address.sun_path)) throw std::runtime_error("Socket path is too long: " + path);
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    return address;
+}
+
+//The addresses that a "host:port" address resolves to
+static addrinfo* resolve(const std::string& address, const bool passive) {
+    const size_t colon = address.rfind(':');
+    std::string host = address.substr(0, colon);
+    const std::string port = address.substr(colon + 1);
+    if(host.size() >= 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2); //[::1]:port
+
+    if(host.empty()) host = "127.0.0.1"; //:port
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if(passive) hints.ai_flags = AI_PASSIVE;
+
+    addrinfo* result = nullptr;
+    if(getaddrinfo(host == "*" ? nullptr : host.c_str(), port.c_str(), &hints, &result) != 0 || !result) throw std::runtime_error("Could not resolve " + address);
+
+    return result;
+}
+
+//Requests and responses are single lines that the other side waits for, so they should not wait for more data to be sent with them
+static void disableNagle(const std::intptr_t socket) {
+    const int enabled = 1;
+    setsockopt(static_cast<NativeSocket>(socket), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+}
+
+Socket::Socket(const std::intptr_t handle): socket(handle) {}
+
+Socket::~Socket() {
+    if(socket != INVALID) closeSocket(socket);
+}
+
+Socket::Socket(Socket&& other) noexcept: socket(std::exchange(other.socket, INVALID)), received(std::move(other.received)) {}
+
+Socket& Socket::operator=(Socket&& other) noexcept {
+    if(this != &other) {
+        if(socket != INVALID) closeSocket(socket);
+        socket = std::exchange(other.socket, INVALID);
+        received = std::move(other.received);
+    }
+
+    return *this;
+}
+
+bool Socket::isTcpAddress(const std::string& address) {
+    const size_t colon = address.rfind(':');
+    if(colon == std::string::npos || colon + 1 == address.size()) return false;
+    if(address.find_first_of("/\\") != std::string::npos) return false; //A path, such as C:\daemon.sock
+
+    return std::all_of(address.begin() + static_cast<std::ptrdiff_t>(colon) + 1, address.end(), [](const char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+}
+
+bool Socket::isLocalAddress(const std::string& address) {
+    if(!isTcpAddress(address)) return true;
+    if(address.substr(0, address.rfind(':')) == "*") return false;
+
+    initializeSockets();
+    addrinfo* addresses = resolve(address, true);
+    bool local = true;
+    for(const addrinfo* a = addresses; a && local; a = a->ai_next) {
+        if(a->ai_family == AF_INET) {
+            local = ntohl(reinterpret_cast<const sockaddr_in*>(a->ai_addr)->sin_addr.s_addr) >> 24 == 127; //127.0.0.0/8
+        } else {
+            local = a->ai_family == AF_INET6 && std::memcmp(&reinterpret_cast<const sockaddr_in6*>(a->ai_addr)->sin6_addr, &in6addr_loopback, sizeof(in6_addr)) == 0;
+        }
+    }
+
+    freeaddrinfo(addresses);
+    return local;
+}
+
+Socket Socket::connect(const std::string& address) {
+    initializeSockets();
+
+    if(!isTcpAddress(address)) {
+        const sockaddr_un unixSocket = unixAddress(address);
+        Socket result(static_cast<std::intptr_t>(::socket(AF_UNIX, SOCK_STREAM, 0)));
+        if(!result.valid() || ::connect(static_cast<NativeSocket>(result.socket), reinterpret_cast<const sockaddr*>(&unixSocket), sizeof(unixSocket)) != 0) {
+            throw std::runtime_error("Could not connect to " + address);
+        }
+        return result;
+    }
+
+    addrinfo* addresses = resolve(address, false);
+    for(const addrinfo* a = addresses; a; a = a->ai_next) {
+        Socket result(static_cast<std::intptr_t>(::socket(a->ai_family, a->ai_socktype, a->ai_protocol)));
+        if(!result.valid() || ::connect(static_cast<NativeSocket>(result.socket), a->ai_addr, static_cast<AddressLength>(a->ai_addrlen)) != 0) continue;
+
+        freeaddrinfo(addresses);
+        disableNagle(result.socket);
+        return result;
+    }
+
+    freeaddrinfo(addresses);
+    throw std::runtime_error("Could not connect to " + address);
+}
+
+Socket Socket::listen(const std::string& address) {
+    initializeSockets();
+
+    if(!isTcpAddress(address)) {
+        //A socket file left behind by a process that did not exit cleanly, anything else (including a link to a socket) is not ours to remove
+        if(std::filesystem::exists(std::filesystem::symlink_status(address))) {
+            if(!isSocketFile(address)) throw std::runtime_error(address + " exists and is not a socket");
+            std::filesystem::remove(address);
+        }
+
+        const sockaddr_un unixSocket = unixAddress(address);
+        Socket result(static_cast<std::intptr_t>(::socket(AF_UNIX, SOCK_STREAM, 0)));
+        if(!result.valid() || bind(static_cast<NativeSocket>(result.socket), reinterpret_cast<const sockaddr*>(&unixSocket), sizeof(unixSocket)) != 0
+           || ::listen(static_cast<NativeSocket>(result.socket), SOMAXCONN) != 0) {
+            throw std::runtime_error("Could not listen on " + address);
+        }
+        return result;
+    }
+
+    addrinfo* addresses = resolve(address, true);
+    for(const addrinfo* a = addresses; a; a = a->ai_next) {
+        Socket result(static_cast<std::intptr_t>(::socket(a->ai_family, a->ai_socktype, a->ai_protocol)));
+        if(!result.valid()) continue;
+
+        //A daemon that restarts should not have to wait for the connections of the previous one to time out
+        const int enabled = 1;
+        setsockopt(static_cast<NativeSocket>(result.socket), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+        if(bind(static_cast<NativeSocket>(result.socket), a->ai_addr, static_cast<AddressLength>(a->ai_addrlen)) != 0 || ::listen(static_cast<NativeSocket>(result.socket), SOMAXCONN) != 0) continue;
+
+        freeaddrinfo(addresses);
+        return result;
+    }
+
+    freeaddrinfo(addresses);
+    throw std::runtime_error("Could not listen on " + address);
+}
+
+Socket Socket::accept() const {
+    const auto client = static_cast<std::intptr_t>(::accept(static_cast<NativeSocket>(socket), nullptr, nullptr));
+    if(client == INVALID) return {};
+
+    //Fails harmlessly for Unix domain sockets
+    disableNagle(client);
+    return Socket(client);
+}
+
+bool Socket::valid() const {
+    return socket != INVALID;
+}
+
+std::intptr_t Socket::handle() const {
+    return socket;
+}
+
+bool Socket::sendAll(const std::string& data) const {
+    size_t sent = 0;
+    while(sent < data.size()) {
+        const auto size = static_cast<BufferLength>(std::min<size_t>(data.size() - sent, size_t(1) << 20));
+        const auto result = send(static_cast<NativeSocket>(socket), data.data() + sent, size, SEND_FLAGS);
+        if(result <= 0) return false;
+        sent += static_cast<size_t>(result);
+    }
+
+    return true;
+}
+
+bool Socket::readLine(std::string& line) {
+    size_t searched = 0; //The part of the buffer without a newline
+    while(true) {
+        if(const size_t newline = received.find('\n', searched); newline != std::string::npos) {
+            line.assign(received, 0, newline > 0 && received[newline - 1] == '\r' ? newline - 1 : newline);
+            received.erase(0, newline + 1);
+            return true;
+        }
+        searched = received.size();
+        //A peer that never sends a newline would otherwise grow the buffer until memory runs out
+        if(received.size() > MAX_LINE_BYTES) {
+            received.clear();
+            return false;
+        }
+
+        char chunk[65536];
+        const auto count = recv(static_cast<NativeSocket>(socket), chunk, static_cast<int>(sizeof(chunk)), 0);
+        if(count <= 0) return false;
+        received.append(chunk, static_cast<size_t>(count));
+    }
+}
+
+void Socket::shutdown(const std::intptr_t handle) {
+#ifdef _WIN32
+    ::shutdown(static_cast<NativeSocket>(handle), SD_BOTH);
+#else
+    ::shutdown(static_cast<NativeSocket>(handle), SHUT_RDWR);
+#endif
+}
+
+static constexpr char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string encodeBase64(const std::span<const std::uint8_t> data) {
+    std::string text;
+    text.reserve((data.size() + 2) / 3 * 4);
+
+    for(size_t i = 0; i < data.size(); i += 3) {
+        const size_t count = std::min<size_t>(3, data.size() - i);
+        std::uint32_t bits = static_cast<std::uint32_t>(data[i]) << 16;
+        if(count > 1) bits |= static_cast<std::uint32_t>(data[i + 1]) << 8;
+        if(count > 2) bits |= data[i + 2];
+
+        text.push_back(BASE64_ALPHABET[(bits >> 18) & 63]);
+        text.push_back(BASE64_ALPHABET[(bits >> 12) & 63]);
+        text.push_back(count > 1 ? BASE64_ALPHABET[(bits >> 6) & 63] : '=');
+        text.push_back(count > 2 ? BASE64_ALPHABET[bits & 63] : '=');
+    }
+
+    return text;
+}
+
+std::vector<std::uint8_t> decodeBase64(const std::string& text) {
+    if(text.size() % 4 != 0) throw std::invalid_argument("The length of base64 must be a multiple of 4");
+
+    std::array<std::int8_t, 256> values;
+    values.fill(-1);
+    for(int i = 0; i < 64; i++) values[static_cast<unsigned char>(BASE64_ALPHABET[i])] = static_cast<std::int8_t>(i);
+
+    std::vector<std::uint8_t> data;
+    data.reserve(text.size() / 4 * 3);
+    for(size_t i = 0; i < text.size(); i += 4) {
+        //Padding is only allowed at the end
+        const size_t padding = i + 4 == text.size() ? static_cast<size_t>(text[i + 3] == '=') + static_cast<size_t>(text[i + 2] == '=') : 0;
+
+        std::uint32_t bits = 0;
+        for(size_t j = 0; j < 4; j++) {
+            const std::int8_t value = j >= 4 - padding ? 0 : values[static_cast<unsigned char>(text[i + j])];
+            if(value < 0) throw std::invalid_argument("Invalid character in base64");
+            bits = bits << 6 | static_cast<std::uint32_t>(value);
+        }
+
+        data.push_back(static_cast<std::uint8_t>(bits >> 16));
+        if(padding < 2) data.push_back(static_cast<std::uint8_t>(bits >> 8));
+        if(padding < 1) data.push_back(static_cast<std::uint8_t>(bits));
+    }
+
+    return data;
+}
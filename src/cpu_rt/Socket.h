@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * A stream socket to another process, for the line-based JSON protocol of RenderDaemon. An address is either a path,
+ * which is a Unix domain socket on the same machine, or "host:port" (the port being a number), which is TCP and can
+ * reach other machines.
+ */
+class Socket {
+public:
+    Socket() = default;
+    ~Socket();
+    Socket(Socket&& other) noexcept;
+    Socket& operator=(Socket&& other) noexcept;
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    //Connects to a listening socket, throws if nothing listens on the address
+    [[nodiscard]] static Socket connect(const std::string& address);
+
+    /**
+     * Listens on an address. The host of a TCP address is the interface to listen on: none (":port") for 127.0.0.1,
+     * * for every interface. A socket file left behind at the path of a Unix domain socket is replaced, anything
+     * else (including a symbolic link) is not.
+     */
+    [[nodiscard]] static Socket listen(const std::string& address);
+
+    //Waits for a client of a listening socket. Invalid if accepting failed, for example because the socket was shut down.
+    [[nodiscard]] Socket accept() const;
+
+    //True if the address is "host:port" rather than a path
+    [[nodiscard]] static bool isTcpAddress(const std::string& address);
+    //True if only this machine can connect to the address: a Unix domain socket, or a host that resolves to loopback addresses only
+    [[nodiscard]] static bool isLocalAddress(const std::string& address);
+
+    [[nodiscard]] bool valid() const;
+    //The operating system's handle, to shut down the socket from another thread
+    [[nodiscard]] std::intptr_t handle() const;
+
+    //Sends all of the data, false if the connection broke
+    bool sendAll(const std::string& data) const;
+
+    //The longest line readLine accepts, about twice a whole 4K frame sent back as a tile in base64
+    static constexpr size_t MAX_LINE_BYTES = size_t(64) << 20;
+
+    //Reads up to and without the next newline (and a carriage return before it), false if the connection closed first
+    //or the line is longer than MAX_LINE_BYTES. The connection is then no longer usable.
+    bool readLine(std::string& line);
+
+    //Stops sending and receiving, which wakes up a thread that waits to receive or accept. Thread-safe.
+    static void shutdown(std::intptr_t handle);
+
+private:
+    explicit Socket(std::intptr_t handle);
+
+    std::intptr_t socket = -1;
+    std::string received; //Read past the last line
+};
+
+//Binary data in the strings of JSON messages
+[[nodiscard]] std::string encodeBase64(std::span<const std::uint8_t> data);
+//Throws if the text is not base64
+[[nodiscard]] std::vector<std::uint8_t> decodeBase64(const std::string& text);
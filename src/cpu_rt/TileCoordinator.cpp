@@ -0,0 +1,219 @@
+#include "TileCoordinator.h"
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <json.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+TileCoordinator::TileCoordinator(std::vector<std::string> workerAddresses, const Options frameOptions): workers(std::move(workerAddresses)), options(frameOptions) {
+    if(workers.empty()) throw std::invalid_argument("A coordinator needs at least one worker");
+    //Tiles that start where the tiles of the workers' renderers do give the same packets, see CPURenderer::render
+    const unsigned int alignment = TileScheduler::DEFAULT_TILE_SIZE;
+    options.tileSize = std::max(1u, (options.tileSize + alignment - 1) / alignment) * alignment;
+
+    connections.resize(workers.size());
+}
+
+const std::vector<std::string>& TileCoordinator::getWorkers() const {
+    return workers;
+}
+
+DistributedFrameStats TileCoordinator::render(const Frame& frame, std::vector<uint8_t>& rgb) {
+    const auto start = Clock::now();
+    const std::vector<Tile> tiles = TileScheduler(frame.resolution, options.tileSize, 1).getTiles();
+    rgb.assign(3 * static_cast<size_t>(frame.resolution.x) * frame.resolution.y, 0);
+
+    DistributedFrameStats stats;
+    stats.tiles = tiles.size();
+    stats.tilesPerWorker.resize(workers.size());
+
+    //Every tile request is this one with the rectangle of its tile
+    json frameRequest = {{"type", "render"}, {"mesh", frame.mesh.string()}, {"resolution", {frame.resolution.x, frame.resolution.y}}, {"fov", glm::degrees(frame.fovy)},
+                         {"packets", frame.packets}, {"lod", frame.lodPixels}};
+    if(frame.camera) {
+        const CameraKeyframe& c = *frame.camera;
+        frameRequest["camera"] = {{"lookAt", {c.lookAt.x, c.lookAt.y, c.lookAt.z}}, {"rotation", {c.rotation.x, c.rotation.y, c.rotation.z}}, {"distance", c.distance}};
+    } else {
+        frameRequest["angle"] = frame.angle;
+    }
+
+    //Workers that failed or were cut off after the previous frame get another chance
+    unsigned int liveWorkers = 0;
+    for(size_t worker = 0; worker < workers.size(); worker++) {
+        if(!connections[worker].valid()) {
+            try {
+                connections[worker] = Socket::connect(workers[worker]);
+            } catch(const std::runtime_error& e) {
+                stats.failedWorkers.push_back(e.what());
+                continue;
+            }
+        }
+        liveWorkers++;
+    }
+    if(liveWorkers == 0) throw std::runtime_error("None of the workers can be reached");
+
+    struct TileState {
+        bool done = false;
+        unsigned int copies = 0; //Out at workers right now
+        Clock::time_point issued; //When the first of those copies was sent
+    };
+    std::vector<TileState> states(tiles.size());
+    std::deque<size_t> pending; //Tiles without a copy that is out, in Morton order
+    for(size_t tile = 0; tile < tiles.size(); tile++) pending.push_back(tile);
+    size_t remaining = tiles.size();
+    size_t completed = 0;
+    double completedSeconds = 0.0; //Of the copies that came back first, from request to response
+    std::vector<bool> busy(workers.size(), false);
+
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    //The next tile for an idle worker: a new one, or else a copy of the tile that has been out the longest, once it is late
+    const auto nextTile = [&](std::unique_lock<std::mutex>& lock) -> std::optional<size_t> {
+        while(remaining > 0) {
+            if(!pending.empty()) {
+                const size_t tile = pending.front();
+                pending.pop_front();
+                return tile;
+            }
+
+            if(completed > 0) {
+                const auto lateAfter = std::chrono::duration<double>(static_cast<double>(options.reissueFactor) * completedSeconds / static_cast<double>(completed));
+                const auto now = Clock::now();
+
+                std::optional<size_t> late;
+                for(size_t tile = 0; tile < tiles.size(); tile++) {
+                    const TileState& state = states[tile];
+                    if(state.done || state.copies == 0 || state.copies >= options.maxCopies || now - state.issued < lateAfter) continue;
+                    if(!late || state.issued < states[*late].issued) late = tile;
+                }
+                if(late) {
+                    stats.reissuedTiles++;
+                    return late;
+                }
+            }
+
+            //Woken when a tile comes back, and now and then to see whether a tile has become late
+            changed.wait_for(lock, std::chrono::milliseconds(10));
+        }
+
+        return std::nullopt;
+    };
+
+    const auto work = [&](const size_t worker) {
+        Socket& connection = connections[worker];
+
+        std::unique_lock lock(mutex);
+        while(const std::optional<size_t> next = nextTile(lock)) {
+            const size_t tile = *next;
+            const Tile& rectangle = tiles[tile];
+            if(states[tile].copies++ == 0) states[tile].issued = Clock::now();
+            busy[worker] = true;
+            lock.unlock();
+
+            json request = frameRequest;
+            request["id"] = tile;
+            request["tile"] = {rectangle.min.x, rectangle.min.y, rectangle.max.x - rectangle.min.x, rectangle.max.y - rectangle.min.y};
+
+            const auto sent = Clock::now();
+            std::string line, error;
+            std::vector<uint8_t> pixels;
+            uint64_t rays = 0;
+            if(connection.sendAll(request.dump() + '\n') && connection.readLine(line)) {
+                try {
+                    const json response = json::parse(line);
+                    if(!response.value("ok", false)) throw std::runtime_error(response.value("error", std::string("unknown error")));
+
+                    pixels = decodeBase64(response.at("pixels").get<std::string>());
+                    const glm::uvec2 size = rectangle.max - rectangle.min;
+                    if(pixels.size() != 3 * static_cast<size_t>(size.x) * size.y) throw std::runtime_error("sent a tile of the wrong size");
+                    rays = response.value("rays", uint64_t(0));
+                } catch(const std::exception& e) {
+                    error = e.what();
+                }
+            } else {
+                error = "the connection broke";
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - sent).count();
+
+            lock.lock();
+            busy[worker] = false;
+            TileState& state = states[tile];
+            state.copies--;
+
+            if(!error.empty()) {
+                //A worker that is cut off because the frame is done has not failed, it only reconnects for the next frame
+                if(remaining > 0) stats.failedWorkers.push_back(workers[worker] + ": " + error);
+                if(!state.done && state.copies == 0) pending.push_front(tile);
+                connection = Socket();
+                liveWorkers--;
+                changed.notify_all();
+                return;
+            }
+
+            if(state.done) {
+                stats.discardedTiles++;
+                continue;
+            }
+
+            const glm::uvec2 size = rectangle.max - rectangle.min;
+            for(unsigned int y = 0; y < size.y; y++) {
+                const size_t row = (static_cast<size_t>(rectangle.min.y + y) * frame.resolution.x + rectangle.min.x) * 3;
+                std::memcpy(rgb.data() + row, pixels.data() + static_cast<size_t>(y) * size.x * 3, static_cast<size_t>(size.x) * 3);
+            }
+
+            state.done = true;
+            remaining--;
+            completed++;
+            completedSeconds += seconds;
+            stats.tilesPerWorker[worker]++;
+            stats.rays += rays;
+            changed.notify_all();
+        }
+    };
+
+    std::vector<bool> cutOff;
+    std::vector<std::thread> threads;
+    for(size_t worker = 0; worker < workers.size(); worker++) {
+        if(connections[worker].valid()) threads.emplace_back(work, worker);
+    }
+
+    {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [&] { return remaining == 0 || liveWorkers == 0; });
+
+        //Copies of tiles that are still out are of no use anymore, and a stuck worker should not hold up the next frame
+        for(size_t worker = 0; worker < workers.size(); worker++) {
+            if(busy[worker]) Socket::shutdown(connections[worker].handle());
+        }
+        cutOff = busy;
+        changed.notify_all();
+    }
+    for(std::thread& thread : threads) thread.join();
+
+    //Even when the response of a cut off worker was read before the shutdown, its connection is no use for the next frame
+    for(size_t worker = 0; worker < workers.size(); worker++) {
+        if(cutOff[worker]) connections[worker] = Socket();
+    }
+
+    if(remaining > 0) {
+        std::string errors;
+        for(const std::string& error : stats.failedWorkers) errors += "\n" + error;
+        throw std::runtime_error("Every worker failed before the frame was done:" + errors);
+    }
+
+    stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return stats;
+}
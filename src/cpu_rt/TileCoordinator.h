@@ -0,0 +1,84 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "CameraPath.h"
+#include "Socket.h"
+#include "TileScheduler.h"
+
+//What happened while a TileCoordinator rendered a frame
+struct DistributedFrameStats {
+    double seconds = 0.0;
+    uint64_t rays = 0;
+    size_t tiles = 0;
+    size_t reissuedTiles = 0; //Copies of tiles that were sent to a second worker because the first one took too long
+    size_t discardedTiles = 0; //Copies that came back after another copy of the same tile
+    std::vector<size_t> tilesPerWorker; //Tiles whose result was used, per worker
+    std::vector<std::string> failedWorkers; //Workers whose connection broke, their tiles went to the others
+
+    [[nodiscard]] double raysPerSecond() const {
+        return seconds > 0.0 ? static_cast<double>(rays) / seconds : 0.0;
+    }
+};
+
+/**
+ * Renders frames on several RenderDaemon processes, on this machine or on others: every frame is split into tiles,
+ * which the workers take one at a time as tile requests, and the pixels that come back are assembled into the frame.
+ * Workers that are faster take more tiles, so the load is balanced like the work stealing of CPURenderer, one level up.
+ *
+ * Once there are no new tiles left, idle workers take copies of tiles that have been out for much longer than tiles take
+ * on average, so a worker that is slow or stuck does not hold up the frame; whichever copy comes back first is used. A
+ * worker whose connection breaks is dropped and its tiles go to the others. Every worker loads the mesh through its own
+ * scene cache, which daemons that share a --paged-cache directory fill from the same memory-mapped file.
+ *
+ * Workers render exactly the pixels CPURenderer::render would, so the assembled frame is the same as one rendered locally.
+ */
+class TileCoordinator {
+public:
+    struct Options {
+        unsigned int tileSize = 128; //Width and height of the tiles, in pixels. Rounded up to a multiple of the tiles of CPURenderer.
+        float reissueFactor = 3.0f; //A tile is copied once it has been out for this many times the average time of a tile
+        unsigned int maxCopies = 2; //Of a tile that are out at the same time
+    };
+
+    //A frame and how to render it, sent as the fields of a render request, see RenderDaemon
+    struct Frame {
+        std::filesystem::path mesh; //As the workers see it, so an absolute path on a file system they share
+        glm::uvec2 resolution{1024, 1024};
+        float fovy = glm::radians(80.0f);
+        std::optional<CameraKeyframe> camera; //Without one, the workers frame the mesh
+        float angle = 0.0f; //Around the mesh when the workers frame it, in radians
+        bool packets = false;
+        float lodPixels = 0.0f;
+    };
+
+    /**
+     * @param workerAddresses the addresses of the daemons, see Socket. Connected to when a frame is rendered.
+     * @param frameOptions how frames are split and when tiles are copied
+     */
+    TileCoordinator(std::vector<std::string> workerAddresses, Options frameOptions);
+
+    /**
+     * Renders a frame on all workers that can be reached. Throws if none can, or if every worker failed before the frame was done.
+     *
+     * @param frame the frame
+     * @param rgb the colors of the frame as 8-bit RGB, row by row starting at the top, see CPURenderer::toRGB8
+     */
+    DistributedFrameStats render(const Frame& frame, std::vector<uint8_t>& rgb);
+
+    [[nodiscard]] const std::vector<std::string>& getWorkers() const;
+
+private:
+    std::vector<std::string> workers;
+    std::vector<Socket> connections; //Per worker, invalid if it is not connected
+    Options options;
+};
@@ -0,0 +1,103 @@
+#include "TileScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+//The deque of a single worker. Aligned to a cache line, so that workers do not invalidate each other's lock.
+struct alignas(64) WorkerQueue {
+    std::mutex mutex;
+    std::deque<unsigned int> tiles;
+
+    bool popFront(unsigned int& tile) {
+        const std::lock_guard lock(mutex);
+        if(tiles.empty()) return false;
+
+        tile = tiles.front();
+        tiles.pop_front();
+        return true;
+    }
+
+    bool stealBack(unsigned int& tile) {
+        const std::lock_guard lock(mutex);
+        if(tiles.empty()) return false;
+
+        tile = tiles.back();
+        tiles.pop_back();
+        return true;
+    }
+};
+
+TileScheduler::TileScheduler(const glm::uvec2& resolution, const unsigned int tileSize, const unsigned int threadCount): workerCount(std::max(1u, threadCount)) {
+    const unsigned int size = std::max(1u, tileSize);
+    const glm::uvec2 tileCount = (resolution + size - 1u) / size;
+
+    tiles.reserve(static_cast<size_t>(tileCount.x) * tileCount.y);
+    for(unsigned int y = 0; y < tileCount.y; y++) {
+        for(unsigned int x = 0; x < tileCount.x; x++) {
+            const glm::uvec2 min = glm::uvec2(x, y) * size;
+            tiles.push_back({min, glm::min(min + size, resolution)});
+        }
+    }
+
+    std::ranges::sort(tiles, {}, [size](const Tile& tile) { return mortonCode(tile.min.x / size, tile.min.y / size); });
+}
+
+unsigned int TileScheduler::run(const std::function<void(unsigned int worker, const Tile& tile)>& renderTile) const {
+    const unsigned int workers = std::clamp(workerCount, 1u, std::max(1u, static_cast<unsigned int>(tiles.size())));
+
+    //Every worker starts with a contiguous range of tiles in Morton order
+    std::vector<WorkerQueue> queues(workers);
+    for(unsigned int worker = 0; worker < workers; worker++) {
+        const size_t begin = tiles.size() * worker / workers;
+        const size_t end = tiles.size() * (worker + 1) / workers;
+        for(size_t tile = begin; tile < end; tile++) queues[worker].tiles.push_back(static_cast<unsigned int>(tile));
+    }
+
+    std::atomic<unsigned int> stolenTiles = 0;
+
+    const auto work = [&](const unsigned int worker) {
+        unsigned int tile;
+        while(true) {
+            if(queues[worker].popFront(tile)) {
+                renderTile(worker, tiles[tile]);
+                continue;
+            }
+
+            //No tiles are ever added, so once every deque is empty the frame is done
+            bool stole = false;
+            for(unsigned int i = 1; i < workers && !stole; i++) stole = queues[(worker + i) % workers].stealBack(tile);
+            if(!stole) return;
+
+            stolenTiles.fetch_add(1, std::memory_order_relaxed);
+            renderTile(worker, tiles[tile]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for(unsigned int worker = 1; worker < workers; worker++) threads.emplace_back(work, worker);
+    work(0);
+    for(std::thread& thread : threads) thread.join();
+
+    return stolenTiles.load();
+}
+
+const std::vector<Tile>& TileScheduler::getTiles() const {
+    return tiles;
+}
+
+unsigned int TileScheduler::mortonCode(const unsigned int x, const unsigned int y) {
+    const auto spread = [](unsigned int v) {
+        v &= 0x0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    };
+
+    return spread(x) | (spread(y) << 1);
+}
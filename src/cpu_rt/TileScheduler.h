@@ -0,0 +1,52 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <functional>
+#include <vector>
+
+//A rectangle of pixels from min (inclusive) to max (exclusive)
+struct Tile {
+    glm::uvec2 min;
+    glm::uvec2 max;
+};
+
+/**
+ * Distributes the tiles of a frame over worker threads with work stealing.
+ *
+ * The tiles are sorted in Morton order and every worker starts with a contiguous range of them in its own deque, so
+ * that neighbouring tiles (which touch the same parts of the mesh) are rendered by the same thread. A worker takes
+ * tiles from the front of its own deque; once that is empty it steals from the back of the other deques. Rays that
+ * hit strongly displaced regions are much more expensive than the rest, so this balances the load far better than a
+ * static split of the image.
+ */
+class TileScheduler {
+public:
+    static constexpr unsigned int DEFAULT_TILE_SIZE = 16;
+
+    /**
+     * @param resolution the resolution of the frame
+     * @param tileSize the width and height of a tile. Tiles at the right and bottom border can be smaller.
+     * @param threadCount the number of threads, including the calling thread
+     */
+    TileScheduler(const glm::uvec2& resolution, unsigned int tileSize, unsigned int threadCount);
+
+    /**
+     * Renders all tiles and returns when they are done. Worker 0 is the calling thread.
+     *
+     * @param renderTile called with the index of the worker and the tile to render
+     * @return the number of tiles that were stolen from another worker
+     */
+    unsigned int run(const std::function<void(unsigned int worker, const Tile& tile)>& renderTile) const;
+
+    [[nodiscard]] const std::vector<Tile>& getTiles() const;
+
+    //Interleaves the bits of x and y
+    [[nodiscard]] static unsigned int mortonCode(unsigned int x, unsigned int y);
+
+private:
+    std::vector<Tile> tiles; //In Morton order
+    unsigned int workerCount;
+};
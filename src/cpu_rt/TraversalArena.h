@@ -0,0 +1,70 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <vector>
+
+struct MicroVertex2D {
+    glm::vec2 position; //position on plane before displacing it
+    glm::vec3 bc; //Barycentric coordinates
+    glm::uvec2 coordinates; //local grid coordinates
+};
+
+struct StackElement {
+    MicroVertex2D vertices[3];
+    int level;
+    unsigned int localIndex; //Index of this triangle among the hierarchy triangles of its level. The shader stores the path instead, which encodes the same.
+    float entryT; //Ray parameter `t` where it enters the triangle
+    glm::vec2 minMaxDispl; //Decoded min-max displacements, only kept if the hierarchy is quantized (see QuantizedBounds)
+    int record; //Index of its min-max displacements and delta in the block. -1 below a flat leaf of a sparse hierarchy (see InteriorWord).
+};
+
+//A displaced micro-vertex of the regular micro-grid, see intersectMicroMeshTriangleGrid
+struct GridVertex {
+    glm::vec3 position;
+    float height; //Displacement along the normal of the base triangle's plane
+};
+
+//A hierarchy triangle that is traversed by several rays of a packet at once
+struct PacketStackElement {
+    StackElement element;
+    unsigned int laneMask; //The rays that cross this triangle
+};
+
+/**
+ * Scratch memory for the micro-mesh traversal. Every thread that traces rays owns one, so that no memory is allocated
+ * per ray: the stack is allocated once, up front, for the deepest hierarchy of the mesh and only cleared in between.
+ */
+class TraversalArena {
+    std::vector<StackElement> stack;
+    std::vector<PacketStackElement> packetStack;
+    std::vector<GridVertex> gridRows[2];
+
+public:
+    explicit TraversalArena(const int maxSubdivisionLevel = 0) {
+        stack.reserve(static_cast<size_t>(3 * maxSubdivisionLevel + 1)); //Every level pushes at most 4 triangles of which 1 is popped right away
+        packetStack.reserve(static_cast<size_t>(3 * maxSubdivisionLevel + 1));
+        for(auto& row : gridRows) row.reserve((size_t(1) << maxSubdivisionLevel) + 1);
+    }
+
+    //Returns the empty traversal stack, which keeps its capacity
+    [[nodiscard]] std::vector<StackElement>& clearedStack() {
+        stack.clear();
+        return stack;
+    }
+
+    //Returns the empty traversal stack for ray packets. It is separate from the single-ray stack, so that a packet can
+    //continue with single rays halfway through its traversal.
+    [[nodiscard]] std::vector<PacketStackElement>& clearedPacketStack() {
+        packetStack.clear();
+        return packetStack;
+    }
+
+    //Returns the micro-vertices of two neighbouring rows of the micro-grid, which keep their capacity
+    [[nodiscard]] std::vector<GridVertex>& clearedGridRow(const int row) {
+        gridRows[row].clear();
+        return gridRows[row];
+    }
+};
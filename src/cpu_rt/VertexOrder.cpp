@@ -0,0 +1,77 @@
+#include "VertexOrder.h"
+
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+static constexpr std::uint32_t UNNUMBERED = std::numeric_limits<std::uint32_t>::max();
+
+static unsigned int rowMajorIndex(const glm::uvec2& coords) {
+    return (coords.x * (coords.x + 1)) / 2 + coords.y;
+}
+
+//Numbers the micro-vertices of the micro-triangles below a grid triangle that are not numbered yet
+static void numberVertices(const VertexOrdering::GridTriangle& t, std::vector<std::uint32_t>& order, std::uint32_t& next) {
+    if(t.size == 1) {
+        for(const glm::uvec2& corner : t.corners()) {
+            std::uint32_t& index = order[rowMajorIndex(corner)];
+            if(index == UNNUMBERED) index = next++;
+        }
+        return;
+    }
+
+    for(const VertexOrdering::GridTriangle& child : t.children()) numberVertices(child, order, next);
+}
+
+namespace VertexOrdering {
+    std::array<GridTriangle, 4> GridTriangle::children() const {
+        const unsigned int half = size / 2;
+        const glm::uvec2 c = corner;
+
+        if(upright) {
+            return {{
+                {c, half, true},
+                {{c.x + half, c.y}, half, false},
+                {{c.x + half, c.y}, half, true},
+                {{c.x + half, c.y + half}, half, true}
+            }};
+        }
+
+        return {{
+            {c, half, false},
+            {{c.x, c.y + half}, half, true},
+            {{c.x + half, c.y + half}, half, false},
+            {{c.x, c.y + half}, half, false}
+        }};
+    }
+
+    std::array<glm::uvec2, 3> GridTriangle::corners() const {
+        if(upright) return {corner, {corner.x + size, corner.y}, {corner.x + size, corner.y + size}};
+
+        return {corner, {corner.x + size, corner.y + size}, {corner.x, corner.y + size}};
+    }
+
+    GridTriangle root(const int subdivisionLevel) {
+        return {{0, 0}, 1u << subdivisionLevel, true};
+    }
+
+    const std::vector<std::uint32_t>& birdCurve(const int subdivisionLevel) {
+        if(subdivisionLevel < 0 || subdivisionLevel > MAX_LEVEL) throw std::runtime_error("Unsupported subdivision level " + std::to_string(subdivisionLevel));
+
+        static std::array<std::vector<std::uint32_t>, MAX_LEVEL + 1> orders;
+        static std::array<std::once_flag, MAX_LEVEL + 1> computed;
+
+        const auto level = static_cast<size_t>(subdivisionLevel);
+        std::call_once(computed[level], [subdivisionLevel, level] {
+            const unsigned int rows = (1u << subdivisionLevel) + 1;
+            std::vector<std::uint32_t>& order = orders[level];
+            order.assign(rows * (rows + 1) / 2, UNNUMBERED);
+
+            std::uint32_t next = 0;
+            numberVertices(root(subdivisionLevel), order, next);
+        });
+
+        return orders[level];
+    }
+}
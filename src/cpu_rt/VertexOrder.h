@@ -0,0 +1,53 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <array>
+#include <cstdint>
+#include <vector>
+
+//How the displacement scales of the micro-vertices of a base triangle are laid out, see BakedMesh::displacementScale
+enum class VertexOrder {
+    ROW_MAJOR, //Row by row, x * (x + 1) / 2 + y, like Triangle::uVertices and getDisplacementScale(...) in intersection.hlsl
+    BIRD_CURVE //Along a space-filling curve through the micro-triangles, see VertexOrdering
+};
+
+/**
+ * The bird-curve order of micro-vertices. The micro-triangles of a base triangle are visited depth first, subdividing
+ * every triangle into its 4 children like the hierarchy does, and the micro-vertices are numbered the first time a
+ * micro-triangle uses them. The vertices of every hierarchy triangle therefore follow each other, except for those on
+ * its edges that an earlier sibling already numbered, while in row-major order they are spread over as many rows as the
+ * hierarchy triangle is high.
+ */
+namespace VertexOrdering {
+    //Subdivision levels above this have more micro-vertices than the traversal can index
+    static constexpr int MAX_LEVEL = 15;
+
+    /**
+     * A triangle of the grid of micro-vertex coordinates (x, y) with 0 <= y <= x, see BakedMesh::displacementScale.
+     * Upright triangles have the corners (x, y), (x + size, y) and (x + size, y + size); the others, which only appear
+     * as middle children, have the corners (x, y), (x + size, y + size) and (x, y + size).
+     */
+    struct GridTriangle {
+        glm::uvec2 corner;
+        unsigned int size;
+        bool upright;
+
+        //The 4 triangles of half the size, in curve order: the child at the first corner, the middle one, and the
+        //children at the second and third corner
+        [[nodiscard]] std::array<GridTriangle, 4> children() const;
+        //The grid coordinates of the 3 corners
+        [[nodiscard]] std::array<glm::uvec2, 3> corners() const;
+    };
+
+    //The whole base triangle of a subdivision level
+    [[nodiscard]] GridTriangle root(int subdivisionLevel);
+
+    /**
+     * For every micro-vertex in row-major order, its index in bird-curve order. Computed once per subdivision level,
+     * the first time it is needed.
+     */
+    [[nodiscard]] const std::vector<std::uint32_t>& birdCurve(int subdivisionLevel);
+}
@@ -0,0 +1,119 @@
+#include "micromesh_query.h"
+
+#include <framework/TinyGLTFLoader.h>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CPUScene.h"
+#include "InstancedScene.h"
+#include "RayQuery.h"
+#include "ShardedBake.h"
+
+struct mmq_scene {
+    std::unique_ptr<RayTracedScene> scene;
+    RayQuery query;
+};
+
+static thread_local std::string lastError;
+
+//Runs a function of the interface, and turns the exceptions that it throws into error codes
+template <typename Function>
+static int32_t guarded(Function&& function) {
+    lastError.clear();
+    try {
+        function();
+        return MMQ_OK;
+    } catch(const std::invalid_argument& e) {
+        lastError = e.what();
+        return MMQ_INVALID_ARGUMENT;
+    } catch(const std::exception& e) {
+        lastError = e.what();
+        return MMQ_ERROR;
+    } catch(...) {
+        lastError = "Unknown error";
+        return MMQ_ERROR;
+    }
+}
+
+static CPUScene bake(const Mesh& mesh, const mmq_scene_options& options) {
+    const VertexOrder order = options.vertex_order == MMQ_ORDER_BIRD_CURVE ? VertexOrder::BIRD_CURVE : VertexOrder::ROW_MAJOR;
+    const CPUScene::TraversalMode traversal = options.traversal == MMQ_TRAVERSAL_HIERARCHY ? CPUScene::TraversalMode::HIERARCHY
+                                            : options.traversal == MMQ_TRAVERSAL_GRID ? CPUScene::TraversalMode::GRID
+                                                                                      : CPUScene::TraversalMode::AUTOMATIC;
+
+    return CPUScene(ShardedBake::bake(mesh, order, options.thread_count), traversal);
+}
+
+uint32_t mmq_version(void) {
+    return (MMQ_VERSION_MAJOR << 16) | MMQ_VERSION_MINOR;
+}
+
+mmq_scene_options mmq_default_scene_options(void) {
+    return {0, MMQ_TRAVERSAL_AUTOMATIC, MMQ_ORDER_ROW_MAJOR, 0, 1};
+}
+
+mmq_scene* mmq_load_scene(const char* path, const mmq_scene_options* options) {
+    mmq_scene* result = nullptr;
+    guarded([&] {
+        if(!path) throw std::invalid_argument("The path is NULL");
+        const mmq_scene_options settings = options ? *options : mmq_default_scene_options();
+        if(settings.traversal > MMQ_TRAVERSAL_GRID) throw std::invalid_argument("Unknown traversal: " + std::to_string(settings.traversal));
+        if(settings.vertex_order > MMQ_ORDER_BIRD_CURVE) throw std::invalid_argument("Unknown vertex order: " + std::to_string(settings.vertex_order));
+
+        std::unique_ptr<RayTracedScene> scene;
+        if(settings.instancing) {
+            //Every unique mesh is baked once, however often it is instanced
+            const MeshScene meshScene = TinyGLTFLoader::loadScene(path);
+            std::vector<CPUScene> meshes;
+            for(const Mesh& mesh : meshScene.meshes) meshes.push_back(bake(mesh, settings));
+
+            std::vector<InstancedScene::Instance> instances;
+            for(const MeshInstance& instance : meshScene.instances) instances.push_back({instance.mesh, instance.transform});
+            scene = std::make_unique<InstancedScene>(std::move(meshes), std::move(instances));
+        } else {
+            scene = std::make_unique<CPUScene>(bake(TinyGLTFLoader::loadMesh(path), settings));
+        }
+
+        const RayQuery query(*scene, settings.thread_count, settings.packets != 0);
+        result = new mmq_scene{std::move(scene), query};
+    });
+
+    return result;
+}
+
+void mmq_destroy_scene(mmq_scene* scene) {
+    delete scene;
+}
+
+int32_t mmq_scene_bounds(const mmq_scene* scene, float min[3], float max[3]) {
+    return guarded([&] {
+        if(!scene || !min || !max) throw std::invalid_argument("The scene or the bounds are NULL");
+
+        const AABB bounds = scene->scene->bounds();
+        for(int i = 0; i < 3; i++) {
+            min[i] = bounds.minPos[i];
+            max[i] = bounds.maxPos[i];
+        }
+    });
+}
+
+int32_t mmq_trace_rays(const mmq_scene* scene, const mmq_rays* rays, const mmq_hits* hits, mmq_stats* stats) {
+    return guarded([&] {
+        if(!scene || !rays || !hits) throw std::invalid_argument("The scene, rays or hits are NULL");
+
+        const RayArrays rayArrays{static_cast<size_t>(rays->count), rays->origin_x, rays->origin_y, rays->origin_z, rays->direction_x, rays->direction_y, rays->direction_z,
+                                  rays->t_min, rays->t_max};
+        const HitArrays hitArrays{hits->t, hits->base_triangle, hits->micro_triangle, hits->u, hits->v, hits->instance};
+        const QueryStats queryStats = scene->query.trace(rayArrays, hitArrays);
+
+        if(stats) *stats = {queryStats.traversal.rays, queryStats.traversal.hits, queryStats.seconds, queryStats.raysPerSecond()};
+    });
+}
+
+const char* mmq_last_error(void) {
+    return lastError.c_str();
+}
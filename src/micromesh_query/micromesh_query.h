@@ -0,0 +1,111 @@
+#pragma once
+
+/**
+ * C interface of the CPU ray tracer for tools that embed it: loads micro-meshes and finds the closest hits of batches of
+ * rays, see RayQuery. Only plain C types cross the interface, and the layout of the structs and the behavior of the
+ * functions stay the same for every library with the same MMQ_VERSION_MAJOR, so a tool that was built against an older
+ * minor version keeps working with a newer library. Minor versions only add functions.
+ *
+ * Functions that can fail return MMQ_OK or an error code, or NULL, and mmq_last_error() then describes the error on the
+ * calling thread. A scene can be queried from several threads at once.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(MMQ_BUILDING)
+#define MMQ_API __declspec(dllexport)
+#else
+#define MMQ_API __declspec(dllimport)
+#endif
+#else
+#define MMQ_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MMQ_VERSION_MAJOR 1
+#define MMQ_VERSION_MINOR 0
+
+#define MMQ_OK 0
+#define MMQ_INVALID_ARGUMENT 1
+#define MMQ_ERROR 2
+
+//The base triangle, micro-triangle and instance of a ray that hits nothing
+#define MMQ_MISS 0xFFFFFFFFu
+
+#define MMQ_TRAVERSAL_AUTOMATIC 0
+#define MMQ_TRAVERSAL_HIERARCHY 1
+#define MMQ_TRAVERSAL_GRID 2
+
+#define MMQ_ORDER_ROW_MAJOR 0
+#define MMQ_ORDER_BIRD_CURVE 1
+
+typedef struct mmq_scene mmq_scene;
+
+typedef struct mmq_scene_options {
+    uint32_t instancing; //Non-zero loads every mesh and instance of a glTF scene, rather than the micro-mesh of the file
+    uint32_t traversal; //MMQ_TRAVERSAL_*
+    uint32_t vertex_order; //MMQ_ORDER_*
+    uint32_t thread_count; //Threads that bake the meshes and trace every query, 0 uses every hardware thread
+    uint32_t packets; //Non-zero traces the rays in packets of 8 consecutive rays, which pays for coherent rays
+} mmq_scene_options;
+
+//One element per ray. The directions do not have to be normalized, t is measured in multiples of them.
+typedef struct mmq_rays {
+    uint64_t count;
+    const float* origin_x;
+    const float* origin_y;
+    const float* origin_z;
+    const float* direction_x;
+    const float* direction_y;
+    const float* direction_z;
+    const float* t_min; //NULL for 0
+    const float* t_max; //NULL for no limit
+} mmq_rays;
+
+//One element per ray, arrays that are NULL are not written
+typedef struct mmq_hits {
+    float* t; //Infinity for a miss
+    uint32_t* base_triangle;
+    //x * x + 2 * y for the upright micro-triangle (x, y) (x + 1, y) (x + 1, y + 1) of the grid of micro-vertex
+    //coordinates of its base triangle, and x * x + 2 * y + 1 for the upside down one (x, y) (x + 1, y + 1) (x, y + 1)
+    uint32_t* micro_triangle;
+    float* u; //Barycentrics of the hit in the micro-triangle, the weights of its second and third vertex in the order above
+    float* v;
+    uint32_t* instance; //0 without instancing
+} mmq_hits;
+
+typedef struct mmq_stats {
+    uint64_t rays;
+    uint64_t hits;
+    double seconds;
+    double rays_per_second;
+} mmq_stats;
+
+//Returns (MMQ_VERSION_MAJOR << 16) | MMQ_VERSION_MINOR of the library
+MMQ_API uint32_t mmq_version(void);
+
+//The default options: no instancing, automatic traversal, row-major order, every hardware thread and packets
+MMQ_API mmq_scene_options mmq_default_scene_options(void);
+
+//Loads and bakes the micro-mesh or glTF scene of a file. options may be NULL for the defaults. Returns NULL on failure.
+MMQ_API mmq_scene* mmq_load_scene(const char* path, const mmq_scene_options* options);
+
+MMQ_API void mmq_destroy_scene(mmq_scene* scene);
+
+//The bounds of the scene, empty (min > max) if it has nothing in it
+MMQ_API int32_t mmq_scene_bounds(const mmq_scene* scene, float min[3], float max[3]);
+
+//Finds the closest hit of every ray. stats may be NULL.
+MMQ_API int32_t mmq_trace_rays(const mmq_scene* scene, const mmq_rays* rays, const mmq_hits* hits, mmq_stats* stats);
+
+//Describes the last error on the calling thread, "" if there was none. Valid until the next call on this thread.
+MMQ_API const char* mmq_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,33 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "AABBBuilder.h"
+#include "TestUtils.h"
+
+//Bitwise, like the GPU would receive them
+static size_t mismatches(const std::vector<AABB>& a, const std::vector<AABB>& b) {
+    if(a.size() != b.size()) return std::max(a.size(), b.size());
+
+    size_t count = 0;
+    for(size_t i = 0; i < a.size(); i++) count += std::memcmp(&a[i], &b[i], sizeof(AABB)) != 0;
+    return count;
+}
+
+TEST_CASE("The parallel SIMD AABB builder gives the bits of the scalar one") {
+    //More base triangles than fit in one chunk, with mixed subdivision levels, so the threads share the work unevenly
+    const Mesh mesh = gridMesh(24, 3, 1);
+    REQUIRE(mesh.triangles.size() > AABBBuilder::CHUNK_SIZE);
+    const std::vector<AABB> reference = AABBBuilder::buildScalar(mesh);
+
+    for(const unsigned int threadCount : {1u, 3u, 8u}) {
+        INFO(threadCount << " threads, " << AABBBuilder::instructionSet());
+        CHECK(mismatches(AABBBuilder::build(mesh, threadCount), reference) == 0);
+    }
+
+    std::vector<AABB> single;
+    for(const Triangle& triangle : mesh.triangles) single.push_back(AABBBuilder::build(triangle));
+    CHECK(mismatches(single, reference) == 0);
+}
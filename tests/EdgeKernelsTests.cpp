@@ -0,0 +1,127 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <cmath>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "EdgeKernels.h"
+#include "TestUtils.h"
+
+//Four child triangles, how far to expand them and a 2D ray
+struct EdgeCase {
+    EdgeKernels::ChildTriangles triangles;
+    float deltas[EdgeKernels::CHILDREN];
+    glm::vec2 origin, direction;
+};
+
+//Subdivided triangles like the traversal produces, plus rays that start both inside and outside of them
+static std::vector<EdgeCase> randomCases(const int count) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> delta(0.0f, 0.1f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+    std::vector<EdgeCase> cases(count);
+    for(EdgeCase& c : cases) {
+        const glm::vec2 v0(position(rng), position(rng)), v1(position(rng), position(rng)), v2(position(rng), position(rng));
+        const glm::vec2 uv0 = 0.5f * (v0 + v1), uv1 = 0.5f * (v1 + v2), uv2 = 0.5f * (v2 + v0);
+        const glm::vec2 children[4][3] = {{v0, uv0, uv2}, {uv0, v1, uv1}, {uv2, uv1, v2}, {uv0, uv1, uv2}};
+
+        for(int child = 0; child < EdgeKernels::CHILDREN; child++) {
+            for(int vertex = 0; vertex < 3; vertex++) c.triangles.set(child, vertex, children[child][vertex]);
+            c.deltas[child] = delta(rng);
+        }
+
+        c.origin = 2.0f * glm::vec2(position(rng), position(rng));
+        const float a = angle(rng);
+        c.direction = glm::vec2(std::cos(a), std::sin(a));
+    }
+
+    return cases;
+}
+
+static bool sameHits(const EdgeKernels::ChildHits& a, const EdgeKernels::ChildHits& b) {
+    if(a.mask != b.mask) return false;
+
+    for(int i = 0; i < EdgeKernels::CHILDREN; i++) {
+        if(!sameBits(a.entryT[i], b.entryT[i]) || !sameBits(a.exitT[i], b.exitT[i])) return false;
+    }
+
+    return true;
+}
+
+static bool sameTriangles(const EdgeKernels::ChildTriangles& a, const EdgeKernels::ChildTriangles& b) {
+    for(int child = 0; child < EdgeKernels::CHILDREN; child++) {
+        for(int vertex = 0; vertex < 3; vertex++) {
+            if(!sameBits(a.x[vertex][child], b.x[vertex][child]) || !sameBits(a.y[vertex][child], b.y[vertex][child])) return false;
+        }
+    }
+
+    return true;
+}
+
+using Intersect = EdgeKernels::ChildHits (*)(const EdgeKernels::ChildTriangles&, const glm::vec2&, const glm::vec2&, unsigned int);
+using Expand = void (*)(EdgeKernels::ChildTriangles&, const float (&)[EdgeKernels::CHILDREN]);
+
+TEST_CASE("Every SIMD edge expansion gives the bits of the scalar one") {
+    std::vector<std::pair<std::string, Expand>> kernels{{"widest", &EdgeKernels::expandChildren}};
+#if defined(EDGE_KERNELS_SSE)
+    kernels.emplace_back("SSE2", &EdgeKernels::expandChildrenSSE);
+#endif
+#if defined(EDGE_KERNELS_NEON)
+    kernels.emplace_back("NEON", &EdgeKernels::expandChildrenNEON);
+#endif
+
+    const std::vector<EdgeCase> cases = randomCases(1 << 14);
+    for(const auto& [name, expand] : kernels) {
+        int mismatches = 0;
+        for(const EdgeCase& c : cases) {
+            EdgeKernels::ChildTriangles expected = c.triangles, expanded = c.triangles;
+            EdgeKernels::expandChildrenScalar(expected, c.deltas);
+            expand(expanded, c.deltas);
+            mismatches += !sameTriangles(expanded, expected);
+        }
+
+        INFO(name);
+        CHECK(mismatches == 0);
+    }
+}
+
+TEST_CASE("Every SIMD edge intersection gives the bits of the scalar one") {
+    std::vector<std::pair<std::string, Intersect>> kernels{{"widest", &EdgeKernels::intersectChildren}};
+#if defined(EDGE_KERNELS_SSE)
+    kernels.emplace_back("SSE2", &EdgeKernels::intersectChildrenSSE);
+#endif
+#if defined(EDGE_KERNELS_AVX2)
+    kernels.emplace_back("AVX2", &EdgeKernels::intersectChildrenAVX2);
+#endif
+#if defined(EDGE_KERNELS_NEON)
+    kernels.emplace_back("NEON", &EdgeKernels::intersectChildrenNEON);
+#endif
+
+    //Against the triangles as they are and expanded, with every child and with only some of them active
+    const std::vector<EdgeCase> cases = randomCases(1 << 14);
+    for(const auto& [name, intersect] : kernels) {
+        int mismatches = 0;
+        for(const EdgeCase& c : cases) {
+            EdgeKernels::ChildTriangles expanded = c.triangles;
+            EdgeKernels::expandChildrenScalar(expanded, c.deltas);
+
+            for(const EdgeKernels::ChildTriangles& triangles : {c.triangles, expanded}) {
+                for(const unsigned int activeMask : {0xFu, 0x5u}) {
+                    mismatches += !sameHits(intersect(triangles, c.origin, c.direction, activeMask),
+                                            EdgeKernels::intersectChildrenScalar(triangles, c.origin, c.direction, activeMask));
+                }
+            }
+        }
+
+        INFO(name);
+        CHECK(mismatches == 0);
+    }
+}
@@ -0,0 +1,84 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <random>
+#include <vector>
+
+#include "BakedMesh.h"
+#include "TestUtils.h"
+
+//Scales the displacement of a micro-vertex along its interpolated direction, as an editor brush does
+static void scaleDisplacement(Mesh& mesh, const unsigned int triangle, const unsigned int microVertex, const float factor) {
+    const Triangle& t = mesh.triangles[triangle];
+    const Vertex& v0 = mesh.vertices[t.baseVertexIndices.x];
+    const Vertex& v1 = mesh.vertices[t.baseVertexIndices.y];
+    const Vertex& v2 = mesh.vertices[t.baseVertexIndices.z];
+
+    const glm::vec3 bc = Triangle::computeBaryCoords(v0.position, v1.position, v2.position, t.uVertices[microVertex].position);
+    const glm::vec3 direction = bc.x * v0.direction + bc.y * v1.direction + bc.z * v2.direction;
+    mesh.setDisplacement(triangle, microVertex, factor * mesh.displacementScale(t, t.uVertices[microVertex]) * direction);
+}
+
+//The micro-vertex of a base triangle that is displaced the highest (it spans the AABB) or the farthest along the plane (it sets the tangential displacement)
+static unsigned int extremeMicroVertex(const Mesh& mesh, const unsigned int triangle, const bool tangential) {
+    const Triangle& t = mesh.triangles[triangle];
+
+    unsigned int extreme = 0;
+    float farthest = -1.0f;
+    for(unsigned int v = 0; v < t.uVertices.size(); v++) {
+        const glm::vec3& displacement = t.uVertices[v].displacement;
+        const float distance = tangential ? glm::length(glm::vec2(displacement)) : t.uVertices[v].position.z + displacement.z;
+        if(distance > farthest) {
+            farthest = distance;
+            extreme = v;
+        }
+    }
+
+    return extreme;
+}
+
+TEST_CASE("Incremental updates after edits give the bits of a full bake") {
+    for(const int coarseLevel : {-1, 0}) {
+        Mesh mesh = gridMesh(4, 3, coarseLevel);
+        BakedMesh baked = BakedMesh::bake(mesh);
+        TriangleHierarchies hierarchies;
+        std::mt19937 rng(5);
+
+        const auto applyAndCompare = [&] {
+            const BakedMeshUpdate update = baked.applyEdits(mesh, mesh.dirtyMicroVertices(), hierarchies);
+            CHECK(update.triangles.size() > 0);
+            mesh.clearDirty();
+            CHECK(bakedMismatches(baked, BakedMesh::bake(mesh)) == 0);
+        };
+
+        INFO((coarseLevel < 0 ? "uniform" : "mixed") << " subdivision levels");
+
+        //Micro-vertices that span the AABB and set the tangential displacement move inwards, so those can only be found
+        //again from all micro-vertices
+        const unsigned int shrunk[] = {0, 5, 13};
+        std::vector<AABB> before;
+        for(const unsigned int triangle : shrunk) {
+            before.push_back(baked.AABBs[triangle]);
+            scaleDisplacement(mesh, triangle, extremeMicroVertex(mesh, triangle, false), 0.25f);
+            scaleDisplacement(mesh, triangle, extremeMicroVertex(mesh, triangle, true), 0.25f);
+        }
+        applyAndCompare();
+        for(size_t i = 0; i < before.size(); i++) CHECK(baked.AABBs[shrunk[i]].maxPos.z < before[i].maxPos.z);
+
+        //Rounds of random edits outwards and inwards, partly of base triangles whose hierarchies were computed before
+        std::uniform_real_distribution<float> factor(0.5f, 1.5f);
+        for(const int editsPerRound : {1, 8, 64}) {
+            for(int i = 0; i < editsPerRound; i++) {
+                const auto triangle = std::uniform_int_distribution<unsigned int>(0, static_cast<unsigned int>(mesh.triangles.size()) - 1)(rng);
+                const auto microVertex = std::uniform_int_distribution<unsigned int>(0, static_cast<unsigned int>(mesh.triangles[triangle].uVertices.size()) - 1)(rng);
+                scaleDisplacement(mesh, triangle, microVertex, factor(rng));
+            }
+
+            INFO(editsPerRound << " edits");
+            applyAndCompare();
+        }
+    }
+}
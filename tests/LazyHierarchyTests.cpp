@@ -0,0 +1,48 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BakedMesh.h"
+#include "LazyHierarchy.h"
+#include "TestUtils.h"
+
+TEST_CASE("Lazily built records give the bits of a full bake") {
+    const auto mesh = std::make_shared<const Mesh>(gridMesh(6, 3, 1));
+    const BakedMesh expected = BakedMesh::bake(*mesh);
+
+    SECTION("Built on one thread") {
+        BakedMesh baked = BakedMesh::bakeLazily(*mesh);
+        const LazyHierarchy lazy(mesh, baked);
+        CHECK(lazy.builtCount() == 0);
+
+        lazy.buildAll();
+        CHECK(lazy.builtCount() == mesh->triangles.size());
+        CHECK(bakedMismatches(baked, expected) == 0);
+    }
+
+    SECTION("Built by threads that reach the same base triangles at once") {
+        for(const unsigned int threadCount : {2u, 4u, 8u}) {
+            BakedMesh baked = BakedMesh::bakeLazily(*mesh);
+            const LazyHierarchy lazy(mesh, baked);
+
+            //Half of the threads go forwards and half backwards, so that they claim and wait for each other's triangles
+            std::vector<std::thread> threads;
+            for(unsigned int t = 0; t < threadCount; t++) {
+                threads.emplace_back([&, t] {
+                    if(t % 2 == 0) {
+                        lazy.buildAll();
+                        return;
+                    }
+                    for(auto i = static_cast<unsigned int>(mesh->triangles.size()); i-- > 0;) lazy.ensureBuilt(i);
+                });
+            }
+            for(std::thread& thread : threads) thread.join();
+
+            INFO(threadCount << " threads");
+            CHECK(lazy.builtCount() == mesh->triangles.size());
+            CHECK(bakedMismatches(baked, expected) == 0);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "BakedMesh.h"
+#include "PagedBlocks.h"
+#include "TestUtils.h"
+
+//The number of values in which the block of a base triangle differs from that of a mesh in memory, bit by bit
+static size_t blockMismatches(const BakedMesh& paged, const BakedMesh& expected, const unsigned int primitiveIndex) {
+    const TriangleData& td = expected.triangleData[primitiveIndex];
+    const TriangleBlock a = paged.block(primitiveIndex);
+    const TriangleBlock b = expected.block(primitiveIndex);
+    const size_t scaleCount = static_cast<size_t>(td.nRows) * static_cast<size_t>(td.nRows + 1) / 2;
+    const size_t recordCount = BakedMesh::hierarchyRecordCount(td);
+
+    size_t count = 0;
+    for(size_t i = 0; i < scaleCount; i++) count += !sameBits(a.displacementScales[i], b.displacementScales[i]);
+    for(size_t i = 0; i < recordCount; i++) {
+        count += std::memcmp(&a.minMaxDisplacements[i], &b.minMaxDisplacements[i], sizeof(glm::vec2)) != 0 || !sameBits(a.deltas[i], b.deltas[i]);
+    }
+    return count + ((a.vertexOrder == nullptr) != (b.vertexOrder == nullptr));
+}
+
+TEST_CASE("Paged blocks give the bits of a bake in memory while the cache evicts them") {
+    const Mesh mesh = gridMesh(6, 3, 1);
+    const std::filesystem::path file = std::filesystem::temp_directory_path() / ("cpu_rt_tests_" + std::to_string(std::random_device{}()) + ".pages");
+
+    for(const VertexOrder order : {VertexOrder::ROW_MAJOR, VertexOrder::BIRD_CURVE}) {
+        const BakedMesh expected = BakedMesh::bake(mesh, order);
+        PagedBlocks::bake(mesh, file, order);
+
+        {
+            //Too small for more than one block per shard
+            const BakedMesh paged = PagedBlocks::open(file, 1);
+            REQUIRE(paged.pages);
+            CHECK(paged.displacementScales.empty());
+            CHECK((differentValues(paged.vertices, expected.vertices) + differentValues(paged.AABBs, expected.AABBs)
+                + differentValues(paged.tangentialDisplacements, expected.tangentialDisplacements)) == 0);
+            //Without hierarchy records in memory, the blocks have no offsets into them
+            size_t differentTriangles = paged.triangleData.size() != expected.triangleData.size();
+            for(size_t i = 0; i < std::min(paged.triangleData.size(), expected.triangleData.size()); i++) {
+                const TriangleData& a = paged.triangleData[i];
+                const TriangleData& b = expected.triangleData[i];
+                differentTriangles += a.vIndices != b.vIndices || a.nRows != b.nRows || a.subDivisionLevel != b.subDivisionLevel || a.displacementOffset != b.displacementOffset;
+            }
+            CHECK(differentTriangles == 0);
+            CHECK(paged.vertexOrder == order);
+
+            //Forwards and backwards, so that every block is read again after it was evicted
+            size_t mismatches = 0;
+            const auto count = static_cast<unsigned int>(mesh.triangles.size());
+            for(unsigned int i = 0; i < count; i++) mismatches += blockMismatches(paged, expected, i);
+            for(unsigned int i = count; i-- > 0;) mismatches += blockMismatches(paged, expected, i);
+
+            INFO((order == VertexOrder::ROW_MAJOR ? "row-major" : "bird-curve") << " order");
+            CHECK(mismatches == 0);
+            CHECK(paged.pages->stats().evictions > 0);
+            CHECK(paged.pages->stats().residentBlocks <= PagedBlocks::SHARD_COUNT);
+        }
+        std::filesystem::remove(file);
+    }
+}
+
+TEST_CASE("A paged file whose header counts do not fit into it is rejected") {
+    const Mesh mesh = gridMesh(2, 2);
+    const std::filesystem::path file = std::filesystem::temp_directory_path() / ("cpu_rt_tests_" + std::to_string(std::random_device{}()) + ".pages");
+
+    //The counts are checked before anything is allocated, so this is no failed allocation. The vertex and triangle counts
+    //follow the magic and four 32-bit fields of the header.
+    for(const std::streamoff countOffset : {24, 32}) {
+        PagedBlocks::bake(mesh, file, VertexOrder::ROW_MAJOR);
+        {
+            std::fstream out(file, std::ios::binary | std::ios::in | std::ios::out);
+            const std::uint64_t count = std::uint64_t(1) << 40;
+            out.seekp(countOffset);
+            out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        }
+
+        INFO((countOffset == 24 ? "vertex" : "triangle") << " count");
+        CHECK_THROWS_AS(PagedBlocks::open(file, 1 << 20), std::runtime_error);
+    }
+    std::filesystem::remove(file);
+}
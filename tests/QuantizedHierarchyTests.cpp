@@ -0,0 +1,84 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+#include "BakedMesh.h"
+#include "CPUScene.h"
+#include "TestUtils.h"
+
+TEST_CASE("Decoded quantized bounds contain the exact ones") {
+    Mesh mesh = gridMesh(4, 4, 2);
+    flattenLeftOf(mesh, 0.1f);
+    const BakedMesh full = BakedMesh::bake(mesh);
+    BakedMesh quantized = full;
+    quantized.quantizeHierarchy();
+    REQUIRE(quantized.hasQuantizedHierarchy());
+    REQUIRE(quantized.minMaxDisplacements.empty());
+
+    size_t notContained = 0, flatParents = 0;
+    std::vector<glm::vec2> decoded;
+    for(size_t i = 0; i < full.triangleData.size(); i++) {
+        const TriangleData& td = full.triangleData[i];
+        const size_t count = BakedMesh::hierarchyRecordCount(td);
+        if(count == 0) continue;
+
+        const glm::vec2* exactMinMax = full.minMaxDisplacements.data() + td.minMaxOffset;
+        const float* exactDeltas = full.deltas.data() + td.minMaxOffset;
+        const QuantizedBounds* records = quantized.quantizedBounds.data() + td.minMaxOffset;
+        const HierarchyRange& range = quantized.hierarchyRanges[i];
+        CHECK((sameBits(range.rootMinMax.x, exactMinMax[0].x) && sameBits(range.rootMinMax.y, exactMinMax[0].y)));
+
+        for(size_t r = 0; r < count; r++) notContained += dequantize(0.0f, range.maxDelta, records[r].delta) < exactDeltas[r];
+
+        //Level by level, every child decoded from the decoded bounds of its parent, as the traversal does
+        decoded.assign(count, glm::vec2(0.0f));
+        decoded[0] = range.rootMinMax;
+        for(int level = 0; level + 1 < td.subDivisionLevel; level++) {
+            const size_t levelBegin = ((size_t(1) << (2 * level)) - 1) / 3;
+            const size_t childBegin = ((size_t(1) << (2 * (level + 1))) - 1) / 3;
+
+            for(size_t local = 0; local < (size_t(1) << (2 * level)); local++) {
+                const glm::vec2& parent = decoded[levelBegin + local];
+                flatParents += parent.x == parent.y;
+
+                for(size_t c = 0; c < 4; c++) {
+                    const size_t child = childBegin + 4 * local + c;
+                    decoded[child] = dequantizeMinMax(parent, records[child]);
+                    notContained += decoded[child].x > exactMinMax[child].x || decoded[child].y < exactMinMax[child].y;
+                }
+            }
+        }
+    }
+
+    CHECK(notContained == 0);
+    //The flat region has parents without extent, whose children must decode to the same single value
+    CHECK(flatParents > 0);
+}
+
+TEST_CASE("A quantized hierarchy loses no hit") {
+    Mesh mesh = gridMesh(4, 4, 2);
+    flattenLeftOf(mesh, 0.1f);
+    BakedMesh quantized = BakedMesh::bake(mesh);
+    quantized.quantizeHierarchy();
+
+    const CPUScene fullScene(BakedMesh::bake(mesh), CPUScene::TraversalMode::HIERARCHY);
+    const CPUScene quantizedScene(std::move(quantized), CPUScene::TraversalMode::HIERARCHY);
+    const std::vector<RayDesc> rays = downwardRays(fullScene.bounds(), 4096);
+    const std::vector<HitInfo> fullHits = traceAll(fullScene, rays);
+    const std::vector<HitInfo> quantizedHits = traceAll(quantizedScene, rays);
+
+    //Looser bounds only cost tests, the micro-triangles and so the hits are the same
+    size_t hits = 0, lostHits = 0, differentHits = 0;
+    for(size_t i = 0; i < rays.size(); i++) {
+        if(fullHits[i].primitiveIndex == static_cast<unsigned int>(-1)) continue;
+
+        hits++;
+        lostHits += quantizedHits[i].primitiveIndex == static_cast<unsigned int>(-1);
+        differentHits += quantizedHits[i].primitiveIndex != fullHits[i].primitiveIndex || quantizedHits[i].microTriangleIndex != fullHits[i].microTriangleIndex
+            || !sameBits(quantizedHits[i].t, fullHits[i].t);
+    }
+
+    REQUIRE(hits > rays.size() / 2);
+    CHECK(lostHits == 0);
+    CHECK(differentHits == 0);
+}
@@ -0,0 +1,160 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <array>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "BakedMesh.h"
+#include "CPUScene.h"
+#include "MicroMeshTraversal.h"
+#include "RayQuery.h"
+#include "TestUtils.h"
+
+//Rays of a query, stored as RayArrays wants them
+struct QueryRays {
+    std::vector<float> originX, originY, originZ, directionX, directionY, directionZ, tMin, tMax;
+
+    void push(const glm::vec3& origin, const glm::vec3& direction, const float rayTMin, const float rayTMax) {
+        originX.push_back(origin.x);
+        originY.push_back(origin.y);
+        originZ.push_back(origin.z);
+        directionX.push_back(direction.x);
+        directionY.push_back(direction.y);
+        directionZ.push_back(direction.z);
+        tMin.push_back(rayTMin);
+        tMax.push_back(rayTMax);
+    }
+
+    [[nodiscard]] size_t size() const {
+        return originX.size();
+    }
+
+    [[nodiscard]] RayArrays arrays() const {
+        return {size(), originX.data(), originY.data(), originZ.data(), directionX.data(), directionY.data(), directionZ.data(), tMin.data(), tMax.data()};
+    }
+};
+
+//Hits of a query, stored as HitArrays wants them
+struct QueryHits {
+    std::vector<float> t, u, v;
+    std::vector<uint32_t> baseTriangle, microTriangle;
+
+    explicit QueryHits(const size_t count): t(count), u(count), v(count), baseTriangle(count), microTriangle(count) {}
+
+    [[nodiscard]] HitArrays arrays() {
+        return {t.data(), baseTriangle.data(), microTriangle.data(), u.data(), v.data(), nullptr};
+    }
+};
+
+//Rays down onto the mesh from random points above it, and segments between random points of its bounds
+static QueryRays randomRays(const AABB& bounds, const size_t count) {
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> along(0.0f, 1.0f);
+    const auto randomPoint = [&] { return bounds.minPos + glm::vec3(along(rng), along(rng), along(rng)) * (bounds.maxPos - bounds.minPos); };
+
+    QueryRays rays;
+    for(size_t i = 0; i < count / 2; i++) {
+        const glm::vec3 target = randomPoint();
+        const glm::vec3 origin = target + glm::vec3(0.3f * (along(rng) - 0.5f), 0.3f * (along(rng) - 0.5f), 2.0f);
+        rays.push(origin, glm::normalize(target - origin), 0.001f, 10000.0f);
+    }
+    while(rays.size() < count) {
+        const glm::vec3 from = randomPoint();
+        rays.push(from, randomPoint() - from, 0.0f, 1.0f);
+    }
+
+    return rays;
+}
+
+//The micro-triangles of a base triangle indexed like HitInfo::microTriangleIndex, with their vertices in its order
+static std::vector<std::array<glm::vec3, 3>> indexedMicroTriangles(const BakedMesh& mesh, const unsigned int primitiveIndex) {
+    std::vector<std::array<glm::vec3, 3>> triangles;
+    for(const MicroTriangle& triangle : tessellateMicroMeshTriangle(mesh, primitiveIndex)) {
+        const glm::uvec2 c[3] = {triangle.coordinates[0], triangle.coordinates[1], triangle.coordinates[2]};
+        const glm::uvec2 low = glm::min(glm::min(c[0], c[1]), c[2]);
+        const bool upsideDown = (c[0].x == low.x) + (c[1].x == low.x) + (c[2].x == low.x) == 2;
+        const glm::uvec2 corners[3] = {low, low + glm::uvec2(1, upsideDown ? 1 : 0), low + glm::uvec2(upsideDown ? 0 : 1, 1)};
+
+        const unsigned int index = low.x * low.x + 2 * low.y + (upsideDown ? 1 : 0);
+        if(index >= triangles.size()) triangles.resize(index + 1);
+        for(int corner = 0; corner < 3; corner++) {
+            for(int i = 0; i < 3; i++) {
+                if(c[i] == corners[corner]) triangles[index][corner] = triangle.vertices[i];
+            }
+        }
+    }
+
+    return triangles;
+}
+
+TEST_CASE("Every hit of a query lies where its micro-triangle and barycentrics put it") {
+    const BakedMesh mesh = BakedMesh::bake(gridMesh(4, 3));
+    const CPUScene hierarchy(mesh, CPUScene::TraversalMode::HIERARCHY);
+    const CPUScene grid(mesh, CPUScene::TraversalMode::GRID);
+    const CPUScene tessellated(mesh, CPUScene::TraversalMode::HIERARCHY, false, mesh.maxSubdivisionLevel + 1);
+    const std::pair<const char*, const CPUScene*> scenes[] = {{"hierarchy", &hierarchy}, {"grid", &grid}, {"tessellated", &tessellated}};
+
+    const AABB bounds = hierarchy.bounds();
+    const QueryRays rays = randomRays(bounds, 4096);
+    const float tolerance = 1e-4f * glm::length(bounds.maxPos - bounds.minPos);
+
+    std::map<unsigned int, std::vector<std::array<glm::vec3, 3>>> microTriangles;
+    for(const auto& [name, scene] : scenes) {
+        for(const bool packets : {false, true}) {
+            QueryHits hits(rays.size());
+            const QueryStats stats = RayQuery(*scene, 1, packets).trace(rays.arrays(), hits.arrays());
+            REQUIRE(stats.traversal.hits > 0);
+
+            size_t inconsistent = 0;
+            for(size_t i = 0; i < rays.size(); i++) {
+                if(hits.baseTriangle[i] == RayQuery::MISS) continue;
+
+                auto it = microTriangles.find(hits.baseTriangle[i]);
+                if(it == microTriangles.end()) it = microTriangles.emplace(hits.baseTriangle[i], indexedMicroTriangles(mesh, hits.baseTriangle[i])).first;
+                if(hits.microTriangle[i] >= it->second.size()) {
+                    inconsistent++;
+                    continue;
+                }
+
+                const std::array<glm::vec3, 3>& v = it->second[hits.microTriangle[i]];
+                const glm::vec3 expected = v[0] + hits.u[i] * (v[1] - v[0]) + hits.v[i] * (v[2] - v[0]);
+                const glm::vec3 point = glm::vec3(rays.originX[i], rays.originY[i], rays.originZ[i]) + hits.t[i] * glm::vec3(rays.directionX[i], rays.directionY[i], rays.directionZ[i]);
+                inconsistent += glm::length(point - expected) > tolerance;
+            }
+
+            INFO(name << (packets ? " with packets" : " with single rays"));
+            CHECK(inconsistent == 0);
+        }
+    }
+}
+
+TEST_CASE("A query gives the bits of one thread on every number of threads") {
+    const CPUScene scene(BakedMesh::bake(gridMesh(4, 3)));
+    //Several chunks per thread, and a last packet that is not full
+    const QueryRays rays = randomRays(scene.bounds(), 8 * RayQuery::CHUNK_SIZE + 3);
+
+    for(const bool packets : {false, true}) {
+        QueryHits oneThread(rays.size());
+        (void)RayQuery(scene, 1, packets).trace(rays.arrays(), oneThread.arrays());
+
+        for(const unsigned int threadCount : {2u, 4u, 7u}) {
+            QueryHits hits(rays.size());
+            (void)RayQuery(scene, threadCount, packets).trace(rays.arrays(), hits.arrays());
+
+            size_t mismatches = 0;
+            for(size_t i = 0; i < rays.size(); i++) {
+                mismatches += !sameBits(hits.t[i], oneThread.t[i]) || hits.baseTriangle[i] != oneThread.baseTriangle[i] || hits.microTriangle[i] != oneThread.microTriangle[i]
+                    || !sameBits(hits.u[i], oneThread.u[i]) || !sameBits(hits.v[i], oneThread.v[i]);
+            }
+
+            INFO(threadCount << " threads" << (packets ? " with packets" : ""));
+            CHECK(mismatches == 0);
+        }
+    }
+}
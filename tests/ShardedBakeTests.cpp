@@ -0,0 +1,80 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BakedMesh.h"
+#include "ShardedBake.h"
+#include "TestUtils.h"
+
+TEST_CASE("Shards merged in any order give the bits of a single bake") {
+    const Mesh mesh = gridMesh(6, 3, 1);
+    const ShardedBake::Range all{0, static_cast<unsigned int>(mesh.triangles.size())};
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / ("cpu_rt_tests_shards_" + std::to_string(std::random_device{}()));
+    std::filesystem::create_directories(directory);
+
+    for(const VertexOrder order : {VertexOrder::ROW_MAJOR, VertexOrder::BIRD_CURVE}) {
+        const BakedMesh expected = BakedMesh::bake(mesh, order);
+
+        for(const unsigned int shardCount : {1u, 2u, 7u, 32u}) {
+            //Every shard through a file, as if another process baked it, and merged in reverse
+            const std::vector<ShardedBake::Range> ranges = ShardedBake::split(mesh, all, shardCount);
+            std::vector<ShardedBake::Shard> shards;
+            for(size_t i = ranges.size(); i-- > 0;) {
+                const std::filesystem::path file = directory / (std::to_string(i) + ".shard");
+                ShardedBake::write(ShardedBake::bakeShard(mesh, ranges[i], order), file);
+                shards.push_back(ShardedBake::read(file));
+            }
+
+            INFO(ranges.size() << " shards in " << (order == VertexOrder::ROW_MAJOR ? "row-major" : "bird-curve") << " order");
+            CHECK(bakedMismatches(ShardedBake::merge(shards), expected) == 0);
+
+            //A missing shard leaves a gap
+            if(shards.size() > 1) {
+                shards.erase(shards.begin() + 1);
+                CHECK_THROWS(ShardedBake::merge(std::move(shards)));
+            }
+        }
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Baking in pieces on threads gives the bits of a single bake") {
+    const Mesh mesh = gridMesh(6, 3, 1);
+    const BakedMesh expected = BakedMesh::bake(mesh);
+
+    for(const unsigned int threadCount : {1u, 3u, 8u}) {
+        INFO(threadCount << " threads");
+        CHECK(bakedMismatches(ShardedBake::bake(mesh, VertexOrder::ROW_MAJOR, threadCount), expected) == 0);
+    }
+}
+
+TEST_CASE("A shard file whose header counts do not fit into it is rejected") {
+    const Mesh mesh = gridMesh(2, 2);
+    const std::filesystem::path file = std::filesystem::temp_directory_path() / ("cpu_rt_tests_" + std::to_string(std::random_device{}()) + ".shard");
+    const ShardedBake::Shard shard = ShardedBake::bakeShard(mesh, {0, static_cast<unsigned int>(mesh.triangles.size())}, VertexOrder::ROW_MAJOR);
+
+    //Where the triangle (32 bits), vertex, scale and record counts (64 bits) are in the header. The counts are checked
+    //before anything is allocated, so this is no failed allocation.
+    const std::pair<std::streamoff, size_t> counts[] = {{20, 4}, {32, 8}, {40, 8}, {48, 8}};
+    for(const auto& [offset, size] : counts) {
+        ShardedBake::write(shard, file);
+        {
+            std::fstream out(file, std::ios::binary | std::ios::in | std::ios::out);
+            const std::uint64_t count = size == 4 ? 0xFFFFFFFFu : std::uint64_t(1) << 40;
+            out.seekp(offset);
+            out.write(reinterpret_cast<const char*>(&count), static_cast<std::streamsize>(size));
+        }
+
+        INFO("Count at byte " << offset);
+        CHECK_THROWS_AS(ShardedBake::read(file), std::runtime_error);
+    }
+    std::filesystem::remove(file);
+}
@@ -0,0 +1,99 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/gtc/matrix_transform.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Skinning.h"
+
+static constexpr int JOINTS = 16;
+static constexpr float SEGMENT = 1.0f / JOINTS;
+
+//A tube along y around a chain of joints, like a limb. The vertices do not fill the last block, so its padding is skinned too.
+static Skinning::RestPose tube(const size_t vertexCount) {
+    std::vector<Vertex> vertices(vertexCount);
+    std::vector<glm::uvec4> joints(vertexCount);
+    std::vector<glm::vec4> weights(vertexCount);
+    for(size_t v = 0; v < vertexCount; v++) {
+        const float height = (static_cast<float>(v) + 0.5f) / static_cast<float>(vertexCount);
+        const float angle = 2.39996323f * static_cast<float>(v);
+        const glm::vec3 radial(std::cos(angle), 0.0f, std::sin(angle));
+        vertices[v] = {glm::vec3(0.0f, height, 0.0f) + 0.05f * radial, radial, 0.01f * glm::normalize(radial + glm::vec3(0.0f, 0.2f, 0.0f))};
+
+        //The 4 joints around its height, weighted by distance
+        const float segment = height / SEGMENT;
+        glm::vec4 w;
+        for(int influence = 0; influence < Skinning::INFLUENCES; influence++) {
+            const int joint = std::clamp(static_cast<int>(segment) - 1 + influence, 0, JOINTS - 1);
+            joints[v][influence] = static_cast<unsigned int>(joint);
+            w[influence] = std::max(0.0f, 2.0f - std::abs(segment - (static_cast<float>(joint) + 0.5f)));
+        }
+        weights[v] = w / (w.x + w.y + w.z + w.w);
+    }
+
+    return {vertices, joints, weights};
+}
+
+//Every joint bends the chain above it a little
+static std::vector<glm::mat4> bentJoints() {
+    std::vector<glm::mat4> matrices(JOINTS);
+    glm::mat4 world(1.0f);
+    for(int joint = 0; joint < JOINTS; joint++) {
+        world = glm::rotate(world * glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, joint == 0 ? 0.0f : SEGMENT, 0.0f)), 0.1f * std::sin(static_cast<float>(joint)),
+                            glm::vec3(0.0f, 0.0f, 1.0f));
+        matrices[joint] = world * glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -SEGMENT * static_cast<float>(joint), 0.0f));
+    }
+
+    return matrices;
+}
+
+TEST_CASE("Every SIMD skinning kernel gives the bits of the scalar one") {
+    std::vector<std::pair<std::string, Skinning::Kernel>> kernels;
+#if defined(EDGE_KERNELS_SSE)
+    kernels.emplace_back("SSE2", &Skinning::skinSSE);
+#endif
+#if defined(EDGE_KERNELS_AVX2)
+    kernels.emplace_back("AVX2", &Skinning::skinAVX2);
+#endif
+#if defined(EDGE_KERNELS_NEON)
+    kernels.emplace_back("NEON", &Skinning::skinNEON);
+#endif
+
+    const Skinning::RestPose rest = tube(100003);
+    const std::vector<glm::mat4> joints = bentJoints();
+    Skinning::VertexArrays reference;
+    Skinning::skin(&Skinning::skinScalar, rest, joints, reference, 1);
+
+    const auto mismatches = [&](const Skinning::VertexArrays& posed) {
+        if(posed.count != reference.count) return reference.count;
+
+        size_t count = 0;
+        for(size_t v = 0; v < reference.count; v++) {
+            const Vertex a = posed.get(v), b = reference.get(v);
+            count += std::memcmp(&a, &b, sizeof(Vertex)) != 0;
+        }
+        return count;
+    };
+
+    for(const auto& [name, kernel] : kernels) {
+        for(const unsigned int threadCount : {1u, 4u}) {
+            Skinning::VertexArrays posed;
+            Skinning::skin(kernel, rest, joints, posed, threadCount);
+
+            INFO(name << " on " << threadCount << " threads");
+            CHECK(mismatches(posed) == 0);
+        }
+    }
+
+    Skinning::VertexArrays posed;
+    Skinning::skin(rest, joints, posed, 3);
+    INFO(Skinning::instructionSet());
+    CHECK(mismatches(posed) == 0);
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "Socket.h"
+
+static std::filesystem::path temporarySocketPath() {
+    return std::filesystem::temp_directory_path() / ("cpu_rt_tests_" + std::to_string(std::random_device{}()) + ".sock");
+}
+
+TEST_CASE("Lines longer than the limit drop the connection") {
+    const std::string address = temporarySocketPath().string();
+    const Socket listener = Socket::listen(address);
+
+    std::thread client([&] {
+        const Socket connection = Socket::connect(address);
+        (void)connection.sendAll("short\r\n");
+        //Sending fails once the other side gives up on the line
+        const std::string chunk(1 << 20, 'x');
+        for(size_t sent = 0; sent <= Socket::MAX_LINE_BYTES + chunk.size() && connection.sendAll(chunk); sent += chunk.size()) {}
+    });
+
+    Socket connection = listener.accept();
+    std::string line;
+    REQUIRE(connection.readLine(line));
+    CHECK(line == "short");
+    CHECK_FALSE(connection.readLine(line));
+    connection = Socket();
+    client.join();
+
+    std::filesystem::remove(address);
+}
+
+TEST_CASE("Listening only replaces socket files") {
+    const std::filesystem::path path = temporarySocketPath();
+
+    //A socket file left behind
+    {
+        const Socket stale = Socket::listen(path.string());
+    }
+    REQUIRE(std::filesystem::exists(path));
+    CHECK(Socket::listen(path.string()).valid());
+
+#ifndef _WIN32
+    //A link to that socket stays where it is (links need extra privileges on Windows)
+    const std::filesystem::path link = temporarySocketPath();
+    std::filesystem::create_symlink(path, link);
+    CHECK_THROWS_AS(Socket::listen(link.string()), std::runtime_error);
+    CHECK(std::filesystem::is_symlink(std::filesystem::symlink_status(link)));
+    std::filesystem::remove(link);
+#endif
+    std::filesystem::remove(path);
+
+    //And so does a regular file
+    std::ofstream(path) << "not a socket";
+    CHECK_THROWS_AS(Socket::listen(path.string()), std::runtime_error);
+    CHECK(std::filesystem::is_regular_file(path));
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,118 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "BakedMesh.h"
+#include "CPUScene.h"
+#include "TestUtils.h"
+
+//Whether every micro-vertex of a base triangle is left of x (flat) or none is (curved)
+static bool allLeftOf(const Mesh& mesh, const unsigned int triangle, const float x, const bool left) {
+    for(const uVertex& microVertex : mesh.triangles[triangle].uVertices) {
+        if((microVertex.position.x < x) != left) return false;
+    }
+    return true;
+}
+
+TEST_CASE("A sparse hierarchy keeps the records of the dense one that are not below a flat leaf") {
+    //Level 5 has 341 records per base triangle, so that their bits span six words
+    Mesh mesh = gridMesh(4, 5);
+    flattenLeftOf(mesh, 0.1f);
+    const BakedMesh dense = BakedMesh::bake(mesh);
+    BakedMesh sparse = dense;
+    const size_t flatLeaves = sparse.collapseFlatSubtrees(0.0f);
+    REQUIRE(sparse.hasSparseHierarchy());
+
+    size_t records = 0, walkedFlatLeaves = 0, mismatches = 0, partlyFlatTriangles = 0;
+    for(unsigned int i = 0; i < dense.triangleData.size(); i++) {
+        const TriangleData& denseTd = dense.triangleData[i];
+        const TriangleData& sparseTd = sparse.triangleData[i];
+        const TriangleBlock block = sparse.block(i);
+        REQUIRE(block.interior != nullptr);
+
+        //Breadth first from the root, every record found through firstChildRecord must be the dense record at its path
+        struct Node {
+            int record, level;
+            unsigned int localIndex;
+        };
+        std::vector<Node> level{{0, 0, 0}};
+        size_t triangleRecords = 0, triangleFlatLeaves = 0;
+        while(!level.empty()) {
+            std::vector<Node> next;
+            for(const Node& node : level) {
+                const size_t denseRecord = denseTd.minMaxOffset + ((size_t(1) << (2 * node.level)) - 1) / 3 + node.localIndex;
+                const size_t sparseRecord = sparseTd.minMaxOffset + static_cast<size_t>(node.record);
+                mismatches += !sameBits(sparse.minMaxDisplacements[sparseRecord].x, dense.minMaxDisplacements[denseRecord].x)
+                    || !sameBits(sparse.minMaxDisplacements[sparseRecord].y, dense.minMaxDisplacements[denseRecord].y)
+                    || !sameBits(sparse.deltas[sparseRecord], dense.deltas[denseRecord]);
+                triangleRecords++;
+
+                if(node.level + 1 < denseTd.subDivisionLevel && hasChildren(block.interior, node.record)) {
+                    const int firstChild = firstChildRecord(block.interior, node.record);
+                    for(int c = 0; c < 4; c++) next.push_back({firstChild + c, node.level + 1, 4 * node.localIndex + static_cast<unsigned int>(c)});
+                } else if(!hasChildren(block.interior, node.record)) {
+                    //Only the flat region has exactly flat subtrees
+                    mismatches += dense.minMaxDisplacements[denseRecord] != glm::vec2(0.0f);
+                    triangleFlatLeaves++;
+                }
+            }
+            level = std::move(next);
+        }
+
+        //The records of a base triangle are contiguous, the next one starts right after them
+        if(i + 1 < dense.triangleData.size()) CHECK(static_cast<size_t>(sparse.triangleData[i + 1].minMaxOffset - sparseTd.minMaxOffset) == triangleRecords);
+
+        INFO("Base triangle " << i);
+        if(allLeftOf(mesh, i, 0.1f, true)) CHECK(triangleRecords == 1);
+        else if(allLeftOf(mesh, i, 0.1f, false)) CHECK(triangleRecords == BakedMesh::hierarchyRecordCount(denseTd));
+        else partlyFlatTriangles += triangleFlatLeaves > 0 && triangleRecords > 1;
+
+        records += triangleRecords;
+        walkedFlatLeaves += triangleFlatLeaves;
+    }
+
+    CHECK(mismatches == 0);
+    CHECK(sparse.deltas.size() == records);
+    CHECK(records < dense.deltas.size());
+    CHECK(walkedFlatLeaves == flatLeaves);
+    //Base triangles across the flat region have flat leaves below the root
+    CHECK(partlyFlatTriangles > 0);
+}
+
+TEST_CASE("A sparse hierarchy at tolerance 0 finds the hits of the dense one") {
+    Mesh mesh = gridMesh(4, 5);
+    flattenLeftOf(mesh, 0.1f);
+    const CPUScene denseScene(BakedMesh::bake(mesh), CPUScene::TraversalMode::HIERARCHY);
+    const std::vector<RayDesc> rays = downwardRays(denseScene.bounds(), 4096);
+    const std::vector<HitInfo> denseHits = traceAll(denseScene, rays);
+
+    //With split AABBs, the BVH also starts the traversal at hierarchy triangles below flat leaves
+    for(const bool splitTriangles : {false, true}) {
+        BakedMesh sparse = BakedMesh::bake(mesh);
+        REQUIRE(sparse.collapseFlatSubtrees(0.0f) > 0);
+        const CPUScene sparseScene(std::move(sparse), CPUScene::TraversalMode::HIERARCHY, splitTriangles);
+        if(splitTriangles) REQUIRE(sparseScene.primitiveCount() > mesh.triangles.size());
+        const std::vector<HitInfo> sparseHits = traceAll(sparseScene, rays);
+
+        //A flat leaf lies in the plane of its micro-triangles, so the hits only differ by float rounding
+        size_t hits = 0, lostHits = 0, differentHits = 0;
+        for(size_t i = 0; i < rays.size(); i++) {
+            if(denseHits[i].primitiveIndex == static_cast<unsigned int>(-1)) continue;
+
+            hits++;
+            lostHits += sparseHits[i].primitiveIndex == static_cast<unsigned int>(-1);
+            differentHits += sparseHits[i].primitiveIndex != denseHits[i].primitiveIndex || std::abs(sparseHits[i].t - denseHits[i].t) > 1e-5f * denseHits[i].t;
+        }
+
+        INFO((splitTriangles ? "with" : "without") << " split AABBs");
+        REQUIRE(hits > rays.size() / 2);
+        CHECK(lostHits == 0);
+        CHECK(differentHits == 0);
+    }
+}
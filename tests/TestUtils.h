@@ -0,0 +1,134 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+#include <framework/mesh.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "BakedMesh.h"
+#include "CPUScene.h"
+
+//Bitwise comparison, so that differences in the sign of zero or in NaNs are caught as well
+inline bool sameBits(const float a, const float b) {
+    return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+//The number of values (or triangles, for the triangle data) in which two baked meshes differ, bit by bit
+template<typename T>
+inline size_t differentValues(const std::vector<T>& a, const std::vector<T>& b) {
+    if(a.size() != b.size()) return std::max(a.size(), b.size());
+
+    size_t count = 0;
+    for(size_t i = 0; i < a.size(); i++) count += std::memcmp(&a[i], &b[i], sizeof(T)) != 0;
+    return count;
+}
+
+inline size_t bakedMismatches(const BakedMesh& a, const BakedMesh& b) {
+    return differentValues(a.vertices, b.vertices) + differentValues(a.triangleData, b.triangleData) + differentValues(a.displacementScales, b.displacementScales)
+        + differentValues(a.minMaxDisplacements, b.minMaxDisplacements) + differentValues(a.deltas, b.deltas) + differentValues(a.AABBs, b.AABBs)
+        + differentValues(a.tangentialDisplacements, b.tangentialDisplacements) + (a.uniformSubdivisionLevel != b.uniformSubdivisionLevel)
+        + (a.maxSubdivisionLevel != b.maxSubdivisionLevel) + (a.vertexOrder != b.vertexOrder);
+}
+
+/**
+ * A micro-mesh on a grid of quads in the xy plane from (-1, -1) to (1, 1), every quad split into two base triangles,
+ * displaced along tilted directions by a smooth pattern of heights, like a loaded .gltf file.
+ *
+ * @param quadsPerSide the number of quads along x and along y
+ * @param subdivisionLevel the subdivision level of the base triangles
+ * @param coarseLevel if not negative, the subdivision level of every third base triangle, for meshes with mixed levels
+ */
+inline Mesh gridMesh(const int quadsPerSide, const int subdivisionLevel, const int coarseLevel = -1) {
+    const auto direction = [](const glm::vec3& p) { return glm::normalize(glm::vec3(0.1f * std::sin(3.0f * p.x), 0.1f * std::cos(2.0f * p.y), 1.0f)); };
+    const auto height = [](const glm::vec3& p) { return 0.1f * (0.5f + 0.5f * std::sin(7.0f * p.x) * std::cos(5.0f * p.y)); };
+
+    Mesh mesh;
+    for(int y = 0; y <= quadsPerSide; y++) {
+        for(int x = 0; x <= quadsPerSide; x++) {
+            const glm::vec3 position(2.0f * static_cast<float>(x) / static_cast<float>(quadsPerSide) - 1.0f, 2.0f * static_cast<float>(y) / static_cast<float>(quadsPerSide) - 1.0f, 0.0f);
+            mesh.vertices.push_back({position, glm::vec3(0.0f, 0.0f, 1.0f), direction(position)});
+        }
+    }
+
+    const auto index = [&](const int x, const int y) { return static_cast<unsigned int>(y * (quadsPerSide + 1) + x); };
+    for(int y = 0; y < quadsPerSide; y++) {
+        for(int x = 0; x < quadsPerSide; x++) {
+            for(const glm::uvec3& corners : {glm::uvec3(index(x, y), index(x + 1, y), index(x + 1, y + 1)), glm::uvec3(index(x, y), index(x + 1, y + 1), index(x, y + 1))}) {
+                const int level = coarseLevel >= 0 && mesh.triangles.size() % 3 == 0 ? coarseLevel : subdivisionLevel;
+                const int segments = 1 << level;
+                const Vertex& v0 = mesh.vertices[corners.x];
+                const Vertex& v1 = mesh.vertices[corners.y];
+                const Vertex& v2 = mesh.vertices[corners.z];
+
+                //Micro-vertices row by row from the first corner, as the loader stores them
+                Triangle triangle;
+                triangle.baseVertexIndices = corners;
+                for(int row = 0; row <= segments; row++) {
+                    for(int column = 0; column <= row; column++) {
+                        const float s = static_cast<float>(segments);
+                        const glm::vec3 barycentrics(static_cast<float>(segments - row) / s, static_cast<float>(row - column) / s, static_cast<float>(column) / s);
+                        const glm::vec3 position = barycentrics.x * v0.position + barycentrics.y * v1.position + barycentrics.z * v2.position;
+                        const glm::vec3 displacement = barycentrics.x * v0.direction + barycentrics.y * v1.direction + barycentrics.z * v2.direction;
+                        triangle.uVertices.push_back({position, height(position) * displacement, true});
+                    }
+                }
+
+                const auto microVertex = [](const int row, const int column) { return static_cast<unsigned int>(row * (row + 1) / 2 + column); };
+                for(int row = 0; row < segments; row++) {
+                    for(int column = 0; column <= row; column++) triangle.uFaces.push_back({microVertex(row, column), microVertex(row + 1, column), microVertex(row + 1, column + 1)});
+                    for(int column = 0; column < row; column++) triangle.uFaces.push_back({microVertex(row, column), microVertex(row + 1, column + 1), microVertex(row, column + 1)});
+                }
+                mesh.triangles.push_back(std::move(triangle));
+            }
+        }
+    }
+
+    return mesh;
+}
+
+//Removes the displacements of the micro-vertices left of x, for meshes with an exactly flat and a curved region. Base
+//triangles across x are partly flat.
+inline void flattenLeftOf(Mesh& mesh, const float x) {
+    for(Triangle& triangle : mesh.triangles) {
+        for(uVertex& microVertex : triangle.uVertices) {
+            if(microVertex.position.x < x) microVertex.displacement = glm::vec3(0.0f);
+        }
+    }
+}
+
+//Rays from random points above the bounds down onto random points of their bottom
+inline std::vector<RayDesc> downwardRays(const AABB& bounds, const size_t count) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> along(0.0f, 1.0f);
+    const glm::vec3 extent = bounds.maxPos - bounds.minPos;
+
+    std::vector<RayDesc> rays;
+    for(size_t i = 0; i < count; i++) {
+        const glm::vec3 origin(bounds.minPos.x + along(rng) * extent.x, bounds.minPos.y + along(rng) * extent.y, bounds.maxPos.z + 1.0f);
+        const glm::vec3 target(bounds.minPos.x + along(rng) * extent.x, bounds.minPos.y + along(rng) * extent.y, bounds.minPos.z);
+        rays.push_back({origin, 0.0f, glm::normalize(target - origin), std::numeric_limits<float>::infinity()});
+    }
+
+    return rays;
+}
+
+//The closest hit of every ray, with a primitive index of -1 for misses
+inline std::vector<HitInfo> traceAll(const CPUScene& scene, const std::vector<RayDesc>& rays) {
+    TraversalArena arena(scene.getMesh().maxSubdivisionLevel);
+    TraversalStats stats;
+
+    std::vector<HitInfo> hits(rays.size());
+    for(size_t i = 0; i < rays.size(); i++) {
+        if(!scene.traceRay(rays[i], hits[i], stats, arena)) hits[i].primitiveIndex = static_cast<unsigned int>(-1);
+    }
+
+    return hits;
+}
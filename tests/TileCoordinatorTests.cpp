@@ -0,0 +1,246 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <json.hpp>
+DISABLE_WARNINGS_POP()
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CameraPath.h"
+#include "CPURenderer.h"
+#include "CPUScene.h"
+#include "RenderDaemon.h"
+#include "Socket.h"
+#include "TestUtils.h"
+#include "TileCoordinator.h"
+
+static std::filesystem::path temporaryPath(const std::string& extension) {
+    return std::filesystem::temp_directory_path() / ("cpu_rt_tests_" + std::to_string(std::random_device{}()) + extension);
+}
+
+//Bakes the grid mesh whatever the file is, the daemons only hash its content
+static SceneCache::Loaded loadGrid(const std::filesystem::path&, std::uint64_t) {
+    auto scene = std::make_unique<CPUScene>(BakedMesh::bake(gridMesh(4, 3)));
+    const size_t bytes = scene->getMesh().sizeInBytes();
+    return {std::move(scene), bytes};
+}
+
+static RenderDaemon::Options daemonOptions(const std::string& address) {
+    RenderDaemon::Options options;
+    options.address = address;
+    options.threadCount = 2;
+    return options;
+}
+
+//A RenderDaemon listening on a temporary Unix domain socket, shut down by a request when it goes out of scope
+class TestDaemon {
+public:
+    TestDaemon(): address(temporaryPath(".sock").string()), daemon(loadGrid, daemonOptions(address)) {
+        thread = std::thread([this] { daemon.run(); });
+
+        //run() listens on a thread of its own, so wait until it does
+        for(int attempt = 0;; attempt++) {
+            try {
+                (void)Socket::connect(address);
+                return;
+            } catch(const std::runtime_error&) {
+                if(attempt == 500) throw;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    }
+
+    ~TestDaemon() {
+        Socket connection = Socket::connect(address);
+        std::string response;
+        (void)connection.sendAll("{\"type\": \"shutdown\"}\n");
+        (void)connection.readLine(response);
+        connection = Socket();
+        thread.join();
+    }
+
+    const std::string address;
+
+private:
+    RenderDaemon daemon;
+    std::thread thread;
+};
+
+//A frame of the grid mesh from a fixed camera, and the same frame rendered in this process as 8-bit RGB
+static TileCoordinator::Frame gridFrame(const std::filesystem::path& meshFile, std::vector<uint8_t>& expected) {
+    TileCoordinator::Frame frame;
+    frame.mesh = meshFile;
+    frame.resolution = {96, 64};
+
+    //The field of view goes through degrees in the request, see RenderDaemon
+    CameraPath path;
+    path.resolution = frame.resolution;
+    path.fovy = glm::radians(glm::degrees(frame.fovy));
+    const CPUScene scene(BakedMesh::bake(gridMesh(4, 3)));
+    frame.camera = path.frameBounds(scene.bounds(), 0.7f);
+
+    std::vector<glm::vec3> pixels;
+    (void)CPURenderer(scene, 2).render(glm::inverse(path.projectionMatrix() * CameraPath::viewMatrix(*frame.camera)), path.resolution, pixels);
+    expected = CPURenderer::toRGB8(pixels);
+
+    return frame;
+}
+
+TEST_CASE("Tiles rendered on several daemons assemble the frame of a local render") {
+    const std::filesystem::path meshFile = temporaryPath(".mesh");
+    std::ofstream(meshFile) << "grid";
+    std::vector<uint8_t> expected;
+    const TileCoordinator::Frame frame = gridFrame(meshFile, expected);
+
+    {
+        TestDaemon daemons[3];
+        TileCoordinator coordinator({daemons[0].address, daemons[1].address, daemons[2].address}, {16, 3.0f, 2});
+
+        //The second frame finds the scene in the caches of the daemons and the connections still open
+        for(int i = 0; i < 2; i++) {
+            std::vector<uint8_t> rgb;
+            const DistributedFrameStats stats = coordinator.render(frame, rgb);
+
+            INFO("Frame " << i);
+            CHECK(rgb == expected);
+            CHECK(stats.tiles == 24);
+            CHECK(std::accumulate(stats.tilesPerWorker.begin(), stats.tilesPerWorker.end(), size_t(0)) == stats.tiles);
+            CHECK(stats.failedWorkers.empty());
+        }
+    }
+
+    //Without a daemon to reach there is no frame
+    TileCoordinator unreachable({temporaryPath(".sock").string()}, {});
+    std::vector<uint8_t> rgb;
+    CHECK_THROWS_AS(unreachable.render(frame, rgb), std::runtime_error);
+
+    std::filesystem::remove(meshFile);
+}
+
+/**
+ * Workers whose answers are held back or that break off, scripted so that a frame goes through every path of the
+ * coordinator: two workers hold their first tile until a third has answered a copy of it, and one disconnects on its
+ * second tile. Every request is answered by a RenderDaemon that is not listening itself.
+ */
+class ScriptedWorkers {
+public:
+    enum class Role {
+        FAST, //Answers right away, but once it answered a copy of a held tile, holds its next request until a holder took another tile
+        HOLDER, //Holds its first tile until the fast worker answered a copy of it and took another tile, or another holder did
+        DOOMED //Answers its first tile and disconnects on the second
+    };
+
+    explicit ScriptedWorkers(const std::vector<Role>& roles): daemon(loadGrid, daemonOptions(temporaryPath(".sock").string())) {
+        for(size_t i = 0; i < roles.size(); i++) {
+            addresses.push_back(temporaryPath(".sock").string());
+            listeners.push_back(Socket::listen(addresses.back()));
+        }
+        for(size_t i = 0; i < roles.size(); i++) threads.emplace_back(&ScriptedWorkers::serve, this, roles[i], i);
+    }
+
+    ~ScriptedWorkers() {
+        release();
+        //The coordinator closed its connections, or never connected
+        for(const Socket& listener : listeners) Socket::shutdown(listener.handle());
+        for(std::thread& thread : threads) thread.join();
+        for(const std::string& address : addresses) std::filesystem::remove(address);
+    }
+
+    //Lets every held tile go, once the frame is done
+    void release() {
+        std::scoped_lock lock(mutex);
+        frameDone = true;
+        changed.notify_all();
+    }
+
+    std::vector<std::string> addresses;
+
+private:
+    RenderDaemon daemon;
+    std::vector<Socket> listeners;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::set<int> heldTiles;
+    int fastCopy = -1; //The first held tile that the fast worker answered a copy of
+    bool fastTookAnother = false; //The fast worker took a tile after that copy
+    bool holderTookAnother = false; //A holder took a tile after it let its held one go
+    bool frameDone = false;
+
+    //Waits for the script, but never for longer than a broken script would take to show
+    void waitUntil(std::unique_lock<std::mutex>& lock, const std::function<bool()>& condition) {
+        changed.wait_for(lock, std::chrono::seconds(30), [&] { return frameDone || condition(); });
+    }
+
+    void serve(const Role role, const size_t index) {
+        Socket connection = listeners[index].accept();
+        std::string line;
+        for(int request = 0; connection.readLine(line); request++) {
+            const int tile = nlohmann::json::parse(line).value("id", -1);
+            {
+                std::unique_lock lock(mutex);
+                if(role == Role::DOOMED && request == 1) return;
+                if(role == Role::HOLDER && request == 0) {
+                    heldTiles.insert(tile);
+                    waitUntil(lock, [&] { return (fastCopy == tile && fastTookAnother) || holderTookAnother; });
+                } else if(role == Role::HOLDER) {
+                    holderTookAnother = true;
+                    changed.notify_all();
+                } else if(role == Role::FAST && fastCopy >= 0) {
+                    fastTookAnother = true;
+                    changed.notify_all();
+                    waitUntil(lock, [&] { return holderTookAnother; });
+                }
+            }
+
+            if(!connection.sendAll(daemon.handle(line) + '\n')) return;
+
+            std::scoped_lock lock(mutex);
+            if(role == Role::FAST && fastCopy < 0 && heldTiles.contains(tile)) {
+                fastCopy = tile;
+                changed.notify_all();
+            }
+        }
+    }
+};
+
+TEST_CASE("Late tiles are copied and workers that break off are dropped without changing the frame") {
+    const std::filesystem::path meshFile = temporaryPath(".mesh");
+    std::ofstream(meshFile) << "grid";
+    std::vector<uint8_t> expected;
+    const TileCoordinator::Frame frame = gridFrame(meshFile, expected);
+
+    using Role = ScriptedWorkers::Role;
+    ScriptedWorkers workers({Role::DOOMED, Role::HOLDER, Role::HOLDER, Role::FAST});
+    //Tiles are late as soon as they take longer than average, and a third copy lets a holder take over the other held tile
+    TileCoordinator coordinator(workers.addresses, {16, 1.0f, 3});
+
+    std::vector<uint8_t> rgb;
+    const DistributedFrameStats stats = coordinator.render(frame, rgb);
+    workers.release();
+
+    CHECK(rgb == expected);
+    CHECK(std::accumulate(stats.tilesPerWorker.begin(), stats.tilesPerWorker.end(), size_t(0)) == stats.tiles);
+    //Both held tiles were copied, and the first one came back after its copy
+    CHECK(stats.reissuedTiles >= 2);
+    CHECK(stats.discardedTiles >= 1);
+    //Only the doomed worker failed, its tile went to the others
+    REQUIRE(stats.failedWorkers.size() == 1);
+    CHECK(stats.failedWorkers[0].starts_with(workers.addresses[0]));
+
+    std::filesystem::remove(meshFile);
+}